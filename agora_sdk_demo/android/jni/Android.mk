@@ -25,7 +25,7 @@ AGORA_FILE_LIST += $(wildcard $(LOCAL_PATH)/../../src/utils/file_parser/*.cpp)
 AGORA_FILE_LIST += $(wildcard $(LOCAL_PATH)/../../src/rtc/*.cpp)
 
 ## please add ignored files to the following.
-AGORA_IGNORE_FILE_LIST := %ogg_opus_file_parser.cpp
+AGORA_IGNORE_FILE_LIST := %ogg_opus_file_parser.cpp %ogg_opus_packet_parser.cpp
 
 LOCAL_SRC_FILES := $(filter-out $(AGORA_IGNORE_FILE_LIST),$(AGORA_FILE_LIST))
 LOCAL_SRC_FILES := $(LOCAL_SRC_FILES:$(LOCAL_PATH)/%=%)
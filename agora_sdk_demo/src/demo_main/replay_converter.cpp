@@ -0,0 +1,79 @@
+//  Agora RTC/MEDIA SDK
+//
+//  Copyright (c) 2020 Agora.io. All rights reserved.
+//
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <string>
+
+#include "wrapper/replay_file_converter.h"
+
+namespace {
+
+void PrintUsage(const char* program) {
+  printf("Usage: %s -t <type> -i <input> [-o <output>]\n", program);
+  printf("  type: h264, h265, av1, ivf, aac, heaac, opus or wav\n");
+  printf("  The output defaults to <input>.replay, which the senders then play\n");
+  printf("  instead of parsing <input> for as long as <input> doesn't change.\n");
+}
+
+}  // namespace
+
+int main(int argc, char* argv[]) {
+  std::string type;
+  std::string input;
+  std::string output;
+  int ch = 0;
+  while ((ch = getopt(argc, argv, "t:i:o:")) != -1) {
+    switch (ch) {
+      case 't':
+        type = optarg;
+        break;
+      case 'i':
+        input = optarg;
+        break;
+      case 'o':
+        output = optarg;
+        break;
+      default:
+        PrintUsage(argv[0]);
+        return 1;
+    }
+  }
+  if (type.empty() || input.empty()) {
+    PrintUsage(argv[0]);
+    return 1;
+  }
+
+  bool converted = false;
+  if (type == "h264") {
+    converted = ConvertVideoToReplayFile(input.c_str(), VideoFileFormat::kH264AnnexB,
+                                         output.c_str());
+  } else if (type == "h265") {
+    converted = ConvertVideoToReplayFile(input.c_str(), VideoFileFormat::kH265AnnexB,
+                                         output.c_str());
+  } else if (type == "av1") {
+    converted = ConvertVideoToReplayFile(input.c_str(), VideoFileFormat::kAv1Obu, output.c_str());
+  } else if (type == "ivf") {
+    converted = ConvertVideoToReplayFile(input.c_str(), VideoFileFormat::kIvf, output.c_str());
+  } else if (type == "aac") {
+    converted = ConvertAudioToReplayFile(input.c_str(), AUDIO_FILE_TYPE::AUDIO_FILE_AACLC,
+                                         output.c_str());
+  } else if (type == "heaac") {
+    converted = ConvertAudioToReplayFile(input.c_str(), AUDIO_FILE_TYPE::AUDIO_FILE_HEAAC,
+                                         output.c_str());
+  } else if (type == "opus") {
+    converted = ConvertAudioToReplayFile(input.c_str(), AUDIO_FILE_TYPE::AUDIO_FILE_OPUS,
+                                         output.c_str());
+  } else if (type == "wav") {
+    converted = ConvertAudioToReplayFile(input.c_str(), AUDIO_FILE_TYPE::AUDIO_FILE_PCM,
+                                         output.c_str());
+  } else {
+    printf("Unknown type %s\n", type.c_str());
+    PrintUsage(argv[0]);
+    return 1;
+  }
+  return converted ? 0 : 1;
+}
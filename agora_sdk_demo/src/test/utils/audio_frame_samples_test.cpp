@@ -0,0 +1,208 @@
+//  Agora RTC/MEDIA SDK
+//
+//  Copyright (c) 2020 Agora.io. All rights reserved.
+//
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <algorithm>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "utils/file_parser/aac_file_parser.h"
+#include "utils/file_parser/audio_file_parser_factory.h"
+#if defined(__linux__) && !defined(__ANDROID__)
+#include "utils/file_parser/ogg_opus_packet_parser.h"
+#endif
+#include "utils/file_parser/prefetching_audio_file_parser.h"
+
+namespace {
+
+// Hands out |frames| frames of |i| + 1 bytes, frame |i| holding 100 * |i|
+// samples.
+class FakeAudioFileParser : public AudioFileParser {
+ public:
+  explicit FakeAudioFileParser(int frames) : frames_(frames) {}
+
+  bool open() override { return true; }
+  bool hasNext() override { return next_ < frames_; }
+  void getNext(char* buffer, int* length) override {
+    memset(buffer, next_, next_ + 1);
+    *length = next_ + 1;
+    samples_ = 100 * next_;
+    ++next_;
+  }
+  agora::rtc::AUDIO_CODEC_TYPE getCodecType() override { return agora::rtc::AUDIO_CODEC_OPUS; }
+  int getSampleRateHz() override { return 48000; }
+  int getNumberOfChannels() override { return 2; }
+  int getFrameSamples() override { return samples_; }
+
+ private:
+  int frames_;
+  int next_{0};
+  int samples_{0};
+};
+
+// Writes ADTS frames at the 24 kHz core rate, frame |i| holding |i| % 4 + 1
+// raw data blocks.
+std::string WriteAdtsFile(int frames) {
+  char path[256] = {0};
+  snprintf(path, sizeof(path), "/tmp/audio_frame_samples_test_%d.aac", getpid());
+  AacAudioConfig config = {2, 6, 2, 24000, false};
+  FILE* file = fopen(path, "wb");
+  for (int i = 0; i < frames; ++i) {
+    std::vector<uint8_t> payload(100 + i, 0x21);
+    uint8_t header[kAdtsHeaderSize];
+    WriteAdtsHeader(config, payload.size(), header);
+    header[6] = static_cast<uint8_t>((header[6] & 0xFC) | (i % 4));
+    fwrite(header, 1, sizeof(header), file);
+    fwrite(payload.data(), 1, payload.size(), file);
+  }
+  fclose(file);
+  return path;
+}
+
+}  // namespace
+
+class AudioFrameSamplesTest : public testing::Test {
+ public:
+  void SetUp() override {}
+
+  void TearDown() override {}
+};
+
+#if defined(__linux__) && !defined(__ANDROID__)
+TEST_F(AudioFrameSamplesTest, opus_packet_samples_follow_the_toc) {
+  struct {
+    std::vector<uint8_t> packet;
+    int samples;
+  } cases[] = {
+      // SILK 10, 20, 40 and 60 ms, one frame.
+      {{0 << 3}, 480},
+      {{1 << 3}, 960},
+      {{2 << 3}, 1920},
+      {{3 << 3}, 2880},
+      // Hybrid 10 and 20 ms.
+      {{12 << 3}, 480},
+      {{13 << 3}, 960},
+      // CELT 2.5, 5, 10 and 20 ms.
+      {{16 << 3}, 120},
+      {{17 << 3}, 240},
+      {{18 << 3}, 480},
+      {{31 << 3}, 960},
+      // Two frames, equal and different sizes.
+      {{31 << 3 | 1}, 1920},
+      {{1 << 3 | 2}, 1920},
+      // Code 3 with three 20 ms frames, and too many frames for 120 ms.
+      {{31 << 3 | 3, 3}, 2880},
+      {{31 << 3 | 3, 7}, 0},
+      // Code 3 without the frame count byte.
+      {{31 << 3 | 3}, 0},
+      {{}, 0},
+  };
+  for (const auto& c : cases) {
+    EXPECT_EQ(c.samples, OpusPacketSamples(c.packet.data(), c.packet.size()))
+        << (c.packet.empty() ? -1 : c.packet[0]);
+  }
+}
+#endif
+
+TEST_F(AudioFrameSamplesTest, aac_frame_samples_follow_the_header) {
+  EXPECT_EQ(48000, AacOutputSampleRate(24000, true));
+  EXPECT_EQ(44100, AacOutputSampleRate(22050, true));
+  EXPECT_EQ(48000, AacOutputSampleRate(48000, true));
+  EXPECT_EQ(24000, AacOutputSampleRate(24000, false));
+
+  const int kFrames = 12;
+  std::string path = WriteAdtsFile(kFrames);
+  AACFileParser lc(path.c_str());
+  HEAACFileParser he(path.c_str());
+  ASSERT_TRUE(lc.open());
+  ASSERT_TRUE(he.open());
+  EXPECT_EQ(24000, lc.getSampleRateHz());
+  EXPECT_EQ(48000, he.getSampleRateHz());
+  std::vector<char> buffer(8192);
+  for (int i = 0; i < kFrames; ++i) {
+    int length = static_cast<int>(buffer.size());
+    lc.getNext(buffer.data(), &length);
+    ASSERT_EQ(100 + i + static_cast<int>(kAdtsHeaderSize), length);
+    EXPECT_EQ(1024 * (i % 4 + 1), lc.getFrameSamples());
+    EXPECT_EQ(1024 * (i % 4 + 1), AdtsFrameSamples(reinterpret_cast<uint8_t*>(buffer.data()),
+                                                   false));
+    length = static_cast<int>(buffer.size());
+    he.getNext(buffer.data(), &length);
+    EXPECT_EQ(2048 * (i % 4 + 1), he.getFrameSamples());
+  }
+  EXPECT_FALSE(lc.hasNext());
+  unlink(path.c_str());
+}
+
+TEST_F(AudioFrameSamplesTest, prefetching_parser_keeps_frame_samples) {
+  const int kFrames = 50;
+  std::unique_ptr<AudioFileParser> fake(new FakeAudioFileParser(kFrames));
+  PrefetchingAudioFileParser parser(std::move(fake), 8);
+  ASSERT_TRUE(parser.open());
+  std::vector<char> buffer(1024);
+  for (int i = 0; i < kFrames; ++i) {
+    ASSERT_TRUE(parser.hasNext());
+    int length = static_cast<int>(buffer.size());
+    parser.getNext(buffer.data(), &length);
+    ASSERT_EQ(i + 1, length);
+    EXPECT_EQ(i, buffer[i]);
+    EXPECT_EQ(100 * i, parser.getFrameSamples());
+  }
+  EXPECT_FALSE(parser.hasNext());
+}
+
+TEST_F(AudioFrameSamplesTest, batches_keep_copied_frames_apart) {
+  const int kFrames = 10;
+  FakeAudioFileParser parser(kFrames);
+  ASSERT_FALSE(parser.viewsStayValid());
+  AudioFrameView frames[4];
+  int64_t samples = 0;
+  for (int i = 0; i < kFrames;) {
+    size_t count = parser.nextBatch(frames, 4);
+    ASSERT_EQ(std::min(4, kFrames - i), static_cast<int>(count));
+    for (size_t j = 0; j < count; ++j, ++i) {
+      // Every view of the batch still holds its own frame.
+      ASSERT_EQ(static_cast<size_t>(i + 1), frames[j].size);
+      EXPECT_EQ(i, frames[j].data[i]);
+      EXPECT_EQ(static_cast<uint32_t>(100 * i), frames[j].durationSamples);
+      EXPECT_EQ(samples * 1000000 / 48000, frames[j].ptsUs);
+      // The first frame has no samples and counts as 10 ms.
+      samples += i ? 100 * i : 480;
+    }
+  }
+  EXPECT_EQ(0u, parser.nextBatch(frames, 4));
+}
+
+TEST_F(AudioFrameSamplesTest, aac_views_point_into_the_file) {
+  const int kFrames = 8;
+  std::string path = WriteAdtsFile(kFrames);
+  AACFileParser parser(path.c_str());
+  ASSERT_TRUE(parser.open());
+  ASSERT_TRUE(parser.viewsStayValid());
+  AudioFrameView frames[kFrames];
+  ASSERT_EQ(static_cast<size_t>(kFrames), parser.nextBatch(frames, kFrames));
+  int64_t samples = 0;
+  for (int i = 0; i < kFrames; ++i) {
+    EXPECT_EQ(100 + i + kAdtsHeaderSize, frames[i].size);
+    EXPECT_EQ(0xFF, frames[i].data[0]);
+    EXPECT_EQ(static_cast<uint32_t>(1024 * (i % 4 + 1)), frames[i].durationSamples);
+    EXPECT_EQ(samples * 1000000 / 24000, frames[i].ptsUs);
+    samples += frames[i].durationSamples;
+    if (i > 0) {
+      EXPECT_EQ(frames[i - 1].data + frames[i - 1].size, frames[i].data);
+    }
+  }
+  AudioFrameView frame;
+  EXPECT_FALSE(parser.next(&frame));
+  parser.reset();
+  ASSERT_TRUE(parser.next(&frame));
+  EXPECT_EQ(0, frame.ptsUs);
+  unlink(path.c_str());
+}
@@ -0,0 +1,197 @@
+//  Agora RTC/MEDIA SDK
+//
+//  Copyright (c) 2020 Agora.io. All rights reserved.
+//
+
+#include <string.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "test/utils/test_file_writer.h"
+#include "utils/file_parser/av1_obu_file_parser.h"
+
+namespace {
+
+// Writes fields most significant bit first, as AV1 headers are read.
+class BitWriter {
+ public:
+  void write(uint32_t value, int bits) {
+    for (int i = bits - 1; i >= 0; --i) {
+      if (bitPos_ % 8 == 0) {
+        bytes_.push_back(0);
+      }
+      if ((value >> i) & 1) {
+        bytes_.back() |= static_cast<uint8_t>(0x80 >> (bitPos_ % 8));
+      }
+      ++bitPos_;
+    }
+  }
+
+  const Bytes& bytes() const { return bytes_; }
+
+ private:
+  Bytes bytes_;
+  size_t bitPos_{0};
+};
+
+// A 1280x720 sequence header, with timing_info of 30000 / 1001 fps if
+// |timing|.
+Bytes SequenceHeader(bool timing) {
+  BitWriter writer;
+  writer.write(0, 3);  // seq_profile
+  writer.write(0, 1);  // still_picture
+  writer.write(0, 1);  // reduced_still_picture_header
+  writer.write(timing ? 1 : 0, 1);
+  if (timing) {
+    writer.write(1001, 32);   // num_units_in_display_tick
+    writer.write(30000, 32);  // time_scale
+    writer.write(0, 1);       // equal_picture_interval
+    writer.write(0, 1);       // decoder_model_info_present_flag
+  }
+  writer.write(0, 1);   // initial_display_delay_present_flag
+  writer.write(0, 5);   // operating_points_cnt_minus_1
+  writer.write(0, 12);  // operating_point_idc[0]
+  writer.write(8, 5);   // seq_level_idx[0], above 7 so seq_tier[0] follows
+  writer.write(0, 1);
+  writer.write(10, 4);  // frame_width_bits_minus_1
+  writer.write(9, 4);   // frame_height_bits_minus_1
+  writer.write(1279, 11);
+  writer.write(719, 10);
+  writer.write(0, 7);  // The rest of the header, not parsed.
+  return writer.bytes();
+}
+
+// An OBU with obu_has_size_field, the extension header if |extension|.
+Bytes Obu(Av1ObuType type, const Bytes& payload, bool extension = false) {
+  Bytes obu = {static_cast<uint8_t>(type << 3 | (extension ? 0x04 : 0) | 0x02)};
+  if (extension) {
+    obu.push_back(0);
+  }
+  size_t size = payload.size();
+  do {
+    obu.push_back(static_cast<uint8_t>((size & 0x7F) | (size > 0x7F ? 0x80 : 0)));
+    size >>= 7;
+  } while (size > 0);
+  PutBytes(&obu, payload);
+  return obu;
+}
+
+// A frame OBU of |size| bytes whose header starts with show_existing_frame 0
+// and frame_type |frameType|.
+Bytes Frame(uint8_t frameType, size_t size) {
+  Bytes payload(size, 0x33);
+  payload[0] = static_cast<uint8_t>(frameType << 5);
+  return Obu(kAv1ObuFrame, payload);
+}
+
+const uint8_t kKeyFrame = 0;
+const uint8_t kInterFrame = 1;
+
+}  // namespace
+
+class Av1ObuFileParserTest : public testing::Test {
+ public:
+  void SetUp() override {}
+
+  void TearDown() override {}
+};
+
+TEST_F(Av1ObuFileParserTest, parses_sequence_headers) {
+  Bytes payload = SequenceHeader(true);
+  Av1SequenceHeader header;
+  ASSERT_TRUE(ParseAv1SequenceHeader(payload.data(), payload.size(), &header));
+  EXPECT_FALSE(header.reducedStillPictureHeader);
+  EXPECT_EQ(1280, header.maxFrameWidth);
+  EXPECT_EQ(720, header.maxFrameHeight);
+  EXPECT_EQ(1001u, header.numUnitsInDisplayTick);
+  EXPECT_EQ(30000u, header.timeScale);
+
+  payload = SequenceHeader(false);
+  ASSERT_TRUE(ParseAv1SequenceHeader(payload.data(), payload.size(), &header));
+  EXPECT_EQ(1280, header.maxFrameWidth);
+  EXPECT_EQ(720, header.maxFrameHeight);
+  EXPECT_EQ(0u, header.numUnitsInDisplayTick);
+  EXPECT_EQ(0u, header.timeScale);
+
+  // Still pictures: seq_level_idx[0] right behind the flags, 320x240.
+  BitWriter still;
+  still.write(0, 3);
+  still.write(1, 1);
+  still.write(1, 1);
+  still.write(4, 5);
+  still.write(8, 4);
+  still.write(7, 4);
+  still.write(319, 9);
+  still.write(239, 8);
+  ASSERT_TRUE(ParseAv1SequenceHeader(still.bytes().data(), still.bytes().size(), &header));
+  EXPECT_TRUE(header.reducedStillPictureHeader);
+  EXPECT_EQ(320, header.maxFrameWidth);
+  EXPECT_EQ(240, header.maxFrameHeight);
+
+  // Cut off inside the frame size.
+  payload = SequenceHeader(true);
+  EXPECT_FALSE(ParseAv1SequenceHeader(payload.data(), 13, &header));
+}
+
+TEST_F(Av1ObuFileParserTest, splits_temporal_units) {
+  const Bytes delimiter = Obu(kAv1ObuTemporalDelimiter, Bytes());
+  // A key frame too large for a one byte size, an inter frame behind an OBU
+  // with an extension header, a frame header showing an existing frame, and
+  // a key frame repeating the sequence header.
+  std::vector<Bytes> units(4, delimiter);
+  PutBytes(&units[0], Obu(kAv1ObuSequenceHeader, SequenceHeader(true)));
+  PutBytes(&units[0], Frame(kKeyFrame, 300));
+  PutBytes(&units[1], Obu(kAv1ObuPadding, Bytes(5, 0), true));
+  PutBytes(&units[1], Frame(kInterFrame, 50));
+  PutBytes(&units[2], Obu(kAv1ObuFrameHeader, Bytes{0x80}));
+  PutBytes(&units[3], Obu(kAv1ObuSequenceHeader, SequenceHeader(true)));
+  PutBytes(&units[3], Frame(kKeyFrame, 40));
+  Bytes file;
+  for (const Bytes& unit : units) {
+    PutBytes(&file, unit);
+  }
+  std::string path = WriteTempFile("av1_obu_file_parser_test", file);
+
+  Av1ObuFileParser parser(path.c_str());
+  ASSERT_TRUE(parser.open());
+  const bool keyFrames[] = {true, false, false, true};
+  for (int pass = 0; pass < 2; ++pass) {
+    const uint8_t* data = nullptr;
+    int length = 0;
+    bool keyFrame = false;
+    for (size_t i = 0; i < units.size(); ++i) {
+      ASSERT_TRUE(parser.hasNext());
+      ASSERT_TRUE(parser.getNextTemporalUnit(&data, &length, &keyFrame)) << "unit " << i;
+      ASSERT_EQ(static_cast<int>(units[i].size()), length) << "unit " << i;
+      EXPECT_EQ(0, memcmp(units[i].data(), data, length)) << "unit " << i;
+      EXPECT_EQ(keyFrames[i], keyFrame) << "unit " << i;
+    }
+    EXPECT_FALSE(parser.hasNext());
+    EXPECT_FALSE(parser.getNextTemporalUnit(&data, &length, &keyFrame));
+    ASSERT_TRUE(parser.hasSequenceHeader());
+    EXPECT_EQ(1280, parser.sequenceHeader().maxFrameWidth);
+    EXPECT_EQ(720, parser.sequenceHeader().maxFrameHeight);
+    EXPECT_EQ(30000u, parser.sequenceHeader().timeScale);
+    parser.reset();
+  }
+  unlink(path.c_str());
+}
+
+TEST_F(Av1ObuFileParserTest, frames_before_a_sequence_header_are_no_key_frames) {
+  Bytes unit = Obu(kAv1ObuTemporalDelimiter, Bytes());
+  PutBytes(&unit, Frame(kKeyFrame, 20));
+  Av1SequenceHeader header;
+  memset(&header, 0, sizeof(header));
+  bool hasSequenceHeader = false;
+  EXPECT_FALSE(IsAv1KeyTemporalUnit(unit.data(), unit.size(), &header, &hasSequenceHeader));
+  EXPECT_FALSE(hasSequenceHeader);
+
+  // A stream has to start with a temporal delimiter.
+  std::string path = WriteTempFile("av1_obu_file_parser_test", Frame(kKeyFrame, 20));
+  Av1ObuFileParser parser(path.c_str());
+  EXPECT_FALSE(parser.open());
+  unlink(path.c_str());
+}
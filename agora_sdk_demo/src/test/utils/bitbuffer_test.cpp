@@ -0,0 +1,204 @@
+//  Agora RTC/MEDIA SDK
+//
+//  Copyright (c) 2020 Agora.io. All rights reserved.
+//
+
+#include <stdio.h>
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "utils/bitbuffer.h"
+
+namespace {
+
+// Appends |bit_count| bits of |val| to |bits|, most significant first.
+void PutBits(std::vector<bool>* bits, uint64_t val, size_t bit_count) {
+  for (size_t i = bit_count; i > 0; --i) {
+    bits->push_back(((val >> (i - 1)) & 1) != 0);
+  }
+}
+
+void PutExponentialGolomb(std::vector<bool>* bits, uint32_t val) {
+  uint64_t x = static_cast<uint64_t>(val) + 1;
+  size_t bit_count = 0;
+  while ((x >> bit_count) > 1) {
+    ++bit_count;
+  }
+  PutBits(bits, 0, bit_count);
+  PutBits(bits, x, bit_count + 1);
+}
+
+std::vector<uint8_t> ToBytes(const std::vector<bool>& bits) {
+  std::vector<uint8_t> bytes((bits.size() + 7) / 8);
+  for (size_t i = 0; i < bits.size(); ++i) {
+    if (bits[i]) {
+      bytes[i / 8] |= 0x80 >> (i % 8);
+    }
+  }
+  return bytes;
+}
+
+// Exponential golomb values of the magnitudes slice headers carry, with the
+// occasional large one.
+std::vector<uint32_t> MakeGolombValues(size_t count, uint32_t seed) {
+  std::mt19937 random(seed);
+  std::vector<uint32_t> values(count);
+  for (size_t i = 0; i < count; ++i) {
+    uint32_t magnitude = random() % 100 < 95 ? 8 : 31;
+    values[i] = random() % (1u << (random() % magnitude));
+  }
+  return values;
+}
+
+// Bytes holding the exponential golomb codes of |values|.
+std::vector<uint8_t> EncodeGolombValues(const std::vector<uint32_t>& values) {
+  std::vector<bool> bits;
+  for (uint32_t value : values) {
+    PutExponentialGolomb(&bits, value);
+  }
+  return ToBytes(bits);
+}
+
+// Sums the first |count| exponential golomb values in |data|.
+template <typename Reader>
+uint64_t SumGolombValues(const std::vector<uint8_t>& data, size_t count) {
+  Reader reader(data.data(), data.size());
+  uint64_t sum = 0;
+  uint32_t val = 0;
+  for (size_t i = 0; i < count && reader.ReadExponentialGolomb(&val); ++i) {
+    sum += val;
+  }
+  return sum;
+}
+
+}  // namespace
+
+class BitBufferTest : public testing::Test {
+ public:
+  void SetUp() override {}
+
+  void TearDown() override {}
+};
+
+TEST_F(BitBufferTest, cached_reader_matches_bit_buffer) {
+  std::mt19937 random(7);
+  for (int round = 0; round < 200; ++round) {
+    std::vector<uint8_t> data(random() % 64);
+    for (uint8_t& byte : data) {
+      // Mostly zeros, so that long golomb codes show up.
+      byte = random() % 3 == 0 ? static_cast<uint8_t>(random()) : 0;
+    }
+    BitBuffer reference(data.data(), data.size());
+    CachedBitBuffer cached(data.data(), data.size());
+    for (int op = 0; op < 100; ++op) {
+      ASSERT_EQ(reference.RemainingBitCount(), cached.RemainingBitCount());
+      size_t expected_byte = 0, expected_bit = 0, byte = 0, bit = 0;
+      reference.GetCurrentOffset(&expected_byte, &expected_bit);
+      cached.GetCurrentOffset(&byte, &bit);
+      ASSERT_EQ(expected_byte, byte);
+      ASSERT_EQ(expected_bit, bit);
+
+      uint32_t expected = 0, val = 0;
+      switch (random() % 4) {
+        case 0: {
+          size_t bit_count = random() % 32 + 1;
+          ASSERT_EQ(reference.ReadBits(&expected, bit_count), cached.ReadBits(&val, bit_count));
+          ASSERT_EQ(expected, val);
+          break;
+        }
+        case 1: {
+          size_t bit_count = random() % 80;
+          ASSERT_EQ(reference.ConsumeBits(bit_count), cached.ConsumeBits(bit_count));
+          break;
+        }
+        case 2: {
+          // BitBuffer consumes the zeros of a code it fails on, so only
+          // compare codes that can be read.
+          bool ok = cached.ReadExponentialGolomb(&val);
+          if (ok) {
+            ASSERT_TRUE(reference.ReadExponentialGolomb(&expected));
+            ASSERT_EQ(expected, val);
+          } else {
+            reference.Seek(byte, bit);
+          }
+          break;
+        }
+        case 3: {
+          size_t seek_byte = data.empty() ? 0 : random() % data.size();
+          size_t seek_bit = random() % 8;
+          ASSERT_EQ(reference.Seek(seek_byte, seek_bit), cached.Seek(seek_byte, seek_bit));
+          break;
+        }
+      }
+    }
+  }
+}
+
+TEST_F(BitBufferTest, reads_exponential_golomb_values) {
+  std::vector<uint32_t> values = MakeGolombValues(10000, 3);
+  values.push_back(0xFFFFFFFE);
+  values.push_back(0);
+  std::vector<bool> bits;
+  for (size_t i = 0; i < values.size(); ++i) {
+    PutExponentialGolomb(&bits, values[i]);
+    // Signed values round trip through the unsigned mapping.
+    PutExponentialGolomb(&bits, i % 2 ? 2 * i - 1 : 2 * i);
+  }
+  std::vector<uint8_t> data = ToBytes(bits);
+
+  CachedBitBuffer reader(data.data(), data.size());
+  for (size_t i = 0; i < values.size(); ++i) {
+    uint32_t val = 0;
+    int32_t signed_val = 0;
+    ASSERT_TRUE(reader.ReadExponentialGolomb(&val)) << i;
+    ASSERT_EQ(values[i], val) << i;
+    ASSERT_TRUE(reader.ReadSignedExponentialGolomb(&signed_val)) << i;
+    ASSERT_EQ(i % 2 ? static_cast<int32_t>(i) : -static_cast<int32_t>(i), signed_val) << i;
+  }
+  EXPECT_LT(reader.RemainingBitCount(), 8u);
+
+  // 32 leading zeros don't fit a uint32_t and leave the offset alone.
+  std::vector<uint8_t> too_long = {0, 0, 0, 0, 0x80, 0, 0, 0, 0};
+  CachedBitBuffer long_reader(too_long.data(), too_long.size());
+  uint32_t val = 0;
+  EXPECT_FALSE(long_reader.ReadExponentialGolomb(&val));
+  EXPECT_EQ(too_long.size() * 8, long_reader.RemainingBitCount());
+}
+
+TEST_F(BitBufferTest, cached_reader_decodes_golomb_streams) {
+  const size_t kValues = 4096;
+  std::vector<uint32_t> values = MakeGolombValues(kValues, 11);
+  std::vector<uint8_t> data = EncodeGolombValues(values);
+  uint64_t expected = 0;
+  for (uint32_t value : values) {
+    expected += value;
+  }
+  EXPECT_EQ(expected, SumGolombValues<BitBuffer>(data, kValues));
+  EXPECT_EQ(expected, SumGolombValues<CachedBitBuffer>(data, kValues));
+}
+
+// Times both readers on 4M values, run it with
+// --gtest_also_run_disabled_tests.
+TEST_F(BitBufferTest, DISABLED_benchmark) {
+  const size_t kValues = 4 * 1024 * 1024;
+  const int kRounds = 4;
+  std::vector<uint8_t> data = EncodeGolombValues(MakeGolombValues(kValues, 11));
+
+  auto measure = [&](const char* name, uint64_t (*decode)(const std::vector<uint8_t>&, size_t)) {
+    uint64_t sum = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int round = 0; round < kRounds; ++round) {
+      sum += decode(data, kValues);
+    }
+    double seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("%-8s %7.1f M values/s\n", name, kValues * kRounds / seconds / 1e6);
+    return sum;
+  };
+
+  uint64_t expected = measure("legacy", SumGolombValues<BitBuffer>);
+  EXPECT_EQ(expected, measure("cached", SumGolombValues<CachedBitBuffer>));
+}
@@ -0,0 +1,170 @@
+//  Agora RTC/MEDIA SDK
+//
+//  Copyright (c) 2020 Agora.io. All rights reserved.
+//
+
+#include <stdio.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "test/utils/test_file_writer.h"
+#include "utils/file_parser/flv_demuxer.h"
+
+namespace {
+
+const uint8_t kSps[] = {0x67, 0x42, 0xC0, 0x1E};
+const uint8_t kPps[] = {0x68, 0xCE, 0x38, 0x80};
+
+Bytes Header() {
+  Bytes header = {'F', 'L', 'V', 1, 0x05, 0, 0, 0, 9};
+  // PreviousTagSize0
+  Put32(&header, 0);
+  return header;
+}
+
+void AppendTag(Bytes* file, uint8_t type, uint32_t timestampMs, const Bytes& data) {
+  Bytes tag = {type};
+  Put24(&tag, static_cast<uint32_t>(data.size()));
+  Put24(&tag, timestampMs & 0xFFFFFF);
+  tag.push_back(static_cast<uint8_t>(timestampMs >> 24));
+  Put24(&tag, 0);
+  tag.insert(tag.end(), data.begin(), data.end());
+  Put32(&tag, static_cast<uint32_t>(tag.size()));
+  file->insert(file->end(), tag.begin(), tag.end());
+}
+
+Bytes AvcSequenceHeader() {
+  Bytes tag = {0x17, 0, 0, 0, 0, 1, 0x42, 0xC0, 0x1E, 0xFF, 0xE1, 0, sizeof(kSps)};
+  tag.insert(tag.end(), kSps, kSps + sizeof(kSps));
+  tag.push_back(1);
+  tag.push_back(0);
+  tag.push_back(sizeof(kPps));
+  tag.insert(tag.end(), kPps, kPps + sizeof(kPps));
+  return tag;
+}
+
+// One NAL unit of |size| bytes of |fill|.
+Bytes AvcNalu(bool key, int32_t compositionTimeMs, size_t size, uint8_t fill) {
+  Bytes tag = {static_cast<uint8_t>(key ? 0x17 : 0x27), 1};
+  Put24(&tag, static_cast<uint32_t>(compositionTimeMs) & 0xFFFFFF);
+  Put32(&tag, static_cast<uint32_t>(size));
+  tag.push_back(static_cast<uint8_t>(key ? 0x65 : 0x41));
+  tag.resize(tag.size() + size - 1, fill);
+  return tag;
+}
+
+Bytes ExpectedAnnexB(bool key, size_t size, uint8_t fill) {
+  Bytes expected;
+  if (key) {
+    expected = {0, 0, 0, 1};
+    expected.insert(expected.end(), kSps, kSps + sizeof(kSps));
+    expected.insert(expected.end(), {0, 0, 0, 1});
+    expected.insert(expected.end(), kPps, kPps + sizeof(kPps));
+  }
+  expected.insert(expected.end(), {0, 0, 0, 1, static_cast<uint8_t>(key ? 0x65 : 0x41)});
+  expected.resize(expected.size() + size - 1, fill);
+  return expected;
+}
+
+// AAC LC, 44100 Hz, stereo.
+Bytes AacSequenceHeader() { return Bytes{0xAF, 0, 0x12, 0x10}; }
+
+Bytes AacRaw(size_t size, uint8_t fill) {
+  Bytes tag = {0xAF, 1};
+  tag.resize(2 + size, fill);
+  return tag;
+}
+
+}  // namespace
+
+class FlvDemuxerTest : public testing::Test {
+ public:
+  void SetUp() override {}
+
+  void TearDown() override {}
+};
+
+TEST_F(FlvDemuxerTest, converts_tags) {
+  Bytes file = Header();
+  // Script data first, as recorders write onMetaData.
+  AppendTag(&file, 18, 0, Bytes(30, 0x02));
+  AppendTag(&file, 9, 0, AvcSequenceHeader());
+  AppendTag(&file, 8, 0, AacSequenceHeader());
+  AppendTag(&file, 9, 0, AvcNalu(true, 66, 100, 1));
+  AppendTag(&file, 8, 5, AacRaw(50, 0xA1));
+  AppendTag(&file, 9, 33, AvcNalu(false, -33, 80, 2));
+  // Past the 24 bit timestamp, in the extension byte.
+  AppendTag(&file, 8, 0x1000010, AacRaw(60, 0xA2));
+  std::string path = WriteTempFile("flv_demuxer_test", file);
+
+  FlvDemuxer demuxer(path.c_str());
+  ASSERT_TRUE(demuxer.open());
+  ASSERT_EQ(2u, demuxer.tracks().size());
+  EXPECT_EQ(agora::rtc::VIDEO_CODEC_H264, demuxer.tracks()[0].videoCodec);
+  EXPECT_EQ(agora::rtc::AUDIO_CODEC_AACLC, demuxer.tracks()[1].audioCodec);
+  EXPECT_EQ(44100, demuxer.tracks()[1].sampleRateHz);
+  EXPECT_EQ(2, demuxer.tracks()[1].numberOfChannels);
+
+  for (int round = 0; round < 2; ++round) {
+    ContainerSample sample;
+    ASSERT_TRUE(demuxer.getNext(&sample));
+    EXPECT_EQ(0, sample.track);
+    EXPECT_TRUE(sample.keyFrame);
+    EXPECT_EQ(0, sample.dtsUs);
+    EXPECT_EQ(66000, sample.ptsUs);
+    EXPECT_EQ(ExpectedAnnexB(true, 100, 1), Bytes(sample.data, sample.data + sample.length));
+
+    ASSERT_TRUE(demuxer.getNext(&sample));
+    EXPECT_EQ(1, sample.track);
+    EXPECT_EQ(5000, sample.dtsUs);
+    ASSERT_EQ(57, sample.length);
+    EXPECT_EQ(0xFF, sample.data[0]);
+    EXPECT_EQ(Bytes(50, 0xA1), Bytes(sample.data + 7, sample.data + sample.length));
+
+    ASSERT_TRUE(demuxer.getNext(&sample));
+    EXPECT_EQ(0, sample.track);
+    EXPECT_FALSE(sample.keyFrame);
+    EXPECT_EQ(33000, sample.dtsUs);
+    EXPECT_EQ(0, sample.ptsUs);
+    EXPECT_EQ(ExpectedAnnexB(false, 80, 2), Bytes(sample.data, sample.data + sample.length));
+
+    ASSERT_TRUE(demuxer.getNext(&sample));
+    EXPECT_EQ(1, sample.track);
+    EXPECT_EQ(0x1000010 * 1000ll, sample.dtsUs);
+
+    EXPECT_FALSE(demuxer.getNext(&sample));
+    EXPECT_EQ(0, demuxer.reset());
+  }
+  unlink(path.c_str());
+}
+
+TEST_F(FlvDemuxerTest, streams_files_larger_than_the_buffer) {
+  // About 20 MB of video in tags of up to 1 MB, and one tag too large to
+  // buffer.
+  const int kTags = 40;
+  Bytes file = Header();
+  AppendTag(&file, 9, 0, AvcSequenceHeader());
+  for (int i = 0; i < kTags; ++i) {
+    size_t size = i == 20 ? 5 * 1024 * 1024 : 1000 + i * 25000;
+    AppendTag(&file, 9, i * 40, AvcNalu(i % 10 == 0, 0, size, static_cast<uint8_t>(i)));
+  }
+  std::string path = WriteTempFile("flv_demuxer_test", file);
+
+  FlvDemuxer demuxer(path.c_str());
+  ASSERT_TRUE(demuxer.open());
+  ASSERT_EQ(1u, demuxer.tracks().size());
+  int frames = 0;
+  ContainerSample sample;
+  while (demuxer.getNext(&sample)) {
+    int i = static_cast<int>(sample.dtsUs / 40000);
+    ASSERT_NE(20, i);
+    EXPECT_EQ(ExpectedAnnexB(i % 10 == 0, 1000 + i * 25000, static_cast<uint8_t>(i)),
+              Bytes(sample.data, sample.data + sample.length));
+    ++frames;
+  }
+  EXPECT_EQ(kTags - 1, frames);
+  unlink(path.c_str());
+}
@@ -0,0 +1,206 @@
+//  Agora RTC/MEDIA SDK
+//
+//  Copyright (c) 2020 Agora.io. All rights reserved.
+//
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "utils/file_parser/g711_file_parser.h"
+#include "utils/g711.h"
+#include "utils/wav_header.h"
+
+namespace {
+
+const SimdLevel kAllLevels[] = {SimdLevel::kScalar, SimdLevel::kSse2, SimdLevel::kAvx2};
+
+const G711Law kAllLaws[] = {G711Law::kMuLaw, G711Law::kALaw};
+
+// ulaw_compress() and alaw_compress() of the ITU-T G.191 software tools.
+uint8_t ReferenceCode(int16_t sample, G711Law law) {
+  if (law == G711Law::kMuLaw) {
+    int absno = sample < 0 ? ((~sample) >> 2) + 33 : (sample >> 2) + 33;
+    if (absno > 0x1FFF) {
+      absno = 0x1FFF;
+    }
+    int i = absno >> 6;
+    int segno = 1;
+    while (i != 0) {
+      segno++;
+      i >>= 1;
+    }
+    int highNibble = 0x0008 - segno;
+    int lowNibble = 0x000F - ((absno >> segno) & 0x000F);
+    int out = highNibble << 4 | lowNibble;
+    return static_cast<uint8_t>(sample >= 0 ? out | 0x0080 : out);
+  }
+  int ix = sample < 0 ? (~sample) >> 4 : sample >> 4;
+  if (ix > 15) {
+    int iexp = 1;
+    while (ix > 16 + 15) {
+      ix >>= 1;
+      iexp++;
+    }
+    ix -= 16;
+    ix += iexp << 4;
+  }
+  if (sample >= 0) {
+    ix |= 0x0080;
+  }
+  return static_cast<uint8_t>(ix ^ 0x0055);
+}
+
+std::vector<int16_t> AllSamples() {
+  std::vector<int16_t> samples;
+  for (int i = -32768; i <= 32767; ++i) {
+    samples.push_back(static_cast<int16_t>(i));
+  }
+  return samples;
+}
+
+// Writes a 16 bit WAV file of |frames| frames, every channel of every frame
+// holding the same values.
+std::string WriteWavFile(int sampleRateHz, const std::vector<int16_t>& frame, size_t frames) {
+  char path[256] = {0};
+  snprintf(path, sizeof(path), "/tmp/g711_test_%d.wav", getpid());
+  WavHeader header;
+  header.numberOfChannels = static_cast<int16_t>(frame.size());
+  header.sampleRateHz = sampleRateHz;
+  header.bytesPerSample = static_cast<int16_t>(2 * frame.size());
+  header.bytesPerSecond = sampleRateHz * header.bytesPerSample;
+  header.dataLength = static_cast<int32_t>(frames * header.bytesPerSample);
+  unsigned char bytes[44];
+  makeWAVHeader(bytes, header);
+  FILE* file = fopen(path, "wb");
+  fwrite(bytes, sizeof(bytes), 1, file);
+  for (size_t i = 0; i < frames; ++i) {
+    fwrite(frame.data(), sizeof(int16_t), frame.size(), file);
+  }
+  fclose(file);
+  return path;
+}
+
+}  // namespace
+
+class G711Test : public testing::Test {
+ public:
+  void SetUp() override {}
+
+  void TearDown() override {}
+};
+
+TEST_F(G711Test, encodes_every_sample_like_reference) {
+  const std::vector<int16_t> src = AllSamples();
+  for (G711Law law : kAllLaws) {
+    for (SimdLevel level : kAllLevels) {
+      std::vector<uint8_t> dst(src.size());
+      EncodeG711(src.data(), law, src.size(), dst.data(), level);
+      for (size_t i = 0; i < src.size(); ++i) {
+        ASSERT_EQ(ReferenceCode(src[i], law), dst[i])
+            << SimdLevelName(level) << " law " << static_cast<int>(law) << " sample " << src[i];
+      }
+    }
+  }
+}
+
+TEST_F(G711Test, vector_tails_stay_in_bounds) {
+  const std::vector<int16_t> src = AllSamples();
+  for (G711Law law : kAllLaws) {
+    for (SimdLevel level : kAllLevels) {
+      for (size_t samples = 0; samples <= 100; ++samples) {
+        // Windows around zero, across the lower segments of both laws.
+        const int16_t* in = src.data() + 32768 - 50 * 64 + samples * 61;
+        std::vector<uint8_t> dst(samples + 1, 0xAA);
+        EncodeG711(in, law, samples, dst.data(), level);
+        for (size_t i = 0; i < samples; ++i) {
+          ASSERT_EQ(ReferenceCode(in[i], law), dst[i])
+              << SimdLevelName(level) << " sample " << i << " of " << samples;
+        }
+        ASSERT_EQ(0xAA, dst[samples]) << "wrote past the end";
+      }
+    }
+  }
+}
+
+TEST_F(G711Test, decoded_codes_encode_to_themselves) {
+  std::vector<uint8_t> codes(256);
+  for (int i = 0; i < 256; ++i) {
+    codes[i] = static_cast<uint8_t>(i);
+  }
+  for (G711Law law : kAllLaws) {
+    std::vector<int16_t> samples(codes.size());
+    DecodeG711(codes.data(), law, codes.size(), samples.data());
+    std::vector<uint8_t> encoded(codes.size());
+    EncodeG711(samples.data(), law, samples.size(), encoded.data());
+    for (int i = 0; i < 256; ++i) {
+      // mu-law has a negative zero, which comes back positive.
+      if (law == G711Law::kMuLaw && i == 0x7F) {
+        EXPECT_EQ(0, samples[i]);
+        continue;
+      }
+      EXPECT_EQ(codes[i], encoded[i]) << "law " << static_cast<int>(law) << " code " << i;
+    }
+  }
+  // Full scale, G.711 tables 2a and 2b.
+  const uint8_t loud[] = {0x80, 0x00, 0xAA, 0x2A};
+  int16_t decoded[4];
+  DecodeG711(loud, G711Law::kMuLaw, 2, decoded);
+  EXPECT_EQ(32124, decoded[0]);
+  EXPECT_EQ(-32124, decoded[1]);
+  DecodeG711(loud + 2, G711Law::kALaw, 2, decoded);
+  EXPECT_EQ(32256, decoded[0]);
+  EXPECT_EQ(-32256, decoded[1]);
+}
+
+TEST_F(G711Test, decoding_stays_within_one_step) {
+  const std::vector<int16_t> src = AllSamples();
+  for (G711Law law : kAllLaws) {
+    std::vector<uint8_t> codes(src.size());
+    EncodeG711(src.data(), law, src.size(), codes.data());
+    std::vector<int16_t> decoded(src.size());
+    DecodeG711(codes.data(), law, codes.size(), decoded.data());
+    for (size_t i = 0; i < src.size(); ++i) {
+      // The largest step is 1024 in both laws, which also covers clipping
+      // beyond the top segment.
+      ASSERT_LE(abs(decoded[i] - src[i]), 1024)
+          << "law " << static_cast<int>(law) << " sample " << src[i];
+    }
+  }
+}
+
+TEST_F(G711Test, wav_file_goes_out_as_8_khz_mono) {
+  // 25 ms of 16 kHz stereo, which mixes down to 2000.
+  std::string path = WriteWavFile(16000, {1000, 3000}, 400);
+  G711FileParser parser(path.c_str(), G711Law::kALaw);
+  ASSERT_TRUE(parser.open());
+  EXPECT_EQ(agora::rtc::AUDIO_CODEC_PCMA, parser.getCodecType());
+  EXPECT_EQ(8000, parser.getSampleRateHz());
+  EXPECT_EQ(1, parser.getNumberOfChannels());
+
+  uint8_t loud = 0;
+  uint8_t silent = 0;
+  const int16_t levels[] = {2000, 0};
+  EncodeG711(levels, G711Law::kALaw, 1, &loud);
+  EncodeG711(levels + 1, G711Law::kALaw, 1, &silent);
+  for (int pass = 0; pass < 2; ++pass) {
+    AudioFrameView frame;
+    for (int i = 0; i < 3; ++i) {
+      ASSERT_TRUE(parser.next(&frame)) << "frame " << i;
+      ASSERT_EQ(80u, frame.size);
+      EXPECT_EQ(80u, frame.durationSamples);
+      EXPECT_EQ(i * 10000, frame.ptsUs);
+      // The last 5 ms are padded with silence.
+      for (size_t j = 0; j < frame.size; ++j) {
+        ASSERT_EQ(i == 2 && j >= 40 ? silent : loud, frame.data[j]) << "sample " << j;
+      }
+    }
+    EXPECT_FALSE(parser.next(&frame));
+    ASSERT_EQ(0, parser.reset());
+  }
+  unlink(path.c_str());
+}
@@ -0,0 +1,68 @@
+//  Agora RTC/MEDIA SDK
+//
+//  Copyright (c) 2020 Agora.io. All rights reserved.
+//
+
+#include <unistd.h>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "test/utils/test_file_writer.h"
+#include "utils/file_parser/h264_file_parser.h"
+
+namespace {
+
+Bytes Nalu(uint8_t header, size_t payloadSize) {
+  Bytes nalu = {0, 0, 0, 1, header};
+  nalu.resize(nalu.size() + payloadSize, 0x55);
+  return nalu;
+}
+
+}  // namespace
+
+class H264FileParserTest : public testing::Test {
+ public:
+  void SetUp() override {}
+
+  void TearDown() override {}
+};
+
+TEST_F(H264FileParserTest, reports_nal_units_larger_than_the_read_buffer) {
+  // An IDR slice of 600 KB between two small NAL units.
+  std::vector<Bytes> nalus = {Nalu(0x67, 10), Nalu(0x65, 600 * 1024), Nalu(0x41, 10)};
+  Bytes file;
+  for (const Bytes& nalu : nalus) {
+    PutBytes(&file, nalu);
+  }
+  std::string path = WriteTempFile("h264_file_parser_test", file);
+
+  for (bool useMmap : {true, false}) {
+    H264FileParser parser(path.c_str(), useMmap);
+    ASSERT_TRUE(parser.open());
+    std::vector<int> lengths;
+    const uint8_t* data = nullptr;
+    int length = 0;
+    while (parser.hasNext()) {
+      if (parser.getNext(&data, &length) && length > 0) {
+        lengths.push_back(length);
+      }
+    }
+    if (useMmap) {
+      EXPECT_FALSE(parser.overflowed());
+      ASSERT_EQ(nalus.size(), lengths.size());
+      for (size_t i = 0; i < nalus.size(); ++i) {
+        EXPECT_EQ(static_cast<int>(nalus[i].size()), lengths[i]) << "NAL unit " << i;
+      }
+    } else {
+      // The reads stop inside the large NAL unit, which comes out cut.
+      EXPECT_TRUE(parser.overflowed());
+      ASSERT_EQ(2u, lengths.size());
+      EXPECT_LT(lengths[1], static_cast<int>(nalus[1].size()));
+      ASSERT_EQ(0, parser.reset());
+      EXPECT_FALSE(parser.overflowed());
+    }
+  }
+  unlink(path.c_str());
+}
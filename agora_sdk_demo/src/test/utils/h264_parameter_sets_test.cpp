@@ -0,0 +1,238 @@
+//  Agora RTC/MEDIA SDK
+//
+//  Copyright (c) 2020 Agora.io. All rights reserved.
+//
+
+#include <stdint.h>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "utils/file_parser/h264_parameter_sets.h"
+
+namespace {
+
+class BitWriter {
+ public:
+  void put(uint64_t val, size_t bit_count) {
+    for (size_t i = bit_count; i > 0; --i) {
+      bits_.push_back(((val >> (i - 1)) & 1) != 0);
+    }
+  }
+
+  void putUe(uint32_t val) {
+    uint64_t x = static_cast<uint64_t>(val) + 1;
+    size_t bit_count = 0;
+    while ((x >> bit_count) > 1) {
+      ++bit_count;
+    }
+    put(0, bit_count);
+    put(x, bit_count + 1);
+  }
+
+  void putSe(int32_t val) { putUe(val > 0 ? 2 * val - 1 : -2 * val); }
+
+  // Adds the rbsp_trailing_bits and returns the NAL unit with |header|, start
+  // code and emulation prevention bytes.
+  std::vector<uint8_t> nalu(uint8_t header) {
+    put(1, 1);
+    while (bits_.size() % 8) {
+      put(0, 1);
+    }
+    std::vector<uint8_t> out = {0, 0, 0, 1, header};
+    int zeros = 0;
+    for (size_t i = 0; i < bits_.size(); i += 8) {
+      uint8_t byte = 0;
+      for (size_t j = 0; j < 8; ++j) {
+        byte = byte << 1 | bits_[i + j];
+      }
+      if (zeros >= 2 && byte <= 3) {
+        out.push_back(3);
+        zeros = 0;
+      }
+      out.push_back(byte);
+      zeros = byte == 0 ? zeros + 1 : 0;
+    }
+    return out;
+  }
+
+ private:
+  std::vector<bool> bits_;
+};
+
+struct SpsParams {
+  uint8_t profileIdc;
+  uint32_t id;
+  uint32_t widthInMbs;
+  uint32_t heightInMapUnits;
+  bool frameMbsOnly;
+  uint32_t cropRight;
+  uint32_t cropBottom;
+  uint32_t numUnitsInTick;
+  uint32_t timeScale;
+};
+
+std::vector<uint8_t> MakeSps(const SpsParams& params) {
+  BitWriter writer;
+  writer.put(params.profileIdc, 8);
+  writer.put(0, 8);
+  writer.put(40, 8);
+  writer.putUe(params.id);
+  if (params.profileIdc == 100) {
+    writer.putUe(1);  // chroma_format_idc
+    writer.putUe(0);
+    writer.putUe(0);
+    writer.put(0, 1);
+    // A scaling matrix with one list, all zero deltas but the first.
+    writer.put(1, 1);
+    writer.put(1, 1);
+    writer.putSe(-8);
+    writer.put(0, 7);
+  }
+  writer.putUe(0);  // log2_max_frame_num_minus4
+  writer.putUe(1);  // pic_order_cnt_type
+  writer.put(0, 1);
+  writer.putSe(-2);
+  writer.putSe(0);
+  writer.putUe(2);
+  writer.putSe(1);
+  writer.putSe(-1);
+  writer.putUe(4);  // max_num_ref_frames
+  writer.put(0, 1);
+  writer.putUe(params.widthInMbs - 1);
+  writer.putUe(params.heightInMapUnits - 1);
+  writer.put(params.frameMbsOnly, 1);
+  if (!params.frameMbsOnly) {
+    writer.put(0, 1);
+  }
+  writer.put(1, 1);
+  bool cropping = params.cropRight || params.cropBottom;
+  writer.put(cropping, 1);
+  if (cropping) {
+    writer.putUe(0);
+    writer.putUe(params.cropRight);
+    writer.putUe(0);
+    writer.putUe(params.cropBottom);
+  }
+  bool timing = params.numUnitsInTick > 0;
+  writer.put(1, 1);  // vui_parameters_present_flag
+  writer.put(1, 1);  // aspect_ratio_info_present_flag, Extended_SAR
+  writer.put(255, 8);
+  writer.put(1, 16);
+  writer.put(1, 16);
+  writer.put(0, 1);
+  writer.put(1, 1);  // video_signal_type_present_flag
+  writer.put(5, 3);
+  writer.put(0, 1);
+  writer.put(1, 1);
+  writer.put(0x010101, 24);
+  writer.put(0, 1);
+  writer.put(timing, 1);
+  if (timing) {
+    writer.put(params.numUnitsInTick, 32);
+    writer.put(params.timeScale, 32);
+    writer.put(1, 1);
+  }
+  writer.put(0, 1);
+  writer.put(0, 1);
+  writer.put(0, 1);
+  writer.put(0, 1);
+  return writer.nalu(0x67);
+}
+
+std::vector<uint8_t> MakePps(uint32_t id, uint32_t spsId) {
+  BitWriter writer;
+  writer.putUe(id);
+  writer.putUe(spsId);
+  writer.put(1, 1);
+  writer.put(0, 1);
+  return writer.nalu(0x68);
+}
+
+void Append(std::vector<uint8_t>* data, const std::vector<uint8_t>& nalu) {
+  data->insert(data->end(), nalu.begin(), nalu.end());
+}
+
+}  // namespace
+
+class H264ParameterSetsTest : public testing::Test {
+ public:
+  void SetUp() override {}
+
+  void TearDown() override {}
+};
+
+TEST_F(H264ParameterSetsTest, parses_size_and_timing) {
+  // 1080p at 30000/1001 fps, coded as 1920x1088 and cropped.
+  std::vector<uint8_t> progressive = MakeSps({100, 0, 120, 68, true, 0, 4, 1001, 60000});
+  H264ParameterSets sets;
+  ASSERT_TRUE(sets.update(progressive.data(), progressive.size()));
+  const H264Sps* sps = sets.lastSps();
+  ASSERT_TRUE(sps != nullptr);
+  EXPECT_EQ(100, sps->profileIdc);
+  EXPECT_EQ(40, sps->levelIdc);
+  EXPECT_EQ(1u, sps->chromaFormatIdc);
+  EXPECT_EQ(1920, sps->width);
+  EXPECT_EQ(1080, sps->height);
+  EXPECT_TRUE(sps->fixedFrameRate);
+  uint32_t num = 0;
+  uint32_t den = 0;
+  ASSERT_TRUE(GetH264FrameRate(*sps, &num, &den));
+  EXPECT_EQ(60000u, num);
+  EXPECT_EQ(2002u, den);
+
+  // Interlaced 720x576 without timing, the crop unit doubles vertically.
+  std::vector<uint8_t> interlaced = MakeSps({77, 1, 45, 18, false, 0, 0, 0, 0});
+  ASSERT_TRUE(sets.update(interlaced.data(), interlaced.size()));
+  sps = sets.sps(1);
+  ASSERT_TRUE(sps != nullptr);
+  EXPECT_EQ(720, sps->width);
+  EXPECT_EQ(576, sps->height);
+  EXPECT_FALSE(GetH264FrameRate(*sps, &num, &den));
+
+  std::vector<uint8_t> cropped = MakeSps({66, 2, 80, 45, true, 4, 4, 1, 30});
+  ASSERT_TRUE(sets.update(cropped.data(), cropped.size()));
+  EXPECT_EQ(1272, sets.sps(2)->width);
+  EXPECT_EQ(712, sets.sps(2)->height);
+  ASSERT_TRUE(GetH264FrameRate(*sets.sps(2), &num, &den));
+  EXPECT_EQ(30u, num);
+  EXPECT_EQ(2u, den);
+}
+
+TEST_F(H264ParameterSetsTest, parses_each_set_once) {
+  std::vector<uint8_t> data;
+  std::vector<uint8_t> slice = {0, 0, 1, 0x65, 0x88, 0x84, 0x00};
+  for (int i = 0; i < 10; ++i) {
+    Append(&data, MakeSps({66, 0, 40, 30, true, 0, 0, 1, 50}));
+    Append(&data, MakePps(0, 0));
+    Append(&data, MakePps(1, 0));
+    Append(&data, slice);
+  }
+  H264ParameterSets sets;
+  EXPECT_TRUE(sets.update(data.data(), data.size()));
+  EXPECT_EQ(3, sets.parseCount());
+  EXPECT_FALSE(sets.update(data.data(), data.size()));
+  EXPECT_EQ(3, sets.parseCount());
+
+  const H264Sps* sps = sets.activeSps(1);
+  ASSERT_TRUE(sps != nullptr);
+  EXPECT_EQ(640, sps->width);
+  EXPECT_EQ(480, sps->height);
+  EXPECT_TRUE(sets.activeSps(2) == nullptr);
+
+  // A changed SPS with the same id replaces the old one.
+  std::vector<uint8_t> changed = MakeSps({66, 0, 80, 45, true, 0, 0, 1, 50});
+  EXPECT_TRUE(sets.update(changed.data(), changed.size()));
+  EXPECT_EQ(4, sets.parseCount());
+  EXPECT_EQ(1280, sets.activeSps(1)->width);
+}
+
+TEST_F(H264ParameterSetsTest, rejects_truncated_sets) {
+  std::vector<uint8_t> sps = MakeSps({100, 0, 120, 68, true, 0, 4, 1001, 60000});
+  H264ParameterSets sets;
+  // Cut inside the frame size, the sets stay unknown.
+  EXPECT_FALSE(sets.update(sps.data(), 12));
+  EXPECT_TRUE(sets.lastSps() == nullptr);
+  EXPECT_FALSE(sets.update(sps.data(), 5));
+  EXPECT_TRUE(sets.lastSps() == nullptr);
+}
@@ -0,0 +1,91 @@
+//  Agora RTC/MEDIA SDK
+//
+//  Copyright (c) 2020 Agora.io. All rights reserved.
+//
+
+#include <string.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "test/utils/test_file_writer.h"
+#include "utils/file_parser/h265_file_parser.h"
+
+namespace {
+
+// A NAL unit of |type| behind a four or three byte start code. Slices get
+// first_slice_segment_in_pic_flag from |firstSlice|.
+Bytes Nalu(H265NaluType type, bool longStartCode, size_t payloadSize, bool firstSlice = false) {
+  Bytes nalu = {0, 0, 1};
+  if (longStartCode) {
+    nalu.insert(nalu.begin(), 0);
+  }
+  nalu.push_back(static_cast<uint8_t>(type << 1));
+  nalu.push_back(1);
+  nalu.push_back(firstSlice ? 0xD5 : 0x55);
+  nalu.resize(nalu.size() + payloadSize - 1, 0x55);
+  return nalu;
+}
+
+const H265NaluType kTrailR = static_cast<H265NaluType>(1);
+
+// Parameter sets with an IDR picture, a picture of two slices between a
+// prefix and a suffix SEI, and a single slice picture.
+std::vector<Bytes> AccessUnits() {
+  Bytes idr = Nalu(kH265Vps, true, 20);
+  PutBytes(&idr, Nalu(kH265Sps, true, 40));
+  PutBytes(&idr, Nalu(kH265Pps, true, 8));
+  PutBytes(&idr, Nalu(kH265IdrWRadl, true, 3000, true));
+
+  Bytes slices = Nalu(kH265PrefixSei, true, 12);
+  PutBytes(&slices, Nalu(kTrailR, true, 700, true));
+  PutBytes(&slices, Nalu(kTrailR, false, 600));
+  PutBytes(&slices, Nalu(kH265SuffixSei, false, 9));
+
+  Bytes single = Nalu(kTrailR, true, 500, true);
+  return {idr, slices, single};
+}
+
+}  // namespace
+
+class H265FileParserTest : public testing::Test {
+ public:
+  void SetUp() override {}
+
+  void TearDown() override {}
+};
+
+TEST_F(H265FileParserTest, splits_access_units) {
+  const std::vector<Bytes> accessUnits = AccessUnits();
+  Bytes file;
+  for (const Bytes& accessUnit : accessUnits) {
+    PutBytes(&file, accessUnit);
+  }
+  std::string path = WriteTempFile("h265_file_parser_test", file);
+
+  const bool irap[] = {true, false, false};
+  for (bool useMmap : {true, false}) {
+    H265FileParser parser(path.c_str(), useMmap);
+    ASSERT_TRUE(parser.open());
+    EXPECT_EQ(useMmap, parser.isMapped());
+    for (int pass = 0; pass < 2; ++pass) {
+      const uint8_t* data = nullptr;
+      int length = 0;
+      bool key = false;
+      for (size_t i = 0; i < accessUnits.size(); ++i) {
+        ASSERT_TRUE(parser.hasNext());
+        ASSERT_TRUE(parser.getNextAccessUnit(&data, &length, &key))
+            << "mmap " << useMmap << " access unit " << i;
+        ASSERT_EQ(static_cast<int>(accessUnits[i].size()), length)
+            << "mmap " << useMmap << " access unit " << i;
+        EXPECT_EQ(0, memcmp(accessUnits[i].data(), data, length));
+        EXPECT_EQ(irap[i], key) << "mmap " << useMmap << " access unit " << i;
+      }
+      EXPECT_FALSE(parser.getNextAccessUnit(&data, &length, &key));
+      ASSERT_EQ(0, parser.reset());
+    }
+  }
+  unlink(path.c_str());
+}
@@ -0,0 +1,283 @@
+//  Agora RTC/MEDIA SDK
+//
+//  Copyright (c) 2020 Agora.io. All rights reserved.
+//
+
+#include <stdint.h>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "utils/file_parser/h265_file_parser.h"
+#include "utils/file_parser/h265_parameter_sets.h"
+
+namespace {
+
+class BitWriter {
+ public:
+  void put(uint64_t val, size_t bit_count) {
+    for (size_t i = bit_count; i > 0; --i) {
+      bits_.push_back(((val >> (i - 1)) & 1) != 0);
+    }
+  }
+
+  void putUe(uint32_t val) {
+    uint64_t x = static_cast<uint64_t>(val) + 1;
+    size_t bit_count = 0;
+    while ((x >> bit_count) > 1) {
+      ++bit_count;
+    }
+    put(0, bit_count);
+    put(x, bit_count + 1);
+  }
+
+  void putSe(int32_t val) { putUe(val > 0 ? 2 * val - 1 : -2 * val); }
+
+  // Adds the rbsp_trailing_bits and returns the NAL unit of |type|, with
+  // start code and emulation prevention bytes.
+  std::vector<uint8_t> nalu(H265NaluType type) {
+    put(1, 1);
+    while (bits_.size() % 8) {
+      put(0, 1);
+    }
+    std::vector<uint8_t> out = {0, 0, 0, 1, static_cast<uint8_t>(type << 1), 1};
+    int zeros = 0;
+    for (size_t i = 0; i < bits_.size(); i += 8) {
+      uint8_t byte = 0;
+      for (size_t j = 0; j < 8; ++j) {
+        byte = byte << 1 | bits_[i + j];
+      }
+      if (zeros >= 2 && byte <= 3) {
+        out.push_back(3);
+        zeros = 0;
+      }
+      out.push_back(byte);
+      zeros = byte == 0 ? zeros + 1 : 0;
+    }
+    return out;
+  }
+
+ private:
+  std::vector<bool> bits_;
+};
+
+// profile_tier_level() of Main profile at level 3.1, with |subLayers| more
+// sub-layers that carry both their profile and level.
+void PutProfileTierLevel(BitWriter* writer, uint32_t subLayers) {
+  writer->put(1, 8);
+  writer->put(0x60000000, 32);
+  writer->put(0x900000000000ull, 48);
+  writer->put(93, 8);
+  for (uint32_t i = 0; i < subLayers; ++i) {
+    writer->put(3, 2);
+  }
+  if (subLayers > 0) {
+    writer->put(0, 2 * (8 - subLayers));
+  }
+  for (uint32_t i = 0; i < subLayers; ++i) {
+    writer->put(0x0160000000ull, 40);
+    writer->put(0, 48);
+    writer->put(90, 8);
+  }
+}
+
+// A 4:2:0 1920x1088 SPS cropped to 1080 lines, with a scaling list, PCM,
+// predicted short term reference picture sets, long term reference pictures
+// and VUI timing of 60000 / 1001 fps.
+std::vector<uint8_t> MakeFullSps() {
+  BitWriter writer;
+  writer.put(0, 4);
+  writer.put(1, 3);  // sps_max_sub_layers_minus1
+  writer.put(1, 1);
+  PutProfileTierLevel(&writer, 1);
+  writer.putUe(1);  // sps_seq_parameter_set_id
+  writer.putUe(1);  // chroma_format_idc
+  writer.putUe(1920);
+  writer.putUe(1088);
+  writer.put(1, 1);  // conformance_window_flag
+  writer.putUe(0);
+  writer.putUe(0);
+  writer.putUe(0);
+  writer.putUe(4);
+  writer.putUe(0);
+  writer.putUe(0);
+  writer.putUe(4);   // log2_max_pic_order_cnt_lsb_minus4
+  writer.put(1, 1);  // sps_sub_layer_ordering_info_present_flag
+  for (int i = 0; i < 2 * 3 + 6; ++i) {
+    writer.putUe(i % 3);
+  }
+  writer.put(1, 1);  // scaling_list_enabled_flag
+  writer.put(1, 1);
+  for (int sizeId = 0; sizeId < 4; ++sizeId) {
+    for (int matrixId = 0; matrixId < 6; matrixId += sizeId == 3 ? 3 : 1) {
+      bool explicitList = sizeId == 2 && matrixId == 1;
+      writer.put(explicitList, 1);
+      if (!explicitList) {
+        writer.putUe(0);
+        continue;
+      }
+      writer.putSe(8);
+      for (int i = 0; i < 64; ++i) {
+        writer.putSe(i % 2 ? -1 : 1);
+      }
+    }
+  }
+  writer.put(3, 2);
+  writer.put(1, 1);  // pcm_enabled_flag
+  writer.put(0x77, 8);
+  writer.putUe(0);
+  writer.putUe(1);
+  writer.put(0, 1);
+  writer.putUe(3);  // num_short_term_ref_pic_sets
+  // Two pictures before, one after.
+  writer.putUe(2);
+  writer.putUe(1);
+  for (int i = 0; i < 3; ++i) {
+    writer.putUe(i);
+    writer.put(1, 1);
+  }
+  // Predicted from the set before, three of its four deltas used.
+  writer.put(1, 1);
+  writer.put(0, 1);
+  writer.putUe(0);
+  writer.put(1, 1);
+  writer.put(0, 1);
+  writer.put(1, 1);
+  writer.put(0, 1);
+  writer.put(0, 1);
+  writer.put(1, 1);
+  // Predicted from that one, four flags again.
+  writer.put(1, 1);
+  writer.put(1, 1);
+  writer.putUe(1);
+  for (int i = 0; i < 4; ++i) {
+    writer.put(1, 1);
+  }
+  writer.put(1, 1);  // long_term_ref_pics_present_flag
+  writer.putUe(2);
+  writer.put(0x55, 8);
+  writer.put(1, 1);
+  writer.put(0xAA, 8);
+  writer.put(0, 1);
+  writer.put(3, 2);
+  writer.put(1, 1);  // vui_parameters_present_flag
+  writer.put(1, 1);
+  writer.put(255, 8);
+  writer.put(1, 16);
+  writer.put(1, 16);
+  writer.put(0, 1);
+  writer.put(1, 1);  // video_signal_type_present_flag
+  writer.put(5, 3);
+  writer.put(0, 1);
+  writer.put(1, 1);
+  writer.put(0x010101, 24);
+  writer.put(0, 1);
+  writer.put(0, 3);
+  writer.put(1, 1);  // default_display_window_flag
+  for (int i = 0; i < 4; ++i) {
+    writer.putUe(0);
+  }
+  writer.put(1, 1);  // vui_timing_info_present_flag
+  writer.put(1001, 32);
+  writer.put(60000, 32);
+  writer.put(0, 2);
+  writer.put(0, 2);
+  return writer.nalu(kH265Sps);
+}
+
+// A 4:0:0 SPS of 640x480 without anything optional.
+std::vector<uint8_t> MakeMinimalSps() {
+  BitWriter writer;
+  writer.put(0, 4);
+  writer.put(0, 3);
+  writer.put(1, 1);
+  PutProfileTierLevel(&writer, 0);
+  writer.putUe(0);
+  writer.putUe(0);
+  writer.putUe(640);
+  writer.putUe(480);
+  writer.put(0, 1);
+  writer.putUe(0);
+  writer.putUe(0);
+  writer.putUe(0);
+  writer.put(0, 1);
+  for (int i = 0; i < 3 + 6; ++i) {
+    writer.putUe(0);
+  }
+  writer.put(0, 1);
+  writer.put(0, 3);
+  writer.putUe(0);
+  writer.put(0, 1);
+  writer.put(0, 3);
+  return writer.nalu(kH265Sps);
+}
+
+void Append(std::vector<uint8_t>* data, const std::vector<uint8_t>& nalu) {
+  data->insert(data->end(), nalu.begin(), nalu.end());
+}
+
+}  // namespace
+
+class H265ParameterSetsTest : public testing::Test {
+ public:
+  void SetUp() override {}
+
+  void TearDown() override {}
+};
+
+TEST_F(H265ParameterSetsTest, parses_size_and_timing) {
+  std::vector<uint8_t> nalu = MakeFullSps();
+  H265Sps sps;
+  ASSERT_TRUE(FindH265Sps(nalu.data(), nalu.size(), &sps));
+  EXPECT_EQ(1u, sps.id);
+  EXPECT_EQ(1, sps.generalProfileIdc);
+  EXPECT_EQ(93, sps.generalLevelIdc);
+  EXPECT_EQ(1u, sps.chromaFormatIdc);
+  EXPECT_EQ(1920, sps.width);
+  EXPECT_EQ(1080, sps.height);
+  uint32_t num = 0;
+  uint32_t den = 0;
+  ASSERT_TRUE(GetH265FrameRate(sps, &num, &den));
+  EXPECT_EQ(60000u, num);
+  EXPECT_EQ(1001u, den);
+
+  nalu = MakeMinimalSps();
+  ASSERT_TRUE(FindH265Sps(nalu.data(), nalu.size(), &sps));
+  EXPECT_EQ(0u, sps.chromaFormatIdc);
+  EXPECT_EQ(640, sps.width);
+  EXPECT_EQ(480, sps.height);
+  EXPECT_FALSE(GetH265FrameRate(sps, &num, &den));
+}
+
+TEST_F(H265ParameterSetsTest, finds_the_sps_of_an_access_unit) {
+  std::vector<uint8_t> accessUnit = {0, 0, 0, 1, kH265Vps << 1, 1, 0x0C, 0x01};
+  Append(&accessUnit, MakeFullSps());
+  // A trailing zero before the next start code.
+  accessUnit.push_back(0);
+  Append(&accessUnit, {0, 0, 0, 1, kH265Pps << 1, 1, 0xC1, 0x62});
+  Append(&accessUnit, {0, 0, 1, kH265IdrWRadl << 1, 1, 0xAF, 0x08, 0x40});
+  H265Sps sps;
+  ASSERT_TRUE(FindH265Sps(accessUnit.data(), accessUnit.size(), &sps));
+  EXPECT_EQ(1920, sps.width);
+  EXPECT_EQ(1080, sps.height);
+  EXPECT_EQ(60000u, sps.timeScale);
+
+  std::vector<uint8_t> slices(accessUnit.end() - 16, accessUnit.end());
+  EXPECT_FALSE(FindH265Sps(slices.data(), slices.size(), &sps));
+}
+
+TEST_F(H265ParameterSetsTest, rejects_truncated_sets) {
+  std::vector<uint8_t> nalu = MakeFullSps();
+  H265Sps sps;
+  // Cut inside the profile and level, and right before the end of the
+  // conformance window.
+  EXPECT_FALSE(FindH265Sps(nalu.data(), 24, &sps));
+  EXPECT_FALSE(FindH265Sps(nalu.data(), 47, &sps));
+  // Cut inside the VUI, the size is known but the timing is not.
+  ASSERT_TRUE(FindH265Sps(nalu.data(), nalu.size() - 8, &sps));
+  EXPECT_EQ(1920, sps.width);
+  EXPECT_EQ(1080, sps.height);
+  uint32_t num = 0;
+  uint32_t den = 0;
+  EXPECT_FALSE(GetH265FrameRate(sps, &num, &den));
+}
@@ -0,0 +1,163 @@
+//  Agora RTC/MEDIA SDK
+//
+//  Copyright (c) 2020 Agora.io. All rights reserved.
+//
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "utils/file_parser/ivf_file_parser.h"
+
+namespace {
+
+// First bytes of VP9 uncompressed headers of profile 0: frame_marker,
+// profile bits, show_existing_frame, frame_type, show_frame.
+const uint8_t kVp9KeyShown = 0x82;
+const uint8_t kVp9InterShown = 0x86;
+const uint8_t kVp9InterHidden = 0x84;
+const uint8_t kVp9ShowExisting = 0x88;
+
+std::vector<uint8_t> Vp9Frame(uint8_t header, size_t size) {
+  std::vector<uint8_t> frame(size, 0x11);
+  frame[0] = header;
+  return frame;
+}
+
+// Bundles |frames| with a superframe index of two byte sizes.
+std::vector<uint8_t> Vp9Superframe(const std::vector<std::vector<uint8_t>>& frames) {
+  std::vector<uint8_t> data;
+  const uint8_t marker = static_cast<uint8_t>(0xC0 | (1 << 3) | (frames.size() - 1));
+  for (const auto& frame : frames) {
+    data.insert(data.end(), frame.begin(), frame.end());
+  }
+  data.push_back(marker);
+  for (const auto& frame : frames) {
+    data.push_back(static_cast<uint8_t>(frame.size()));
+    data.push_back(static_cast<uint8_t>(frame.size() >> 8));
+  }
+  data.push_back(marker);
+  return data;
+}
+
+// Writes a standard IVF file at 30 fps, frame |i| at timestamp |i|.
+std::string WriteIvfFile(uint32_t fourcc, const std::vector<std::vector<uint8_t>>& frames) {
+  char path[256] = {0};
+  snprintf(path, sizeof(path), "/tmp/ivf_file_parser_test_%d.ivf", getpid());
+  IvfFileHeader header;
+  memset(&header, 0, sizeof(header));
+  header.signature = IvfFourcc('D', 'K', 'I', 'F');
+  header.headerSize = sizeof(header);
+  header.fourcc = fourcc;
+  header.width = 1280;
+  header.height = 720;
+  header.timeBaseRate = 30;
+  header.timeBaseScale = 1;
+  header.frameCount = static_cast<uint32_t>(frames.size());
+  FILE* file = fopen(path, "wb");
+  fwrite(&header, sizeof(header), 1, file);
+  for (size_t i = 0; i < frames.size(); ++i) {
+    uint32_t length = static_cast<uint32_t>(frames[i].size());
+    uint64_t timestamp = i;
+    fwrite(&length, sizeof(length), 1, file);
+    fwrite(&timestamp, sizeof(timestamp), 1, file);
+    fwrite(frames[i].data(), 1, frames[i].size(), file);
+  }
+  fclose(file);
+  return path;
+}
+
+}  // namespace
+
+class IvfFileParserTest : public testing::Test {
+ public:
+  void SetUp() override {}
+
+  void TearDown() override {}
+};
+
+TEST_F(IvfFileParserTest, vp9_superframes_are_shown_if_any_frame_is) {
+  std::vector<std::vector<uint8_t>> frames = {
+      Vp9Frame(kVp9KeyShown, 3000),
+      // An alt-ref bundled with the frame shown next to it.
+      Vp9Superframe({Vp9Frame(kVp9InterHidden, 2000), Vp9Frame(kVp9InterShown, 300)}),
+      Vp9Frame(kVp9InterHidden, 1500),
+      Vp9Frame(kVp9ShowExisting, 1),
+      Vp9Frame(kVp9InterShown, 400),
+  };
+  std::string path = WriteIvfFile(IvfFourcc('V', 'P', '9', '0'), frames);
+  EXPECT_TRUE(IvfFileParser::IsIvfFile(path.c_str()));
+
+  IvfFileParser parser(path.c_str());
+  ASSERT_TRUE(parser.open());
+  EXPECT_EQ(1280, parser.header().width);
+  EXPECT_EQ(720, parser.header().height);
+  const bool keyFrames[] = {true, false, false, false, false};
+  const bool shown[] = {true, true, false, true, true};
+  uint64_t offset = sizeof(IvfFileHeader);
+  IvfFrame frame;
+  for (size_t i = 0; i < frames.size(); ++i) {
+    ASSERT_TRUE(parser.getNextFrame(&frame)) << "frame " << i;
+    offset += 12;
+    EXPECT_EQ(offset, frame.offset);
+    ASSERT_EQ(frames[i].size(), frame.size);
+    EXPECT_EQ(0, memcmp(frames[i].data(), frame.data, frame.size));
+    EXPECT_EQ(keyFrames[i], frame.keyFrame) << "frame " << i;
+    EXPECT_EQ(shown[i], frame.shown) << "frame " << i;
+    int64_t ptsUs = 0;
+    ASSERT_TRUE(parser.timestampToUs(frame.timestamp, &ptsUs));
+    EXPECT_EQ(static_cast<int64_t>(i) * 1000000 / 30, ptsUs);
+    offset += frame.size;
+  }
+  EXPECT_FALSE(parser.hasNext());
+  EXPECT_FALSE(parser.getNextFrame(&frame));
+
+  parser.reset();
+  ASSERT_TRUE(parser.getNextFrame(&frame));
+  EXPECT_TRUE(frame.keyFrame);
+  unlink(path.c_str());
+}
+
+TEST_F(IvfFileParserTest, superframe_index_must_fit_the_frame) {
+  std::vector<uint8_t> superframe =
+      Vp9Superframe({Vp9Frame(kVp9InterHidden, 100), Vp9Frame(kVp9InterShown, 50)});
+  uint32_t sizes[8];
+  ASSERT_EQ(2u, ParseVp9Superframe(superframe.data(), superframe.size(), sizes));
+  EXPECT_EQ(100u, sizes[0]);
+  EXPECT_EQ(50u, sizes[1]);
+
+  // Sizes beyond the data, and a marker without its twin in front.
+  superframe[superframe.size() - 4] = 0xFF;
+  EXPECT_EQ(0u, ParseVp9Superframe(superframe.data(), superframe.size(), sizes));
+  std::vector<uint8_t> plain = Vp9Frame(kVp9InterShown, 64);
+  plain.back() = 0xC0;
+  EXPECT_EQ(0u, ParseVp9Superframe(plain.data(), plain.size(), sizes));
+}
+
+TEST_F(IvfFileParserTest, vp8_hidden_frames_are_flagged) {
+  // The frame tag's show_frame bit, key frames have key_frame 0.
+  std::vector<std::vector<uint8_t>> frames = {
+      std::vector<uint8_t>(500, 0x10),
+      std::vector<uint8_t>(200, 0x01),
+      std::vector<uint8_t>(100, 0x11),
+  };
+  std::string path = WriteIvfFile(IvfFourcc('V', 'P', '8', '0'), frames);
+  IvfFileParser parser(path.c_str());
+  ASSERT_TRUE(parser.open());
+  IvfFrame frame;
+  ASSERT_TRUE(parser.getNextFrame(&frame));
+  EXPECT_TRUE(frame.keyFrame);
+  EXPECT_TRUE(frame.shown);
+  ASSERT_TRUE(parser.getNextFrame(&frame));
+  EXPECT_FALSE(frame.keyFrame);
+  EXPECT_FALSE(frame.shown);
+  ASSERT_TRUE(parser.getNextFrame(&frame));
+  EXPECT_FALSE(frame.keyFrame);
+  EXPECT_TRUE(frame.shown);
+  EXPECT_FALSE(parser.getNextFrame(&frame));
+  unlink(path.c_str());
+}
@@ -0,0 +1,225 @@
+//  Agora RTC/MEDIA SDK
+//
+//  Copyright (c) 2020 Agora.io. All rights reserved.
+//
+
+#include <fcntl.h>
+#include <stdio.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+#include <chrono>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "utils/file_parser/aac_file_parser.h"
+#include "utils/file_parser/h264_file_parser.h"
+#include "utils/live_stream_reader.h"
+
+namespace {
+
+std::string TestPath(const char* name) {
+  char path[256] = {0};
+  snprintf(path, sizeof(path), "/tmp/live_stream_reader_test_%d_%s", getpid(), name);
+  unlink(path);
+  return path;
+}
+
+// Writes |data| to |fd| in pieces of |piece| bytes with a pause in between,
+// the way an encoder hands over its output.
+void WriteSlowly(int fd, const std::vector<uint8_t>& data, size_t piece) {
+  for (size_t pos = 0; pos < data.size(); pos += piece) {
+    size_t bytes = std::min(piece, data.size() - pos);
+    ASSERT_EQ(static_cast<ssize_t>(bytes), write(fd, data.data() + pos, bytes));
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+}
+
+std::vector<uint8_t> CountingBytes(size_t size) {
+  std::vector<uint8_t> data(size);
+  for (size_t i = 0; i < size; ++i) {
+    data[i] = static_cast<uint8_t>(i % 251);
+  }
+  return data;
+}
+
+std::vector<uint8_t> AdtsFrames(int frames) {
+  AacAudioConfig config = {2, 3, 2, 48000, false};
+  std::vector<uint8_t> data;
+  for (int i = 0; i < frames; ++i) {
+    uint8_t header[kAdtsHeaderSize];
+    WriteAdtsHeader(config, 200 + i, header);
+    data.insert(data.end(), header, header + kAdtsHeaderSize);
+    // Sync words in the payload must not split frames.
+    data.insert(data.end(), 200 + i, i % 2 ? 0xFF : 0xF1);
+  }
+  return data;
+}
+
+void AppendNalu(std::vector<uint8_t>* data, uint8_t header, uint8_t first, size_t size) {
+  static const uint8_t kStartCode[] = {0, 0, 0, 1};
+  data->insert(data->end(), kStartCode, kStartCode + sizeof(kStartCode));
+  data->push_back(header);
+  data->push_back(first);
+  data->insert(data->end(), size, 0x55);
+}
+
+}  // namespace
+
+class LiveStreamReaderTest : public testing::Test {
+ public:
+  void SetUp() override {}
+
+  void TearDown() override {}
+};
+
+TEST_F(LiveStreamReaderTest, fifo_delivers_every_byte_as_written) {
+  std::string path = TestPath("fifo");
+  ASSERT_EQ(0, mkfifo(path.c_str(), 0600));
+  EXPECT_TRUE(LiveStreamReader::IsLivePath(path.c_str()));
+  EXPECT_TRUE(LiveStreamReader::IsLivePath("-"));
+
+  LiveStreamReader reader(path.c_str(), false);
+  ASSERT_TRUE(reader.open());
+  std::vector<uint8_t> data = CountingBytes(100000);
+  std::thread writer([&] {
+    int fd = open(path.c_str(), O_WRONLY);
+    WriteSlowly(fd, data, 777);
+    close(fd);
+  });
+  // A read returns what arrived instead of waiting for the whole buffer.
+  std::vector<uint8_t> received;
+  uint8_t buffer[4096];
+  size_t bytes = 0;
+  while ((bytes = reader.read(buffer, sizeof(buffer))) > 0) {
+    EXPECT_LE(bytes, 4096u);
+    received.insert(received.end(), buffer, buffer + bytes);
+  }
+  writer.join();
+  EXPECT_TRUE(reader.ended());
+  EXPECT_EQ(data, received);
+  EXPECT_EQ(data.size(), reader.bytesRead());
+  unlink(path.c_str());
+}
+
+TEST_F(LiveStreamReaderTest, follows_a_growing_file_until_idle) {
+  std::string path = TestPath("growing");
+  std::vector<uint8_t> data = CountingBytes(50000);
+  int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0600);
+  ASSERT_GE(fd, 0);
+  ASSERT_EQ(1000, write(fd, data.data(), 1000));
+  EXPECT_FALSE(LiveStreamReader::IsLivePath(path.c_str()));
+
+  LiveStreamReader reader(path.c_str(), true, 200);
+  ASSERT_TRUE(reader.open());
+  std::thread writer([&] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    WriteSlowly(fd, std::vector<uint8_t>(data.begin() + 1000, data.end()), 4999);
+  });
+  // Asks for more than the file holds at first.
+  ASSERT_TRUE(reader.require(data.size()));
+  EXPECT_TRUE(std::equal(data.begin(), data.end(), reader.data()));
+  reader.consume(data.size());
+  writer.join();
+
+  auto start = std::chrono::steady_clock::now();
+  EXPECT_FALSE(reader.require(1));
+  EXPECT_TRUE(reader.ended());
+  EXPECT_GE(std::chrono::steady_clock::now() - start, std::chrono::milliseconds(100));
+  close(fd);
+  unlink(path.c_str());
+}
+
+TEST_F(LiveStreamReaderTest, cancel_wakes_a_blocked_read) {
+  std::string path = TestPath("cancel");
+  ASSERT_EQ(0, mkfifo(path.c_str(), 0600));
+  LiveStreamReader reader(path.c_str(), false);
+  ASSERT_TRUE(reader.open());
+  // The writer is there but never writes.
+  int fd = open(path.c_str(), O_WRONLY);
+  std::thread canceller([&] {
+    std::this_thread::sleep_for(std::chrono::milliseconds(20));
+    reader.cancel();
+  });
+  uint8_t buffer[16];
+  EXPECT_EQ(0u, reader.read(buffer, sizeof(buffer)));
+  EXPECT_TRUE(reader.ended());
+  canceller.join();
+  close(fd);
+  unlink(path.c_str());
+}
+
+TEST_F(LiveStreamReaderTest, aac_frames_arrive_live) {
+  std::string path = TestPath("aac");
+  ASSERT_EQ(0, mkfifo(path.c_str(), 0600));
+  std::vector<uint8_t> data = AdtsFrames(50);
+  std::thread writer([&] {
+    int fd = open(path.c_str(), O_WRONLY);
+    WriteSlowly(fd, data, 101);
+    close(fd);
+  });
+
+  AACFileParser parser(path.c_str());
+  ASSERT_TRUE(parser.setLiveInput(false));
+  ASSERT_TRUE(parser.open());
+  EXPECT_FALSE(parser.viewsStayValid());
+  EXPECT_EQ(48000, parser.getSampleRateHz());
+  EXPECT_EQ(2, parser.getNumberOfChannels());
+  int frames = 0;
+  AudioFrameView view;
+  while (parser.next(&view)) {
+    ASSERT_EQ(kAdtsHeaderSize + 200 + frames, view.size) << "frame " << frames;
+    EXPECT_EQ(0xFF, view.data[0]);
+    EXPECT_EQ(1024u, view.durationSamples);
+    ++frames;
+  }
+  writer.join();
+  EXPECT_EQ(50, frames);
+  EXPECT_EQ(-1, parser.reset());
+  unlink(path.c_str());
+}
+
+TEST_F(LiveStreamReaderTest, h264_access_units_arrive_live) {
+  std::string path = TestPath("h264");
+  ASSERT_EQ(0, mkfifo(path.c_str(), 0600));
+  // SPS, PPS and an IDR of two slices, then three pictures of one slice.
+  // first_mb_in_slice 0 is the set top bit of the byte after the header.
+  std::vector<uint8_t> data;
+  AppendNalu(&data, 0x67, 0x42, 10);
+  AppendNalu(&data, 0x68, 0xCE, 3);
+  AppendNalu(&data, 0x65, 0x88, 5000);
+  AppendNalu(&data, 0x65, 0x20, 5000);
+  for (int i = 0; i < 3; ++i) {
+    AppendNalu(&data, 0x41, 0x9A, 3000 + i);
+  }
+  std::thread writer([&] {
+    int fd = open(path.c_str(), O_WRONLY);
+    WriteSlowly(fd, data, 1000);
+    close(fd);
+  });
+
+  H264FileParser parser(path.c_str(), false);
+  parser.setLiveInput(false);
+  ASSERT_TRUE(parser.open());
+  std::vector<int> lengths;
+  std::vector<bool> idrs;
+  const uint8_t* au = nullptr;
+  int length = 0;
+  bool idr = false;
+  while (parser.getNextAccessUnit(&au, &length, &idr)) {
+    lengths.push_back(length);
+    idrs.push_back(idr);
+  }
+  writer.join();
+  ASSERT_EQ(4u, lengths.size());
+  EXPECT_EQ(4 * 6 + 10 + 3 + 5000 + 5000, lengths[0]);
+  for (int i = 0; i < 3; ++i) {
+    EXPECT_EQ(4 + 2 + 3000 + i, lengths[i + 1]);
+  }
+  EXPECT_EQ(std::vector<bool>({true, false, false, false}), idrs);
+  EXPECT_EQ(-1, parser.reset());
+  unlink(path.c_str());
+}
@@ -0,0 +1,116 @@
+//  Agora RTC/MEDIA SDK
+//
+//  Copyright (c) 2020 Agora.io. All rights reserved.
+//
+
+#include <chrono>
+#include <thread>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "utils/media_file_source.h"
+
+namespace {
+
+// Frame |i| is |i| % 251 + 1 bytes, all of value |i|.
+class CountingReader {
+ public:
+  CountingReader(int frames, int delayEveryFrames)
+      : frames_(frames), delayEveryFrames_(delayEveryFrames), next_(0) {}
+
+  bool operator()(std::vector<uint8_t>* frame) {
+    if (next_ >= frames_) {
+      return false;
+    }
+    if (delayEveryFrames_ > 0 && next_ % delayEveryFrames_ == 0) {
+      std::this_thread::sleep_for(std::chrono::milliseconds(1));
+    }
+    frame->assign(next_ % 251 + 1, static_cast<uint8_t>(next_));
+    ++next_;
+    return true;
+  }
+
+  void rewind() { next_ = 0; }
+
+ private:
+  int frames_;
+  int delayEveryFrames_;
+  int next_;
+};
+
+void ExpectFrame(int i, const uint8_t* data, int length) {
+  ASSERT_EQ(i % 251 + 1, length) << "frame " << i;
+  for (int j = 0; j < length; ++j) {
+    ASSERT_EQ(static_cast<uint8_t>(i), data[j]) << "frame " << i;
+  }
+}
+
+}  // namespace
+
+class MediaFileSourceTest : public testing::Test {
+ public:
+  void SetUp() override {}
+
+  void TearDown() override {}
+};
+
+TEST_F(MediaFileSourceTest, delivers_every_frame_in_order) {
+  for (int delay : {0, 7}) {
+    CountingReader reader(2000, delay);
+    MediaFileSource source(std::ref(reader), 4);
+    EXPECT_EQ(4u, source.capacity());
+    source.start();
+    int frames = 0;
+    const uint8_t* data = nullptr;
+    int length = 0;
+    while (source.hasNext()) {
+      ASSERT_TRUE(source.next(&data, &length));
+      ExpectFrame(frames, data, length);
+      // The view must survive the producer running ahead.
+      if (frames % 100 == 0) {
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        ExpectFrame(frames, data, length);
+      }
+      ++frames;
+    }
+    EXPECT_EQ(2000, frames);
+    EXPECT_FALSE(source.next(&data, &length));
+    EXPECT_EQ(0, length);
+  }
+}
+
+TEST_F(MediaFileSourceTest, restarts_after_rewind) {
+  CountingReader reader(50, 0);
+  MediaFileSource source(std::ref(reader), 3);
+  EXPECT_FALSE(source.hasNext());
+  source.start();
+  const uint8_t* data = nullptr;
+  int length = 0;
+  for (int i = 0; i < 10; ++i) {
+    ASSERT_TRUE(source.next(&data, &length));
+    ExpectFrame(i, data, length);
+  }
+  // Frames read ahead are dropped, reading continues from the rewound file.
+  source.stop();
+  reader.rewind();
+  source.start();
+  int frames = 0;
+  while (source.next(&data, &length)) {
+    ExpectFrame(frames, data, length);
+    ++frames;
+  }
+  EXPECT_EQ(50, frames);
+}
+
+TEST_F(MediaFileSourceTest, stops_while_full) {
+  CountingReader reader(1000, 0);
+  MediaFileSource source(std::ref(reader), 8);
+  source.start();
+  const uint8_t* data = nullptr;
+  int length = 0;
+  ASSERT_TRUE(source.next(&data, &length));
+  std::this_thread::sleep_for(std::chrono::milliseconds(5));
+  source.stop();
+  EXPECT_FALSE(source.hasNext());
+}
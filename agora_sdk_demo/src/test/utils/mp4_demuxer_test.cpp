@@ -0,0 +1,342 @@
+//  Agora RTC/MEDIA SDK
+//
+//  Copyright (c) 2020 Agora.io. All rights reserved.
+//
+
+#include <stdio.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "test/utils/test_file_writer.h"
+#include "utils/file_parser/mp4_demuxer.h"
+
+namespace {
+
+Bytes Box(const char* type, const Bytes& payload) {
+  Bytes box;
+  Put32(&box, static_cast<uint32_t>(payload.size() + 8));
+  box.insert(box.end(), type, type + 4);
+  PutBytes(&box, payload);
+  return box;
+}
+
+Bytes FullBox(const char* type, uint32_t versionAndFlags, const Bytes& payload) {
+  Bytes body;
+  Put32(&body, versionAndFlags);
+  PutBytes(&body, payload);
+  return Box(type, body);
+}
+
+Bytes Table(uint32_t count, const std::vector<uint32_t>& values) {
+  Bytes table;
+  Put32(&table, count);
+  for (uint32_t value : values) {
+    Put32(&table, value);
+  }
+  return table;
+}
+
+const uint8_t kSps[] = {0x67, 0x42, 0xC0, 0x1E};
+const uint8_t kPps[] = {0x68, 0xCE, 0x38, 0x80};
+// AAC LC, 44100 Hz, stereo.
+const uint8_t kAudioSpecificConfig[] = {0x12, 0x10};
+
+Bytes AvcSampleEntry() {
+  Bytes avcC = {1, 0x42, 0xC0, 0x1E, 0xFF, 0xE1};
+  Put16(&avcC, sizeof(kSps));
+  avcC.insert(avcC.end(), kSps, kSps + sizeof(kSps));
+  avcC.push_back(1);
+  Put16(&avcC, sizeof(kPps));
+  avcC.insert(avcC.end(), kPps, kPps + sizeof(kPps));
+
+  Bytes entry(78, 0);
+  entry[7] = 1;
+  entry[24] = 320 >> 8;
+  entry[25] = 320 & 0xFF;
+  entry[27] = 240;
+  PutBytes(&entry, Box("avcC", avcC));
+  return Box("avc1", entry);
+}
+
+Bytes AacSampleEntry() {
+  Bytes esds;
+  Put32(&esds, 0);
+  Bytes decoderSpecificInfo = {0x05, sizeof(kAudioSpecificConfig)};
+  decoderSpecificInfo.insert(decoderSpecificInfo.end(), kAudioSpecificConfig,
+                             kAudioSpecificConfig + sizeof(kAudioSpecificConfig));
+  Bytes decoderConfig = {0x04, static_cast<uint8_t>(13 + decoderSpecificInfo.size()), 0x40,
+                         0x15};
+  decoderConfig.resize(decoderConfig.size() + 11, 0);
+  PutBytes(&decoderConfig, decoderSpecificInfo);
+  Bytes esDescriptor = {0x03, static_cast<uint8_t>(3 + decoderConfig.size()), 0, 1, 0};
+  PutBytes(&esDescriptor, decoderConfig);
+  PutBytes(&esds, esDescriptor);
+
+  Bytes entry(28, 0);
+  entry[7] = 1;
+  entry[17] = 2;
+  entry[19] = 16;
+  entry[24] = 44100 >> 8;
+  entry[25] = 44100 & 0xFF;
+  PutBytes(&entry, Box("esds", esds));
+  return Box("mp4a", entry);
+}
+
+Bytes Trak(uint32_t id, const char* handler, uint32_t timescale, const Bytes& sampleEntry,
+           const Bytes& sampleTables) {
+  Bytes tkhd(80, 0);
+  tkhd[11] = static_cast<uint8_t>(id);
+  Bytes mdhd(20, 0);
+  mdhd[8] = static_cast<uint8_t>(timescale >> 24);
+  mdhd[9] = static_cast<uint8_t>(timescale >> 16);
+  mdhd[10] = static_cast<uint8_t>(timescale >> 8);
+  mdhd[11] = static_cast<uint8_t>(timescale);
+  Bytes hdlr(4, 0);
+  hdlr.insert(hdlr.end(), handler, handler + 4);
+  hdlr.resize(21, 0);
+
+  Bytes stsd;
+  Put32(&stsd, 1);
+  PutBytes(&stsd, sampleEntry);
+  Bytes stbl = FullBox("stsd", 0, stsd);
+  PutBytes(&stbl, sampleTables);
+
+  Bytes mdia = FullBox("mdhd", 0, mdhd);
+  PutBytes(&mdia, FullBox("hdlr", 0, hdlr));
+  PutBytes(&mdia, Box("minf", Box("stbl", stbl)));
+  Bytes trak = FullBox("tkhd", 0, tkhd);
+  PutBytes(&trak, Box("mdia", mdia));
+  return Box("trak", trak);
+}
+
+// Video sample |i| is one NAL unit of 4 + |i| bytes of value |i|, behind a
+// four byte length.
+Bytes VideoSample(int i) {
+  Bytes sample;
+  Put32(&sample, 4 + i);
+  sample.push_back(i == 0 ? 0x65 : 0x41);
+  sample.resize(sample.size() + 3 + i, static_cast<uint8_t>(i));
+  return sample;
+}
+
+Bytes AudioSample(int i) { return Bytes(10 + i, static_cast<uint8_t>(0xA0 + i)); }
+
+// Two video samples at 25 fps, the first shown one frame late and the second
+// a non sync sample, and three AAC frames, all in one chunk per track.
+Bytes PlainMp4() {
+  Bytes ftyp = Box("ftyp", Bytes{'i', 's', 'o', 'm', 0, 0, 0, 0});
+  Bytes media;
+  for (int i = 0; i < 2; ++i) {
+    PutBytes(&media, VideoSample(i));
+  }
+  uint32_t audioOffset = static_cast<uint32_t>(ftyp.size() + 8 + media.size());
+  for (int i = 0; i < 3; ++i) {
+    PutBytes(&media, AudioSample(i));
+  }
+  uint32_t videoOffset = static_cast<uint32_t>(ftyp.size() + 8);
+
+  Bytes videoTables = FullBox("stts", 0, Table(1, {2, 3600}));
+  PutBytes(&videoTables, FullBox("ctts", 0, Table(2, {1, 3600, 1, 0})));
+  PutBytes(&videoTables, FullBox("stsc", 0, Table(1, {1, 2, 1})));
+  PutBytes(&videoTables, FullBox("stsz", 0, Table(0, {2, 8, 9})));
+  PutBytes(&videoTables, FullBox("stco", 0, Table(1, {videoOffset})));
+  PutBytes(&videoTables, FullBox("stss", 0, Table(1, {1})));
+
+  Bytes audioTables = FullBox("stts", 0, Table(1, {3, 1024}));
+  PutBytes(&audioTables, FullBox("stsc", 0, Table(1, {1, 3, 1})));
+  PutBytes(&audioTables, FullBox("stsz", 0, Table(0, {3, 10, 11, 12})));
+  PutBytes(&audioTables, FullBox("stco", 0, Table(1, {audioOffset})));
+
+  Bytes moov = Trak(1, "vide", 90000, AvcSampleEntry(), videoTables);
+  PutBytes(&moov, Trak(2, "soun", 44100, AacSampleEntry(), audioTables));
+
+  Bytes file = ftyp;
+  PutBytes(&file, Box("mdat", media));
+  PutBytes(&file, Box("moov", moov));
+  return file;
+}
+
+// One fragment per track: the video run takes its sizes from trun, the audio
+// run its durations and sizes from trex.
+Bytes FragmentedMp4() {
+  Bytes moov = Trak(1, "vide", 90000, AvcSampleEntry(), Bytes());
+  PutBytes(&moov, Trak(2, "soun", 44100, AacSampleEntry(), Bytes()));
+  // track_ID, sample description index, duration, size and flags.
+  Bytes mvex = FullBox("trex", 0, Table(1, {1, 3600, 0, 0x10000}));
+  PutBytes(&mvex, FullBox("trex", 0, Table(2, {1, 1024, 10, 0})));
+  PutBytes(&moov, Box("mvex", mvex));
+
+  Bytes file = Box("ftyp", Bytes{'i', 's', 'o', '6', 0, 0, 0, 0});
+  PutBytes(&file, Box("moov", moov));
+
+  // Video: the first sample flagged as sync, defaults say non sync.
+  Bytes media;
+  for (int i = 0; i < 2; ++i) {
+    PutBytes(&media, VideoSample(i));
+  }
+  Bytes tfhd;
+  Put32(&tfhd, 1);
+  Bytes tfdt;
+  Put32(&tfdt, 0);
+  Bytes trun;
+  Put32(&trun, 2);
+  // The data offset is patched in once the moof size is known.
+  Put32(&trun, 0);
+  Put32(&trun, 0x02000000);
+  Put32(&trun, 8);
+  Put32(&trun, 9);
+  Bytes traf = FullBox("tfhd", 0x020000, tfhd);
+  PutBytes(&traf, FullBox("tfdt", 0, tfdt));
+  PutBytes(&traf, FullBox("trun", 0x000205, trun));
+  Bytes moof = Box("traf", traf);
+  Bytes moofBox = Box("moof", moof);
+  uint32_t dataOffset = static_cast<uint32_t>(moofBox.size() + 8);
+  size_t patch = moofBox.size() - 16;
+  for (int i = 0; i < 4; ++i) {
+    moofBox[patch + i] = static_cast<uint8_t>(dataOffset >> (24 - 8 * i));
+  }
+  PutBytes(&file, moofBox);
+  PutBytes(&file, Box("mdat", media));
+
+  // Audio: two frames of the default size.
+  media.clear();
+  for (int i = 0; i < 2; ++i) {
+    PutBytes(&media, Bytes(10, static_cast<uint8_t>(0xB0 + i)));
+  }
+  tfhd.clear();
+  Put32(&tfhd, 2);
+  trun.clear();
+  Put32(&trun, 2);
+  Put32(&trun, 0);
+  traf = FullBox("tfhd", 0x020000, tfhd);
+  PutBytes(&traf, FullBox("tfdt", 0, tfdt));
+  PutBytes(&traf, FullBox("trun", 0x000001, trun));
+  moofBox = Box("moof", Box("traf", traf));
+  dataOffset = static_cast<uint32_t>(moofBox.size() + 8);
+  patch = moofBox.size() - 4;
+  for (int i = 0; i < 4; ++i) {
+    moofBox[patch + i] = static_cast<uint8_t>(dataOffset >> (24 - 8 * i));
+  }
+  PutBytes(&file, moofBox);
+  PutBytes(&file, Box("mdat", media));
+  return file;
+}
+
+Bytes AnnexB(const uint8_t* nal, size_t size) {
+  Bytes out = {0, 0, 0, 1};
+  out.insert(out.end(), nal, nal + size);
+  return out;
+}
+
+}  // namespace
+
+class Mp4DemuxerTest : public testing::Test {
+ public:
+  void SetUp() override {}
+
+  void TearDown() override {}
+};
+
+TEST_F(Mp4DemuxerTest, demuxes_plain_file_in_decode_order) {
+  std::string path = WriteTempFile("mp4_demuxer_test", PlainMp4());
+  Mp4Demuxer demuxer(path.c_str());
+  ASSERT_TRUE(demuxer.open());
+  ASSERT_EQ(2u, demuxer.tracks().size());
+  EXPECT_EQ(ContainerTrack::kVideo, demuxer.tracks()[0].type);
+  EXPECT_EQ(agora::rtc::VIDEO_CODEC_H264, demuxer.tracks()[0].videoCodec);
+  EXPECT_EQ(320, demuxer.tracks()[0].width);
+  EXPECT_EQ(240, demuxer.tracks()[0].height);
+  EXPECT_EQ(agora::rtc::AUDIO_CODEC_AACLC, demuxer.tracks()[1].audioCodec);
+  EXPECT_EQ(44100, demuxer.tracks()[1].sampleRateHz);
+  EXPECT_EQ(2, demuxer.tracks()[1].numberOfChannels);
+
+  // Video at 0 and 40 ms, audio at 0, 23.2 and 46.4 ms.
+  const int kTracks[] = {0, 1, 1, 0, 1};
+  const int64_t kDtsUs[] = {0, 0, 23219, 40000, 46439};
+  int audio = 0;
+  int video = 0;
+  ContainerSample sample;
+  for (int i = 0; i < 5; ++i) {
+    ASSERT_TRUE(demuxer.getNext(&sample)) << i;
+    EXPECT_EQ(kTracks[i], sample.track) << i;
+    EXPECT_EQ(kDtsUs[i], sample.dtsUs) << i;
+    Bytes data(sample.data, sample.data + sample.length);
+    if (sample.track == 0) {
+      Bytes raw = VideoSample(video);
+      Bytes expected;
+      EXPECT_EQ(40000, sample.ptsUs);
+      if (video == 0) {
+        EXPECT_TRUE(sample.keyFrame);
+        expected = AnnexB(kSps, sizeof(kSps));
+        PutBytes(&expected, AnnexB(kPps, sizeof(kPps)));
+      } else {
+        EXPECT_FALSE(sample.keyFrame);
+      }
+      PutBytes(&expected, AnnexB(raw.data() + 4, raw.size() - 4));
+      EXPECT_EQ(expected, data);
+      ++video;
+    } else {
+      Bytes raw = AudioSample(audio);
+      ASSERT_EQ(raw.size() + 7, data.size());
+      EXPECT_EQ(0xFF, data[0]);
+      EXPECT_EQ(0xF1, data[1]);
+      // Frame length including the header.
+      EXPECT_EQ(raw.size() + 7, static_cast<size_t>((data[3] & 3) << 11 | data[4] << 3 |
+                                                    data[5] >> 5));
+      EXPECT_EQ(raw, Bytes(data.begin() + 7, data.end()));
+      ++audio;
+    }
+  }
+  EXPECT_FALSE(demuxer.getNext(&sample));
+
+  const uint8_t* raw = nullptr;
+  int length = 0;
+  ASSERT_TRUE(demuxer.getRawSample(1, 2, &raw, &length));
+  EXPECT_EQ(AudioSample(2), Bytes(raw, raw + length));
+
+  EXPECT_EQ(0, demuxer.reset());
+  ASSERT_TRUE(demuxer.getNext(&sample));
+  EXPECT_EQ(0, sample.track);
+  unlink(path.c_str());
+}
+
+TEST_F(Mp4DemuxerTest, demuxes_fragments) {
+  std::string path = WriteTempFile("mp4_demuxer_test", FragmentedMp4());
+  Mp4Demuxer demuxer(path.c_str());
+  ASSERT_TRUE(demuxer.open());
+  ASSERT_EQ(2u, demuxer.sampleCount(0));
+  ASSERT_EQ(2u, demuxer.sampleCount(1));
+
+  const uint8_t* raw = nullptr;
+  int length = 0;
+  ASSERT_TRUE(demuxer.getRawSample(0, 1, &raw, &length));
+  EXPECT_EQ(VideoSample(1), Bytes(raw, raw + length));
+  ASSERT_TRUE(demuxer.getRawSample(1, 1, &raw, &length));
+  EXPECT_EQ(Bytes(10, 0xB1), Bytes(raw, raw + length));
+
+  ContainerSample sample;
+  std::vector<int64_t> videoDts;
+  std::vector<bool> keyFrames;
+  while (demuxer.getNext(&sample)) {
+    if (sample.track == 0) {
+      videoDts.push_back(sample.dtsUs);
+      keyFrames.push_back(sample.keyFrame);
+    }
+  }
+  EXPECT_EQ((std::vector<int64_t>{0, 40000}), videoDts);
+  EXPECT_EQ((std::vector<bool>{true, false}), keyFrames);
+  unlink(path.c_str());
+}
+
+TEST_F(Mp4DemuxerTest, fails_without_moov) {
+  // A download cut off before the moov box at the end.
+  Bytes file = PlainMp4();
+  std::string path =
+      WriteTempFile("mp4_demuxer_test", Bytes(file.begin(), file.begin() + file.size() / 2));
+  Mp4Demuxer demuxer(path.c_str());
+  EXPECT_FALSE(demuxer.open());
+  unlink(path.c_str());
+}
@@ -0,0 +1,144 @@
+//  Agora RTC/MEDIA SDK
+//
+//  Copyright (c) 2020 Agora.io. All rights reserved.
+//
+
+#include <math.h>
+#include <string.h>
+#include <limits>
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "utils/pcm_convert.h"
+
+namespace {
+
+const SimdLevel kAllLevels[] = {SimdLevel::kScalar, SimdLevel::kSse2, SimdLevel::kAvx2};
+
+const PcmSampleFormat kAllFormats[] = {PcmSampleFormat::kUInt8, PcmSampleFormat::kInt16,
+                                       PcmSampleFormat::kInt24, PcmSampleFormat::kInt32,
+                                       PcmSampleFormat::kFloat32};
+
+std::vector<uint8_t> MakeSamples(PcmSampleFormat format, size_t samples, uint32_t seed) {
+  std::mt19937 rng(seed);
+  std::vector<uint8_t> data(samples * PcmSampleBytes(format));
+  if (format != PcmSampleFormat::kFloat32) {
+    for (auto& byte : data) {
+      byte = static_cast<uint8_t>(rng());
+    }
+    return data;
+  }
+  // Mostly in range, with clipping, rounding ties and NaN in between.
+  const float specials[] = {1.0f,   -1.0f, 1.5f, -7.0f, 0.5f / 32768, 1.5f / 32768,
+                            -0.5f / 32768, std::numeric_limits<float>::quiet_NaN()};
+  std::uniform_real_distribution<float> dist(-1.05f, 1.05f);
+  for (size_t i = 0; i < samples; ++i) {
+    float value = (rng() % 16 == 0) ? specials[rng() % 8] : dist(rng);
+    memcpy(data.data() + 4 * i, &value, sizeof(value));
+  }
+  return data;
+}
+
+// Sample by sample reference of the documented conversion.
+int16_t ReferenceSample(const uint8_t* p, PcmSampleFormat format) {
+  switch (format) {
+    case PcmSampleFormat::kUInt8:
+      return static_cast<int16_t>((p[0] - 128) * 256);
+    case PcmSampleFormat::kInt16:
+      return static_cast<int16_t>(p[0] | p[1] << 8);
+    case PcmSampleFormat::kInt24:
+      return static_cast<int16_t>(p[1] | p[2] << 8);
+    case PcmSampleFormat::kInt32:
+      return static_cast<int16_t>(p[2] | p[3] << 8);
+    case PcmSampleFormat::kFloat32: {
+      float value;
+      memcpy(&value, p, sizeof(value));
+      if (isnan(value)) {
+        return -32768;
+      }
+      double scaled = nearbyint(static_cast<double>(value) * 32768);
+      return static_cast<int16_t>(scaled > 32767 ? 32767 : (scaled < -32768 ? -32768 : scaled));
+    }
+  }
+  return 0;
+}
+
+}  // namespace
+
+class PcmConvertTest : public testing::Test {
+ public:
+  void SetUp() override {}
+
+  void TearDown() override {}
+};
+
+TEST_F(PcmConvertTest, converts_like_reference_at_every_length) {
+  for (PcmSampleFormat format : kAllFormats) {
+    const size_t bytes = PcmSampleBytes(format);
+    std::vector<uint8_t> src = MakeSamples(format, 4096, 3);
+    for (SimdLevel level : kAllLevels) {
+      for (size_t samples = 0; samples <= 100; ++samples) {
+        std::vector<int16_t> dst(samples + 1, 0x5555);
+        ConvertPcmToInt16(src.data(), format, samples, dst.data(), level);
+        for (size_t i = 0; i < samples; ++i) {
+          ASSERT_EQ(ReferenceSample(src.data() + i * bytes, format), dst[i])
+              << SimdLevelName(level) << " format " << static_cast<int>(format) << " sample " << i
+              << " of " << samples;
+        }
+        ASSERT_EQ(0x5555, dst[samples]) << "wrote past the end";
+      }
+      std::vector<int16_t> dst(4096);
+      ConvertPcmToInt16(src.data(), format, dst.size(), dst.data(), level);
+      for (size_t i = 0; i < dst.size(); ++i) {
+        ASSERT_EQ(ReferenceSample(src.data() + i * bytes, format), dst[i])
+            << SimdLevelName(level) << " format " << static_cast<int>(format) << " sample " << i;
+      }
+    }
+  }
+}
+
+TEST_F(PcmConvertTest, stereo_to_mono_matches_scalar_in_place) {
+  std::vector<uint8_t> bytes = MakeSamples(PcmSampleFormat::kInt16, 2 * 1000, 5);
+  std::vector<int16_t> stereo(bytes.size() / 2);
+  memcpy(stereo.data(), bytes.data(), bytes.size());
+  stereo[0] = stereo[1] = -32768;
+  stereo[2] = stereo[3] = 32767;
+
+  PcmDownmixer downmixer(2, 0, 1);
+  ASSERT_EQ(1, downmixer.outputChannels());
+  for (SimdLevel level : kAllLevels) {
+    for (size_t frames : {0, 1, 7, 8, 15, 16, 17, 31, 33, 1000}) {
+      std::vector<int16_t> mono(stereo.begin(), stereo.begin() + 2 * frames);
+      downmixer.process(mono.data(), frames, mono.data(), level);
+      for (size_t i = 0; i < frames; ++i) {
+        ASSERT_EQ((stereo[2 * i] + stereo[2 * i + 1]) >> 1, mono[i])
+            << SimdLevelName(level) << " frame " << i << " of " << frames;
+      }
+    }
+  }
+}
+
+TEST_F(PcmConvertTest, surround_downmix_does_not_clip) {
+  // 5.1 in the default order at full scale, LFE included.
+  const int16_t frame[6] = {32767, 32767, 32767, 32767, 32767, 32767};
+  int16_t stereo[2] = {0, 0};
+  PcmDownmixer toStereo(6, 0, 2);
+  toStereo.process(frame, 1, stereo);
+  EXPECT_GE(stereo[0], 32760);
+  EXPECT_GE(stereo[1], 32760);
+
+  // Only the left speakers play: nothing leaks to the right.
+  const int16_t left[6] = {10000, 0, 0, 30000, 10000, 0};
+  toStereo.process(left, 1, stereo);
+  EXPECT_EQ(0, stereo[1]);
+  EXPECT_GT(stereo[0], 0);
+
+  // FL, FR and FC given by the channel mask, mixed to mono.
+  const int16_t lcr[3] = {-32768, -32768, -32768};
+  int16_t mono = 0;
+  PcmDownmixer toMono(3, 0x1 | 0x2 | 0x4, 1);
+  toMono.process(lcr, 1, &mono);
+  EXPECT_LE(mono, -32760);
+}
@@ -0,0 +1,119 @@
+//  Agora RTC/MEDIA SDK
+//
+//  Copyright (c) 2020 Agora.io. All rights reserved.
+//
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "utils/replay_file.h"
+
+namespace {
+
+const uint32_t kCodec = 2;
+
+std::string TempPath(const char* name) {
+  char path[256] = {0};
+  snprintf(path, sizeof(path), "/tmp/replay_file_test_%d_%s", getpid(), name);
+  return path;
+}
+
+// Frame |i| is 3 * |i| + 1 bytes of value |i|.
+std::vector<uint8_t> Payload(int i) { return std::vector<uint8_t>(3 * i + 1, i); }
+
+ReplayFileHeader VideoHeader() {
+  ReplayFileHeader header;
+  memset(&header, 0, sizeof(header));
+  header.mediaType = static_cast<uint32_t>(ReplayMediaType::kVideo);
+  header.codec = kCodec;
+  header.width = 640;
+  header.height = 360;
+  header.frameRateNum = 25;
+  header.frameRateDen = 1;
+  return header;
+}
+
+}  // namespace
+
+class ReplayFileTest : public testing::Test {
+ public:
+  void SetUp() override {}
+
+  void TearDown() override {}
+};
+
+TEST_F(ReplayFileTest, round_trips_frames) {
+  std::string path = TempPath("round_trip");
+  ReplayFileWriter writer(VideoHeader());
+  const int kFrames = 50;
+  for (int i = 0; i < kFrames; ++i) {
+    std::vector<uint8_t> payload = Payload(i);
+    writer.addFrame(payload.data(), payload.size(), i * 40000,
+                    i % 10 == 0 ? ReplayFrame::kKeyFrame : 0, kCodec);
+  }
+  ASSERT_TRUE(writer.save(path.c_str(), kFrames * 40000, 1234, 5678));
+
+  EXPECT_TRUE(ReplayFile::isReplayFile(path.c_str()));
+  ReplayFile replay(path.c_str());
+  ASSERT_TRUE(replay.open());
+  const ReplayFileHeader& header = replay.header();
+  EXPECT_EQ(ReplayMediaType::kVideo, replay.mediaType());
+  EXPECT_EQ(kCodec, header.codec);
+  EXPECT_EQ(640u, header.width);
+  EXPECT_EQ(360u, header.height);
+  EXPECT_EQ(kFrames * 40000, header.durationUs);
+  EXPECT_EQ(1234u, header.sourceSize);
+  EXPECT_EQ(5678, header.sourceMtimeNs);
+  EXPECT_EQ(0u, header.payloadOffset % 4096);
+  ASSERT_EQ(static_cast<size_t>(kFrames), replay.size());
+  for (int i = 0; i < kFrames; ++i) {
+    const ReplayFrame& frame = replay.frame(i);
+    std::vector<uint8_t> payload = Payload(i);
+    ASSERT_EQ(payload.size(), frame.size) << "frame " << i;
+    EXPECT_EQ(i * 40000, frame.ptsUs);
+    EXPECT_EQ(i % 10 == 0 ? ReplayFrame::kKeyFrame : 0u, frame.flags);
+    EXPECT_EQ(kCodec, frame.codec);
+    EXPECT_EQ(0u, frame.offset % kReplayPayloadAlignment);
+    const uint8_t* data = replay.payload(i);
+    ASSERT_TRUE(data != nullptr);
+    EXPECT_EQ(0, memcmp(payload.data(), data, payload.size())) << "frame " << i;
+  }
+  unlink(path.c_str());
+}
+
+TEST_F(ReplayFileTest, rejects_other_files) {
+  std::string path = TempPath("other");
+  FILE* file = fopen(path.c_str(), "wb");
+  ASSERT_TRUE(file != nullptr);
+  std::vector<uint8_t> data(256, 0x47);
+  fwrite(data.data(), 1, data.size(), file);
+  fclose(file);
+
+  EXPECT_FALSE(ReplayFile::isReplayFile(path.c_str()));
+  ReplayFile replay(path.c_str());
+  EXPECT_FALSE(replay.open());
+  unlink(path.c_str());
+}
+
+TEST_F(ReplayFileTest, checks_frames_against_the_file) {
+  std::string path = TempPath("truncated");
+  ReplayFileWriter writer(VideoHeader());
+  std::vector<uint8_t> payload(1000, 1);
+  writer.addFrame(payload.data(), payload.size(), 0, ReplayFrame::kKeyFrame, kCodec);
+  writer.addFrame(payload.data(), payload.size(), 40000, 0, kCodec);
+  ASSERT_TRUE(writer.save(path.c_str(), 80000, 0, 0));
+  // Cut the second frame short.
+  ASSERT_EQ(0, truncate(path.c_str(), 4096 + 1016 + 500));
+
+  ReplayFile replay(path.c_str());
+  ASSERT_TRUE(replay.open());
+  ASSERT_EQ(2u, replay.size());
+  EXPECT_TRUE(replay.payload(0) != nullptr);
+  EXPECT_TRUE(replay.payload(1) == nullptr);
+  unlink(path.c_str());
+}
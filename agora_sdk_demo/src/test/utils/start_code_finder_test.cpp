@@ -0,0 +1,195 @@
+//  Agora RTC/MEDIA SDK
+//
+//  Copyright (c) 2020 Agora.io. All rights reserved.
+//
+
+#include <stdio.h>
+#include <algorithm>
+#include <chrono>
+#include <random>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "utils/start_code_finder.h"
+
+namespace {
+
+const SimdLevel kAllLevels[] = {SimdLevel::kScalar, SimdLevel::kSse2, SimdLevel::kAvx2};
+
+// Byte by byte reference for "00 00 third".
+const uint8_t* FindPatternReference(const uint8_t* begin, const uint8_t* end, uint8_t third) {
+  for (const uint8_t* p = begin; end - p > 2; ++p) {
+    if (p[0] == 0 && p[1] == 0 && p[2] == third) {
+      return p;
+    }
+  }
+  return end;
+}
+
+// The scan loop H264FileParser::getNext used before the vectorized finder.
+const uint8_t* FindStartCodeLegacy(const uint8_t* begin, const uint8_t* end) {
+  const uint8_t* p = begin;
+  while (p < end - 2) {
+    if (p[2] > 1) {
+      p += 3;
+    } else if (p[2] == 1 && p[1] == 0 && p[0] == 0) {
+      return p;
+    } else {
+      ++p;
+    }
+  }
+  return end;
+}
+
+// Compressed slice data looks close to uniformly random, with an emulation
+// prevention byte or a start code every few kilobytes.
+std::vector<uint8_t> MakeBitstream(size_t size, uint32_t seed) {
+  std::mt19937 rng(seed);
+  std::vector<uint8_t> data(size);
+  for (auto& byte : data) {
+    byte = static_cast<uint8_t>(rng());
+  }
+  for (size_t i = 0; i + 4 < size; i += 1000 + rng() % 8000) {
+    data[i] = 0;
+    data[i + 1] = 0;
+    data[i + 2] = (rng() & 1) ? 1 : 3;
+  }
+  return data;
+}
+
+// Byte by byte reference for removing emulation prevention bytes.
+std::vector<uint8_t> UnescapeRbspReference(const std::vector<uint8_t>& data) {
+  std::vector<uint8_t> out;
+  int zeros = 0;
+  for (uint8_t byte : data) {
+    if (zeros >= 2 && byte == 3) {
+      zeros = 0;
+      continue;
+    }
+    zeros = byte == 0 ? zeros + 1 : 0;
+    out.push_back(byte);
+  }
+  return out;
+}
+
+}  // namespace
+
+class StartCodeFinderTest : public testing::Test {
+ public:
+  void SetUp() override {}
+
+  void TearDown() override {}
+};
+
+TEST_F(StartCodeFinderTest, matches_reference_at_every_offset) {
+  std::vector<uint8_t> data = MakeBitstream(4096, 7);
+  // Put patterns right at the buffer edges and across vector lane boundaries.
+  const size_t positions[] = {0, 13, 14, 15, 16, 30, 31, 32, 33, 4093};
+  for (size_t pos : positions) {
+    data[pos] = 0;
+    data[pos + 1] = 0;
+    data[pos + 2] = 1;
+  }
+  const uint8_t* end = data.data() + data.size();
+  for (SimdLevel level : kAllLevels) {
+    for (size_t offset = 0; offset < 64; ++offset) {
+      for (size_t length = 0; length <= 80; ++length) {
+        const uint8_t* begin = data.data() + offset;
+        const uint8_t* stop = begin + length;
+        ASSERT_EQ(FindPatternReference(begin, stop, 1), FindStartCode(begin, stop, level))
+            << SimdLevelName(level) << " offset " << offset << " length " << length;
+        ASSERT_EQ(FindPatternReference(begin, stop, 3), FindEmulationPrevention(begin, stop, level))
+            << SimdLevelName(level) << " offset " << offset << " length " << length;
+      }
+    }
+    const uint8_t* p = data.data();
+    while (p != end) {
+      const uint8_t* expected = FindPatternReference(p, end, 1);
+      ASSERT_EQ(expected, FindStartCode(p, end, level)) << SimdLevelName(level);
+      p = expected == end ? end : expected + 1;
+    }
+  }
+}
+
+TEST_F(StartCodeFinderTest, unescapes_rbsp_prefixes) {
+  std::mt19937 rng(5);
+  for (int round = 0; round < 500; ++round) {
+    // Few distinct values, so that escapes come one after another too.
+    std::vector<uint8_t> data(rng() % 64);
+    for (auto& byte : data) {
+      byte = rng() % 3 == 0 ? 3 : (rng() % 4 == 0 ? static_cast<uint8_t>(rng()) : 0);
+    }
+    std::vector<uint8_t> expected = UnescapeRbspReference(data);
+    for (size_t capacity = 0; capacity <= data.size() + 1; ++capacity) {
+      std::vector<uint8_t> out(capacity + 1, 0xAA);
+      size_t written = UnescapeRbsp(data.data(), data.size(), out.data(), capacity);
+      ASSERT_EQ(std::min(capacity, expected.size()), written);
+      ASSERT_TRUE(std::equal(expected.begin(), expected.begin() + written, out.begin()));
+      // Nothing is written past |capacity|.
+      ASSERT_EQ(0xAA, out[capacity]);
+    }
+  }
+}
+
+TEST_F(StartCodeFinderTest, matches_legacy_scan) {
+  std::vector<uint8_t> data = MakeBitstream(256 * 1024, 1);
+  const uint8_t* end = data.data() + data.size();
+  for (SimdLevel level : kAllLevels) {
+    if (ClampSimdLevel(level) != level) {
+      continue;
+    }
+    const uint8_t* legacy = data.data();
+    const uint8_t* p = data.data();
+    while (p != end) {
+      legacy = FindStartCodeLegacy(p, end);
+      p = FindStartCode(p, end, level);
+      ASSERT_EQ(legacy, p) << SimdLevelName(level);
+      p = p == end ? end : p + 1;
+    }
+  }
+}
+
+// Times the finder on 64 MB, run it with --gtest_also_run_disabled_tests.
+TEST_F(StartCodeFinderTest, DISABLED_benchmark) {
+  const size_t kSize = 64 * 1024 * 1024;
+  const int kRounds = 4;
+  std::vector<uint8_t> data = MakeBitstream(kSize, 1);
+  const uint8_t* end = data.data() + data.size();
+
+  auto measure = [&](const char* name, const uint8_t* (*find)(const uint8_t*, const uint8_t*,
+                                                               SimdLevel),
+                     SimdLevel level) {
+    size_t found = 0;
+    auto start = std::chrono::steady_clock::now();
+    for (int round = 0; round < kRounds; ++round) {
+      const uint8_t* p = data.data();
+      while (p != end) {
+        p = find(p, end, level);
+        if (p != end) {
+          ++found;
+          ++p;
+        }
+      }
+    }
+    double seconds =
+        std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    printf("%-8s %7.2f GB/s (%zu start codes)\n", name, kSize * kRounds / seconds / 1e9,
+           found / kRounds);
+    return found;
+  };
+
+  size_t legacy = measure(
+      "legacy",
+      [](const uint8_t* begin, const uint8_t* end, SimdLevel) {
+        return FindStartCodeLegacy(begin, end);
+      },
+      SimdLevel::kScalar);
+  for (SimdLevel level : kAllLevels) {
+    if (ClampSimdLevel(level) != level) {
+      continue;
+    }
+    const uint8_t* (*find)(const uint8_t*, const uint8_t*, SimdLevel) = FindStartCode;
+    EXPECT_EQ(legacy, measure(SimdLevelName(level), find, level));
+  }
+}
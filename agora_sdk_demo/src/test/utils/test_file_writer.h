@@ -0,0 +1,49 @@
+//  Agora RTC/MEDIA SDK
+//
+//  Copyright (c) 2020 Agora.io. All rights reserved.
+//
+
+#pragma once
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+// Builds synthetic media files for the parser tests. Multi byte values are
+// big endian, as in the containers and bitstreams under test.
+typedef std::vector<uint8_t> Bytes;
+
+inline void Put16(Bytes* out, uint32_t value) {
+  out->push_back(static_cast<uint8_t>(value >> 8));
+  out->push_back(static_cast<uint8_t>(value));
+}
+
+inline void Put24(Bytes* out, uint32_t value) {
+  out->push_back(static_cast<uint8_t>(value >> 16));
+  Put16(out, value & 0xFFFF);
+}
+
+inline void Put32(Bytes* out, uint32_t value) {
+  Put16(out, value >> 16);
+  Put16(out, value & 0xFFFF);
+}
+
+inline void PutBytes(Bytes* out, const Bytes& bytes) {
+  out->insert(out->end(), bytes.begin(), bytes.end());
+}
+
+// Writes |bytes| to a new file under /tmp whose name starts with |prefix|.
+// The caller unlinks it.
+inline std::string WriteTempFile(const char* prefix, const Bytes& bytes) {
+  std::string path = std::string("/tmp/") + prefix + "_XXXXXX";
+  int fd = mkstemp(&path[0]);
+  EXPECT_GE(fd, 0);
+  EXPECT_EQ(static_cast<ssize_t>(bytes.size()), write(fd, bytes.data(), bytes.size()));
+  close(fd);
+  return path;
+}
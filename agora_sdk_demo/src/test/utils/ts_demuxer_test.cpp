@@ -0,0 +1,293 @@
+//  Agora RTC/MEDIA SDK
+//
+//  Copyright (c) 2020 Agora.io. All rights reserved.
+//
+
+#include <stdio.h>
+#include <unistd.h>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "test/utils/test_file_writer.h"
+#include "utils/file_parser/ts_demuxer.h"
+#include "utils/ts_packet_sync.h"
+
+namespace {
+
+const SimdLevel kAllLevels[] = {SimdLevel::kScalar, SimdLevel::kSse2, SimdLevel::kAvx2};
+
+const uint16_t kPmtPid = 0x1000;
+const uint16_t kVideoPid = 0x100;
+const uint16_t kAudioPid = 0x101;
+
+// Writes MPEG-TS with one program of an H.264 and an AAC stream.
+class TsWriter {
+ public:
+  TsWriter() : videoContinuity_(0), audioContinuity_(0) {}
+
+  void writeTables() {
+    Bytes pat = {0x00, 0xB0, 13, 0, 1, 0xC1, 0, 0, 0, 1, 0xE0 | kPmtPid >> 8, kPmtPid & 0xFF};
+    writeSection(0, pat);
+    Bytes pmt = {0x02, 0xB0, 23, 0, 1, 0xC1, 0, 0, 0xE0 | kVideoPid >> 8, kVideoPid & 0xFF,
+                 0xF0, 0};
+    const uint16_t pids[] = {kVideoPid, kAudioPid};
+    const uint8_t types[] = {0x1B, 0x0F};
+    for (int i = 0; i < 2; ++i) {
+      pmt.push_back(types[i]);
+      pmt.push_back(static_cast<uint8_t>(0xE0 | pids[i] >> 8));
+      pmt.push_back(static_cast<uint8_t>(pids[i]));
+      pmt.push_back(0xF0);
+      pmt.push_back(0);
+    }
+    writeSection(kPmtPid, pmt);
+  }
+
+  // A PES of |payload| with a PTS, and a DTS if it differs, split into
+  // packets. Video packets carry the PCR.
+  void writePes(bool video, const Bytes& payload, uint64_t pts, uint64_t dts) {
+    Bytes pes = {0, 0, 1, static_cast<uint8_t>(video ? 0xE0 : 0xC0)};
+    size_t headerData = pts == dts ? 5 : 10;
+    size_t length = video ? 0 : 3 + headerData + payload.size();
+    pes.push_back(static_cast<uint8_t>(length >> 8));
+    pes.push_back(static_cast<uint8_t>(length));
+    pes.push_back(0x80);
+    pes.push_back(pts == dts ? 0x80 : 0xC0);
+    pes.push_back(static_cast<uint8_t>(headerData));
+    putTimestamp(&pes, pts == dts ? 0x20 : 0x30, pts);
+    if (pts != dts) {
+      putTimestamp(&pes, 0x10, dts);
+    }
+    pes.insert(pes.end(), payload.begin(), payload.end());
+
+    uint16_t pid = video ? kVideoPid : kAudioPid;
+    int* continuity = video ? &videoContinuity_ : &audioContinuity_;
+    size_t pos = 0;
+    while (pos < pes.size()) {
+      Bytes adaptation;
+      bool hasAdaptation = false;
+      if (pos == 0 && video) {
+        // The PCR, a bit behind the DTS. Key frames are found by their NAL
+        // units, there is no random_access_indicator.
+        uint64_t pcr = (dts - 3000) & ((1ull << 33) - 1);
+        adaptation = {0x10, static_cast<uint8_t>(pcr >> 25), static_cast<uint8_t>(pcr >> 17),
+                      static_cast<uint8_t>(pcr >> 9), static_cast<uint8_t>(pcr >> 1),
+                      static_cast<uint8_t>((pcr & 1) << 7 | 0x7E), 0};
+        hasAdaptation = true;
+      }
+      size_t left = pes.size() - pos;
+      size_t room = 184 - (hasAdaptation ? 1 + adaptation.size() : 0);
+      if (left < room) {
+        // The last packet gets stuffing.
+        if (!hasAdaptation) {
+          hasAdaptation = true;
+          room -= 1;
+          if (left < room) {
+            adaptation.push_back(0);
+            room -= 1;
+          }
+        }
+        adaptation.insert(adaptation.end(), room - left, 0xFF);
+        room = left;
+      }
+      Bytes packet = {0x47, static_cast<uint8_t>((pos == 0 ? 0x40 : 0) | pid >> 8),
+                      static_cast<uint8_t>(pid),
+                      static_cast<uint8_t>((hasAdaptation ? 0x30 : 0x10) | *continuity)};
+      *continuity = (*continuity + 1) & 0x0F;
+      if (hasAdaptation) {
+        packet.push_back(static_cast<uint8_t>(adaptation.size()));
+        packet.insert(packet.end(), adaptation.begin(), adaptation.end());
+      }
+      packet.insert(packet.end(), pes.begin() + pos, pes.begin() + pos + room);
+      pos += room;
+      EXPECT_EQ(188u, packet.size());
+      data_.insert(data_.end(), packet.begin(), packet.end());
+    }
+  }
+
+  Bytes* data() { return &data_; }
+
+ private:
+  void writeSection(uint16_t pid, const Bytes& section) {
+    Bytes packet = {0x47, static_cast<uint8_t>(0x40 | pid >> 8), static_cast<uint8_t>(pid), 0x10,
+                    0};
+    packet.insert(packet.end(), section.begin(), section.end());
+    // The CRC isn't checked.
+    packet.resize(packet.size() + 4, 0);
+    packet.resize(188, 0xFF);
+    data_.insert(data_.end(), packet.begin(), packet.end());
+  }
+
+  static void putTimestamp(Bytes* out, uint8_t prefix, uint64_t ts) {
+    out->push_back(static_cast<uint8_t>(prefix | (ts >> 29 & 0x0E) | 1));
+    out->push_back(static_cast<uint8_t>(ts >> 22));
+    out->push_back(static_cast<uint8_t>((ts >> 14 & 0xFE) | 1));
+    out->push_back(static_cast<uint8_t>(ts >> 7));
+    out->push_back(static_cast<uint8_t>((ts << 1 & 0xFE) | 1));
+  }
+
+  Bytes data_;
+  int videoContinuity_;
+  int audioContinuity_;
+};
+
+// An access unit of |size| bytes, an IDR if |key|.
+Bytes AccessUnit(size_t size, bool key, uint8_t fill) {
+  Bytes au = {0, 0, 0, 1, 0x09, 0xF0, 0, 0, 0, 1, static_cast<uint8_t>(key ? 0x65 : 0x41)};
+  au.resize(size, fill);
+  return au;
+}
+
+// ADTS frame of AAC LC, 48 kHz, stereo.
+Bytes AdtsFrame(size_t payloadSize, uint8_t fill) {
+  size_t length = payloadSize + 7;
+  Bytes frame = {0xFF, 0xF1, 0x4C, static_cast<uint8_t>(0x80 | length >> 11),
+                 static_cast<uint8_t>(length >> 3), static_cast<uint8_t>((length & 7) << 5 | 0x1F),
+                 0xFC};
+  frame.resize(length, fill);
+  return frame;
+}
+
+// Video at 30 fps with capture jitter, and two AAC frames per PES, starting at
+// |start| on the 90 kHz clock.
+const int64_t kVideoJitter[] = {0, 400, -700, 1200, 0, -300};
+
+Bytes MakeStream(uint64_t start, int frames) {
+  TsWriter writer;
+  writer.writeTables();
+  for (int i = 0; i < frames; ++i) {
+    uint64_t dts = (start + i * 3000 + kVideoJitter[i % 6]) & ((1ull << 33) - 1);
+    writer.writePes(true, AccessUnit(500 + 97 * i, i % 3 == 0, static_cast<uint8_t>(i)),
+                    (dts + 3000) & ((1ull << 33) - 1), dts);
+    if (i % 2 == 0) {
+      Bytes frames = AdtsFrame(100 + i, static_cast<uint8_t>(0x80 + i));
+      Bytes second = AdtsFrame(90, static_cast<uint8_t>(0xC0 + i));
+      frames.insert(frames.end(), second.begin(), second.end());
+      uint64_t pts = (start + i * 3000 + 1000) & ((1ull << 33) - 1);
+      writer.writePes(false, frames, pts, pts);
+    }
+  }
+  return *writer.data();
+}
+
+int64_t ExpectedVideoDtsUs(int i) { return (i * 3000 + kVideoJitter[i % 6]) * 100 / 9; }
+
+int64_t ExpectedVideoPtsUs(int i) { return (i * 3000 + kVideoJitter[i % 6] + 3000) * 100 / 9; }
+
+}  // namespace
+
+class TsDemuxerTest : public testing::Test {
+ public:
+  void SetUp() override {}
+
+  void TearDown() override {}
+};
+
+TEST_F(TsDemuxerTest, counts_synced_packets) {
+  std::mt19937 rng(5);
+  const size_t kPackets = 100;
+  Bytes data(kPackets * kTsPacketSize);
+  for (uint8_t& byte : data) {
+    byte = static_cast<uint8_t>(rng());
+  }
+  for (size_t i = 0; i < kPackets; ++i) {
+    data[i * kTsPacketSize] = kTsSyncByte;
+  }
+  for (SimdLevel level : kAllLevels) {
+    for (size_t packets = 0; packets <= kPackets; ++packets) {
+      ASSERT_EQ(packets, CountTsSyncedPackets(data.data(), packets, level))
+          << SimdLevelName(level);
+    }
+    for (size_t lost = 0; lost < 40; ++lost) {
+      data[lost * kTsPacketSize] = 0x46;
+      ASSERT_EQ(lost, CountTsSyncedPackets(data.data(), kPackets, level)) << SimdLevelName(level);
+      data[lost * kTsPacketSize] = kTsSyncByte;
+    }
+  }
+}
+
+TEST_F(TsDemuxerTest, keeps_source_timing) {
+  const int kFrames = 12;
+  std::string path = WriteTempFile("ts_demuxer_test", MakeStream(900000, kFrames));
+  TsDemuxer demuxer(path.c_str());
+  ASSERT_TRUE(demuxer.open());
+  ASSERT_EQ(2u, demuxer.tracks().size());
+  EXPECT_EQ(agora::rtc::VIDEO_CODEC_H264, demuxer.tracks()[0].videoCodec);
+  EXPECT_EQ(ContainerTrack::kAudio, demuxer.tracks()[1].type);
+  EXPECT_EQ(48000, demuxer.tracks()[1].sampleRateHz);
+  EXPECT_EQ(2, demuxer.tracks()[1].numberOfChannels);
+
+  for (int round = 0; round < 2; ++round) {
+    int video = 0;
+    int audio = 0;
+    int64_t lastDtsUs = -1000000;
+    ContainerSample sample;
+    while (demuxer.getNext(&sample)) {
+      EXPECT_GE(sample.dtsUs, lastDtsUs);
+      lastDtsUs = sample.dtsUs;
+      Bytes data(sample.data, sample.data + sample.length);
+      if (sample.track == 0) {
+        EXPECT_EQ(AccessUnit(500 + 97 * video, video % 3 == 0, static_cast<uint8_t>(video)),
+                  data);
+        EXPECT_EQ(ExpectedVideoDtsUs(video), sample.dtsUs);
+        EXPECT_EQ(ExpectedVideoPtsUs(video), sample.ptsUs);
+        EXPECT_EQ(video % 3 == 0, sample.keyFrame);
+        ++video;
+      } else {
+        int pes = audio / 2 * 2;
+        if (audio % 2 == 0) {
+          EXPECT_EQ(AdtsFrame(100 + pes, static_cast<uint8_t>(0x80 + pes)), data);
+          EXPECT_EQ((pes * 3000 + 1000) * 100 / 9, sample.dtsUs);
+        } else {
+          EXPECT_EQ(AdtsFrame(90, static_cast<uint8_t>(0xC0 + pes)), data);
+          // 1024 samples at 48 kHz after the first.
+          EXPECT_EQ((pes * 3000 + 1000 + 1920) * 100 / 9, sample.dtsUs);
+        }
+        ++audio;
+      }
+    }
+    EXPECT_EQ(kFrames, video);
+    EXPECT_EQ(kFrames, audio);
+    EXPECT_EQ(0, demuxer.reset());
+  }
+  unlink(path.c_str());
+}
+
+TEST_F(TsDemuxerTest, unwraps_timestamps) {
+  // The 33 bit clock wraps after the second frame.
+  const int kFrames = 6;
+  std::string path = WriteTempFile("ts_demuxer_test", MakeStream((1ull << 33) - 5000, kFrames));
+  TsDemuxer demuxer(path.c_str());
+  ASSERT_TRUE(demuxer.open());
+  int video = 0;
+  ContainerSample sample;
+  while (demuxer.getNext(&sample)) {
+    if (sample.track == 0) {
+      EXPECT_EQ(ExpectedVideoDtsUs(video), sample.dtsUs);
+      ++video;
+    }
+  }
+  EXPECT_EQ(kFrames, video);
+  unlink(path.c_str());
+}
+
+TEST_F(TsDemuxerTest, resyncs_after_garbage) {
+  Bytes data = MakeStream(0, 6);
+  // Garbage between packets, with a stray sync byte in it.
+  size_t at = 20 * kTsPacketSize;
+  Bytes garbage = {0x00, 0x47, 0x13, 0x00, 0x47, 0x11};
+  data.insert(data.begin() + at, garbage.begin(), garbage.end());
+  std::string path = WriteTempFile("ts_demuxer_test", data);
+  TsDemuxer demuxer(path.c_str());
+  ASSERT_TRUE(demuxer.open());
+  int samples = 0;
+  ContainerSample sample;
+  while (demuxer.getNext(&sample)) {
+    ++samples;
+  }
+  // Nothing was lost, the garbage sat between packets.
+  EXPECT_EQ(12, samples);
+  unlink(path.c_str());
+}
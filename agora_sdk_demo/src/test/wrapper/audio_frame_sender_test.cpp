@@ -0,0 +1,81 @@
+//  Agora RTC/MEDIA SDK
+//
+//  Copyright (c) 2020 Agora.io. All rights reserved.
+//
+
+#include <stdio.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "utils/wav_header.h"
+#include "wrapper/audio_frame_sender.h"
+
+namespace {
+
+// Records the capture timestamps of the frames it is handed.
+class FakePcmDataSender : public agora::rtc::IAudioPcmDataSender {
+ public:
+  int sendAudioPcmData(const void* audio_data, uint32_t capture_timestamp,
+                       const size_t samples_per_channel, const size_t bytes_per_sample,
+                       const size_t number_of_channels, const uint32_t sample_rate) override {
+    timestamps.push_back(capture_timestamp);
+    return 0;
+  }
+
+  // Lives on the stack of the test.
+  void AddRef() const override {}
+  agora::RefCountReleaseStatus Release() const override {
+    return agora::RefCountReleaseStatus::kOtherRefsRemained;
+  }
+
+  std::vector<uint32_t> timestamps;
+};
+
+// Writes |ms| milliseconds of 16 kHz mono silence, 10 ms per parsed frame.
+void WriteWavFile(const std::string& path, int ms) {
+  const int sampleRateHz = 16000;
+  WavHeader header;
+  header.numberOfChannels = 1;
+  header.sampleRateHz = sampleRateHz;
+  header.bytesPerSample = 2;
+  header.bytesPerSecond = sampleRateHz * 2;
+  header.dataLength = sampleRateHz / 1000 * ms * 2;
+  unsigned char bytes[44];
+  makeWAVHeader(bytes, header);
+  std::vector<uint8_t> samples(header.dataLength, 0);
+  FILE* file = fopen(path.c_str(), "wb");
+  ASSERT_NE(nullptr, file);
+  fwrite(bytes, sizeof(bytes), 1, file);
+  fwrite(samples.data(), 1, samples.size(), file);
+  fclose(file);
+}
+
+}  // namespace
+
+class AudioFrameSenderTest : public testing::Test {
+ public:
+  void SetUp() override {
+    char path[256] = {0};
+    snprintf(path, sizeof(path), "/tmp/audio_frame_sender_test_%d.wav", getpid());
+    path_ = path;
+  }
+
+  void TearDown() override { unlink(path_.c_str()); }
+
+ protected:
+  std::string path_;
+};
+
+TEST_F(AudioFrameSenderTest, live_pcm_timestamps_count_the_samples_sent) {
+  WriteWavFile(path_, 50);
+  FakePcmDataSender fake;
+  AudioPcmFrameSender sender(path_.c_str());
+  sender.setLiveInput(false);
+  ASSERT_TRUE(sender.open(&fake));
+  sender.sendAudioFrames();
+  const std::vector<uint32_t> expected = {0, 10, 20, 30, 40};
+  EXPECT_EQ(expected, fake.timestamps);
+}
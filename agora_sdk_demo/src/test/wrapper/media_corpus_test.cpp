@@ -0,0 +1,205 @@
+//  Agora RTC/MEDIA SDK
+//
+//  Copyright (c) 2020 Agora.io. All rights reserved.
+//
+
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "utils/file_parser/ivf_file_parser.h"
+#include "utils/replay_file.h"
+#include "utils/wav_header.h"
+#include "wrapper/media_corpus.h"
+
+namespace {
+
+std::string TestPath(const char* name) {
+  char path[256] = {0};
+  snprintf(path, sizeof(path), "/tmp/media_corpus_test_%d_%s", getpid(), name);
+  return path;
+}
+
+// Writes |ms| milliseconds of 16 kHz mono silence, 10 ms per parsed frame.
+void WriteWavFile(const std::string& path, int ms) {
+  const int sampleRateHz = 16000;
+  WavHeader header;
+  header.numberOfChannels = 1;
+  header.sampleRateHz = sampleRateHz;
+  header.bytesPerSample = 2;
+  header.bytesPerSecond = sampleRateHz * 2;
+  header.dataLength = sampleRateHz / 1000 * ms * 2;
+  unsigned char bytes[44];
+  makeWAVHeader(bytes, header);
+  std::vector<uint8_t> samples(header.dataLength, 0);
+  FILE* file = fopen(path.c_str(), "wb");
+  ASSERT_NE(nullptr, file);
+  fwrite(bytes, sizeof(bytes), 1, file);
+  fwrite(samples.data(), 1, samples.size(), file);
+  fclose(file);
+}
+
+// Writes a VP8 IVF file of |frames| key frames.
+void WriteIvfFile(const std::string& path, int frames) {
+  IvfFileHeader header;
+  memset(&header, 0, sizeof(header));
+  header.signature = IvfFourcc('D', 'K', 'I', 'F');
+  header.headerSize = sizeof(header);
+  header.fourcc = IvfFourcc('V', 'P', '8', '0');
+  header.width = 320;
+  header.height = 240;
+  header.timeBaseRate = 30;
+  header.timeBaseScale = 1;
+  header.frameCount = frames;
+  FILE* file = fopen(path.c_str(), "wb");
+  ASSERT_NE(nullptr, file);
+  fwrite(&header, sizeof(header), 1, file);
+  std::vector<uint8_t> frame(200, 0x10);
+  for (int i = 0; i < frames; ++i) {
+    uint32_t length = static_cast<uint32_t>(frame.size());
+    uint64_t timestamp = i;
+    fwrite(&length, sizeof(length), 1, file);
+    fwrite(&timestamp, sizeof(timestamp), 1, file);
+    fwrite(frame.data(), 1, frame.size(), file);
+  }
+  fclose(file);
+}
+
+}  // namespace
+
+class MediaCorpusTest : public testing::Test {
+ public:
+  void SetUp() override {}
+
+  void TearDown() override {
+    for (const std::string& path : paths_) {
+      unlink(path.c_str());
+      unlink(VideoFrameIndex::sidecarPath(path.c_str()).c_str());
+    }
+  }
+
+ protected:
+  std::string addPath(const char* name) {
+    paths_.push_back(TestPath(name));
+    return paths_.back();
+  }
+
+ private:
+  std::vector<std::string> paths_;
+};
+
+TEST_F(MediaCorpusTest, audio_is_released_by_the_last_user) {
+  std::string path = addPath("audio.wav");
+  WriteWavFile(path, 100);
+  MediaCorpus& corpus = MediaCorpus::Instance();
+  auto first = corpus.acquireAudio(path.c_str(), AUDIO_FILE_TYPE::AUDIO_FILE_PCM);
+  ASSERT_TRUE(first);
+  EXPECT_EQ(10u, first->size());
+  auto second = corpus.acquireAudio(path.c_str(), AUDIO_FILE_TYPE::AUDIO_FILE_PCM);
+  EXPECT_EQ(first.get(), second.get());
+  // Another way of framing the file is another entry.
+  auto g711 = corpus.acquireAudio(path.c_str(), AUDIO_FILE_TYPE::AUDIO_FILE_PCMU);
+  ASSERT_TRUE(g711);
+  EXPECT_NE(first.get(), g711.get());
+
+  std::weak_ptr<const MediaCorpusAudio> watch = first;
+  first.reset();
+  EXPECT_FALSE(watch.expired());
+  second.reset();
+  EXPECT_TRUE(watch.expired());
+
+  // The next user loads the file again and sees what it holds now.
+  WriteWavFile(path, 50);
+  auto reloaded = corpus.acquireAudio(path.c_str(), AUDIO_FILE_TYPE::AUDIO_FILE_PCM);
+  ASSERT_TRUE(reloaded);
+  EXPECT_EQ(5u, reloaded->size());
+  EXPECT_EQ(10u, g711->size());
+}
+
+TEST_F(MediaCorpusTest, video_is_released_by_the_last_user) {
+  std::string path = addPath("video.ivf");
+  WriteIvfFile(path, 3);
+  MediaCorpus& corpus = MediaCorpus::Instance();
+  auto first = corpus.acquireVideo(path.c_str(), VideoFileFormat::kIvf);
+  ASSERT_TRUE(first);
+  EXPECT_EQ(3u, first->size());
+  auto second = corpus.acquireVideo(path.c_str(), VideoFileFormat::kIvf);
+  EXPECT_EQ(first.get(), second.get());
+
+  std::weak_ptr<const MediaCorpusVideo> watch = first;
+  first.reset();
+  second.reset();
+  EXPECT_TRUE(watch.expired());
+}
+
+TEST_F(MediaCorpusTest, preloader_holds_files_until_destroyed) {
+  std::string audioPath = addPath("preload.wav");
+  std::string videoPath = addPath("preload.ivf");
+  WriteWavFile(audioPath, 30);
+  WriteIvfFile(videoPath, 2);
+  std::weak_ptr<const MediaCorpusAudio> audio;
+  std::weak_ptr<const MediaCorpusVideo> video;
+  {
+    MediaCorpusPreloader preloader(2);
+    preloader.addAudio(audioPath, AUDIO_FILE_TYPE::AUDIO_FILE_PCM);
+    preloader.addVideo(videoPath, VideoFileFormat::kIvf);
+    preloader.addVideo(videoPath, VideoFileFormat::kIvf);
+    EXPECT_EQ(2u, preloader.size());
+    preloader.start();
+    EXPECT_EQ(0u, preloader.wait());
+
+    // Senders find the files loaded.
+    auto sender = MediaCorpus::Instance().acquireAudio(audioPath.c_str(),
+                                                       AUDIO_FILE_TYPE::AUDIO_FILE_PCM);
+    ASSERT_TRUE(sender);
+    EXPECT_EQ(3u, sender->size());
+    audio = sender;
+    video = MediaCorpus::Instance().acquireVideo(videoPath.c_str(), VideoFileFormat::kIvf);
+    sender.reset();
+    EXPECT_FALSE(audio.expired());
+    EXPECT_FALSE(video.expired());
+  }
+  EXPECT_TRUE(audio.expired());
+  EXPECT_TRUE(video.expired());
+}
+
+TEST_F(MediaCorpusTest, audio_parser_keeps_the_priming_flag) {
+  std::string path = addPath("priming.replay");
+  ReplayFileHeader header;
+  memset(&header, 0, sizeof(header));
+  header.mediaType = static_cast<uint32_t>(ReplayMediaType::kAudio);
+  header.codec = agora::rtc::AUDIO_CODEC_OPUS;
+  header.sampleRateHz = 48000;
+  header.numberOfChannels = 2;
+  ReplayFileWriter writer(header);
+  std::vector<uint8_t> packet(40, 0xFC);
+  for (int i = 0; i < 3; ++i) {
+    uint32_t flags = ReplayFrame::kKeyFrame | (i == 0 ? ReplayFrame::kPriming : 0);
+    writer.addFrame(packet.data(), packet.size(), i * 20000, flags, header.codec);
+  }
+  ASSERT_TRUE(writer.save(path.c_str(), 60000, 0, 0));
+
+  auto audio = MediaCorpus::Instance().acquireAudio(path.c_str(), AUDIO_FILE_TYPE::AUDIO_FILE_OPUS);
+  ASSERT_TRUE(audio);
+  MediaCorpusAudioParser parser(audio);
+  ASSERT_TRUE(parser.open());
+  AudioFrameView view;
+  for (int i = 0; i < 3; ++i) {
+    ASSERT_TRUE(parser.next(&view));
+    EXPECT_EQ(i == 0 ? AudioFrameView::kPriming : 0u, view.flags) << "frame " << i;
+  }
+  EXPECT_FALSE(parser.next(&view));
+
+  // Parsed frames keep theirs too, none for PCM.
+  std::string wavPath = addPath("priming.wav");
+  WriteWavFile(wavPath, 20);
+  auto pcm = MediaCorpus::Instance().acquireAudio(wavPath.c_str(), AUDIO_FILE_TYPE::AUDIO_FILE_PCM);
+  ASSERT_TRUE(pcm);
+  ASSERT_EQ(2u, pcm->size());
+  EXPECT_EQ(0u, pcm->frameFlags(0));
+}
@@ -0,0 +1,190 @@
+//  Agora RTC/MEDIA SDK
+//
+//  Copyright (c) 2020 Agora.io. All rights reserved.
+//
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/time.h>
+#include <unistd.h>
+#include <string>
+#include <vector>
+
+#include "gtest/gtest.h"
+
+#include "utils/file_parser/ivf_file_parser.h"
+#include "wrapper/video_frame_index.h"
+
+namespace {
+
+// Sidecar header and record sizes, see video_frame_index.cpp.
+const size_t kSidecarHeaderSize = 56;
+const size_t kEntryFlagsOffset = 12;
+
+// VP8 frame tags: key frames have key_frame 0, then show_frame.
+const uint8_t kVp8KeyShown = 0x10;
+const uint8_t kVp8InterShown = 0x11;
+const uint8_t kVp8InterHidden = 0x01;
+
+// Writes a standard VP8 IVF file at 30 fps, frame |i| at timestamp |i|, each
+// frame |100 * (i + 1)| bytes starting with its tag in |tags|.
+void WriteIvfFile(const std::string& path, const std::vector<uint8_t>& tags) {
+  IvfFileHeader header;
+  memset(&header, 0, sizeof(header));
+  header.signature = IvfFourcc('D', 'K', 'I', 'F');
+  header.headerSize = sizeof(header);
+  header.fourcc = IvfFourcc('V', 'P', '8', '0');
+  header.width = 640;
+  header.height = 360;
+  header.timeBaseRate = 30;
+  header.timeBaseScale = 1;
+  header.frameCount = static_cast<uint32_t>(tags.size());
+  FILE* file = fopen(path.c_str(), "wb");
+  ASSERT_NE(nullptr, file);
+  fwrite(&header, sizeof(header), 1, file);
+  for (size_t i = 0; i < tags.size(); ++i) {
+    std::vector<uint8_t> frame(100 * (i + 1), 0x22);
+    frame[0] = tags[i];
+    uint32_t length = static_cast<uint32_t>(frame.size());
+    uint64_t timestamp = i;
+    fwrite(&length, sizeof(length), 1, file);
+    fwrite(&timestamp, sizeof(timestamp), 1, file);
+    fwrite(frame.data(), 1, frame.size(), file);
+  }
+  fclose(file);
+}
+
+std::vector<uint8_t> ReadFile(const std::string& path) {
+  std::vector<uint8_t> data;
+  FILE* file = fopen(path.c_str(), "rb");
+  if (!file) {
+    return data;
+  }
+  uint8_t buffer[4096];
+  size_t read = 0;
+  while ((read = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+    data.insert(data.end(), buffer, buffer + read);
+  }
+  fclose(file);
+  return data;
+}
+
+void OverwriteFile(const std::string& path, const std::vector<uint8_t>& data) {
+  FILE* file = fopen(path.c_str(), "wb");
+  ASSERT_NE(nullptr, file);
+  fwrite(data.data(), 1, data.size(), file);
+  fclose(file);
+}
+
+// Flags frame |i| as a key frame in the sidecar only, which tells a loaded
+// index from a rebuilt one.
+void MarkKeyFrameInSidecar(const std::string& sidecar, size_t i) {
+  std::vector<uint8_t> data = ReadFile(sidecar);
+  size_t pos = kSidecarHeaderSize + i * sizeof(VideoFrameIndexEntry) + kEntryFlagsOffset;
+  ASSERT_LT(pos, data.size());
+  data[pos] |= VideoFrameIndexEntry::kKeyFrame;
+  OverwriteFile(sidecar, data);
+}
+
+}  // namespace
+
+class VideoFrameIndexTest : public testing::Test {
+ public:
+  void SetUp() override {
+    char path[256] = {0};
+    snprintf(path, sizeof(path), "/tmp/video_frame_index_test_%d.ivf", getpid());
+    path_ = path;
+    sidecar_ = VideoFrameIndex::sidecarPath(path);
+    unlink(sidecar_.c_str());
+  }
+
+  void TearDown() override {
+    unlink(path_.c_str());
+    unlink(sidecar_.c_str());
+  }
+
+ protected:
+  std::string path_;
+  std::string sidecar_;
+};
+
+TEST_F(VideoFrameIndexTest, sidecar_round_trips) {
+  WriteIvfFile(path_, {kVp8KeyShown, kVp8InterShown, kVp8InterShown});
+  auto built = VideoFrameIndex::loadOrBuild(path_.c_str(), VideoFileFormat::kIvf);
+  ASSERT_TRUE(built);
+  ASSERT_EQ(3u, built->size());
+  EXPECT_EQ(kSidecarHeaderSize + 3 * sizeof(VideoFrameIndexEntry), ReadFile(sidecar_).size());
+
+  auto loaded = VideoFrameIndex::loadOrBuild(path_.c_str(), VideoFileFormat::kIvf);
+  ASSERT_TRUE(loaded);
+  EXPECT_EQ(built->codecFourcc(), loaded->codecFourcc());
+  EXPECT_EQ(640, loaded->width());
+  EXPECT_EQ(360, loaded->height());
+  EXPECT_EQ(30, loaded->framesPerSecond());
+  EXPECT_EQ(built->durationUs(), loaded->durationUs());
+  ASSERT_EQ(built->size(), loaded->size());
+  uint64_t offset = sizeof(IvfFileHeader);
+  for (size_t i = 0; i < loaded->size(); ++i) {
+    offset += 12;
+    const VideoFrameIndexEntry& entry = (*loaded)[i];
+    EXPECT_EQ(offset, entry.offset) << "frame " << i;
+    EXPECT_EQ(100 * (i + 1), entry.length) << "frame " << i;
+    EXPECT_EQ(i == 0 ? VideoFrameIndexEntry::kKeyFrame : 0u, entry.flags) << "frame " << i;
+    EXPECT_EQ(static_cast<int64_t>(i) * 1000000 / 30, entry.ptsUs) << "frame " << i;
+    EXPECT_EQ(0, memcmp(&(*built)[i], &entry, sizeof(entry))) << "frame " << i;
+    offset += entry.length;
+  }
+
+  // A valid sidecar is taken as it is, without parsing the file again.
+  MarkKeyFrameInSidecar(sidecar_, 1);
+  loaded = VideoFrameIndex::loadOrBuild(path_.c_str(), VideoFileFormat::kIvf);
+  ASSERT_TRUE(loaded);
+  EXPECT_EQ(VideoFrameIndexEntry::kKeyFrame, (*loaded)[1].flags);
+}
+
+TEST_F(VideoFrameIndexTest, stale_sidecar_is_rebuilt) {
+  WriteIvfFile(path_, {kVp8KeyShown, kVp8InterShown, kVp8InterShown});
+  ASSERT_TRUE(VideoFrameIndex::loadOrBuild(path_.c_str(), VideoFileFormat::kIvf));
+
+  // Same size, other mtime.
+  MarkKeyFrameInSidecar(sidecar_, 1);
+  struct timeval times[2] = {{1000000000, 0}, {1000000000, 0}};
+  ASSERT_EQ(0, utimes(path_.c_str(), times));
+  auto index = VideoFrameIndex::loadOrBuild(path_.c_str(), VideoFileFormat::kIvf);
+  ASSERT_TRUE(index);
+  ASSERT_EQ(3u, index->size());
+  EXPECT_EQ(0u, (*index)[1].flags);
+
+  // The file grew by a frame.
+  MarkKeyFrameInSidecar(sidecar_, 1);
+  WriteIvfFile(path_, {kVp8KeyShown, kVp8InterShown, kVp8InterShown, kVp8InterShown});
+  ASSERT_EQ(0, utimes(path_.c_str(), times));
+  index = VideoFrameIndex::loadOrBuild(path_.c_str(), VideoFileFormat::kIvf);
+  ASSERT_TRUE(index);
+  ASSERT_EQ(4u, index->size());
+  EXPECT_EQ(0u, (*index)[1].flags);
+  EXPECT_EQ(kSidecarHeaderSize + 4 * sizeof(VideoFrameIndexEntry), ReadFile(sidecar_).size());
+
+  // A sidecar cut short of its entries.
+  std::vector<uint8_t> sidecar = ReadFile(sidecar_);
+  sidecar.resize(kSidecarHeaderSize + sizeof(VideoFrameIndexEntry));
+  OverwriteFile(sidecar_, sidecar);
+  index = VideoFrameIndex::loadOrBuild(path_.c_str(), VideoFileFormat::kIvf);
+  ASSERT_TRUE(index);
+  EXPECT_EQ(4u, index->size());
+}
+
+TEST_F(VideoFrameIndexTest, trailing_hidden_frame_keeps_the_frame_interval) {
+  WriteIvfFile(path_, {kVp8KeyShown, kVp8InterShown, kVp8InterShown, kVp8InterHidden});
+  auto index = VideoFrameIndex::loadOrBuild(path_.c_str(), VideoFileFormat::kIvf);
+  ASSERT_TRUE(index);
+  ASSERT_EQ(4u, index->size());
+  // The hidden frame goes out with the frame before it.
+  EXPECT_EQ((*index)[2].ptsUs, (*index)[3].ptsUs);
+  const int64_t frameIntervalUs = 1000000 / 30;
+  EXPECT_EQ(3 * frameIntervalUs, index->durationUs());
+
+  auto loaded = VideoFrameIndex::loadOrBuild(path_.c_str(), VideoFileFormat::kIvf);
+  ASSERT_TRUE(loaded);
+  EXPECT_EQ(index->durationUs(), loaded->durationUs());
+}
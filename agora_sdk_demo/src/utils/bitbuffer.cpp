@@ -10,6 +10,8 @@
 
 #include "bitbuffer.h"
 
+#include <string.h>
+
 #include <algorithm>
 #include <limits>
 
@@ -184,3 +186,162 @@ bool BitBuffer::Seek(size_t byte_offset, size_t bit_offset) {
   bit_offset_ = bit_offset;
   return true;
 }
+
+// Loads 8 bytes from any address, most significant byte first.
+static uint64_t LoadBigEndian64(const uint8_t* bytes) {
+  uint64_t val;
+  memcpy(&val, bytes, sizeof(val));
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+  val = __builtin_bswap64(val);
+#endif
+  return val;
+}
+
+CachedBitBuffer::CachedBitBuffer(const uint8_t* bytes, size_t byte_count)
+    : bytes_(bytes), byte_count_(byte_count), next_byte_(0), cache_(0), cached_bit_count_(0) {
+  Refill();
+}
+
+void CachedBitBuffer::Refill() {
+  if (cached_bit_count_ > 56) {
+    return;
+  }
+  if (byte_count_ - next_byte_ >= 8) {
+    // Takes as many whole bytes as fit. The bits of the next byte land below
+    // them too, which is harmless since they are the bits that follow.
+    cache_ |= LoadBigEndian64(bytes_ + next_byte_) >> cached_bit_count_;
+    size_t byte_count = (63 - cached_bit_count_) >> 3;
+    next_byte_ += byte_count;
+    cached_bit_count_ += byte_count * 8;
+    return;
+  }
+  // The last few bytes, one at a time so nothing past the end is read.
+  while (cached_bit_count_ <= 56 && next_byte_ < byte_count_) {
+    cache_ |= static_cast<uint64_t>(bytes_[next_byte_++]) << (56 - cached_bit_count_);
+    cached_bit_count_ += 8;
+  }
+}
+
+bool CachedBitBuffer::ReadUInt8(uint8_t* val) {
+  uint32_t bit_val;
+  if (!ReadBits(&bit_val, sizeof(uint8_t) * 8)) {
+    return false;
+  }
+  *val = static_cast<uint8_t>(bit_val);
+  return true;
+}
+
+bool CachedBitBuffer::ReadUInt16(uint16_t* val) {
+  uint32_t bit_val;
+  if (!ReadBits(&bit_val, sizeof(uint16_t) * 8)) {
+    return false;
+  }
+  *val = static_cast<uint16_t>(bit_val);
+  return true;
+}
+
+bool CachedBitBuffer::ReadUInt32(uint32_t* val) { return ReadBits(val, sizeof(uint32_t) * 8); }
+
+bool CachedBitBuffer::PeekBits(uint32_t* val, size_t bit_count) {
+  if (!val || bit_count > 32) {
+    return false;
+  }
+  if (cached_bit_count_ < bit_count) {
+    Refill();
+    if (cached_bit_count_ < bit_count) {
+      return false;
+    }
+  }
+  *val = bit_count == 0 ? 0 : static_cast<uint32_t>(cache_ >> (64 - bit_count));
+  return true;
+}
+
+bool CachedBitBuffer::ReadBits(uint32_t* val, size_t bit_count) {
+  return PeekBits(val, bit_count) && ConsumeBits(bit_count);
+}
+
+bool CachedBitBuffer::ConsumeBytes(size_t byte_count) { return ConsumeBits(byte_count * 8); }
+
+bool CachedBitBuffer::ConsumeBits(size_t bit_count) {
+  if (bit_count > RemainingBitCount()) {
+    return false;
+  }
+  if (bit_count < cached_bit_count_) {
+    cache_ <<= bit_count;
+    cached_bit_count_ -= bit_count;
+    return true;
+  }
+  // Skip past the cache, then reload from the byte the new offset is in.
+  bit_count -= cached_bit_count_;
+  next_byte_ += bit_count / 8;
+  cache_ = 0;
+  cached_bit_count_ = 0;
+  Refill();
+  cache_ <<= bit_count % 8;
+  cached_bit_count_ -= bit_count % 8;
+  return true;
+}
+
+bool CachedBitBuffer::ReadExponentialGolomb(uint32_t* val) {
+  if (!val) {
+    return false;
+  }
+  if (cached_bit_count_ < 32) {
+    Refill();
+  }
+  // A value fitting in a uint32_t has at most 31 leading zeros. Ones found
+  // below the cached bits still belong to the buffer.
+  size_t zero_bit_count = cache_ ? __builtin_clzll(cache_) : 64;
+  if (zero_bit_count > 31) {
+    return false;
+  }
+  size_t code_bit_count = 2 * zero_bit_count + 1;
+  if (code_bit_count <= cached_bit_count_) {
+    // The zeros add nothing to the value, so the code reads as x + 1.
+    *val = static_cast<uint32_t>(cache_ >> (64 - code_bit_count)) - 1;
+    cache_ <<= code_bit_count;
+    cached_bit_count_ -= code_bit_count;
+    return true;
+  }
+  // Codes of more than 57 bits straddle a refill.
+  if (code_bit_count > RemainingBitCount()) {
+    return false;
+  }
+  ConsumeBits(zero_bit_count);
+  ReadBits(val, zero_bit_count + 1);
+  *val -= 1;
+  return true;
+}
+
+bool CachedBitBuffer::ReadSignedExponentialGolomb(int32_t* val) {
+  uint32_t unsigned_val;
+  if (!ReadExponentialGolomb(&unsigned_val)) {
+    return false;
+  }
+  if ((unsigned_val & 1) == 0) {
+    *val = -static_cast<int32_t>(unsigned_val / 2);
+  } else {
+    *val = (unsigned_val + 1) / 2;
+  }
+  return true;
+}
+
+void CachedBitBuffer::GetCurrentOffset(size_t* out_byte_offset, size_t* out_bit_offset) {
+  size_t bit_offset = next_byte_ * 8 - cached_bit_count_;
+  *out_byte_offset = bit_offset / 8;
+  *out_bit_offset = bit_offset % 8;
+}
+
+bool CachedBitBuffer::Seek(size_t byte_offset, size_t bit_offset) {
+  if (byte_offset > byte_count_ || bit_offset > 7 ||
+      (byte_offset == byte_count_ && bit_offset > 0)) {
+    return false;
+  }
+  next_byte_ = byte_offset;
+  cache_ = 0;
+  cached_bit_count_ = 0;
+  Refill();
+  cache_ <<= bit_offset;
+  cached_bit_count_ -= bit_offset;
+  return true;
+}
@@ -0,0 +1,27 @@
+//  Agora RTC/MEDIA SDK
+//
+//  Copyright (c) 2020 Agora.io. All rights reserved.
+//
+
+#pragma once
+
+#include <stdint.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define AGORA_DEMO_ARCH_X86 1
+#endif
+
+// Vector instruction sets the hot parsing loops can be dispatched to.
+enum class SimdLevel : uint8_t {
+  kScalar = 0,
+  kSse2,
+  kAvx2,
+};
+
+// Best level supported by the running CPU, detected once through CPUID.
+SimdLevel GetSimdLevel();
+
+// Clamps |level| to what the running CPU supports.
+SimdLevel ClampSimdLevel(SimdLevel level);
+
+const char* SimdLevelName(SimdLevel level);
@@ -6,58 +6,323 @@
 
 #include "aac_file_parser.h"
 
-#include <errno.h>
-#include <cmath>
-#include <map>
+#include "utils/bitbuffer.h"
+#include "utils/live_stream_reader.h"
+#include "utils/mapped_file.h"
+
+namespace {
+
+// Indexed by sampling_frequency_index, zero for the reserved indexes.
+constexpr uint32_t kAdtsSampleRates[16] = {96000, 88200, 64000, 48000, 44100, 32000,
+                                           24000, 22050, 16000, 12000, 11025, 8000,
+                                           7350,  0,     0,     0};
+
+const size_t kAdtsHeaderWithCrcSize = 9;
+const size_t kAdtsMaxFrameLength = 0x1FFF;
+
+const int kAacSamplesPerBlock = 1024;
+// Highest core rate SBR doubles.
+const int kAacMaxSbrCoreSampleRateHz = 24000;
+
+const int kAacObjectTypeSbr = 5;
+const int kAacObjectTypePs = 29;
+const int kAacObjectTypeEscape = 31;
+
+// Sync word, ID, layer and protection_absent.
+const uint8_t kAdtsFixedHeaderMask1 = 0xFF;
+// profile, sampling_frequency_index and the high channel_configuration bit,
+// leaving out private_bit.
+const uint8_t kAdtsFixedHeaderMask2 = 0xFD;
+// The low channel_configuration bits.
+const uint8_t kAdtsFixedHeaderMask3 = 0xC0;
+
+// Returns the aac_frame_length of the ADTS header at |p| if it is plausible
+// and fits into the |size| bytes left, otherwise 0.
+size_t AdtsFrameLength(const uint8_t* p, size_t size) {
+  // 12 bit sync word of ones and layer 00, with either ID (0xFFF1 for MPEG-4,
+  // 0xFFF9 for MPEG-2 and 0xFFF0/0xFFF8 when a CRC follows).
+  if (size < kAdtsHeaderSize || p[0] != 0xFF || (p[1] & 0xF6) != 0xF0) {
+    return 0;
+  }
+  if (kAdtsSampleRates[(p[2] >> 2) & 0x0F] == 0) {
+    return 0;
+  }
+  size_t headerSize = (p[1] & 0x01) ? kAdtsHeaderSize : kAdtsHeaderWithCrcSize;
+  size_t frameLength = ((p[3] & 0x03) << 11) | (p[4] << 3) | (p[5] >> 5);
+  if (frameLength <= headerSize || frameLength > size) {
+    return 0;
+  }
+  return frameLength;
+}
+
+void GetFixedHeader(const uint8_t* p, uint8_t* fixedHeader) {
+  fixedHeader[0] = p[1] & kAdtsFixedHeaderMask1;
+  fixedHeader[1] = p[2] & kAdtsFixedHeaderMask2;
+  fixedHeader[2] = p[3] & kAdtsFixedHeaderMask3;
+}
+
+bool MatchesFixedHeader(const uint8_t* p, const uint8_t* fixedHeader) {
+  uint8_t header[3];
+  GetFixedHeader(p, header);
+  return memcmp(header, fixedHeader, sizeof(header)) == 0;
+}
 
-static std::map<uint8_t, uint32_t> AacFrameSampleRateMap = {
-    {0x0, 96000}, {0x1, 88200}, {0x2, 64000}, {0x3, 48000}, {0x4, 44100},
-    {0x5, 32000}, {0x6, 24000}, {0x7, 22000}, {0x8, 16000}, {0x9, 12000},
-    {0xa, 11025}, {0xb, 8000},  {0xc, 7350}};
+bool ReadAacObjectType(BitBuffer* bits, int* objectType) {
+  uint32_t value = 0;
+  if (!bits->ReadBits(&value, 5)) {
+    return false;
+  }
+  if (value == kAacObjectTypeEscape) {
+    uint32_t extension = 0;
+    if (!bits->ReadBits(&extension, 6)) {
+      return false;
+    }
+    value = 32 + extension;
+  }
+  *objectType = static_cast<int>(value);
+  return true;
+}
 
-AACFileParser::AACFileParser(const char* filepath)
+// Reads a sampling frequency index, or the explicit rate that may follow it.
+bool ReadAacSampleRate(BitBuffer* bits, int* index, int* sampleRateHz) {
+  uint32_t value = 0;
+  if (!bits->ReadBits(&value, 4)) {
+    return false;
+  }
+  if (value == 0x0F) {
+    uint32_t rate = 0;
+    if (!bits->ReadBits(&rate, 24)) {
+      return false;
+    }
+    // ADTS can only carry rates from the table.
+    for (value = 0; value < 13 && kAdtsSampleRates[value] != rate; ++value) {
+    }
+    if (value == 13) {
+      return false;
+    }
+  }
+  if (kAdtsSampleRates[value] == 0) {
+    return false;
+  }
+  *index = static_cast<int>(value);
+  *sampleRateHz = static_cast<int>(kAdtsSampleRates[value]);
+  return true;
+}
+
+}  // namespace
+
+bool ParseAudioSpecificConfig(const uint8_t* data, size_t size, AacAudioConfig* config) {
+  BitBuffer bits(data, size);
+  AacAudioConfig parsed;
+  uint32_t channelConfig = 0;
+  if (!ReadAacObjectType(&bits, &parsed.objectType) ||
+      !ReadAacSampleRate(&bits, &parsed.sampleRateIndex, &parsed.sampleRateHz) ||
+      !bits.ReadBits(&channelConfig, 4)) {
+    return false;
+  }
+  parsed.channelConfig = static_cast<int>(channelConfig);
+  parsed.sbr = parsed.objectType == kAacObjectTypeSbr || parsed.objectType == kAacObjectTypePs;
+  if (parsed.sbr) {
+    // The extension rate is the output rate, the core coder follows.
+    int extensionIndex = 0;
+    if (!ReadAacSampleRate(&bits, &extensionIndex, &parsed.sampleRateHz) ||
+        !ReadAacObjectType(&bits, &parsed.objectType)) {
+      return false;
+    }
+  }
+  *config = parsed;
+  return true;
+}
+
+bool WriteAdtsHeader(const AacAudioConfig& config, size_t payloadSize,
+                     uint8_t header[kAdtsHeaderSize]) {
+  // The profile field holds object types 1 to 4 only.
+  size_t frameLength = payloadSize + kAdtsHeaderSize;
+  if (config.objectType < 1 || config.objectType > 4 || frameLength > kAdtsMaxFrameLength) {
+    return false;
+  }
+  int profile = config.objectType - 1;
+  header[0] = 0xFF;
+  // MPEG-4, layer 0, no CRC.
+  header[1] = 0xF1;
+  header[2] = static_cast<uint8_t>(profile << 6 | config.sampleRateIndex << 2 |
+                                   (config.channelConfig >> 2 & 0x01));
+  header[3] = static_cast<uint8_t>((config.channelConfig & 0x03) << 6 | frameLength >> 11);
+  header[4] = static_cast<uint8_t>(frameLength >> 3);
+  // Buffer fullness 0x7FF for variable bit rate, one raw data block.
+  header[5] = static_cast<uint8_t>((frameLength & 0x07) << 5 | 0x1F);
+  header[6] = 0xFC;
+  return true;
+}
+
+size_t ParseAdtsHeader(const uint8_t* p, size_t size, AacAudioConfig* config) {
+  size_t frameLength = AdtsFrameLength(p, size);
+  if (frameLength == 0) {
+    return 0;
+  }
+  config->objectType = (p[2] >> 6) + 1;
+  config->sampleRateIndex = (p[2] >> 2) & 0x0F;
+  config->channelConfig = (p[2] & 0x01) << 2 | p[3] >> 6;
+  config->sampleRateHz = static_cast<int>(kAdtsSampleRates[config->sampleRateIndex]);
+  // ADTS has no way to signal SBR.
+  config->sbr = false;
+  return frameLength;
+}
+
+int AacOutputSampleRate(int coreSampleRateHz, bool sbr) {
+  return sbr && coreSampleRateHz <= kAacMaxSbrCoreSampleRateHz ? 2 * coreSampleRateHz
+                                                               : coreSampleRateHz;
+}
+
+int AdtsFrameSamples(const uint8_t* p, bool sbr) {
+  int coreSampleRateHz = static_cast<int>(kAdtsSampleRates[(p[2] >> 2) & 0x0F]);
+  // number_of_raw_data_blocks_in_frame holds the blocks minus one.
+  int coreSamples = kAacSamplesPerBlock * ((p[6] & 0x03) + 1);
+  return AacOutputSampleRate(coreSampleRateHz, sbr) == coreSampleRateHz ? coreSamples
+                                                                        : 2 * coreSamples;
+}
+
+AACFileParser::AACFileParser(const char* filepath, bool sbr)
     : aacFilePath_(strdup(filepath)),
-      aacFile_(nullptr),
-      isEof_(false),
-      currentBytePos_(0),
-      dataEndPos_(0),
-      currentFrameStart_(0),
+      mappedFile_(new MappedFile(filepath)),
+      liveFrameTaken_(false),
+      framePos_(0),
+      frameLength_(0),
+      fixedHeader_{0, 0, 0},
+      sbr_(sbr),
       numberOfChannels_(0),
       sampleRateHz_(48000),
-      readsize_(0),
-      firstGet_(true),
-      firstBuffer_(nullptr),
-      firstBufferLength_(0) {}
+      frameSamples_(0) {}
+
+AACFileParser::~AACFileParser() { free(static_cast<void*>(aacFilePath_)); }
 
-AACFileParser::~AACFileParser() {
-  if (aacFile_) {
-    fclose(aacFile_);
+bool AACFileParser::setLiveInput(bool follow) {
+  live_.reset(new LiveStreamReader(aacFilePath_, follow));
+  return true;
+}
+
+void AACFileParser::cancel() {
+  if (live_) {
+    live_->cancel();
   }
-  free(static_cast<void*>(aacFilePath_));
 }
 
 bool AACFileParser::open() {
-  if (aacFile_) {
-    return true;
-  }
-  aacFile_ = fopen(aacFilePath_, "rb");
-  if (!aacFile_) {
-    printf("open %s fail, error %s", aacFilePath_, strerror(errno));
-    return false;
+  const uint8_t* firstFrame = nullptr;
+  if (live_) {
+    // Waits for the writer to send the first frame.
+    fixedHeader_[0] = 0;
+    liveFrameTaken_ = false;
+    if (!live_->open() || !findLiveFrame()) {
+      printf("No ADTS frame found in %s\n", aacFilePath_);
+      return false;
+    }
+    firstFrame = live_->data();
+  } else {
+    if (mappedFile_->isOpen()) {
+      return true;
+    }
+    if (!mappedFile_->open(MappedFile::kAdviceSequential)) {
+      printf("open %s fail\n", aacFilePath_);
+      return false;
+    }
+    if (!findFrame(0)) {
+      printf("No ADTS frame found in %s\n", aacFilePath_);
+      mappedFile_->close();
+      return false;
+    }
+    firstFrame = mappedFile_->data() + framePos_;
   }
-
-  firstBuffer_.reset(new char[kBufferSize]);
-  firstBufferLength_ = kBufferSize;
-  getAacDataBuffer(firstBuffer_.get(), &firstBufferLength_);
   AACAudioFrame firstAacframe;
-  parseADTSHeader(firstAacframe, (unsigned char*)firstBuffer_.get());
-  firstGet_ = false;
+  parseADTSHeader(firstAacframe, firstFrame);
+  printf("aacframe.profile %d, protection_absent %d, sampling_frequency_index %d\n",
+         firstAacframe.profile, firstAacframe.protection_absent,
+         firstAacframe.sampling_frequency_index);
   return true;
 }
 
-bool AACFileParser::hasNext() { return (!isEof_) || (currentBytePos_ < (dataEndPos_ - 1)); }
+bool AACFileParser::findFrame(size_t from) {
+  const uint8_t* data = mappedFile_->data();
+  const size_t size = mappedFile_->size();
+  bool locked = fixedHeader_[0] != 0;
+  frameLength_ = 0;
+  for (size_t pos = from; pos + kAdtsHeaderSize <= size; ++pos) {
+    const uint8_t* p = static_cast<const uint8_t*>(memchr(data + pos, 0xFF, size - pos));
+    if (!p) {
+      break;
+    }
+    pos = p - data;
+    size_t length = AdtsFrameLength(p, size - pos);
+    if (length == 0 || (locked && !MatchesFixedHeader(p, fixedHeader_))) {
+      continue;
+    }
+    // Verify the sync by the header that has to follow, unless no header fits
+    // behind the frame anymore.
+    uint8_t fixedHeader[3];
+    GetFixedHeader(p, fixedHeader);
+    const uint8_t* next = p + length;
+    if (pos + length + kAdtsHeaderSize <= size &&
+        (AdtsFrameLength(next, size - pos - length) == 0 ||
+         !MatchesFixedHeader(next, fixedHeader))) {
+      continue;
+    }
+    if (!locked) {
+      memcpy(fixedHeader_, fixedHeader, sizeof(fixedHeader_));
+    }
+    framePos_ = pos;
+    frameLength_ = length;
+    return true;
+  }
+  framePos_ = size;
+  return false;
+}
+
+bool AACFileParser::findLiveFrame() {
+  bool locked = fixedHeader_[0] != 0;
+  frameLength_ = 0;
+  while (live_->require(kAdtsHeaderSize)) {
+    const uint8_t* p = live_->data();
+    size_t length = AdtsFrameLength(p, kAdtsMaxFrameLength);
+    if (length == 0 || (locked && !MatchesFixedHeader(p, fixedHeader_))) {
+      // Skip to the next byte that could start a sync word.
+      const void* sync = memchr(p + 1, 0xFF, live_->available() - 1);
+      live_->consume(sync ? static_cast<const uint8_t*>(sync) - p : live_->available());
+      continue;
+    }
+    if (!live_->require(locked ? length : length + kAdtsHeaderSize)) {
+      // Only a whole frame at the end of the stream still counts.
+      if (live_->available() < length) {
+        return false;
+      }
+    } else if (!locked) {
+      p = live_->data();
+      uint8_t fixedHeader[3];
+      GetFixedHeader(p, fixedHeader);
+      if (AdtsFrameLength(p + length, kAdtsMaxFrameLength) == 0 ||
+          !MatchesFixedHeader(p + length, fixedHeader)) {
+        live_->consume(1);
+        continue;
+      }
+    }
+    if (!locked) {
+      GetFixedHeader(live_->data(), fixedHeader_);
+    }
+    frameLength_ = length;
+    return true;
+  }
+  return false;
+}
+
+bool AACFileParser::hasNext() {
+  if (live_ && liveFrameTaken_) {
+    live_->consume(frameLength_);
+    liveFrameTaken_ = false;
+    findLiveFrame();
+  }
+  return frameLength_ > 0;
+}
 
-void AACFileParser::parseADTSHeader(AACAudioFrame& aacframe, unsigned char* aacData) {
+void AACFileParser::parseADTSHeader(AACAudioFrame& aacframe, const unsigned char* aacData) {
   uint64_t adts = 0;
   const unsigned char* p = aacData;
   for (int i = 0; i < 7; ++i) {
@@ -76,131 +341,89 @@ void AACFileParser::parseADTSHeader(AACAudioFrame& aacframe, unsigned char* aacD
   aacframe.original_copy = (adts >> 29) & 0x01;
   aacframe.home = (adts >> 28) & 0x01;
 
-  adts = 0;
-  for (int i = 7; i < 14; ++i) {
-    adts <<= 8;
-    adts |= p[i];
-  }
-
   aacframe.copyrighted_id_bit = (adts >> 27) & 0x01;
   aacframe.copyrighted_id_start = (adts >> 26) & 0x01;
-  aacframe.aac_frame_length = (adts >> 13) & (static_cast<int>(pow(2, 14)) - 1);
-  aacframe.adts_buffer_fullness = (adts >> 2) & (static_cast<int>(pow(2, 11)) - 1);
+  aacframe.aac_frame_length = (adts >> 13) & 0x1FFF;
+  aacframe.adts_buffer_fullness = (adts >> 2) & 0x7FF;
   aacframe.number_of_raw_data_blocks_in_frame = adts & 0x03;
 
-  auto search = AacFrameSampleRateMap.find(aacframe.sampling_frequency_index);
-  if (AacFrameSampleRateMap.end() != search) {
-    sampleRateHz_ = search->second;
+  if (kAdtsSampleRates[aacframe.sampling_frequency_index] != 0) {
+    sampleRateHz_ = kAdtsSampleRates[aacframe.sampling_frequency_index];
   }
   numberOfChannels_ = aacframe.channel_configuration;
-  printf("aacframe.profile %d, protection_absent %d, sampling_frequency_index %d\n",
-         aacframe.profile, aacframe.protection_absent, aacframe.sampling_frequency_index);
 }
 
-void AACFileParser::getNext(AACAudioFrame& aacframe) {
-  getNext(reinterpret_cast<char*>(aacframe.aac_data_buffer), &aacframe.data_length);
-  parseADTSHeader(aacframe, aacframe.aac_data_buffer);
+bool AACFileParser::getNext(const uint8_t** data, int* length) {
+  if (!hasNext()) {
+    *length = 0;
+    return false;
+  }
+  *length = static_cast<int>(frameLength_);
+  if (live_) {
+    // Stays in the buffer until the next call.
+    *data = live_->data();
+    liveFrameTaken_ = true;
+  } else {
+    *data = mappedFile_->data() + framePos_;
+    findFrame(framePos_ + frameLength_);
+  }
+  frameSamples_ = AdtsFrameSamples(*data, sbr_);
+  return true;
 }
 
-void AACFileParser::getNext(char* buffer, int* length) {
-  if (firstGet_) {
-    getFirstAacDataBuffer(buffer, length);
-    firstGet_ = false;
-    return;
+void AACFileParser::getNext(AACAudioFrame& aacframe) {
+  aacframe.data_length = AACAudioFrame::AACDataBufferSize;
+  getNext(reinterpret_cast<char*>(aacframe.aac_data_buffer), &aacframe.data_length);
+  if (aacframe.data_length > 0) {
+    parseADTSHeader(aacframe, aacframe.aac_data_buffer);
   }
-
-  getAacDataBuffer(buffer, length);
 }
 
-void AACFileParser::readData() {
-  if (isEof_) {
+void AACFileParser::getNext(char* buffer, int* length) {
+  if (!hasNext() || static_cast<int>(frameLength_) > *length) {
+    *length = 0;
     return;
   }
-
-  if (dataEndPos_ > 0 && currentFrameStart_ > 0) {
-    char tmpbuf[4096] = {0};
-    memcpy(tmpbuf, aacDataBuffer_ + currentFrameStart_, dataEndPos_ - currentFrameStart_);
-    memcpy(aacDataBuffer_, tmpbuf, dataEndPos_ - currentFrameStart_);
-    dataEndPos_ = dataEndPos_ - currentFrameStart_;
-    currentFrameStart_ = 0;
-    currentBytePos_ = 2;
-  }
-
-  if (dataEndPos_ == 0) {
-    currentBytePos_ = 2;
-  }
-
-  int buferRemainingSize = kBufferSize - dataEndPos_;
-  while (!isEof_ && buferRemainingSize > 0) {
-    size_t readsize = fread(aacDataBuffer_ + dataEndPos_, 1, buferRemainingSize, aacFile_);
-    if (readsize == 0) {
-      isEof_ = true;
-      continue;
-    }
-    readsize_ += readsize;
-    dataEndPos_ += readsize;
-    buferRemainingSize = kBufferSize - dataEndPos_;
-  }
+  const uint8_t* data = nullptr;
+  getNext(&data, length);
+  memcpy(buffer, data, *length);
 }
 
 agora::rtc::AUDIO_CODEC_TYPE AACFileParser::getCodecType() { return agora::rtc::AUDIO_CODEC_AACLC; }
 
-int AACFileParser::getSampleRateHz() { return sampleRateHz_; }
+int AACFileParser::getSampleRateHz() { return AacOutputSampleRate(sampleRateHz_, sbr_); }
 
 int AACFileParser::getNumberOfChannels() { return numberOfChannels_; }
 
-void AACFileParser::getAacDataBuffer(char* buffer, int* length) {
-  readData();
-  while (currentBytePos_ < dataEndPos_ - 1) {
-    if (aacDataBuffer_[currentBytePos_] == 0xFF && aacDataBuffer_[currentBytePos_ + 1] == 0xF1) {
-      if ((*length) < currentBytePos_ - currentFrameStart_) {
-        *length = 0;
-        return;
-      }
-      *length = currentBytePos_ - currentFrameStart_;
-      memcpy(buffer, aacDataBuffer_ + currentFrameStart_, *length);
+int AACFileParser::getFrameSamples() { return frameSamples_; }
 
-      currentFrameStart_ = currentBytePos_;
-      currentBytePos_ += 2;
-      return;
-    } else {
-      ++currentBytePos_;
-    }
-  }
-  if (isEof_ && currentBytePos_ >= (dataEndPos_ - 1)) {
-    if ((*length) < dataEndPos_ - currentFrameStart_) {
-      *length = 0;
-      return;
-    }
-    *length = dataEndPos_ - currentFrameStart_;
-    memcpy(buffer, aacDataBuffer_ + currentFrameStart_, *length);
+int AACFileParser::reset() {
+  if (live_ || !mappedFile_->isOpen()) {
+    return -1;
   }
+  findFrame(0);
+  resetSampleClock();
+  return 0;
 }
 
-void AACFileParser::getFirstAacDataBuffer(char* buffer, int* length) {
-  *length = firstBufferLength_;
-  memcpy(buffer, firstBuffer_.get(), *length);
-  firstBuffer_ = nullptr;
-}
-
-int AACFileParser::reset() {
-  rewind(aacFile_);
-
-  isEof_ = false;
-  currentBytePos_ = 0;
-  dataEndPos_ = 0;
-
-  currentFrameStart_ = 0;
-  readsize_ = 0;
-  return 0;
+bool AACFileParser::next(AudioFrameView* frame) {
+  const uint8_t* data = nullptr;
+  int length = 0;
+  if (!getNext(&data, &length)) {
+    return false;
+  }
+  frame->data = data;
+  frame->size = length;
+  frame->durationSamples = frameSamples_;
+  frame->flags = 0;
+  stampBySamples(frame);
+  return true;
 }
 
-HEAACFileParser::HEAACFileParser(const char* filepath) : AACFileParser(filepath) {}
+HEAACFileParser::HEAACFileParser(const char* filepath) : AACFileParser(filepath, true) {}
 
 HEAACFileParser::~HEAACFileParser() {}
 
 agora::rtc::AUDIO_CODEC_TYPE HEAACFileParser::getCodecType() {
   return agora::rtc::AUDIO_CODEC_HEAAC;
 }
-
-int HEAACFileParser::getSampleRateHz() { return 48000; }
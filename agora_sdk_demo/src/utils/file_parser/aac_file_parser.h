@@ -9,9 +9,49 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <memory>
 
 #include "audio_file_parser_factory.h"
 
+class LiveStreamReader;
+class MappedFile;
+
+// The fields of an MPEG-4 AudioSpecificConfig (ISO 14496-3 1.6.2.1) that an
+// ADTS header can carry.
+struct AacAudioConfig {
+  // Audio object type of the core coder, 2 for AAC LC.
+  int objectType;
+  // Sampling frequency index of the core coder.
+  int sampleRateIndex;
+  int channelConfig;
+  // Output sample rate, twice the core rate when SBR is signalled.
+  int sampleRateHz;
+  // HE-AAC, signalled explicitly by the SBR or PS object type.
+  bool sbr;
+};
+
+bool ParseAudioSpecificConfig(const uint8_t* data, size_t size, AacAudioConfig* config);
+
+const size_t kAdtsHeaderSize = 7;
+
+// Writes the ADTS header of a raw AAC frame of |payloadSize| bytes. Fails if
+// the object type or the frame length don't fit an ADTS header.
+bool WriteAdtsHeader(const AacAudioConfig& config, size_t payloadSize,
+                     uint8_t header[kAdtsHeaderSize]);
+
+// Returns the aac_frame_length of the ADTS header at |p|, which has |size|
+// bytes left, and fills |config| from it. Returns 0 if there is no plausible
+// header or the frame doesn't fit.
+size_t ParseAdtsHeader(const uint8_t* p, size_t size, AacAudioConfig* config);
+
+// Output rate of a stream whose core coder runs at |coreSampleRateHz|. SBR
+// doubles the rate, except above 24 kHz where decoders run it downsampled.
+int AacOutputSampleRate(int coreSampleRateHz, bool sbr);
+
+// Samples per channel at the output rate the ADTS frame at |p| decodes to,
+// 1024 per raw data block at the core rate. |p| must hold a whole header.
+int AdtsFrameSamples(const uint8_t* p, bool sbr);
+
 typedef struct AACAudioFrame_ {
   constexpr static int AACDataBufferSize = 0x2000;
   uint16_t syncword{0};
@@ -35,9 +75,19 @@ typedef struct AACAudioFrame_ {
   int data_length{0};
 } AACAudioFrame;
 
+// Splits an ADTS file into frames by the aac_frame_length of their headers.
+// A header only counts once the frame after it starts with a matching header
+// too, so sync words inside payloads are never taken for frames. Frames are
+// handed out as views into the memory mapped file. ADTS can't signal SBR, so
+// |sbr| tells whether the file holds HE-AAC, which plays at twice the rate
+// of its headers.
+//
+// Read live, only the first frame waits for the header behind it. Later ones
+// go out as soon as they are complete, checked against the fixed header of
+// the first.
 class AACFileParser : public AudioFileParser {
  public:
-  explicit AACFileParser(const char* filepath);
+  explicit AACFileParser(const char* filepath, bool sbr = false);
   ~AACFileParser();
 
  public:
@@ -50,35 +100,43 @@ class AACFileParser : public AudioFileParser {
   agora::rtc::AUDIO_CODEC_TYPE getCodecType() override;
   int getSampleRateHz() override;
   int getNumberOfChannels() override;
+  int getFrameSamples() override;
 
   int reset() override;
+  // Views point into the mapped file.
+  bool next(AudioFrameView* frame) override;
+  bool viewsStayValid() const override { return !live_; }
+  bool setLiveInput(bool follow) override;
+  void cancel() override;
 
  public:
-  void parseADTSHeader(AACAudioFrame& aacframe, unsigned char* aacData);
+  void parseADTSHeader(AACAudioFrame& aacframe, const unsigned char* aacData);
   void getNext(AACAudioFrame& aacframe);
+  // Points |data| at the next ADTS frame, header included. The view stays
+  // valid as long as the parser, or until the next call when read live.
+  bool getNext(const uint8_t** data, int* length);
 
  private:
-  void readData();
-  void getAacDataBuffer(char* buffer, int* length);
-  void getFirstAacDataBuffer(char* buffer, int* length);
+  bool findFrame(size_t from);
+  // Finds the next frame of the live stream, which then starts its buffer.
+  bool findLiveFrame();
 
  private:
-  static constexpr int kBufferSize = 4096;
-
   char* aacFilePath_;
-  FILE* aacFile_;
-  unsigned char aacDataBuffer_[kBufferSize] = {0};
-  bool isEof_;
-  int currentBytePos_;
-  int dataEndPos_;
-  int currentFrameStart_;
+  std::unique_ptr<MappedFile> mappedFile_;
+  std::unique_ptr<LiveStreamReader> live_;
+  // The frame at the start of the live buffer was handed out.
+  bool liveFrameTaken_;
+  // The next verified frame, valid if |frameLength_| > 0.
+  size_t framePos_;
+  size_t frameLength_;
+  // Fixed header bits of the first frame, which all frames must repeat.
+  uint8_t fixedHeader_[3];
+  bool sbr_;
   int numberOfChannels_;
+  // Core rate from the headers.
   int sampleRateHz_;
-
-  int readsize_ = {0};
-  bool firstGet_;
-  std::unique_ptr<char[]> firstBuffer_;
-  int firstBufferLength_;
+  int frameSamples_;
 };
 
 class HEAACFileParser : public AACFileParser {
@@ -88,5 +146,4 @@ class HEAACFileParser : public AACFileParser {
 
  public:
   agora::rtc::AUDIO_CODEC_TYPE getCodecType() override;
-  int getSampleRateHz() override;
 };
@@ -5,16 +5,72 @@
 //
 #include "audio_file_parser_factory.h"
 
+#include <stdio.h>
 #include <memory>
 
 #if defined(__linux__) && !defined(__ANDROID__)
-#include "ogg_opus_file_parser.h"
+#include "ogg_opus_packet_parser.h"
 #endif
 #include "aac_file_parser.h"
+#include "g711_file_parser.h"
+#include "prefetching_audio_file_parser.h"
 #include "wav_pcm_file_parser.h"
 
+namespace {
+
+// Larger than any frame the parsers hand out, including 10 ms of PCM at
+// 192 kHz stereo.
+const int kMaxAudioFrameSize = 64 * 1024;
+
+}  // namespace
+
 AudioFileParser::~AudioFileParser() {}
 
+bool AudioFileParser::next(AudioFrameView* frame) {
+  copyBuffer_.resize(kMaxAudioFrameSize);
+  int length = 0;
+  while (length <= 0) {
+    if (!hasNext()) {
+      return false;
+    }
+    length = kMaxAudioFrameSize;
+    getNext(copyBuffer_.data(), &length);
+  }
+  frame->data = reinterpret_cast<const uint8_t*>(copyBuffer_.data());
+  frame->size = length;
+  frame->durationSamples = getFrameSamples();
+  frame->flags = 0;
+  stampBySamples(frame);
+  return true;
+}
+
+size_t AudioFileParser::nextBatch(AudioFrameView* frames, size_t count) {
+  bool copy = !viewsStayValid();
+  if (copy && batchStorage_.size() < count) {
+    batchStorage_.resize(count);
+  }
+  size_t filled = 0;
+  while (filled < count && next(&frames[filled])) {
+    if (copy) {
+      std::vector<uint8_t>& storage = batchStorage_[filled];
+      storage.assign(frames[filled].data, frames[filled].data + frames[filled].size);
+      frames[filled].data = storage.data();
+    }
+    ++filled;
+  }
+  return filled;
+}
+
+void AudioFileParser::stampBySamples(AudioFrameView* frame) {
+  int sampleRateHz = getSampleRateHz();
+  if (sampleRateHz <= 0) {
+    frame->ptsUs = 0;
+    return;
+  }
+  frame->ptsUs = playedSamples_ * 1000000 / sampleRateHz;
+  playedSamples_ += frame->durationSamples > 0 ? frame->durationSamples : sampleRateHz / 100;
+}
+
 AudioFileParserFactory& AudioFileParserFactory::Instance() {
   static AudioFileParserFactory factory;
   return factory;
@@ -28,17 +84,44 @@ std::unique_ptr<AudioFileParser> AudioFileParserFactory::createAudioFileParser(
     const char* filepath, AUDIO_FILE_TYPE filetype) {
   std::unique_ptr<AudioFileParser> parser;
   if (filetype == AUDIO_FILE_TYPE::AUDIO_FILE_OPUS) {
-    parser = std::move(createOpusFileParser(filepath));
+    parser = std::move(createOpusFileParser(filepath, false));
+  } else if (filetype == AUDIO_FILE_TYPE::AUDIO_FILE_OPUS_VALIDATE) {
+    parser = std::move(createOpusFileParser(filepath, true));
   } else if (filetype == AUDIO_FILE_TYPE::AUDIO_FILE_AACLC) {
     parser = std::move(createAACFileParser(filepath));
   } else if (filetype == AUDIO_FILE_TYPE::AUDIO_FILE_HEAAC) {
     parser = std::move(createHEAACFileParser(filepath));
   } else if (filetype == AUDIO_FILE_TYPE::AUDIO_FILE_PCM) {
     parser = std::move(createWavPcmFileParser(filepath));
+  } else if (filetype == AUDIO_FILE_TYPE::AUDIO_FILE_PCMU) {
+    parser = std::move(createG711FileParser(filepath, true));
+  } else if (filetype == AUDIO_FILE_TYPE::AUDIO_FILE_PCMA) {
+    parser = std::move(createG711FileParser(filepath, false));
   }
   return std::move(parser);
 }
 
+std::unique_ptr<AudioFileParser> AudioFileParserFactory::createPrefetchingAudioFileParser(
+    const char* filepath, AUDIO_FILE_TYPE filetype, int frames) {
+  std::unique_ptr<AudioFileParser> parser = createAudioFileParser(filepath, filetype);
+  if (!parser) {
+    return nullptr;
+  }
+  return std::unique_ptr<AudioFileParser>(
+      new PrefetchingAudioFileParser(std::move(parser), frames));
+}
+
+std::unique_ptr<AudioFileParser> AudioFileParserFactory::createLiveAudioFileParser(
+    const char* filepath, AUDIO_FILE_TYPE filetype, bool follow, int frames) {
+  std::unique_ptr<AudioFileParser> parser = createAudioFileParser(filepath, filetype);
+  if (!parser || !parser->setLiveInput(follow)) {
+    printf("Audio file type %d can't be read live\n", static_cast<int>(filetype));
+    return nullptr;
+  }
+  return std::unique_ptr<AudioFileParser>(
+      new PrefetchingAudioFileParser(std::move(parser), frames));
+}
+
 std::unique_ptr<AudioFileParser> AudioFileParserFactory::createAACFileParser(const char* filepath) {
   std::unique_ptr<AACFileParser> parser(new AACFileParser(filepath));
   return std::move(parser);
@@ -50,10 +133,10 @@ std::unique_ptr<AudioFileParser> AudioFileParserFactory::createHEAACFileParser(
   return std::move(parser);
 }
 
-std::unique_ptr<AudioFileParser> AudioFileParserFactory::createOpusFileParser(
-    const char* filepath) {
+std::unique_ptr<AudioFileParser> AudioFileParserFactory::createOpusFileParser(const char* filepath,
+                                                                             bool validate) {
 #if defined(__linux__) && !defined(__ANDROID__)
-  std::unique_ptr<OggOpusFileParser> parser(new OggOpusFileParser(filepath));
+  std::unique_ptr<OggOpusPacketParser> parser(new OggOpusPacketParser(filepath, validate));
   return std::move(parser);
 #else
   return nullptr;
@@ -65,3 +148,10 @@ std::unique_ptr<AudioFileParser> AudioFileParserFactory::createWavPcmFileParser(
   std::unique_ptr<WavPcmFileParser> parser(new WavPcmFileParser(filepath));
   return std::move(parser);
 }
+
+std::unique_ptr<AudioFileParser> AudioFileParserFactory::createG711FileParser(const char* filepath,
+                                                                             bool muLaw) {
+  std::unique_ptr<G711FileParser> parser(
+      new G711FileParser(filepath, muLaw ? G711Law::kMuLaw : G711Law::kALaw));
+  return std::move(parser);
+}
@@ -5,22 +5,78 @@
 //
 
 #pragma once
+#include <stddef.h>
 #include <stdint.h>
 #include <memory>
+#include <vector>
 
 #include "AgoraBase.h"
 
+// A frame handed out by AudioFileParser::next(), pointing into the parser's
+// memory instead of a copy.
+struct AudioFrameView {
+  enum Flags : uint32_t {
+    // Decoder priming the receiver drops, like the Opus pre-skip.
+    kPriming = 1,
+  };
+
+  const uint8_t* data;
+  size_t size;
+  // Presentation time relative to the start of the stream.
+  int64_t ptsUs;
+  // Samples per channel at the parser's sample rate, 0 if unknown.
+  uint32_t durationSamples;
+  uint32_t flags;
+};
+
 class AudioFileParser {
  public:
   virtual ~AudioFileParser();
   virtual bool open() = 0;
   virtual bool hasNext() = 0;
+  // Copies the next frame into |buffer|. |length| holds the buffer capacity
+  // on input and 0 on output if the frame doesn't fit.
   virtual void getNext(char* buffer, int* length) = 0;
   virtual agora::rtc::AUDIO_CODEC_TYPE getCodecType() = 0;
   virtual int getSampleRateHz() = 0;
   virtual int getNumberOfChannels() = 0;
   virtual int getBitsPerSample() { return 0; }
+  // Samples per channel, at getSampleRateHz(), in the frame the last
+  // getNext() returned. 0 if the format doesn't tell, senders then count the
+  // frame as 10 ms.
+  virtual int getFrameSamples() { return 0; }
   virtual int reset() { return 0; }
+  // Reads the file as a live stream, see LiveStreamReader, and returns false
+  // if the format can't be read that way. Call before open(). Live parsers
+  // can't reset().
+  virtual bool setLiveInput(bool follow) { return false; }
+  // Wakes up a read blocked on a live stream, so that another thread can
+  // stop the parser. The stream ends there.
+  virtual void cancel() {}
+
+  // Points |frame| at the next frame and returns false at the end. The view
+  // stays valid until the next call, or as long as the parser if
+  // viewsStayValid(). The default copies the frame through getNext() and
+  // times it by the samples before it.
+  virtual bool next(AudioFrameView* frame);
+  // Whether views point into memory that lives as long as the parser, like a
+  // mapped file.
+  virtual bool viewsStayValid() const { return false; }
+  // Fills up to |count| views and returns how many, all of them valid until
+  // the next call. Frames of parsers whose views don't stay valid are copied
+  // aside for that.
+  size_t nextBatch(AudioFrameView* frames, size_t count);
+
+ protected:
+  // Sets the presentation time of |frame| from the samples handed out before
+  // it and counts its samples, 10 ms if unknown. For formats without timing.
+  void stampBySamples(AudioFrameView* frame);
+  void resetSampleClock() { playedSamples_ = 0; }
+
+ private:
+  int64_t playedSamples_{0};
+  std::vector<char> copyBuffer_;
+  std::vector<std::vector<uint8_t>> batchStorage_;
 };
 
 enum class AUDIO_FILE_TYPE : uint8_t {
@@ -28,7 +84,12 @@ enum class AUDIO_FILE_TYPE : uint8_t {
   AUDIO_FILE_HEAAC,
   AUDIO_FILE_OPUS,
   AUDIO_FILE_PCM,
-  AUDIO_FILE_FIX_LENGTH_FRAME
+  AUDIO_FILE_FIX_LENGTH_FRAME,
+  // Ogg Opus, with every packet checked against an opusfile decode.
+  AUDIO_FILE_OPUS_VALIDATE,
+  // A WAV file encoded to G.711 while it is read.
+  AUDIO_FILE_PCMU,
+  AUDIO_FILE_PCMA
 };
 
 class AudioFileParserFactory {
@@ -38,12 +99,23 @@ class AudioFileParserFactory {
 
   std::unique_ptr<AudioFileParser> createAudioFileParser(const char* filepath,
                                                          AUDIO_FILE_TYPE filetype);
+  // Same parser, read on a background thread up to |frames| frames ahead.
+  std::unique_ptr<AudioFileParser> createPrefetchingAudioFileParser(const char* filepath,
+                                                                    AUDIO_FILE_TYPE filetype,
+                                                                    int frames);
+  // Reads |filepath| live, "-" for stdin, on a background thread that hands
+  // over every frame as soon as it is complete and blocks the writer once
+  // |frames| frames wait. With |follow| a regular file is read while it grows.
+  std::unique_ptr<AudioFileParser> createLiveAudioFileParser(const char* filepath,
+                                                             AUDIO_FILE_TYPE filetype,
+                                                             bool follow, int frames);
 
  private:
   std::unique_ptr<AudioFileParser> createAACFileParser(const char* filepath);
   std::unique_ptr<AudioFileParser> createHEAACFileParser(const char* filepath);
-  std::unique_ptr<AudioFileParser> createOpusFileParser(const char* filepath);
+  std::unique_ptr<AudioFileParser> createOpusFileParser(const char* filepath, bool validate);
   std::unique_ptr<AudioFileParser> createWavPcmFileParser(const char* filepath);
+  std::unique_ptr<AudioFileParser> createG711FileParser(const char* filepath, bool muLaw);
 
  private:
   AudioFileParserFactory();
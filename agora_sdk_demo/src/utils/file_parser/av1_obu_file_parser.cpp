@@ -0,0 +1,257 @@
+//  Agora RTC/MEDIA SDK
+//
+//  Copyright (c) 2020 Agora.io. All rights reserved.
+//
+
+#include "av1_obu_file_parser.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "utils/bitbuffer.h"
+#include "utils/mapped_file.h"
+
+// frame_type of the uncompressed header.
+static const uint32_t kAv1KeyFrame = 0;
+
+size_t ReadLeb128(const uint8_t* data, size_t size, uint64_t* value) {
+  uint64_t result = 0;
+  for (size_t i = 0; i < 8 && i < size; ++i) {
+    result |= static_cast<uint64_t>(data[i] & 0x7F) << (i * 7);
+    if (!(data[i] & 0x80)) {
+      *value = result;
+      return i + 1;
+    }
+  }
+  return 0;
+}
+
+bool ParseAv1Obu(const uint8_t* data, size_t size, Av1Obu* obu) {
+  if (size < 1 || (data[0] & 0x80)) {
+    // Empty buffer or forbidden bit set.
+    return false;
+  }
+  bool hasExtension = (data[0] & 0x04) != 0;
+  bool hasSizeField = (data[0] & 0x02) != 0;
+  size_t headerSize = hasExtension ? 2 : 1;
+  if (headerSize > size) {
+    return false;
+  }
+  uint64_t payloadSize = size - headerSize;
+  if (hasSizeField) {
+    size_t leb128Size = ReadLeb128(data + headerSize, size - headerSize, &payloadSize);
+    if (leb128Size == 0) {
+      return false;
+    }
+    headerSize += leb128Size;
+    if (payloadSize > size - headerSize) {
+      return false;
+    }
+  }
+  obu->type = static_cast<Av1ObuType>((data[0] >> 3) & 0x0F);
+  obu->payload = data + headerSize;
+  obu->payloadSize = payloadSize;
+  obu->totalSize = headerSize + payloadSize;
+  return true;
+}
+
+// uvlc() of AV1 4.10.3.
+static bool ReadUvlc(CachedBitBuffer* reader, uint32_t* value) {
+  uint32_t leadingZeros = 0;
+  uint32_t bit = 0;
+  while (true) {
+    if (!reader->ReadBits(&bit, 1)) {
+      return false;
+    }
+    if (bit) {
+      break;
+    }
+    ++leadingZeros;
+  }
+  if (leadingZeros >= 32) {
+    *value = UINT32_MAX;
+    return true;
+  }
+  uint32_t bits = 0;
+  if (leadingZeros > 0 && !reader->ReadBits(&bits, leadingZeros)) {
+    return false;
+  }
+  *value = bits + (1u << leadingZeros) - 1;
+  return true;
+}
+
+bool ParseAv1SequenceHeader(const uint8_t* payload, size_t size, Av1SequenceHeader* header) {
+  CachedBitBuffer reader(payload, size);
+  uint32_t seqProfile = 0;
+  uint32_t stillPicture = 0;
+  uint32_t reducedStillPictureHeader = 0;
+  if (!reader.ReadBits(&seqProfile, 3) || !reader.ReadBits(&stillPicture, 1) ||
+      !reader.ReadBits(&reducedStillPictureHeader, 1)) {
+    return false;
+  }
+  memset(header, 0, sizeof(*header));
+  header->reducedStillPictureHeader = reducedStillPictureHeader != 0;
+
+  uint32_t value = 0;
+  if (reducedStillPictureHeader) {
+    // seq_level_idx[0]
+    if (!reader.ConsumeBits(5)) {
+      return false;
+    }
+  } else {
+    uint32_t timingInfoPresent = 0;
+    uint32_t decoderModelInfoPresent = 0;
+    uint32_t bufferDelayLength = 0;
+    if (!reader.ReadBits(&timingInfoPresent, 1)) {
+      return false;
+    }
+    if (timingInfoPresent) {
+      uint32_t equalPictureInterval = 0;
+      if (!reader.ReadUInt32(&header->numUnitsInDisplayTick) ||
+          !reader.ReadUInt32(&header->timeScale) || !reader.ReadBits(&equalPictureInterval, 1)) {
+        return false;
+      }
+      if (equalPictureInterval && !ReadUvlc(&reader, &value)) {
+        return false;
+      }
+      if (!reader.ReadBits(&decoderModelInfoPresent, 1)) {
+        return false;
+      }
+      if (decoderModelInfoPresent) {
+        // buffer_delay_length_minus_1, num_units_in_decoding_tick,
+        // buffer_removal_time_length_minus_1 and
+        // frame_presentation_time_length_minus_1.
+        if (!reader.ReadBits(&bufferDelayLength, 5) || !reader.ConsumeBits(32 + 5 + 5)) {
+          return false;
+        }
+        ++bufferDelayLength;
+      }
+    }
+    uint32_t initialDisplayDelayPresent = 0;
+    uint32_t operatingPointsCount = 0;
+    if (!reader.ReadBits(&initialDisplayDelayPresent, 1) ||
+        !reader.ReadBits(&operatingPointsCount, 5)) {
+      return false;
+    }
+    for (uint32_t i = 0; i <= operatingPointsCount; ++i) {
+      uint32_t seqLevelIdx = 0;
+      // operating_point_idc, then seq_level_idx and seq_tier.
+      if (!reader.ConsumeBits(12) || !reader.ReadBits(&seqLevelIdx, 5) ||
+          (seqLevelIdx > 7 && !reader.ConsumeBits(1))) {
+        return false;
+      }
+      if (decoderModelInfoPresent) {
+        if (!reader.ReadBits(&value, 1)) {
+          return false;
+        }
+        // operating_parameters_info()
+        if (value && !reader.ConsumeBits(2 * bufferDelayLength + 1)) {
+          return false;
+        }
+      }
+      if (initialDisplayDelayPresent) {
+        if (!reader.ReadBits(&value, 1) || (value && !reader.ConsumeBits(4))) {
+          return false;
+        }
+      }
+    }
+  }
+
+  uint32_t widthBits = 0;
+  uint32_t heightBits = 0;
+  uint32_t maxWidth = 0;
+  uint32_t maxHeight = 0;
+  if (!reader.ReadBits(&widthBits, 4) || !reader.ReadBits(&heightBits, 4) ||
+      !reader.ReadBits(&maxWidth, widthBits + 1) || !reader.ReadBits(&maxHeight, heightBits + 1)) {
+    return false;
+  }
+  header->maxFrameWidth = static_cast<int>(maxWidth) + 1;
+  header->maxFrameHeight = static_cast<int>(maxHeight) + 1;
+  return true;
+}
+
+bool IsAv1KeyTemporalUnit(const uint8_t* data, size_t size, Av1SequenceHeader* sequenceHeader,
+                          bool* hasSequenceHeader) {
+  size_t pos = 0;
+  Av1Obu obu;
+  while (pos < size && ParseAv1Obu(data + pos, size - pos, &obu)) {
+    pos += obu.totalSize;
+    if (obu.type == kAv1ObuSequenceHeader) {
+      Av1SequenceHeader header;
+      if (ParseAv1SequenceHeader(obu.payload, obu.payloadSize, &header)) {
+        *sequenceHeader = header;
+        *hasSequenceHeader = true;
+      }
+    } else if (obu.type == kAv1ObuFrameHeader || obu.type == kAv1ObuFrame) {
+      if (!*hasSequenceHeader) {
+        // Undecodable until a sequence header shows up.
+        return false;
+      }
+      if (sequenceHeader->reducedStillPictureHeader) {
+        return true;
+      }
+      CachedBitBuffer reader(obu.payload, obu.payloadSize);
+      uint32_t showExistingFrame = 0;
+      uint32_t frameType = 0;
+      if (!reader.ReadBits(&showExistingFrame, 1) || showExistingFrame ||
+          !reader.ReadBits(&frameType, 2)) {
+        return false;
+      }
+      return frameType == kAv1KeyFrame;
+    }
+  }
+  return false;
+}
+
+Av1ObuFileParser::Av1ObuFileParser(const char* filepath)
+    : mappedFile_(new MappedFile(filepath)), pos_(0), hasSequenceHeader_(false) {
+  memset(&sequenceHeader_, 0, sizeof(sequenceHeader_));
+}
+
+Av1ObuFileParser::~Av1ObuFileParser() = default;
+
+bool Av1ObuFileParser::open() {
+  if (!mappedFile_->open(MappedFile::kAdviceSequential)) {
+    return false;
+  }
+  Av1Obu obu;
+  if (!ParseAv1Obu(mappedFile_->data(), mappedFile_->size(), &obu) ||
+      obu.type != kAv1ObuTemporalDelimiter) {
+    printf("%s is not an AV1 low overhead bitstream\n", mappedFile_->path());
+    mappedFile_->close();
+    return false;
+  }
+  return true;
+}
+
+bool Av1ObuFileParser::hasNext() const {
+  return mappedFile_->isOpen() && pos_ < mappedFile_->size();
+}
+
+void Av1ObuFileParser::reset() { pos_ = 0; }
+
+bool Av1ObuFileParser::getNextTemporalUnit(const uint8_t** data, int* length, bool* keyFrame) {
+  if (!hasNext()) {
+    return false;
+  }
+  const uint8_t* begin = mappedFile_->data() + pos_;
+  const size_t remaining = mappedFile_->size() - pos_;
+  size_t unitSize = 0;
+  Av1Obu obu;
+  while (unitSize < remaining && ParseAv1Obu(begin + unitSize, remaining - unitSize, &obu)) {
+    if (obu.type == kAv1ObuTemporalDelimiter && unitSize > 0) {
+      break;
+    }
+    unitSize += obu.totalSize;
+  }
+  if (unitSize == 0) {
+    // Garbage where an OBU was expected.
+    pos_ = mappedFile_->size();
+    return false;
+  }
+  *data = begin;
+  *length = static_cast<int>(unitSize);
+  *keyFrame = IsAv1KeyTemporalUnit(begin, unitSize, &sequenceHeader_, &hasSequenceHeader_);
+  pos_ += unitSize;
+  return true;
+}
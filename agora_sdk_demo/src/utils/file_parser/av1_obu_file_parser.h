@@ -0,0 +1,86 @@
+//  Agora RTC/MEDIA SDK
+//
+//  Copyright (c) 2020 Agora.io. All rights reserved.
+//
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <memory>
+
+class MappedFile;
+
+enum Av1ObuType : uint8_t {
+  kAv1ObuSequenceHeader = 1,
+  kAv1ObuTemporalDelimiter = 2,
+  kAv1ObuFrameHeader = 3,
+  kAv1ObuTileGroup = 4,
+  kAv1ObuMetadata = 5,
+  kAv1ObuFrame = 6,
+  kAv1ObuRedundantFrameHeader = 7,
+  kAv1ObuTileList = 8,
+  kAv1ObuPadding = 15,
+};
+
+// One OBU as laid out in the low overhead bitstream format (AV1 5.2).
+struct Av1Obu {
+  Av1ObuType type;
+  const uint8_t* payload;
+  size_t payloadSize;
+  // Header, optional extension and size field plus payload.
+  size_t totalSize;
+};
+
+// The sequence header fields needed to split and pace a stream.
+struct Av1SequenceHeader {
+  bool reducedStillPictureHeader;
+  int maxFrameWidth;
+  int maxFrameHeight;
+  // Display rate from timing_info(), zero when not present.
+  uint32_t numUnitsInDisplayTick;
+  uint32_t timeScale;
+};
+
+// Reads an unsigned LEB128 value of at most 8 bytes. Returns the number of
+// bytes consumed, or 0 if |data| is truncated or the value is malformed.
+size_t ReadLeb128(const uint8_t* data, size_t size, uint64_t* value);
+
+// Parses the OBU at the start of [data, data + size). An OBU without
+// obu_has_size_field extends to the end of the buffer.
+bool ParseAv1Obu(const uint8_t* data, size_t size, Av1Obu* obu);
+
+bool ParseAv1SequenceHeader(const uint8_t* payload, size_t size, Av1SequenceHeader* header);
+
+// Tells whether the temporal unit in [data, data + size) starts with a key
+// frame, i.e. its first frame header has frame_type KEY_FRAME. Sequence
+// headers found on the way are stored in |sequenceHeader|, which must carry
+// the last one seen so far since frame headers depend on it.
+bool IsAv1KeyTemporalUnit(const uint8_t* data, size_t size, Av1SequenceHeader* sequenceHeader,
+                          bool* hasSequenceHeader);
+
+// Splits a low overhead format AV1 file (a raw ".obu" stream) into temporal
+// units, each starting at a temporal delimiter OBU. Units are handed out as
+// views into the mapped file.
+class Av1ObuFileParser {
+ public:
+  explicit Av1ObuFileParser(const char* filepath);
+  virtual ~Av1ObuFileParser();
+
+  bool open();
+  bool hasNext() const;
+  // Points |data| at the next temporal unit, which stays valid as long as the
+  // parser. |keyFrame| tells whether it starts with a key frame.
+  bool getNextTemporalUnit(const uint8_t** data, int* length, bool* keyFrame);
+  void reset();
+
+  // The last sequence header seen, valid once |hasSequenceHeader()|.
+  bool hasSequenceHeader() const { return hasSequenceHeader_; }
+  const Av1SequenceHeader& sequenceHeader() const { return sequenceHeader_; }
+
+ private:
+  std::unique_ptr<MappedFile> mappedFile_;
+  size_t pos_;
+  Av1SequenceHeader sequenceHeader_;
+  bool hasSequenceHeader_;
+};
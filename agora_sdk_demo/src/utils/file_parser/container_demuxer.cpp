@@ -0,0 +1,138 @@
+//  Agora RTC/MEDIA SDK
+//
+//  Copyright (c) 2020 Agora.io. All rights reserved.
+//
+
+#include "container_demuxer.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "flv_demuxer.h"
+#include "mp4_demuxer.h"
+#include "ts_demuxer.h"
+#include "utils/ts_packet_sync.h"
+
+namespace {
+
+// Enough for three TS packets.
+const size_t kProbeSize = 3 * kTsPacketSize;
+
+bool IsMp4(const uint8_t* head, size_t size) {
+  // Files start with a box, usually ftyp. Fragments may start with styp.
+  static const char* const kLeadingBoxes[] = {"ftyp", "styp", "moov", "moof",
+                                              "mdat", "free", "skip", "wide"};
+  if (size < 8) {
+    return false;
+  }
+  for (const char* box : kLeadingBoxes) {
+    if (memcmp(head + 4, box, 4) == 0) {
+      return true;
+    }
+  }
+  return false;
+}
+
+void AppendAnnexB(const uint8_t* nal, size_t size, std::vector<uint8_t>* out) {
+  static const uint8_t kStartCode[4] = {0, 0, 0, 1};
+  out->insert(out->end(), kStartCode, kStartCode + sizeof(kStartCode));
+  out->insert(out->end(), nal, nal + size);
+}
+
+// Appends the NAL units of |count| arrays of 16 bit length prefixed units, as
+// found in avcC and hvcC.
+bool AppendParameterSets(const uint8_t* data, size_t size, size_t* pos, int count,
+                         std::vector<uint8_t>* out) {
+  for (int i = 0; i < count; ++i) {
+    if (size - *pos < 2) {
+      return false;
+    }
+    size_t length = data[*pos] << 8 | data[*pos + 1];
+    *pos += 2;
+    if (length > size - *pos) {
+      return false;
+    }
+    AppendAnnexB(data + *pos, length, out);
+    *pos += length;
+  }
+  return true;
+}
+
+}  // namespace
+
+ContainerDemuxer::~ContainerDemuxer() {}
+
+std::unique_ptr<ContainerDemuxer> ContainerDemuxer::create(const char* filepath) {
+  uint8_t head[kProbeSize] = {0};
+  size_t size = 0;
+  FILE* file = fopen(filepath, "rb");
+  if (file) {
+    size = fread(head, 1, sizeof(head), file);
+    fclose(file);
+  }
+  if (FlvDemuxer::probe(head, size)) {
+    return std::unique_ptr<ContainerDemuxer>(new FlvDemuxer(filepath));
+  }
+  if (IsMp4(head, size)) {
+    return std::unique_ptr<ContainerDemuxer>(new Mp4Demuxer(filepath));
+  }
+  if (TsDemuxer::probe(head, size)) {
+    return std::unique_ptr<ContainerDemuxer>(new TsDemuxer(filepath));
+  }
+  printf("Unsupported container format %s\n", filepath);
+  return nullptr;
+}
+
+bool ParseAvcDecoderConfig(const uint8_t* data, size_t size, int* nalLengthSize,
+                           std::vector<uint8_t>* parameterSets) {
+  if (size < 7) {
+    return false;
+  }
+  *nalLengthSize = (data[4] & 0x03) + 1;
+  size_t pos = 5;
+  int spsCount = data[pos++] & 0x1F;
+  if (!AppendParameterSets(data, size, &pos, spsCount, parameterSets) || pos >= size) {
+    return false;
+  }
+  int ppsCount = data[pos++];
+  return AppendParameterSets(data, size, &pos, ppsCount, parameterSets);
+}
+
+bool ParseHevcDecoderConfig(const uint8_t* data, size_t size, int* nalLengthSize,
+                            std::vector<uint8_t>* parameterSets) {
+  if (size < 23) {
+    return false;
+  }
+  *nalLengthSize = (data[21] & 0x03) + 1;
+  int arrays = data[22];
+  size_t pos = 23;
+  for (int i = 0; i < arrays; ++i) {
+    if (size - pos < 3) {
+      return false;
+    }
+    int count = data[pos + 1] << 8 | data[pos + 2];
+    pos += 3;
+    if (!AppendParameterSets(data, size, &pos, count, parameterSets)) {
+      return false;
+    }
+  }
+  return true;
+}
+
+void AppendLengthPrefixedNalUnits(const uint8_t* data, size_t size, int nalLengthSize,
+                                  std::vector<uint8_t>* out) {
+  const size_t lengthSize = static_cast<size_t>(nalLengthSize);
+  size_t pos = 0;
+  while (size - pos > lengthSize) {
+    size_t nalSize = 0;
+    for (size_t i = 0; i < lengthSize; ++i) {
+      nalSize = nalSize << 8 | data[pos + i];
+    }
+    pos += lengthSize;
+    if (nalSize > size - pos) {
+      break;
+    }
+    AppendAnnexB(data + pos, nalSize, out);
+    pos += nalSize;
+  }
+}
@@ -0,0 +1,77 @@
+//  Agora RTC/MEDIA SDK
+//
+//  Copyright (c) 2020 Agora.io. All rights reserved.
+//
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <memory>
+#include <vector>
+
+#include "AgoraBase.h"
+
+struct ContainerTrack {
+  enum Type { kVideo, kAudio };
+
+  Type type;
+  // Only the codec of the track's type is meaningful.
+  agora::rtc::VIDEO_CODEC_TYPE videoCodec;
+  agora::rtc::AUDIO_CODEC_TYPE audioCodec;
+  int width;
+  int height;
+  int sampleRateHz;
+  int numberOfChannels;
+};
+
+// One access unit or audio frame, in the form the SDK senders take it: video
+// as Annex-B with the parameter sets in front of key frames, AAC with an ADTS
+// header.
+struct ContainerSample {
+  // Index into ContainerDemuxer::tracks().
+  int track;
+  const uint8_t* data;
+  int length;
+  int64_t dtsUs;
+  int64_t ptsUs;
+  bool keyFrame;
+};
+
+// Splits a multiplexed file into the samples of its H.264, H.265 and AAC
+// tracks, interleaved in decode order so one thread can pace all of them.
+// Tracks in other codecs are left out.
+class ContainerDemuxer {
+ public:
+  virtual ~ContainerDemuxer();
+
+  // Picks the demuxer by the first bytes of |filepath|. Returns nullptr for
+  // formats that aren't supported.
+  static std::unique_ptr<ContainerDemuxer> create(const char* filepath);
+
+  virtual bool open() = 0;
+  // The next sample of any track. Its data stays valid until the next call.
+  virtual bool getNext(ContainerSample* sample) = 0;
+  virtual int reset() = 0;
+
+  const std::vector<ContainerTrack>& tracks() const { return tracks_; }
+
+ protected:
+  std::vector<ContainerTrack> tracks_;
+};
+
+// Helpers for containers that store H.264/H.265 as length prefixed NAL units,
+// as MP4 and FLV do.
+
+// Appends the parameter sets of an AVCDecoderConfigurationRecord (ISO
+// 14496-15 5.3.3.1) or an HEVCDecoderConfigurationRecord to |parameterSets|
+// as Annex-B, and returns the size of the NAL unit length fields of samples.
+bool ParseAvcDecoderConfig(const uint8_t* data, size_t size, int* nalLengthSize,
+                           std::vector<uint8_t>* parameterSets);
+bool ParseHevcDecoderConfig(const uint8_t* data, size_t size, int* nalLengthSize,
+                            std::vector<uint8_t>* parameterSets);
+
+// Appends the NAL units of a sample with |nalLengthSize| byte length fields to
+// |out| as Annex-B. Stops at a length running past the end of the sample.
+void AppendLengthPrefixedNalUnits(const uint8_t* data, size_t size, int nalLengthSize,
+                                  std::vector<uint8_t>* out);
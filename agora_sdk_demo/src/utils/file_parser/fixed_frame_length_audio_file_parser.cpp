@@ -4,6 +4,7 @@
 //  Copyright (c) 2020 Agora.io. All rights reserved.
 //
 
+#include <stdlib.h>
 #include <string.h>
 
 #include "fixed_frame_length_audio_file_parser.h"
@@ -63,6 +64,19 @@ void FixedFrameLengthAudioFileParser::getNext(char* buffer, int* length) {
   currentBufPos_ += frameLength_;
 }
 
+bool FixedFrameLengthAudioFileParser::next(AudioFrameView* frame) {
+  if (!hasNext()) {
+    return false;
+  }
+  frame->data = dataBuffer_ + currentBufPos_;
+  frame->size = frameLength_;
+  frame->durationSamples = 0;
+  frame->flags = 0;
+  stampBySamples(frame);
+  currentBufPos_ += frameLength_;
+  return true;
+}
+
 agora::rtc::AUDIO_CODEC_TYPE FixedFrameLengthAudioFileParser::getCodecType() { return audioCodec_; }
 
 int FixedFrameLengthAudioFileParser::getSampleRateHz() { return sampleRateHz_; }
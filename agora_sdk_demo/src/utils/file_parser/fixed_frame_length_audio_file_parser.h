@@ -19,6 +19,8 @@ class FixedFrameLengthAudioFileParser : public AudioFileParser {
   bool hasNext() override;
 
   void getNext(char* buffer, int* length) override;
+  // Points into the read buffer, frames are timed as 10 ms each.
+  bool next(AudioFrameView* frame) override;
 
   agora::rtc::AUDIO_CODEC_TYPE getCodecType() override;
   int getSampleRateHz() override;
@@ -0,0 +1,302 @@
+//  Agora RTC/MEDIA SDK
+//
+//  Copyright (c) 2020 Agora.io. All rights reserved.
+//
+
+#include "flv_demuxer.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+namespace {
+
+// Holds any tag up to 4 MB, larger ones are skipped.
+const size_t kBufferSize = 4 * 1024 * 1024;
+
+const size_t kFileHeaderSize = 9;
+const size_t kTagHeaderSize = 11;
+const size_t kPreviousTagSizeSize = 4;
+
+const uint8_t kTagTypeAudio = 8;
+const uint8_t kTagTypeVideo = 9;
+const uint8_t kTagFilter = 0x20;
+
+const uint8_t kHasAudioFlag = 0x04;
+const uint8_t kHasVideoFlag = 0x01;
+
+const int kVideoCodecAvc = 7;
+// Not in the spec, but what RTMP servers in China and most tools use.
+const int kVideoCodecHevc = 12;
+const int kVideoFrameTypeKey = 1;
+const int kSoundFormatAac = 10;
+const int kPacketTypeSequenceHeader = 0;
+const int kPacketTypeNalu = 1;
+
+// Tags read in open() to find the sequence headers.
+const int kMaxProbeTags = 100;
+
+uint32_t Be24(const uint8_t* p) { return p[0] << 16 | p[1] << 8 | p[2]; }
+
+}  // namespace
+
+FlvDemuxer::FlvDemuxer(const char* filepath)
+    : filePath_(strdup(filepath)),
+      file_(nullptr),
+      dataOffset_(0),
+      bufferPos_(0),
+      bufferEnd_(0),
+      videoTrack_(-1),
+      audioTrack_(-1),
+      nalLengthSize_(4),
+      hasAacConfig_(false) {
+  memset(&aacConfig_, 0, sizeof(aacConfig_));
+}
+
+FlvDemuxer::~FlvDemuxer() {
+  if (file_) {
+    fclose(file_);
+  }
+  free(static_cast<void*>(filePath_));
+}
+
+bool FlvDemuxer::probe(const uint8_t* data, size_t size) {
+  return size >= kFileHeaderSize && data[0] == 'F' && data[1] == 'L' && data[2] == 'V' &&
+         data[3] == 1;
+}
+
+bool FlvDemuxer::open() {
+  if (file_) {
+    return reset() == 0;
+  }
+  file_ = fopen(filePath_, "rb");
+  if (!file_) {
+    printf("Open test file %s failed\n", filePath_);
+    return false;
+  }
+  buffer_.resize(kBufferSize);
+  if (!fill(kFileHeaderSize) || !probe(buffer_.data(), kFileHeaderSize)) {
+    printf("Not an FLV file %s\n", filePath_);
+    fclose(file_);
+    file_ = nullptr;
+    return false;
+  }
+  const uint8_t* header = buffer_.data();
+  bool hasAudio = (header[4] & kHasAudioFlag) != 0;
+  bool hasVideo = (header[4] & kHasVideoFlag) != 0;
+  uint32_t headerSize = static_cast<uint32_t>(header[5]) << 24 | Be24(header + 6);
+  dataOffset_ = headerSize + kPreviousTagSizeSize;
+
+  // The tracks come from the sequence headers at the start.
+  rewind();
+  ContainerSample sample;
+  for (int tags = 0; tags < kMaxProbeTags; ++tags) {
+    if ((!hasVideo || videoTrack_ >= 0) && (!hasAudio || audioTrack_ >= 0)) {
+      break;
+    }
+    if (readTag(&sample) < 0) {
+      break;
+    }
+  }
+  if (tracks_.empty()) {
+    printf("No AVC, HEVC or AAC tags in %s\n", filePath_);
+    fclose(file_);
+    file_ = nullptr;
+    return false;
+  }
+  rewind();
+  return true;
+}
+
+bool FlvDemuxer::fill(size_t size) {
+  if (bufferEnd_ - bufferPos_ >= size) {
+    return true;
+  }
+  if (size > buffer_.size()) {
+    return false;
+  }
+  memmove(buffer_.data(), buffer_.data() + bufferPos_, bufferEnd_ - bufferPos_);
+  bufferEnd_ -= bufferPos_;
+  bufferPos_ = 0;
+  while (bufferEnd_ < size) {
+    size_t read = fread(buffer_.data() + bufferEnd_, 1, buffer_.size() - bufferEnd_, file_);
+    if (read == 0) {
+      return false;
+    }
+    bufferEnd_ += read;
+  }
+  return true;
+}
+
+bool FlvDemuxer::skip(size_t size) {
+  size_t buffered = bufferEnd_ - bufferPos_;
+  if (size <= buffered) {
+    bufferPos_ += size;
+    return true;
+  }
+  bufferPos_ = 0;
+  bufferEnd_ = 0;
+  return fseek(file_, static_cast<long>(size - buffered), SEEK_CUR) == 0;
+}
+
+int FlvDemuxer::readTag(ContainerSample* sample) {
+  if (!fill(kTagHeaderSize)) {
+    return -1;
+  }
+  const uint8_t* header = buffer_.data() + bufferPos_;
+  uint8_t type = header[0] & 0x1F;
+  bool filtered = (header[0] & kTagFilter) != 0;
+  size_t dataSize = Be24(header + 1);
+  // 24 bits and 8 extended bits above them.
+  int64_t timestampMs = static_cast<uint32_t>(header[7]) << 24 | Be24(header + 4);
+  bufferPos_ += kTagHeaderSize;
+
+  size_t tagSize = dataSize + kPreviousTagSizeSize;
+  if (filtered || (type != kTagTypeVideo && type != kTagTypeAudio)) {
+    return skip(tagSize) ? 0 : -1;
+  }
+  if (!fill(tagSize)) {
+    if (tagSize > buffer_.size()) {
+      printf("Skip FLV tag of %zu bytes in %s\n", dataSize, filePath_);
+      return skip(tagSize) ? 0 : -1;
+    }
+    return -1;
+  }
+  // Stays valid until the next fill, the tag is converted before that.
+  const uint8_t* data = buffer_.data() + bufferPos_;
+  bufferPos_ += tagSize;
+  bool hasSample = type == kTagTypeVideo ? readVideoTag(data, dataSize, timestampMs, sample)
+                                         : readAudioTag(data, dataSize, timestampMs, sample);
+  return hasSample ? 1 : 0;
+}
+
+bool FlvDemuxer::readVideoTag(const uint8_t* data, size_t size, int64_t timestampMs,
+                              ContainerSample* sample) {
+  // FrameType, CodecID, AVCPacketType and CompositionTime.
+  const size_t kVideoTagHeaderSize = 5;
+  if (size < kVideoTagHeaderSize) {
+    return false;
+  }
+  int frameType = data[0] >> 4;
+  int codecId = data[0] & 0x0F;
+  if (codecId != kVideoCodecAvc && codecId != kVideoCodecHevc) {
+    return false;
+  }
+  int packetType = data[1];
+  // Signed 24 bits.
+  int32_t compositionTimeMs = static_cast<int32_t>(Be24(data + 2) << 8) >> 8;
+  const uint8_t* payload = data + kVideoTagHeaderSize;
+  size_t payloadSize = size - kVideoTagHeaderSize;
+
+  if (packetType == kPacketTypeSequenceHeader) {
+    parameterSets_.clear();
+    bool parsed = codecId == kVideoCodecAvc
+                      ? ParseAvcDecoderConfig(payload, payloadSize, &nalLengthSize_,
+                                              &parameterSets_)
+                      : ParseHevcDecoderConfig(payload, payloadSize, &nalLengthSize_,
+                                               &parameterSets_);
+    if (!parsed) {
+      printf("Bad video sequence header in %s\n", filePath_);
+      parameterSets_.clear();
+      return false;
+    }
+    if (videoTrack_ < 0) {
+      videoTrack_ = addTrack(ContainerTrack::kVideo);
+      tracks_[videoTrack_].videoCodec =
+          codecId == kVideoCodecAvc ? agora::rtc::VIDEO_CODEC_H264 : agora::rtc::VIDEO_CODEC_H265;
+    }
+    return false;
+  }
+  if (packetType != kPacketTypeNalu || videoTrack_ < 0) {
+    return false;
+  }
+
+  bool keyFrame = frameType == kVideoFrameTypeKey;
+  sampleBuffer_.clear();
+  if (keyFrame) {
+    sampleBuffer_ = parameterSets_;
+  }
+  AppendLengthPrefixedNalUnits(payload, payloadSize, nalLengthSize_, &sampleBuffer_);
+  if (sampleBuffer_.empty()) {
+    return false;
+  }
+  sample->track = videoTrack_;
+  sample->data = sampleBuffer_.data();
+  sample->length = static_cast<int>(sampleBuffer_.size());
+  sample->dtsUs = timestampMs * 1000;
+  sample->ptsUs = (timestampMs + compositionTimeMs) * 1000;
+  sample->keyFrame = keyFrame;
+  return true;
+}
+
+bool FlvDemuxer::readAudioTag(const uint8_t* data, size_t size, int64_t timestampMs,
+                              ContainerSample* sample) {
+  // SoundFormat and friends, and AACPacketType.
+  const size_t kAacTagHeaderSize = 2;
+  if (size < kAacTagHeaderSize || (data[0] >> 4) != kSoundFormatAac) {
+    return false;
+  }
+  const uint8_t* payload = data + kAacTagHeaderSize;
+  size_t payloadSize = size - kAacTagHeaderSize;
+
+  if (data[1] == kPacketTypeSequenceHeader) {
+    AacAudioConfig config;
+    if (!ParseAudioSpecificConfig(payload, payloadSize, &config)) {
+      printf("Bad AAC sequence header in %s\n", filePath_);
+      return false;
+    }
+    aacConfig_ = config;
+    hasAacConfig_ = true;
+    if (audioTrack_ < 0) {
+      audioTrack_ = addTrack(ContainerTrack::kAudio);
+    }
+    ContainerTrack& track = tracks_[audioTrack_];
+    track.audioCodec = config.sbr ? agora::rtc::AUDIO_CODEC_HEAAC : agora::rtc::AUDIO_CODEC_AACLC;
+    track.sampleRateHz = config.sampleRateHz;
+    track.numberOfChannels = config.channelConfig;
+    return false;
+  }
+  uint8_t header[kAdtsHeaderSize];
+  if (!hasAacConfig_ || audioTrack_ < 0 || !WriteAdtsHeader(aacConfig_, payloadSize, header)) {
+    return false;
+  }
+  sampleBuffer_.assign(header, header + sizeof(header));
+  sampleBuffer_.insert(sampleBuffer_.end(), payload, payload + payloadSize);
+  sample->track = audioTrack_;
+  sample->data = sampleBuffer_.data();
+  sample->length = static_cast<int>(sampleBuffer_.size());
+  sample->dtsUs = timestampMs * 1000;
+  sample->ptsUs = sample->dtsUs;
+  sample->keyFrame = true;
+  return true;
+}
+
+int FlvDemuxer::addTrack(ContainerTrack::Type type) {
+  ContainerTrack track;
+  memset(&track, 0, sizeof(track));
+  track.type = type;
+  tracks_.push_back(track);
+  return static_cast<int>(tracks_.size()) - 1;
+}
+
+void FlvDemuxer::rewind() {
+  fseek(file_, dataOffset_, SEEK_SET);
+  bufferPos_ = 0;
+  bufferEnd_ = 0;
+}
+
+bool FlvDemuxer::getNext(ContainerSample* sample) {
+  while (true) {
+    int result = readTag(sample);
+    if (result != 0) {
+      return result > 0;
+    }
+  }
+}
+
+int FlvDemuxer::reset() {
+  if (!file_) {
+    return -1;
+  }
+  rewind();
+  return 0;
+}
@@ -0,0 +1,68 @@
+//  Agora RTC/MEDIA SDK
+//
+//  Copyright (c) 2020 Agora.io. All rights reserved.
+//
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <vector>
+
+#include "aac_file_parser.h"
+#include "container_demuxer.h"
+
+// Demuxes FLV files as recorded from RTMP, AVC (and the common HEVC
+// extension) video and AAC audio tags. The file streams through a fixed size
+// buffer, so recordings of any length take the same memory. The last AVC
+// sequence header is kept and put in front of every key frame, AAC frames get
+// an ADTS header from the last AAC sequence header. Timestamps come from the
+// tags, with the composition time of video tags.
+class FlvDemuxer : public ContainerDemuxer {
+ public:
+  explicit FlvDemuxer(const char* filepath);
+  ~FlvDemuxer();
+
+  bool open() override;
+  bool getNext(ContainerSample* sample) override;
+  int reset() override;
+
+  // True if |data| starts with an FLV header.
+  static bool probe(const uint8_t* data, size_t size);
+
+ private:
+  // Makes |size| bytes available at |bufferPos_|, reading more of the file as
+  // needed. Fails at the end of the file.
+  bool fill(size_t size);
+  // Skips |size| bytes, which may lie beyond the buffer.
+  bool skip(size_t size);
+  // Reads the next tag and converts it into |sampleBuffer_|. Returns 1 for a
+  // sample, 0 for a tag without one and -1 at the end of the file.
+  int readTag(ContainerSample* sample);
+  bool readVideoTag(const uint8_t* data, size_t size, int64_t timestampMs,
+                    ContainerSample* sample);
+  bool readAudioTag(const uint8_t* data, size_t size, int64_t timestampMs,
+                    ContainerSample* sample);
+  int addTrack(ContainerTrack::Type type);
+  void rewind();
+
+ private:
+  char* filePath_;
+  FILE* file_;
+  // Where the first tag starts.
+  long dataOffset_;
+  std::vector<uint8_t> buffer_;
+  size_t bufferPos_;
+  size_t bufferEnd_;
+
+  // Index into |tracks_|, -1 until the first sequence header.
+  int videoTrack_;
+  int audioTrack_;
+  int nalLengthSize_;
+  std::vector<uint8_t> parameterSets_;
+  bool hasAacConfig_;
+  AacAudioConfig aacConfig_;
+
+  std::vector<uint8_t> sampleBuffer_;
+};
@@ -0,0 +1,109 @@
+//  Agora RTC/MEDIA SDK
+//
+//  Copyright (c) 2020 Agora.io. All rights reserved.
+//
+
+#include "g711_file_parser.h"
+
+#include <stdio.h>
+#include <string.h>
+
+namespace {
+
+const int kTelephonyRateHz = 8000;
+
+}  // namespace
+
+G711FileParser::G711FileParser(const char* filepath, G711Law law)
+    : wav_(filepath), law_(law), decimation_(1), frameSamples_(0) {}
+
+G711FileParser::~G711FileParser() = default;
+
+bool G711FileParser::open() {
+  if (!wav_.open()) {
+    return false;
+  }
+  const int channels = wav_.getNumberOfChannels();
+  if (channels > 1) {
+    downmixer_.reset(new PcmDownmixer(channels, 0, 1));
+  }
+  const int rate = wav_.getSampleRate();
+  decimation_ = rate > 0 && rate % kTelephonyRateHz == 0 ? rate / kTelephonyRateHz : 1;
+  if (decimation_ == 1 && rate != kTelephonyRateHz) {
+    printf("G.711 of %d Hz audio, not decimated to %d Hz\n", rate, kTelephonyRateHz);
+  }
+  return true;
+}
+
+bool G711FileParser::hasNext() { return wav_.hasNext(); }
+
+bool G711FileParser::encodeNext() {
+  const uint8_t* data = nullptr;
+  int length = 0;
+  if (!wav_.getNext(&data, &length) || length <= 0) {
+    return false;
+  }
+  const int channels = wav_.getNumberOfChannels();
+  const size_t frames = length / (channels * sizeof(int16_t));
+  mono_.resize(frames);
+  if (downmixer_) {
+    downmixer_->process(reinterpret_cast<const int16_t*>(data), frames, mono_.data());
+  } else {
+    memcpy(mono_.data(), data, frames * sizeof(int16_t));
+  }
+
+  // 10 ms hold a whole number of output samples at multiples of 8 kHz.
+  const size_t samples = frames / decimation_;
+  if (decimation_ > 1) {
+    for (size_t i = 0; i < samples; ++i) {
+      int sum = 0;
+      for (int j = 0; j < decimation_; ++j) {
+        sum += mono_[i * decimation_ + j];
+      }
+      mono_[i] = static_cast<int16_t>(sum / decimation_);
+    }
+  }
+  encoded_.resize(samples);
+  EncodeG711(mono_.data(), law_, samples, encoded_.data());
+  frameSamples_ = static_cast<int>(samples);
+  return true;
+}
+
+void G711FileParser::getNext(char* buffer, int* length) {
+  if (!encodeNext() || encoded_.size() > static_cast<size_t>(*length)) {
+    *length = 0;
+    return;
+  }
+  memcpy(buffer, encoded_.data(), encoded_.size());
+  *length = static_cast<int>(encoded_.size());
+}
+
+bool G711FileParser::next(AudioFrameView* frame) {
+  if (!encodeNext()) {
+    return false;
+  }
+  frame->data = encoded_.data();
+  frame->size = encoded_.size();
+  frame->durationSamples = frameSamples_;
+  frame->flags = 0;
+  stampBySamples(frame);
+  return true;
+}
+
+agora::rtc::AUDIO_CODEC_TYPE G711FileParser::getCodecType() {
+  return law_ == G711Law::kMuLaw ? agora::rtc::AUDIO_CODEC_PCMU : agora::rtc::AUDIO_CODEC_PCMA;
+}
+
+int G711FileParser::getSampleRateHz() { return wav_.getSampleRate() / decimation_; }
+
+int G711FileParser::reset() {
+  int ret = wav_.reset();
+  if (ret == 0) {
+    resetSampleClock();
+  }
+  return ret;
+}
+
+bool G711FileParser::setLiveInput(bool follow) { return wav_.setLiveInput(follow); }
+
+void G711FileParser::cancel() { wav_.cancel(); }
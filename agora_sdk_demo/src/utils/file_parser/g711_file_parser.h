@@ -0,0 +1,55 @@
+//  Agora RTC/MEDIA SDK
+//
+//  Copyright (c) 2020 Agora.io. All rights reserved.
+//
+
+#pragma once
+
+#include <stdint.h>
+#include <memory>
+#include <vector>
+
+#include "audio_file_parser_factory.h"
+#include "utils/g711.h"
+#include "wav_pcm_file_parser.h"
+
+// Encodes a WAV file to G.711 on the fly, 10 ms at a time, the way a
+// telephony gateway would send it: mixed down to mono and, if the file runs
+// at a multiple of 8 kHz, decimated to 8 kHz by averaging. Files at other
+// rates keep their rate. Joining frames into longer packets is up to the
+// sender, G.711 can be split anywhere.
+class G711FileParser : public AudioFileParser {
+ public:
+  G711FileParser(const char* filepath, G711Law law);
+  ~G711FileParser();
+
+ public:
+  // AudioFileParser
+  bool open() override;
+  bool hasNext() override;
+
+  void getNext(char* buffer, int* length) override;
+
+  agora::rtc::AUDIO_CODEC_TYPE getCodecType() override;
+  int getSampleRateHz() override;
+  int getNumberOfChannels() override { return 1; }
+  int getBitsPerSample() override { return 8; }
+  int getFrameSamples() override { return frameSamples_; }
+  int reset() override;
+  bool next(AudioFrameView* frame) override;
+  bool setLiveInput(bool follow) override;
+  void cancel() override;
+
+ private:
+  // Encodes the next 10 ms of the WAV file into |encoded_|.
+  bool encodeNext();
+
+ private:
+  WavPcmFileParser wav_;
+  G711Law law_;
+  std::unique_ptr<PcmDownmixer> downmixer_;
+  int decimation_;
+  int frameSamples_;
+  std::vector<int16_t> mono_;
+  std::vector<uint8_t> encoded_;
+};
@@ -8,69 +8,308 @@
 
 #include <stdlib.h>
 #include <string.h>
+#include <algorithm>
+#include <functional>
 #include <memory>
 
-H264FileParser::H264FileParser(const char* filepath)
+#include "utils/live_stream_reader.h"
+#include "utils/mapped_file.h"
+#include "utils/media_file_source.h"
+#include "utils/start_code_finder.h"
+
+namespace {
+
+// NAL units read ahead of a live stream when the caller didn't ask for a
+// number, enough for a frame of a few dozen slices.
+const int kLivePrefetchFrames = 64;
+
+}  // namespace
+
+AnnexBNaluClass ClassifyH264Nalu(const uint8_t* header, int size) {
+  uint8_t type = header[0] & 0x1F;
+  if (!IsH264Vcl(type)) {
+    return {false, false, StartsH264AccessUnit(type)};
+  }
+  // first_mb_in_slice is 0 exactly when its Exp-Golomb code is a single one
+  // bit.
+  return {true, type == 5, size > 1 && (header[1] & 0x80) != 0};
+}
+
+H264FileParser::H264FileParser(const char* filepath, bool useMmap, int prefetchFrames)
     : filePath_(strdup(filepath)),
+      useMmap_(useMmap),
       fileHandle_(nullptr),
+      mappedPos_(0),
       isEof_(false),
+      overflowed_(false),
       currentBytePos_(0),
       dataEndPos_(0),
       currentFrameStart_(0),
-      readsize_(0) {}
+      readsize_(0),
+      prefetchFrames_(prefetchFrames),
+      pendingNalu_(nullptr),
+      pendingLength_(0) {}
 
 H264FileParser::~H264FileParser() {
+  // Stop the background thread before the file goes away.
+  cancel();
+  prefetcher_.reset();
   if (fileHandle_) {
     fclose(fileHandle_);
   }
   free(static_cast<void*>(filePath_));
 }
 
+void H264FileParser::setLiveInput(bool follow) {
+  live_.reset(new LiveStreamReader(filePath_, follow));
+}
+
+void H264FileParser::cancel() {
+  if (live_) {
+    live_->cancel();
+  }
+}
+
 bool H264FileParser::open() {
-  fileHandle_ = fopen(filePath_, "r");
-  return fileHandle_ != nullptr;
+  bool opened = false;
+  int prefetchFrames = prefetchFrames_;
+  if (live_) {
+    opened = live_->open();
+    if (prefetchFrames <= 0) {
+      prefetchFrames = kLivePrefetchFrames;
+    }
+  } else if (useMmap_) {
+    std::unique_ptr<MappedFile> mappedFile(new MappedFile(filePath_));
+    if (mappedFile->open(MappedFile::kAdviceSequential)) {
+      mappedFile_ = std::move(mappedFile);
+      mappedPos_ = 0;
+      opened = true;
+    }
+  }
+  if (!opened && !live_) {
+    fileHandle_ = fopen(filePath_, "r");
+    opened = fileHandle_ != nullptr;
+  }
+  if (opened && prefetchFrames > 0) {
+    prefetcher_.reset(new MediaFileSource(
+        std::bind(&H264FileParser::prefetchFrame, this, std::placeholders::_1), prefetchFrames));
+    prefetcher_->start();
+  }
+  return opened;
+}
+
+bool H264FileParser::isMapped() const { return mappedFile_ != nullptr; }
+
+bool H264FileParser::hasNext() {
+  // An access unit may be left in the NAL unit that ended the last one.
+  if (pendingLength_ > 0) {
+    return true;
+  }
+  return prefetcher_ ? prefetcher_->hasNext() : hasNextInFile();
+}
+
+bool H264FileParser::hasNextInFile() {
+  if (mappedFile_) {
+    return mappedPos_ < mappedFile_->size();
+  }
+  return (!isEof_) || (currentBytePos_ < dataEndPos_);
 }
 
-bool H264FileParser::hasNext() { return (!isEof_) || (currentBytePos_ < dataEndPos_); }
+bool H264FileParser::getNext(const uint8_t** data, int* length) {
+  if (prefetcher_) {
+    return prefetcher_->next(data, length);
+  }
+  return readNext(data, length);
+}
+
+bool H264FileParser::readNext(const uint8_t** data, int* length) {
+  if (mappedFile_) {
+    return getNextMapped(data, length);
+  }
+  if (!fileHandle_ && !live_) {
+    *length = 0;
+    return false;
+  }
+  return getNextBuffered(data, length);
+}
+
+// Runs on the prefetch thread, which then owns the file position.
+bool H264FileParser::prefetchFrame(std::vector<uint8_t>* frame) {
+  while (hasNextInFile()) {
+    const uint8_t* data = nullptr;
+    int length = 0;
+    if (readNext(&data, &length) && length > 0) {
+      frame->assign(data, data + length);
+      return true;
+    }
+  }
+  return false;
+}
+
+bool H264FileParser::getNextMapped(const uint8_t** data, int* length) {
+  const uint8_t* base = mappedFile_->data();
+  const uint8_t* end = base + mappedFile_->size();
+  const uint8_t* frameStart = base + mappedPos_;
+  if (frameStart >= end) {
+    *length = 0;
+    return false;
+  }
+  // Skip the start code of the current NAL unit before looking for the next.
+  const uint8_t* scanStart = end - frameStart > 3 ? frameStart + 3 : end;
+  const uint8_t* next = FindStartCode(scanStart, end);
+  if (next != end && next[-1] == 0) {
+    // Four bytes start code, its leading zero belongs to the next NAL unit.
+    --next;
+  }
+  *data = frameStart;
+  *length = static_cast<int>(next - frameStart);
+  mappedPos_ = next - base;
+  return true;
+}
 
 void H264FileParser::getNext(char* buffer, int* length) {
-  readData();
-  while (currentBytePos_ < dataEndPos_ - 2) {
-    if (dataBuffer_[currentBytePos_ + 2] > 1) {
-      currentBytePos_ += 3;
-    } else if (dataBuffer_[currentBytePos_ + 2] == 1 && dataBuffer_[currentBytePos_ + 1] == 0 &&
-               dataBuffer_[currentBytePos_] == 0) {
-      if ((*length) < currentBytePos_ - currentFrameStart_) {
-        *length = 0;
-        return;
+  // A mapped parser can step back, so a NAL unit that doesn't fit isn't lost.
+  size_t lastPos = mappedPos_;
+  const uint8_t* data = nullptr;
+  int dataLength = 0;
+  if (!getNext(&data, &dataLength) || *length < dataLength) {
+    if (mappedFile_ && !prefetcher_) {
+      mappedPos_ = lastPos;
+    }
+    *length = 0;
+    return;
+  }
+  memcpy(buffer, data, dataLength);
+  *length = dataLength;
+}
+
+bool H264FileParser::getNextBuffered(const uint8_t** data, int* length) {
+  while (true) {
+    if (currentBytePos_ < dataEndPos_ - 2) {
+      const uint8_t* found =
+          FindStartCode(dataBuffer_ + currentBytePos_, dataBuffer_ + dataEndPos_);
+      if (found != dataBuffer_ + dataEndPos_) {
+        currentBytePos_ = static_cast<int>(found - dataBuffer_);
+        // The leading zero of a four bytes start code belongs to the next one.
+        int frameEnd =
+            dataBuffer_[currentBytePos_ - 1] == 0 ? currentBytePos_ - 1 : currentBytePos_;
+        *data = dataBuffer_ + currentFrameStart_;
+        *length = frameEnd - currentFrameStart_;
+        currentFrameStart_ = frameEnd;
+        currentBytePos_ += 3;
+        return true;
       }
-      if (dataBuffer_[currentBytePos_ - 1] == 0) {
-        *length = currentBytePos_ - 1 - currentFrameStart_;
-      } else {
-        *length = currentBytePos_ - currentFrameStart_;
+      currentBytePos_ = dataEndPos_ - 2;
+    }
+    if (isEof_) {
+      break;
+    }
+    // Only read when the buffer holds no further start code, so a live
+    // stream never waits for bytes the NAL unit doesn't need.
+    readData();
+  }
+  *data = dataBuffer_ + currentFrameStart_;
+  *length = dataEndPos_ - currentFrameStart_;
+  currentBytePos_ = dataEndPos_;
+  currentFrameStart_ = dataEndPos_;
+  return *length > 0;
+}
+
+bool H264FileParser::readNalu(const uint8_t** data, int* length) {
+  if (pendingLength_ > 0) {
+    *data = pendingNalu_;
+    *length = pendingLength_;
+    pendingLength_ = 0;
+    return true;
+  }
+  while (hasNext()) {
+    if (getNext(data, length) && *length > 0) {
+      return true;
+    }
+  }
+  *length = 0;
+  return false;
+}
+
+bool H264FileParser::getNextAccessUnit(const uint8_t** data, int* length, bool* idr) {
+  return getNextAccessUnit(data, length, idr, ClassifyH264Nalu);
+}
+
+bool H264FileParser::getNextAccessUnit(const uint8_t** data, int* length, bool* key,
+                                       AnnexBNaluClassifier classify) {
+  // Only the mapping keeps NAL units in place, anything else is copied.
+  const bool contiguous = mappedFile_ && !prefetcher_;
+  const uint8_t* accessUnit = nullptr;
+  int accessUnitLength = 0;
+  bool hasVcl = false;
+  *key = false;
+  accessUnitBuffer_.clear();
+
+  const uint8_t* nalu = nullptr;
+  int naluLength = 0;
+  while (readNalu(&nalu, &naluLength)) {
+    // Skip the three or four bytes start code.
+    int headerPos = 0;
+    while (headerPos < naluLength - 1 && nalu[headerPos] == 0) {
+      ++headerPos;
+    }
+    ++headerPos;
+
+    if (headerPos < naluLength) {
+      AnnexBNaluClass naluClass = classify(nalu + headerPos, naluLength - headerPos);
+      if (hasVcl && naluClass.startsAccessUnit) {
+        // Stays valid until the next read, which takes it first.
+        pendingNalu_ = nalu;
+        pendingLength_ = naluLength;
+        break;
+      }
+      if (naluClass.vcl) {
+        hasVcl = true;
+        *key = *key || naluClass.key;
       }
-      memcpy(buffer, dataBuffer_ + currentFrameStart_, *length);
+    }
 
-      if (dataBuffer_[currentBytePos_ - 1] == 0) {
-        currentFrameStart_ = currentBytePos_ - 1;
-      } else {
-        currentFrameStart_ = currentBytePos_;
+    if (contiguous) {
+      if (accessUnitLength == 0) {
+        accessUnit = nalu;
       }
-      currentBytePos_ += 3;
-      return;
     } else {
-      ++currentBytePos_;
+      accessUnitBuffer_.insert(accessUnitBuffer_.end(), nalu, nalu + naluLength);
+      accessUnit = accessUnitBuffer_.data();
     }
+    accessUnitLength += naluLength;
   }
-  if (isEof_ && currentBytePos_ >= (dataEndPos_ - 3)) {
-    if ((*length) < dataEndPos_ - currentFrameStart_) {
-      *length = 0;
-      return;
-    }
-    *length = dataEndPos_ - currentFrameStart_;
-    memcpy(buffer, dataBuffer_ + currentFrameStart_, *length);
-    currentBytePos_ = dataEndPos_;
+
+  *data = accessUnit;
+  *length = accessUnitLength;
+  return accessUnitLength > 0;
+}
+
+int H264FileParser::reset() {
+  if (live_) {
+    return -1;
+  }
+  if (prefetcher_) {
+    prefetcher_->stop();
+  }
+  pendingLength_ = 0;
+  if (mappedFile_) {
+    mappedPos_ = 0;
+  } else if (fileHandle_) {
+    rewind(fileHandle_);
+    isEof_ = false;
+    overflowed_ = false;
+    currentBytePos_ = 0;
+    dataEndPos_ = 0;
+    currentFrameStart_ = 0;
+    readsize_ = 0;
+  } else {
+    return -1;
+  }
+  if (prefetcher_) {
+    prefetcher_->start();
   }
+  return 0;
 }
 
 void H264FileParser::readData() {
@@ -78,10 +317,11 @@ void H264FileParser::readData() {
     return;
   }
   if (dataEndPos_ > 0 && currentFrameStart_ > 0) {
-    memcpy(dataBuffer_, dataBuffer_ + currentFrameStart_, dataEndPos_ - currentFrameStart_);
+    memmove(dataBuffer_, dataBuffer_ + currentFrameStart_, dataEndPos_ - currentFrameStart_);
     dataEndPos_ = dataEndPos_ - currentFrameStart_;
+    // The bytes scanned already needn't be scanned again.
+    currentBytePos_ = std::max(currentBytePos_ - currentFrameStart_, 4);
     currentFrameStart_ = 0;
-    currentBytePos_ = 4;
   }
 
   if (dataEndPos_ == 0) {
@@ -89,6 +329,20 @@ void H264FileParser::readData() {
   }
 
   int buferRemainingSize = BufferSize - dataEndPos_;
+  if (buferRemainingSize == 0) {
+    printf("NAL unit in %s exceeds the buffer of %d bytes\n", filePath_, BufferSize);
+    isEof_ = true;
+    overflowed_ = true;
+    return;
+  }
+  if (live_) {
+    // One read of whatever arrived.
+    size_t readsize = live_->read(dataBuffer_ + dataEndPos_, buferRemainingSize);
+    isEof_ = readsize == 0;
+    readsize_ += readsize;
+    dataEndPos_ += readsize;
+    return;
+  }
   while (!isEof_ && buferRemainingSize > 0) {
     size_t readsize = fread(dataBuffer_ + dataEndPos_, 1, buferRemainingSize, fileHandle_);
     if (readsize <= 0) {
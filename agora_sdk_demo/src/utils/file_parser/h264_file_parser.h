@@ -6,30 +6,121 @@
 
 #pragma once
 
+#include <stdint.h>
 #include <stdio.h>
+#include <memory>
+#include <vector>
+
+class LiveStreamReader;
+class MappedFile;
+class MediaFileSource;
+
+// nal_unit_type of the coded slices, 1 to 5 (H.264 Table 7-1).
+inline bool IsH264Vcl(uint8_t type) { return type >= 1 && type <= 5; }
+
+// Non-VCL NAL units that start a new access unit when they follow a VCL NAL
+// unit: SEI, SPS, PPS, AUD and 14 to 18, see H.264 7.4.1.2.3.
+inline bool StartsH264AccessUnit(uint8_t type) {
+  return (type >= 6 && type <= 9) || (type >= 14 && type <= 18);
+}
+
+// What splitting Annex-B data into access units needs to know of a NAL unit.
+struct AnnexBNaluClass {
+  // A coded slice.
+  bool vcl;
+  // A slice of a random access picture.
+  bool key;
+  // Starts a new access unit once the current one has a slice.
+  bool startsAccessUnit;
+};
+
+// Classifies the NAL unit whose header is at |header|, |size| bytes up to
+// the next start code.
+typedef AnnexBNaluClass (*AnnexBNaluClassifier)(const uint8_t* header, int size);
+
+// H.264: a new access unit starts at a slice with first_mb_in_slice 0 or at
+// one of the NAL units of StartsH264AccessUnit(). IDR slices are key.
+AnnexBNaluClass ClassifyH264Nalu(const uint8_t* header, int size);
 
 class H264FileParser {
  public:
-  explicit H264FileParser(const char* filepath);
+  // With |useMmap| the file is memory mapped and NAL units are handed out as
+  // views into the mapping. If mapping fails, the parser falls back to the
+  // buffered fread path. With |prefetchFrames| > 0 a background thread reads
+  // that many NAL units ahead, so reads never block the caller.
+  explicit H264FileParser(const char* filepath, bool useMmap = true, int prefetchFrames = 0);
   virtual ~H264FileParser();
 
+  // Reads the file as a live stream, "-" for stdin, see LiveStreamReader.
+  // NAL units are read ahead on a background thread, |prefetchFrames| of
+  // them or a few dozen, and handed out once the start code behind them
+  // arrived. Call before open(). Live parsers can't reset().
+  void setLiveInput(bool follow);
+  // Wakes up the background thread if it waits for a live stream, which
+  // ends there.
+  void cancel();
+
   bool open();
   bool hasNext();
+  // Compatibility shim: copies the next NAL unit, start code included, into
+  // |buffer|. |length| holds the buffer capacity on input.
   void getNext(char* buffer, int* length);
+  // Zero-copy: points |data| at the next NAL unit, start code included. When
+  // mapped without prefetching the view points into the mapping and stays
+  // valid as long as the parser, otherwise only until the next call. Returns
+  // false at the end of file.
+  bool getNext(const uint8_t** data, int* length);
+  // Points |data| at the next access unit, start codes included. A new
+  // access unit starts at a slice with first_mb_in_slice 0 or at one of the
+  // NAL units of StartsH264AccessUnit(), once the current one has a slice.
+  // The view is valid until the next call, or as long as the parser when
+  // mapped without prefetching. |idr| tells whether it holds an IDR slice.
+  // Read live, an access unit is complete once the first NAL unit of the
+  // next one arrived.
+  bool getNextAccessUnit(const uint8_t** data, int* length, bool* idr);
+  // Same for the access units |classify| tells apart, e.g. of an H.265
+  // stream. |key| tells whether the access unit holds a key slice.
+  bool getNextAccessUnit(const uint8_t** data, int* length, bool* key,
+                         AnnexBNaluClassifier classify);
+
+  bool isMapped() const;
+  // True once reading stopped short of the end of the file because a NAL
+  // unit didn't fit the read buffer. The last NAL unit handed out was cut.
+  bool overflowed() const { return overflowed_; }
+  int reset();
 
  private:
   void readData();
+  bool hasNextInFile();
+  bool readNext(const uint8_t** data, int* length);
+  bool getNextMapped(const uint8_t** data, int* length);
+  bool getNextBuffered(const uint8_t** data, int* length);
+  bool prefetchFrame(std::vector<uint8_t>* frame);
+  bool readNalu(const uint8_t** data, int* length);
 
  private:
   static constexpr int BufferSize = 409600;
 
   char* filePath_;
+  bool useMmap_;
   FILE* fileHandle_;
+  std::unique_ptr<LiveStreamReader> live_;
+  std::unique_ptr<MappedFile> mappedFile_;
+  size_t mappedPos_;
   unsigned char dataBuffer_[BufferSize] = {0};
   bool isEof_;
+  bool overflowed_;
   int currentBytePos_;
   int dataEndPos_;
   int currentFrameStart_;
 
   int readsize_;
+
+  int prefetchFrames_;
+  std::unique_ptr<MediaFileSource> prefetcher_;
+
+  // The NAL unit that ended the last access unit, still unread.
+  const uint8_t* pendingNalu_;
+  int pendingLength_;
+  std::vector<uint8_t> accessUnitBuffer_;
 };
@@ -0,0 +1,360 @@
+//  Agora RTC/MEDIA SDK
+//
+//  Copyright (c) 2020 Agora.io. All rights reserved.
+//
+
+#include "h264_parameter_sets.h"
+
+#include <string.h>
+
+#include "utils/bitbuffer.h"
+#include "utils/start_code_finder.h"
+
+namespace {
+
+const uint8_t kH264NaluTypeMask = 0x1F;
+const uint8_t kH264NaluSps = 7;
+const uint8_t kH264NaluPps = 8;
+
+const uint32_t kMaxSpsId = 31;
+const uint32_t kMaxPpsId = 255;
+// Level 6.2 allows 139264 macroblocks per frame, keep the sizes well inside
+// what an int holds.
+const uint32_t kMaxMbsPerDimension = 4096;
+const uint32_t kMaxFramesPerSecond = 240;
+
+// High profiles carry chroma format, bit depth and scaling matrices.
+bool HasChromaFormat(uint8_t profileIdc) {
+  switch (profileIdc) {
+    case 44:
+    case 83:
+    case 86:
+    case 100:
+    case 110:
+    case 118:
+    case 122:
+    case 128:
+    case 134:
+    case 135:
+    case 138:
+    case 139:
+    case 244:
+      return true;
+    default:
+      return false;
+  }
+}
+
+// scaling_list() of 7.3.2.1.1.1, read only to get past it.
+bool SkipScalingList(CachedBitBuffer* reader, int size) {
+  int32_t lastScale = 8;
+  int32_t nextScale = 8;
+  for (int i = 0; i < size; ++i) {
+    if (nextScale != 0) {
+      int32_t deltaScale = 0;
+      if (!reader->ReadSignedExponentialGolomb(&deltaScale)) {
+        return false;
+      }
+      nextScale = (lastScale + deltaScale + 256) % 256;
+    }
+    lastScale = nextScale == 0 ? lastScale : nextScale;
+  }
+  return true;
+}
+
+// vui_parameters() up to and including timing_info (E.1.1).
+bool ParseVuiTiming(CachedBitBuffer* reader, H264Sps* sps) {
+  uint32_t flag = 0;
+  uint32_t value = 0;
+  // aspect_ratio_info_present_flag, aspect_ratio_idc and Extended_SAR.
+  if (!reader->ReadBits(&flag, 1)) {
+    return false;
+  }
+  if (flag && (!reader->ReadBits(&value, 8) || (value == 255 && !reader->ConsumeBits(32)))) {
+    return false;
+  }
+  // overscan_info_present_flag and overscan_appropriate_flag.
+  if (!reader->ReadBits(&flag, 1) || (flag && !reader->ConsumeBits(1))) {
+    return false;
+  }
+  // video_signal_type_present_flag, video_format, video_full_range_flag and
+  // the colour description.
+  if (!reader->ReadBits(&flag, 1)) {
+    return false;
+  }
+  if (flag && (!reader->ConsumeBits(4) || !reader->ReadBits(&value, 1) ||
+               (value && !reader->ConsumeBits(24)))) {
+    return false;
+  }
+  // chroma_loc_info_present_flag and the two chroma sample locations.
+  if (!reader->ReadBits(&flag, 1)) {
+    return false;
+  }
+  if (flag && (!reader->ReadExponentialGolomb(&value) || !reader->ReadExponentialGolomb(&value))) {
+    return false;
+  }
+  if (!reader->ReadBits(&flag, 1)) {
+    return false;
+  }
+  if (flag) {
+    uint32_t fixedFrameRate = 0;
+    if (!reader->ReadUInt32(&sps->numUnitsInTick) || !reader->ReadUInt32(&sps->timeScale) ||
+        !reader->ReadBits(&fixedFrameRate, 1)) {
+      sps->numUnitsInTick = 0;
+      sps->timeScale = 0;
+      return false;
+    }
+    sps->fixedFrameRate = fixedFrameRate != 0;
+  }
+  return true;
+}
+
+// Drops the trailing zero bytes Annex-B allows after a NAL unit, including
+// the first byte of a following four bytes start code.
+size_t TrimTrailingZeros(const uint8_t* data, size_t size) {
+  while (size > 0 && data[size - 1] == 0) {
+    --size;
+  }
+  return size;
+}
+
+bool SameBytes(const std::vector<uint8_t>& bytes, const uint8_t* data, size_t size) {
+  return bytes.size() == size && memcmp(bytes.data(), data, size) == 0;
+}
+
+}  // namespace
+
+bool ParseH264Sps(const uint8_t* rbsp, size_t size, H264Sps* sps) {
+  CachedBitBuffer reader(rbsp, size);
+  uint32_t profileIdc = 0;
+  uint32_t constraintFlags = 0;
+  uint32_t levelIdc = 0;
+  uint32_t id = 0;
+  if (!reader.ReadBits(&profileIdc, 8) || !reader.ReadBits(&constraintFlags, 8) ||
+      !reader.ReadBits(&levelIdc, 8) || !reader.ReadExponentialGolomb(&id) || id > kMaxSpsId) {
+    return false;
+  }
+  memset(sps, 0, sizeof(*sps));
+  sps->id = id;
+  sps->profileIdc = static_cast<uint8_t>(profileIdc);
+  sps->constraintFlags = static_cast<uint8_t>(constraintFlags);
+  sps->levelIdc = static_cast<uint8_t>(levelIdc);
+
+  uint32_t value = 0;
+  int32_t signedValue = 0;
+  uint32_t chromaFormatIdc = 1;
+  uint32_t separateColourPlane = 0;
+  if (HasChromaFormat(sps->profileIdc)) {
+    if (!reader.ReadExponentialGolomb(&chromaFormatIdc) || chromaFormatIdc > 3 ||
+        (chromaFormatIdc == 3 && !reader.ReadBits(&separateColourPlane, 1))) {
+      return false;
+    }
+    // bit_depth_luma_minus8, bit_depth_chroma_minus8 and
+    // qpprime_y_zero_transform_bypass_flag.
+    if (!reader.ReadExponentialGolomb(&value) || !reader.ReadExponentialGolomb(&value) ||
+        !reader.ConsumeBits(1)) {
+      return false;
+    }
+    uint32_t scalingMatrixPresent = 0;
+    if (!reader.ReadBits(&scalingMatrixPresent, 1)) {
+      return false;
+    }
+    if (scalingMatrixPresent) {
+      int lists = chromaFormatIdc != 3 ? 8 : 12;
+      for (int i = 0; i < lists; ++i) {
+        if (!reader.ReadBits(&value, 1) || (value && !SkipScalingList(&reader, i < 6 ? 16 : 64))) {
+          return false;
+        }
+      }
+    }
+  }
+  sps->chromaFormatIdc = chromaFormatIdc;
+
+  // log2_max_frame_num_minus4 and pic_order_cnt_type.
+  uint32_t picOrderCntType = 0;
+  if (!reader.ReadExponentialGolomb(&value) || !reader.ReadExponentialGolomb(&picOrderCntType)) {
+    return false;
+  }
+  if (picOrderCntType == 0) {
+    // log2_max_pic_order_cnt_lsb_minus4
+    if (!reader.ReadExponentialGolomb(&value)) {
+      return false;
+    }
+  } else if (picOrderCntType == 1) {
+    // delta_pic_order_always_zero_flag, offset_for_non_ref_pic,
+    // offset_for_top_to_bottom_field and the offsets of the cycle.
+    uint32_t cycleLength = 0;
+    if (!reader.ConsumeBits(1) || !reader.ReadSignedExponentialGolomb(&signedValue) ||
+        !reader.ReadSignedExponentialGolomb(&signedValue) ||
+        !reader.ReadExponentialGolomb(&cycleLength) || cycleLength > 255) {
+      return false;
+    }
+    for (uint32_t i = 0; i < cycleLength; ++i) {
+      if (!reader.ReadSignedExponentialGolomb(&signedValue)) {
+        return false;
+      }
+    }
+  }
+
+  // max_num_ref_frames, gaps_in_frame_num_value_allowed_flag, then the size.
+  uint32_t widthInMbsMinus1 = 0;
+  uint32_t heightInMapUnitsMinus1 = 0;
+  uint32_t frameMbsOnly = 0;
+  if (!reader.ReadExponentialGolomb(&value) || !reader.ConsumeBits(1) ||
+      !reader.ReadExponentialGolomb(&widthInMbsMinus1) ||
+      !reader.ReadExponentialGolomb(&heightInMapUnitsMinus1) ||
+      !reader.ReadBits(&frameMbsOnly, 1) || widthInMbsMinus1 >= kMaxMbsPerDimension ||
+      heightInMapUnitsMinus1 >= kMaxMbsPerDimension) {
+    return false;
+  }
+  sps->frameMbsOnly = frameMbsOnly != 0;
+  // mb_adaptive_frame_field_flag, then direct_8x8_inference_flag.
+  if ((!frameMbsOnly && !reader.ConsumeBits(1)) || !reader.ConsumeBits(1)) {
+    return false;
+  }
+
+  uint32_t frameCropping = 0;
+  uint32_t cropLeft = 0;
+  uint32_t cropRight = 0;
+  uint32_t cropTop = 0;
+  uint32_t cropBottom = 0;
+  if (!reader.ReadBits(&frameCropping, 1)) {
+    return false;
+  }
+  if (frameCropping &&
+      (!reader.ReadExponentialGolomb(&cropLeft) || !reader.ReadExponentialGolomb(&cropRight) ||
+       !reader.ReadExponentialGolomb(&cropTop) || !reader.ReadExponentialGolomb(&cropBottom))) {
+    return false;
+  }
+  // Crop units of 7.4.2.1.1, in luma samples.
+  uint32_t frameHeightFactor = 2 - frameMbsOnly;
+  uint32_t cropUnitX = 1;
+  uint32_t cropUnitY = frameHeightFactor;
+  if (!separateColourPlane && chromaFormatIdc != 0) {
+    cropUnitX = chromaFormatIdc == 3 ? 1 : 2;
+    cropUnitY = (chromaFormatIdc == 1 ? 2 : 1) * frameHeightFactor;
+  }
+  uint64_t width = (widthInMbsMinus1 + 1) * 16;
+  uint64_t height = (heightInMapUnitsMinus1 + 1) * 16 * frameHeightFactor;
+  uint64_t cropX = (static_cast<uint64_t>(cropLeft) + cropRight) * cropUnitX;
+  uint64_t cropY = (static_cast<uint64_t>(cropTop) + cropBottom) * cropUnitY;
+  if (cropX >= width || cropY >= height) {
+    return false;
+  }
+  sps->width = static_cast<int>(width - cropX);
+  sps->height = static_cast<int>(height - cropY);
+
+  uint32_t vuiPresent = 0;
+  if (reader.ReadBits(&vuiPresent, 1) && vuiPresent) {
+    // The size is known by now, a broken VUI only loses the timing.
+    ParseVuiTiming(&reader, sps);
+  }
+  return true;
+}
+
+bool ParseH264Pps(const uint8_t* rbsp, size_t size, H264Pps* pps) {
+  CachedBitBuffer reader(rbsp, size);
+  uint32_t id = 0;
+  uint32_t spsId = 0;
+  uint32_t entropyCodingMode = 0;
+  if (!reader.ReadExponentialGolomb(&id) || id > kMaxPpsId ||
+      !reader.ReadExponentialGolomb(&spsId) || spsId > kMaxSpsId ||
+      !reader.ReadBits(&entropyCodingMode, 1)) {
+    return false;
+  }
+  pps->id = id;
+  pps->spsId = spsId;
+  pps->entropyCodingMode = entropyCodingMode != 0;
+  return true;
+}
+
+bool GetH264FrameRate(const H264Sps& sps, uint32_t* num, uint32_t* den) {
+  if (sps.numUnitsInTick == 0 || sps.timeScale == 0) {
+    return false;
+  }
+  // Frames last two ticks, one per field (E.2.1).
+  uint64_t frameTicks = 2 * static_cast<uint64_t>(sps.numUnitsInTick);
+  if (sps.timeScale > frameTicks * kMaxFramesPerSecond || frameTicks > 0xFFFFFFFFu) {
+    return false;
+  }
+  *num = sps.timeScale;
+  *den = static_cast<uint32_t>(frameTicks);
+  return true;
+}
+
+bool H264ParameterSets::update(const uint8_t* data, size_t size) {
+  const uint8_t* end = data + size;
+  const uint8_t* nalu = FindStartCode(data, end);
+  bool changed = false;
+  while (nalu < end) {
+    nalu += 3;
+    const uint8_t* next = FindStartCode(nalu, end);
+    changed = updateNalu(nalu, TrimTrailingZeros(nalu, next - nalu)) || changed;
+    nalu = next;
+  }
+  return changed;
+}
+
+bool H264ParameterSets::updateNalu(const uint8_t* nalu, size_t size) {
+  if (size < 2) {
+    return false;
+  }
+  uint8_t type = nalu[0] & kH264NaluTypeMask;
+  if (type == kH264NaluSps) {
+    // Streams carry one or two SPS, a linear search beats parsing the id.
+    for (auto& it : sps_) {
+      if (SameBytes(it.second.bytes, nalu, size)) {
+        lastSps_ = &it.second.set;
+        return false;
+      }
+    }
+    std::vector<uint8_t> rbsp(size - 1);
+    rbsp.resize(UnescapeRbsp(nalu + 1, size - 1, rbsp.data(), rbsp.size()));
+    ++parseCount_;
+    H264Sps sps;
+    if (!ParseH264Sps(rbsp.data(), rbsp.size(), &sps)) {
+      return false;
+    }
+    Entry<H264Sps>& entry = sps_[sps.id];
+    entry.bytes.assign(nalu, nalu + size);
+    entry.set = sps;
+    lastSps_ = &entry.set;
+    return true;
+  }
+  if (type == kH264NaluPps) {
+    for (auto& it : pps_) {
+      if (SameBytes(it.second.bytes, nalu, size)) {
+        return false;
+      }
+    }
+    std::vector<uint8_t> rbsp(size - 1);
+    rbsp.resize(UnescapeRbsp(nalu + 1, size - 1, rbsp.data(), rbsp.size()));
+    ++parseCount_;
+    H264Pps pps;
+    if (!ParseH264Pps(rbsp.data(), rbsp.size(), &pps)) {
+      return false;
+    }
+    Entry<H264Pps>& entry = pps_[pps.id];
+    entry.bytes.assign(nalu, nalu + size);
+    entry.set = pps;
+    return true;
+  }
+  return false;
+}
+
+const H264Sps* H264ParameterSets::sps(uint32_t id) const {
+  auto it = sps_.find(id);
+  return it != sps_.end() ? &it->second.set : nullptr;
+}
+
+const H264Pps* H264ParameterSets::pps(uint32_t id) const {
+  auto it = pps_.find(id);
+  return it != pps_.end() ? &it->second.set : nullptr;
+}
+
+const H264Sps* H264ParameterSets::activeSps(uint32_t ppsId) const {
+  const H264Pps* set = pps(ppsId);
+  return set ? sps(set->spsId) : nullptr;
+}
+
+const H264Sps* H264ParameterSets::lastSps() const { return lastSps_; }
@@ -0,0 +1,79 @@
+//  Agora RTC/MEDIA SDK
+//
+//  Copyright (c) 2020 Agora.io. All rights reserved.
+//
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <map>
+#include <vector>
+
+// The sequence parameter set fields needed to describe and pace a stream
+// (H.264 7.3.2.1.1 and E.1.1).
+struct H264Sps {
+  uint32_t id;
+  uint8_t profileIdc;
+  // constraint_set0_flag to constraint_set5_flag and the two reserved bits.
+  uint8_t constraintFlags;
+  uint8_t levelIdc;
+  uint32_t chromaFormatIdc;
+  bool frameMbsOnly;
+  // Displayed size, frame cropping applied.
+  int width;
+  int height;
+  // VUI timing_info, zero when not present. A frame lasts two ticks.
+  uint32_t numUnitsInTick;
+  uint32_t timeScale;
+  bool fixedFrameRate;
+};
+
+// The picture parameter set fields needed to find the active SPS.
+struct H264Pps {
+  uint32_t id;
+  uint32_t spsId;
+  bool entropyCodingMode;
+};
+
+// |rbsp| is a NAL unit payload without its header byte, with the emulation
+// prevention bytes removed.
+bool ParseH264Sps(const uint8_t* rbsp, size_t size, H264Sps* sps);
+bool ParseH264Pps(const uint8_t* rbsp, size_t size, H264Pps* pps);
+
+// Frame rate of |sps| as |num| / |den| from its VUI timing. Returns false if
+// the SPS carries no timing or an implausible one.
+bool GetH264FrameRate(const H264Sps& sps, uint32_t* num, uint32_t* den);
+
+// The parameter sets of a stream by id. A set is parsed only when its bytes
+// change, so streams repeating SPS and PPS before every IDR picture pay a
+// memcmp per repetition.
+class H264ParameterSets {
+ public:
+  // Takes Annex-B data, one or more NAL units with their start codes, and
+  // picks up the SPS and PPS among them. Returns true if any set changed.
+  bool update(const uint8_t* data, size_t size);
+  // Same for a single NAL unit starting at its header byte.
+  bool updateNalu(const uint8_t* nalu, size_t size);
+
+  const H264Sps* sps(uint32_t id) const;
+  const H264Pps* pps(uint32_t id) const;
+  // The SPS a slice referring to |ppsId| decodes with, nullptr if unknown.
+  const H264Sps* activeSps(uint32_t ppsId) const;
+  // The SPS parsed last, for data without slices to tell which is active.
+  const H264Sps* lastSps() const;
+  // How many times a set was parsed.
+  int parseCount() const { return parseCount_; }
+
+ private:
+  template <typename T>
+  struct Entry {
+    std::vector<uint8_t> bytes;
+    T set;
+  };
+
+  std::map<uint32_t, Entry<H264Sps>> sps_;
+  std::map<uint32_t, Entry<H264Pps>> pps_;
+  const H264Sps* lastSps_{nullptr};
+  int parseCount_{0};
+};
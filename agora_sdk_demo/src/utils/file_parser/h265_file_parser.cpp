@@ -0,0 +1,43 @@
+//  Agora RTC/MEDIA SDK
+//
+//  Copyright (c) 2020 Agora.io. All rights reserved.
+//
+
+#include "h265_file_parser.h"
+
+// Non-VCL NAL unit types that start a new access unit after a VCL NAL unit.
+static bool StartsH265AccessUnit(H265NaluType type) {
+  return type == kH265Vps || type == kH265Sps || type == kH265Pps || type == kH265Aud ||
+         type == kH265PrefixSei || (type >= 41 && type <= 44) || (type >= 48 && type <= 55);
+}
+
+AnnexBNaluClass ClassifyH265Nalu(const uint8_t* header, int size) {
+  if (size <= static_cast<int>(kH265NaluHeaderSize)) {
+    return {false, false, false};
+  }
+  H265NaluType type = ParseH265NaluType(header[0]);
+  if (!IsH265Vcl(type)) {
+    return {false, false, StartsH265AccessUnit(type)};
+  }
+  bool firstSliceSegmentInPic = (header[kH265NaluHeaderSize] & 0x80) != 0;
+  return {true, IsH265Irap(type), firstSliceSegmentInPic};
+}
+
+H265FileParser::H265FileParser(const char* filepath, bool useMmap)
+    : annexbParser_(new H264FileParser(filepath, useMmap)) {}
+
+H265FileParser::~H265FileParser() = default;
+
+bool H265FileParser::open() { return annexbParser_->open(); }
+
+bool H265FileParser::isMapped() const { return annexbParser_->isMapped(); }
+
+bool H265FileParser::overflowed() const { return annexbParser_->overflowed(); }
+
+bool H265FileParser::hasNext() { return annexbParser_->hasNext(); }
+
+int H265FileParser::reset() { return annexbParser_->reset(); }
+
+bool H265FileParser::getNextAccessUnit(const uint8_t** data, int* length, bool* irap) {
+  return annexbParser_->getNextAccessUnit(data, length, irap, ClassifyH265Nalu);
+}
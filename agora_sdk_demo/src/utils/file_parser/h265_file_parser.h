@@ -0,0 +1,75 @@
+//  Agora RTC/MEDIA SDK
+//
+//  Copyright (c) 2020 Agora.io. All rights reserved.
+//
+
+#pragma once
+
+#include <stdint.h>
+#include <memory>
+
+#include "h264_file_parser.h"
+
+enum H265NaluType : uint8_t {
+  kH265TrailN = 0,
+  kH265RaslR = 9,
+  kH265BlaWLp = 16,
+  kH265IdrWRadl = 19,
+  kH265IdrNLp = 20,
+  kH265Cra = 21,
+  kH265RsvIrap23 = 23,
+  kH265RsvVcl31 = 31,
+  kH265Vps = 32,
+  kH265Sps = 33,
+  kH265Pps = 34,
+  kH265Aud = 35,
+  kH265Eos = 36,
+  kH265Eob = 37,
+  kH265Fd = 38,
+  kH265PrefixSei = 39,
+  kH265SuffixSei = 40,
+};
+
+// HEVC NAL unit headers are two bytes: forbidden_zero_bit, nal_unit_type(6),
+// nuh_layer_id(6) and nuh_temporal_id_plus1(3).
+const size_t kH265NaluHeaderSize = 2;
+
+inline H265NaluType ParseH265NaluType(uint8_t data) {
+  return static_cast<H265NaluType>((data >> 1) & 0x3F);
+}
+
+inline bool IsH265Vcl(H265NaluType type) { return type <= kH265RsvVcl31; }
+
+// Intra random access point pictures (BLA, IDR, CRA) are the key frames.
+inline bool IsH265Irap(H265NaluType type) {
+  return type >= kH265BlaWLp && type <= kH265RsvIrap23;
+}
+
+// H.265 rules of H265FileParser for H264FileParser::getNextAccessUnit().
+AnnexBNaluClass ClassifyH265Nalu(const uint8_t* header, int size);
+
+// Splits an H.265 Annex-B file into access units. A new access unit starts at
+// a VCL NAL unit with first_slice_segment_in_pic_flag set, or at a VPS, SPS,
+// PPS, AUD, prefix SEI or reserved prefix NAL unit, once the current access
+// unit has a VCL NAL unit (H.265 7.4.2.4.4).
+class H265FileParser {
+ public:
+  explicit H265FileParser(const char* filepath, bool useMmap = true);
+  virtual ~H265FileParser();
+
+  bool open();
+  bool hasNext();
+  // Points |data| at the next access unit, start codes included. When mapped,
+  // the view goes straight into the file and stays valid as long as the
+  // parser, otherwise it is valid until the next call. |irap| tells whether
+  // the access unit is a random access point.
+  bool getNextAccessUnit(const uint8_t** data, int* length, bool* irap);
+
+  bool isMapped() const;
+  // See H264FileParser::overflowed().
+  bool overflowed() const;
+  int reset();
+
+ private:
+  std::unique_ptr<H264FileParser> annexbParser_;
+};
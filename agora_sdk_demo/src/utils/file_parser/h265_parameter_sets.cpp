@@ -0,0 +1,349 @@
+//  Agora RTC/MEDIA SDK
+//
+//  Copyright (c) 2020 Agora.io. All rights reserved.
+//
+
+#include "h265_parameter_sets.h"
+
+#include <string.h>
+#include <vector>
+
+#include "h265_file_parser.h"
+#include "utils/bitbuffer.h"
+#include "utils/start_code_finder.h"
+
+namespace {
+
+const uint32_t kMaxSpsId = 15;
+const uint32_t kMaxSubLayers = 7;
+const uint32_t kMaxShortTermRefPicSets = 64;
+const uint32_t kMaxLongTermRefPics = 32;
+// Level 6.2 caps either side at sqrt(8 * MaxLumaPs) luma samples (A.4.1).
+const uint32_t kMaxPictureSize = 16888;
+const uint32_t kMaxFramesPerSecond = 240;
+
+// profile_tier_level(1, maxSubLayersMinus1) of 7.3.3, read only to get past
+// it but for the general profile and level.
+bool ParseProfileTierLevel(CachedBitBuffer* reader, uint32_t maxSubLayersMinus1, H265Sps* sps) {
+  uint32_t value = 0;
+  // general_profile_space, general_tier_flag and general_profile_idc.
+  if (!reader->ReadBits(&value, 8)) {
+    return false;
+  }
+  sps->generalProfileIdc = static_cast<uint8_t>(value & 0x1F);
+  // The compatibility and constraint flags.
+  if (!reader->ConsumeBits(32 + 48) || !reader->ReadBits(&value, 8)) {
+    return false;
+  }
+  sps->generalLevelIdc = static_cast<uint8_t>(value);
+
+  uint32_t profilePresent[kMaxSubLayers] = {0};
+  uint32_t levelPresent[kMaxSubLayers] = {0};
+  for (uint32_t i = 0; i < maxSubLayersMinus1; ++i) {
+    if (!reader->ReadBits(&profilePresent[i], 1) || !reader->ReadBits(&levelPresent[i], 1)) {
+      return false;
+    }
+  }
+  // reserved_zero_2bits up to eight sub-layers.
+  if (maxSubLayersMinus1 > 0 && !reader->ConsumeBits(2 * (8 - maxSubLayersMinus1))) {
+    return false;
+  }
+  for (uint32_t i = 0; i < maxSubLayersMinus1; ++i) {
+    if ((profilePresent[i] && !reader->ConsumeBits(88)) ||
+        (levelPresent[i] && !reader->ConsumeBits(8))) {
+      return false;
+    }
+  }
+  return true;
+}
+
+// scaling_list_data() of 7.3.4, read only to get past it.
+bool SkipScalingListData(CachedBitBuffer* reader) {
+  uint32_t value = 0;
+  int32_t signedValue = 0;
+  for (int sizeId = 0; sizeId < 4; ++sizeId) {
+    for (int matrixId = 0; matrixId < 6; matrixId += sizeId == 3 ? 3 : 1) {
+      uint32_t predModeFlag = 0;
+      if (!reader->ReadBits(&predModeFlag, 1)) {
+        return false;
+      }
+      if (!predModeFlag) {
+        // scaling_list_pred_matrix_id_delta
+        if (!reader->ReadExponentialGolomb(&value)) {
+          return false;
+        }
+        continue;
+      }
+      int coefNum = sizeId == 0 ? 16 : 64;
+      if (sizeId > 1 && !reader->ReadSignedExponentialGolomb(&signedValue)) {
+        return false;
+      }
+      for (int i = 0; i < coefNum; ++i) {
+        if (!reader->ReadSignedExponentialGolomb(&signedValue)) {
+          return false;
+        }
+      }
+    }
+  }
+  return true;
+}
+
+// st_ref_pic_set(stRpsIdx) of 7.3.7 as the SPS carries it. |numDeltaPocs|
+// holds NumDeltaPocs of the sets before, the set predicts from the one
+// right before it.
+bool SkipShortTermRefPicSet(CachedBitBuffer* reader, uint32_t stRpsIdx,
+                            std::vector<uint32_t>* numDeltaPocs) {
+  uint32_t value = 0;
+  uint32_t interRefPicSetPrediction = 0;
+  if (stRpsIdx != 0 && !reader->ReadBits(&interRefPicSetPrediction, 1)) {
+    return false;
+  }
+  if (interRefPicSetPrediction) {
+    // delta_rps_sign and abs_delta_rps_minus1.
+    if (!reader->ConsumeBits(1) || !reader->ReadExponentialGolomb(&value)) {
+      return false;
+    }
+    uint32_t deltaPocs = 0;
+    for (uint32_t j = 0; j <= (*numDeltaPocs)[stRpsIdx - 1]; ++j) {
+      uint32_t usedByCurrPic = 0;
+      uint32_t useDelta = 1;
+      if (!reader->ReadBits(&usedByCurrPic, 1) ||
+          (!usedByCurrPic && !reader->ReadBits(&useDelta, 1))) {
+        return false;
+      }
+      if (usedByCurrPic || useDelta) {
+        ++deltaPocs;
+      }
+    }
+    numDeltaPocs->push_back(deltaPocs);
+    return true;
+  }
+  uint32_t numNegativePics = 0;
+  uint32_t numPositivePics = 0;
+  if (!reader->ReadExponentialGolomb(&numNegativePics) ||
+      !reader->ReadExponentialGolomb(&numPositivePics) || numNegativePics > 16 ||
+      numPositivePics > 16) {
+    return false;
+  }
+  // delta_poc_s*_minus1 and used_by_curr_pic_s*_flag.
+  for (uint32_t i = 0; i < numNegativePics + numPositivePics; ++i) {
+    if (!reader->ReadExponentialGolomb(&value) || !reader->ConsumeBits(1)) {
+      return false;
+    }
+  }
+  numDeltaPocs->push_back(numNegativePics + numPositivePics);
+  return true;
+}
+
+// vui_parameters() up to and including the timing info (E.2.1).
+bool ParseVuiTiming(CachedBitBuffer* reader, H265Sps* sps) {
+  uint32_t flag = 0;
+  uint32_t value = 0;
+  // aspect_ratio_info_present_flag, aspect_ratio_idc and Extended_SAR.
+  if (!reader->ReadBits(&flag, 1)) {
+    return false;
+  }
+  if (flag && (!reader->ReadBits(&value, 8) || (value == 255 && !reader->ConsumeBits(32)))) {
+    return false;
+  }
+  // overscan_info_present_flag and overscan_appropriate_flag.
+  if (!reader->ReadBits(&flag, 1) || (flag && !reader->ConsumeBits(1))) {
+    return false;
+  }
+  // video_signal_type_present_flag, video_format, video_full_range_flag and
+  // the colour description.
+  if (!reader->ReadBits(&flag, 1)) {
+    return false;
+  }
+  if (flag && (!reader->ConsumeBits(4) || !reader->ReadBits(&value, 1) ||
+               (value && !reader->ConsumeBits(24)))) {
+    return false;
+  }
+  // chroma_loc_info_present_flag and the two chroma sample locations.
+  if (!reader->ReadBits(&flag, 1)) {
+    return false;
+  }
+  if (flag && (!reader->ReadExponentialGolomb(&value) || !reader->ReadExponentialGolomb(&value))) {
+    return false;
+  }
+  // neutral_chroma_indication_flag, field_seq_flag,
+  // frame_field_info_present_flag, then the default display window.
+  if (!reader->ConsumeBits(3) || !reader->ReadBits(&flag, 1)) {
+    return false;
+  }
+  for (int i = 0; flag && i < 4; ++i) {
+    if (!reader->ReadExponentialGolomb(&value)) {
+      return false;
+    }
+  }
+  if (!reader->ReadBits(&flag, 1)) {
+    return false;
+  }
+  // vui_timing_info_present_flag, vui_num_units_in_tick and vui_time_scale.
+  if (flag &&
+      (!reader->ReadUInt32(&sps->numUnitsInTick) || !reader->ReadUInt32(&sps->timeScale))) {
+    sps->numUnitsInTick = 0;
+    sps->timeScale = 0;
+    return false;
+  }
+  return true;
+}
+
+// Drops the trailing zero bytes Annex-B allows after a NAL unit, including
+// the first byte of a following four bytes start code.
+size_t TrimTrailingZeros(const uint8_t* data, size_t size) {
+  while (size > 0 && data[size - 1] == 0) {
+    --size;
+  }
+  return size;
+}
+
+}  // namespace
+
+bool ParseH265Sps(const uint8_t* rbsp, size_t size, H265Sps* sps) {
+  CachedBitBuffer reader(rbsp, size);
+  uint32_t value = 0;
+  uint32_t maxSubLayersMinus1 = 0;
+  // sps_video_parameter_set_id, sps_max_sub_layers_minus1 and
+  // sps_temporal_id_nesting_flag.
+  if (!reader.ConsumeBits(4) || !reader.ReadBits(&maxSubLayersMinus1, 3) ||
+      maxSubLayersMinus1 >= kMaxSubLayers || !reader.ConsumeBits(1)) {
+    return false;
+  }
+  memset(sps, 0, sizeof(*sps));
+  uint32_t id = 0;
+  if (!ParseProfileTierLevel(&reader, maxSubLayersMinus1, sps) ||
+      !reader.ReadExponentialGolomb(&id) || id > kMaxSpsId) {
+    return false;
+  }
+  sps->id = id;
+
+  uint32_t chromaFormatIdc = 0;
+  uint32_t separateColourPlane = 0;
+  if (!reader.ReadExponentialGolomb(&chromaFormatIdc) || chromaFormatIdc > 3 ||
+      (chromaFormatIdc == 3 && !reader.ReadBits(&separateColourPlane, 1))) {
+    return false;
+  }
+  sps->chromaFormatIdc = chromaFormatIdc;
+
+  uint32_t width = 0;
+  uint32_t height = 0;
+  uint32_t conformanceWindow = 0;
+  uint32_t confLeft = 0;
+  uint32_t confRight = 0;
+  uint32_t confTop = 0;
+  uint32_t confBottom = 0;
+  if (!reader.ReadExponentialGolomb(&width) || !reader.ReadExponentialGolomb(&height) ||
+      width == 0 || height == 0 || width > kMaxPictureSize || height > kMaxPictureSize ||
+      !reader.ReadBits(&conformanceWindow, 1)) {
+    return false;
+  }
+  if (conformanceWindow &&
+      (!reader.ReadExponentialGolomb(&confLeft) || !reader.ReadExponentialGolomb(&confRight) ||
+       !reader.ReadExponentialGolomb(&confTop) || !reader.ReadExponentialGolomb(&confBottom))) {
+    return false;
+  }
+  // Offsets count chroma samples, SubWidthC and SubHeightC of table 6-1.
+  uint32_t chromaArrayType = separateColourPlane ? 0 : chromaFormatIdc;
+  uint64_t subWidth = chromaArrayType == 1 || chromaArrayType == 2 ? 2 : 1;
+  uint64_t subHeight = chromaArrayType == 1 ? 2 : 1;
+  uint64_t cropX = (static_cast<uint64_t>(confLeft) + confRight) * subWidth;
+  uint64_t cropY = (static_cast<uint64_t>(confTop) + confBottom) * subHeight;
+  if (cropX >= width || cropY >= height) {
+    return false;
+  }
+  sps->width = static_cast<int>(width - cropX);
+  sps->height = static_cast<int>(height - cropY);
+
+  // The size is known by now, a broken rest only loses the timing.
+  // bit_depth_luma_minus8, bit_depth_chroma_minus8 and
+  // log2_max_pic_order_cnt_lsb_minus4.
+  uint32_t log2MaxPicOrderCntLsbMinus4 = 0;
+  uint32_t subLayerOrderingInfo = 0;
+  if (!reader.ReadExponentialGolomb(&value) || !reader.ReadExponentialGolomb(&value) ||
+      !reader.ReadExponentialGolomb(&log2MaxPicOrderCntLsbMinus4) ||
+      log2MaxPicOrderCntLsbMinus4 > 12 || !reader.ReadBits(&subLayerOrderingInfo, 1)) {
+    return true;
+  }
+  // sps_max_dec_pic_buffering_minus1, sps_max_num_reorder_pics and
+  // sps_max_latency_increase_plus1 per sub-layer, then the six coding and
+  // transform block sizes and depths.
+  uint32_t fields = 3 * (subLayerOrderingInfo ? maxSubLayersMinus1 + 1 : 1) + 6;
+  for (uint32_t i = 0; i < fields; ++i) {
+    if (!reader.ReadExponentialGolomb(&value)) {
+      return true;
+    }
+  }
+  uint32_t flag = 0;
+  // scaling_list_enabled_flag and sps_scaling_list_data_present_flag.
+  if (!reader.ReadBits(&flag, 1) ||
+      (flag && (!reader.ReadBits(&flag, 1) || (flag && !SkipScalingListData(&reader))))) {
+    return true;
+  }
+  // amp_enabled_flag, sample_adaptive_offset_enabled_flag and pcm_enabled_flag
+  // with the PCM bit depths, block sizes and pcm_loop_filter_disabled_flag.
+  if (!reader.ConsumeBits(2) || !reader.ReadBits(&flag, 1) ||
+      (flag && (!reader.ConsumeBits(8) || !reader.ReadExponentialGolomb(&value) ||
+                !reader.ReadExponentialGolomb(&value) || !reader.ConsumeBits(1)))) {
+    return true;
+  }
+  uint32_t numShortTermRefPicSets = 0;
+  if (!reader.ReadExponentialGolomb(&numShortTermRefPicSets) ||
+      numShortTermRefPicSets > kMaxShortTermRefPicSets) {
+    return true;
+  }
+  std::vector<uint32_t> numDeltaPocs;
+  for (uint32_t i = 0; i < numShortTermRefPicSets; ++i) {
+    if (!SkipShortTermRefPicSet(&reader, i, &numDeltaPocs)) {
+      return true;
+    }
+  }
+  // long_term_ref_pics_present_flag with lt_ref_pic_poc_lsb_sps and
+  // used_by_curr_pic_lt_sps_flag per picture.
+  if (!reader.ReadBits(&flag, 1)) {
+    return true;
+  }
+  if (flag) {
+    uint32_t numLongTermRefPics = 0;
+    if (!reader.ReadExponentialGolomb(&numLongTermRefPics) ||
+        numLongTermRefPics > kMaxLongTermRefPics ||
+        !reader.ConsumeBits(numLongTermRefPics * (log2MaxPicOrderCntLsbMinus4 + 4 + 1))) {
+      return true;
+    }
+  }
+  // sps_temporal_mvp_enabled_flag, strong_intra_smoothing_enabled_flag and
+  // vui_parameters_present_flag.
+  uint32_t vuiPresent = 0;
+  if (reader.ConsumeBits(2) && reader.ReadBits(&vuiPresent, 1) && vuiPresent) {
+    ParseVuiTiming(&reader, sps);
+  }
+  return true;
+}
+
+bool FindH265Sps(const uint8_t* data, size_t size, H265Sps* sps) {
+  const uint8_t* end = data + size;
+  const uint8_t* nalu = FindStartCode(data, end);
+  while (nalu < end) {
+    nalu += 3;
+    const uint8_t* next = FindStartCode(nalu, end);
+    size_t naluSize = TrimTrailingZeros(nalu, next - nalu);
+    if (naluSize > kH265NaluHeaderSize && ParseH265NaluType(nalu[0]) == kH265Sps) {
+      std::vector<uint8_t> rbsp(naluSize - kH265NaluHeaderSize);
+      rbsp.resize(UnescapeRbsp(nalu + kH265NaluHeaderSize, naluSize - kH265NaluHeaderSize,
+                               rbsp.data(), rbsp.size()));
+      return ParseH265Sps(rbsp.data(), rbsp.size(), sps);
+    }
+    nalu = next;
+  }
+  return false;
+}
+
+bool GetH265FrameRate(const H265Sps& sps, uint32_t* num, uint32_t* den) {
+  if (sps.numUnitsInTick == 0 || sps.timeScale == 0 ||
+      sps.timeScale > static_cast<uint64_t>(sps.numUnitsInTick) * kMaxFramesPerSecond) {
+    return false;
+  }
+  *num = sps.timeScale;
+  *den = sps.numUnitsInTick;
+  return true;
+}
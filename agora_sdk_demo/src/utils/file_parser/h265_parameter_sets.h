@@ -0,0 +1,36 @@
+//  Agora RTC/MEDIA SDK
+//
+//  Copyright (c) 2020 Agora.io. All rights reserved.
+//
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// The sequence parameter set fields needed to describe and pace a stream
+// (H.265 7.3.2.2 and E.2.1).
+struct H265Sps {
+  uint32_t id;
+  uint8_t generalProfileIdc;
+  uint8_t generalLevelIdc;
+  uint32_t chromaFormatIdc;
+  // Displayed size, conformance window applied.
+  int width;
+  int height;
+  // VUI timing info, zero when not present. A picture lasts one tick.
+  uint32_t numUnitsInTick;
+  uint32_t timeScale;
+};
+
+// |rbsp| is a NAL unit payload without its two header bytes, with the
+// emulation prevention bytes removed.
+bool ParseH265Sps(const uint8_t* rbsp, size_t size, H265Sps* sps);
+
+// Parses the first SPS among the NAL units of Annex-B |data|, e.g. an access
+// unit. Returns false if there is none or it is broken.
+bool FindH265Sps(const uint8_t* data, size_t size, H265Sps* sps);
+
+// Frame rate of |sps| as |num| / |den| from its VUI timing. Returns false if
+// the SPS carries no timing or an implausible one.
+bool GetH265FrameRate(const H265Sps& sps, uint32_t* num, uint32_t* den);
@@ -0,0 +1,264 @@
+//  Agora RTC/MEDIA SDK
+//
+//  Copyright (c) 2020 Agora.io. All rights reserved.
+//
+
+#include "ivf_file_parser.h"
+
+#include <stdio.h>
+#include <string.h>
+
+#include "utils/bitbuffer.h"
+#include "utils/mapped_file.h"
+
+namespace {
+
+const uint32_t kIvfSignature = IvfFourcc('D', 'K', 'I', 'F');
+
+// Frame header of standard IVF files as written by libvpx and libaom.
+struct IvfFrameHeader {
+  uint32_t length;
+  uint64_t timestamp;
+} __attribute__((packed));
+
+static_assert(sizeof(IvfFrameHeader) == 12, "IvfFrameHeader must stay packed");
+
+// Frame header of our recorder, |frameType| is webrtc::kVideoFrameKey for key
+// frames.
+struct RecorderIvfFrameHeader {
+  uint32_t length;
+  uint32_t frameType;
+  uint64_t timestamp;
+};
+
+static_assert(sizeof(RecorderIvfFrameHeader) == 16, "RecorderIvfFrameHeader must stay packed");
+
+const uint32_t kRecorderKeyFrame = 3;
+
+// Returns where the chain of frames starting at |pos| ends when every frame
+// is preceded by a |frameHeaderSize| byte header.
+size_t IvfFrameChainEnd(const uint8_t* data, size_t size, size_t pos, size_t frameHeaderSize) {
+  while (pos + frameHeaderSize <= size) {
+    uint32_t length = 0;
+    memcpy(&length, data + pos, sizeof(length));
+    if (length == 0 || length > size - pos - frameHeaderSize) {
+      break;
+    }
+    pos += frameHeaderSize + length;
+  }
+  return pos;
+}
+
+bool ParseVp8FrameType(const uint8_t* data, size_t size, bool* keyFrame, bool* shown) {
+  if (size < 3) {
+    return false;
+  }
+  // The frame tag starts with key_frame (0 for key frames), version(3) and
+  // show_frame (RFC 6386 9.1).
+  *keyFrame = (data[0] & 0x01) == 0;
+  *shown = (data[0] & 0x10) != 0;
+  return true;
+}
+
+// A single VP9 frame, not a superframe.
+bool ParseVp9FrameType(const uint8_t* data, size_t size, bool* keyFrame, bool* shown) {
+  // frame_marker(2), profile_low_bit, profile_high_bit, reserved_zero for
+  // profile 3, show_existing_frame, then frame_type (0 for key frames) and
+  // show_frame (VP9 6.2).
+  CachedBitBuffer reader(data, size);
+  uint32_t frameMarker = 0;
+  uint32_t profileLow = 0;
+  uint32_t profileHigh = 0;
+  uint32_t showExistingFrame = 0;
+  if (!reader.ReadBits(&frameMarker, 2) || frameMarker != 2 || !reader.ReadBits(&profileLow, 1) ||
+      !reader.ReadBits(&profileHigh, 1) ||
+      (profileHigh && profileLow && !reader.ConsumeBits(1)) ||
+      !reader.ReadBits(&showExistingFrame, 1)) {
+    return false;
+  }
+  if (showExistingFrame) {
+    // Shows a frame decoded earlier.
+    *keyFrame = false;
+    *shown = true;
+    return true;
+  }
+  uint32_t frameType = 0;
+  uint32_t showFrame = 0;
+  if (!reader.ReadBits(&frameType, 1) || !reader.ReadBits(&showFrame, 1)) {
+    return false;
+  }
+  *keyFrame = frameType == 0;
+  *shown = showFrame != 0;
+  return true;
+}
+
+}  // namespace
+
+size_t ParseVp9Superframe(const uint8_t* data, size_t size, uint32_t sizes[8]) {
+  if (size == 0) {
+    return 0;
+  }
+  // The index ends and starts with a marker byte 0b110xxyyy, xx + 1 bytes
+  // per frame size and yyy + 1 frames.
+  const uint8_t marker = data[size - 1];
+  if ((marker & 0xE0) != 0xC0) {
+    return 0;
+  }
+  const size_t frames = (marker & 0x07) + 1;
+  const size_t bytesPerSize = ((marker >> 3) & 0x03) + 1;
+  const size_t indexSize = 2 + bytesPerSize * frames;
+  if (size < indexSize || data[size - indexSize] != marker) {
+    return 0;
+  }
+  const uint8_t* p = data + size - indexSize + 1;
+  size_t total = 0;
+  for (size_t i = 0; i < frames; ++i) {
+    uint32_t frameSize = 0;
+    for (size_t j = 0; j < bytesPerSize; ++j) {
+      frameSize |= static_cast<uint32_t>(*p++) << (j * 8);
+    }
+    sizes[i] = frameSize;
+    total += frameSize;
+  }
+  // The index follows the frames, which must fit in front of it.
+  return total <= size - indexSize ? frames : 0;
+}
+
+bool ParseVpxFrameType(uint32_t fourcc, const uint8_t* data, size_t size, bool* keyFrame,
+                       bool* shown) {
+  if (fourcc == IvfFourcc('V', 'P', '8', '0')) {
+    return ParseVp8FrameType(data, size, keyFrame, shown);
+  }
+  if (fourcc != IvfFourcc('V', 'P', '9', '0')) {
+    return false;
+  }
+  uint32_t sizes[8];
+  size_t frames = ParseVp9Superframe(data, size, sizes);
+  if (frames == 0) {
+    return ParseVp9FrameType(data, size, keyFrame, shown);
+  }
+  *keyFrame = false;
+  *shown = false;
+  bool parsed = false;
+  for (size_t i = 0; i < frames; ++i) {
+    bool frameKey = false;
+    bool frameShown = false;
+    if (sizes[i] > 0 && ParseVp9FrameType(data, sizes[i], &frameKey, &frameShown)) {
+      *keyFrame = *keyFrame || frameKey;
+      *shown = *shown || frameShown;
+      parsed = true;
+    }
+    data += sizes[i];
+  }
+  return parsed;
+}
+
+IvfFileParser::IvfFileParser(const char* filepath)
+    : mappedFile_(new MappedFile(filepath)),
+      frameHeaderSize_(sizeof(IvfFrameHeader)),
+      end_(0),
+      pos_(0),
+      hasAv1SequenceHeader_(false) {
+  memset(&header_, 0, sizeof(header_));
+  memset(&av1SequenceHeader_, 0, sizeof(av1SequenceHeader_));
+}
+
+IvfFileParser::~IvfFileParser() = default;
+
+bool IvfFileParser::IsIvfFile(const char* filepath) {
+  FILE* file = fopen(filepath, "rb");
+  if (!file) {
+    return false;
+  }
+  uint32_t signature = 0;
+  bool isIvf = fread(&signature, sizeof(signature), 1, file) == 1 && signature == kIvfSignature;
+  fclose(file);
+  return isIvf;
+}
+
+bool IvfFileParser::open() {
+  if (!mappedFile_->open(MappedFile::kAdviceSequential)) {
+    return false;
+  }
+  const uint8_t* data = mappedFile_->data();
+  const size_t size = mappedFile_->size();
+  if (size >= sizeof(header_)) {
+    memcpy(&header_, data, sizeof(header_));
+  }
+  if (size < sizeof(header_) || header_.signature != kIvfSignature ||
+      header_.headerSize < sizeof(header_) || header_.headerSize > size) {
+    printf("%s is not an IVF file\n", mappedFile_->path());
+    mappedFile_->close();
+    return false;
+  }
+
+  // Take the frame header layout whose frames chain up to the end of the
+  // file.
+  const size_t start = header_.headerSize;
+  size_t recorderEnd = IvfFrameChainEnd(data, size, start, sizeof(RecorderIvfFrameHeader));
+  size_t standardEnd = IvfFrameChainEnd(data, size, start, sizeof(IvfFrameHeader));
+  bool standardLayout = recorderEnd != size && (standardEnd == size || standardEnd > recorderEnd);
+  frameHeaderSize_ = standardLayout ? sizeof(IvfFrameHeader) : sizeof(RecorderIvfFrameHeader);
+  end_ = standardLayout ? standardEnd : recorderEnd;
+  pos_ = start;
+  return true;
+}
+
+bool IvfFileParser::hasNext() const { return mappedFile_->isOpen() && pos_ < end_; }
+
+void IvfFileParser::reset() {
+  pos_ = header_.headerSize;
+  hasAv1SequenceHeader_ = false;
+}
+
+bool IvfFileParser::getNextFrame(IvfFrame* frame) {
+  if (!hasNext()) {
+    return false;
+  }
+  const uint8_t* data = mappedFile_->data() + pos_;
+  frame->data = data + frameHeaderSize_;
+  frame->offset = pos_ + frameHeaderSize_;
+  frame->keyFrame = false;
+  frame->shown = true;
+  if (frameHeaderSize_ == sizeof(IvfFrameHeader)) {
+    IvfFrameHeader frameHeader;
+    memcpy(&frameHeader, data, sizeof(frameHeader));
+    frame->size = frameHeader.length;
+    frame->timestamp = frameHeader.timestamp;
+  } else {
+    RecorderIvfFrameHeader frameHeader;
+    memcpy(&frameHeader, data, sizeof(frameHeader));
+    frame->size = frameHeader.length;
+    frame->timestamp = frameHeader.timestamp;
+    frame->keyFrame = frameHeader.frameType == kRecorderKeyFrame;
+  }
+  pos_ += frameHeaderSize_ + frame->size;
+
+  if (header_.fourcc == IvfFourcc('A', 'V', '0', '1')) {
+    // Every temporal unit shows a frame.
+    bool keyFrame = IsAv1KeyTemporalUnit(frame->data, frame->size, &av1SequenceHeader_,
+                                         &hasAv1SequenceHeader_);
+    frame->keyFrame = frame->keyFrame || keyFrame;
+    return true;
+  }
+  bool keyFrame = false;
+  bool shown = true;
+  if (ParseVpxFrameType(header_.fourcc, frame->data, frame->size, &keyFrame, &shown)) {
+    // The recorder's flags are kept, the bitstream only says more.
+    frame->keyFrame = frame->keyFrame || keyFrame;
+    frame->shown = shown;
+  }
+  return true;
+}
+
+bool IvfFileParser::timestampToUs(uint64_t timestamp, int64_t* us) const {
+  if (header_.timeBaseRate == 0) {
+    return false;
+  }
+  uint64_t scale = 1;
+  if (frameHeaderSize_ == sizeof(IvfFrameHeader) && header_.timeBaseScale > 0) {
+    scale = header_.timeBaseScale;
+  }
+  *us = static_cast<int64_t>(timestamp * scale * 1000000 / header_.timeBaseRate);
+  return true;
+}
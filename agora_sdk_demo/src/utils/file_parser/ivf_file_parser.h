@@ -0,0 +1,95 @@
+//  Agora RTC/MEDIA SDK
+//
+//  Copyright (c) 2020 Agora.io. All rights reserved.
+//
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <memory>
+
+#include "av1_obu_file_parser.h"
+
+class MappedFile;
+
+// IVF fourccs are little endian byte strings, compared in host order.
+constexpr uint32_t IvfFourcc(char a, char b, char c, char d) {
+  return static_cast<uint8_t>(a) | static_cast<uint8_t>(b) << 8 | static_cast<uint8_t>(c) << 16 |
+         static_cast<uint32_t>(static_cast<uint8_t>(d)) << 24;
+}
+
+// The 32 byte IVF file header.
+struct IvfFileHeader {
+  uint32_t signature;  // "DKIF"
+  uint16_t version;
+  uint16_t headerSize;
+  uint32_t fourcc;
+  uint16_t width;
+  uint16_t height;
+  // Timestamps count |timeBaseRate| / |timeBaseScale| ticks per second.
+  // Our recorder counts |timeBaseRate| ticks and puts the frame rate into
+  // |timeBaseScale|.
+  uint32_t timeBaseRate;
+  uint32_t timeBaseScale;
+  uint32_t frameCount;
+  uint32_t unused;
+};
+
+static_assert(sizeof(IvfFileHeader) == 32, "IvfFileHeader must stay packed");
+
+// One frame of an IVF file. For VP9 that may be a superframe, which bundles
+// frames that are decoded but never shown, such as an alt-ref, with the
+// frame that is shown.
+struct IvfFrame {
+  const uint8_t* data;
+  size_t size;
+  // Where |data| starts in the file.
+  uint64_t offset;
+  uint64_t timestamp;
+  bool keyFrame;
+  // Whether decoding the frame puts a picture on screen. Hidden frames only
+  // update references and take no display time.
+  bool shown;
+};
+
+// Reads the frame sizes of the VP9 superframe index at the end of [data,
+// data + size) (VP9 Annex B) into |sizes|. Returns how many frames the
+// superframe holds, 0 if the data isn't a superframe.
+size_t ParseVp9Superframe(const uint8_t* data, size_t size, uint32_t sizes[8]);
+
+// Tells whether the VP8 or VP9 frame in [data, data + size) is a key frame
+// and whether it is shown, from the start of its uncompressed header. VP9
+// superframes are split first, they are shown if any of their frames is.
+bool ParseVpxFrameType(uint32_t fourcc, const uint8_t* data, size_t size, bool* keyFrame,
+                       bool* shown);
+
+// Splits an IVF file into its frames, handed out as views into the mapped
+// file. Takes the standard 12 byte frame headers of libvpx and libaom as
+// well as the 16 byte ones of our recorder, which also carry the frame type.
+class IvfFileParser {
+ public:
+  explicit IvfFileParser(const char* filepath);
+  virtual ~IvfFileParser();
+
+  // Whether |filepath| starts with an IVF signature.
+  static bool IsIvfFile(const char* filepath);
+
+  bool open();
+  bool hasNext() const;
+  bool getNextFrame(IvfFrame* frame);
+  void reset();
+
+  const IvfFileHeader& header() const { return header_; }
+  // Converts a frame timestamp to microseconds, false without a time base.
+  bool timestampToUs(uint64_t timestamp, int64_t* us) const;
+
+ private:
+  std::unique_ptr<MappedFile> mappedFile_;
+  IvfFileHeader header_;
+  size_t frameHeaderSize_;
+  size_t end_;
+  size_t pos_;
+  Av1SequenceHeader av1SequenceHeader_;
+  bool hasAv1SequenceHeader_;
+};
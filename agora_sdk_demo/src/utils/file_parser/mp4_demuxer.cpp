@@ -0,0 +1,721 @@
+//  Agora RTC/MEDIA SDK
+//
+//  Copyright (c) 2020 Agora.io. All rights reserved.
+//
+
+#include "mp4_demuxer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "utils/mapped_file.h"
+
+namespace {
+
+constexpr uint32_t BoxType(const char (&name)[5]) {
+  return static_cast<uint32_t>(static_cast<uint8_t>(name[0])) << 24 |
+         static_cast<uint32_t>(static_cast<uint8_t>(name[1])) << 16 |
+         static_cast<uint32_t>(static_cast<uint8_t>(name[2])) << 8 |
+         static_cast<uint32_t>(static_cast<uint8_t>(name[3]));
+}
+
+uint16_t Be16(const uint8_t* p) { return static_cast<uint16_t>(p[0] << 8 | p[1]); }
+
+uint32_t Be32(const uint8_t* p) {
+  return static_cast<uint32_t>(p[0]) << 24 | static_cast<uint32_t>(p[1]) << 16 |
+         static_cast<uint32_t>(p[2]) << 8 | static_cast<uint32_t>(p[3]);
+}
+
+uint64_t Be64(const uint8_t* p) { return static_cast<uint64_t>(Be32(p)) << 32 | Be32(p + 4); }
+
+struct Mp4Box {
+  uint32_t type;
+  // Offset of the box header from the start of the enclosing data.
+  size_t offset;
+  const uint8_t* payload;
+  size_t size;
+};
+
+// Reads the box at |*pos| of the |size| bytes at |data| and moves |*pos| past
+// it. A box claiming more than what is left gets cut to what is left.
+bool ReadBox(const uint8_t* data, size_t size, size_t* pos, Mp4Box* box) {
+  if (size - *pos < 8) {
+    return false;
+  }
+  const uint8_t* p = data + *pos;
+  uint64_t boxSize = Be32(p);
+  size_t headerSize = 8;
+  if (boxSize == 1) {
+    if (size - *pos < 16) {
+      return false;
+    }
+    boxSize = Be64(p + 8);
+    headerSize = 16;
+  } else if (boxSize == 0) {
+    // Up to the end of the enclosing box.
+    boxSize = size - *pos;
+  }
+  if (boxSize < headerSize) {
+    return false;
+  }
+  if (boxSize > size - *pos) {
+    boxSize = size - *pos;
+  }
+  box->type = Be32(p + 4);
+  box->offset = *pos;
+  box->payload = p + headerSize;
+  box->size = static_cast<size_t>(boxSize) - headerSize;
+  *pos += static_cast<size_t>(boxSize);
+  return true;
+}
+
+// Returns the payload of the first |type| child box in |data|.
+bool FindBox(const uint8_t* data, size_t size, uint32_t type, Mp4Box* box) {
+  size_t pos = 0;
+  while (ReadBox(data, size, &pos, box)) {
+    if (box->type == type) {
+      return true;
+    }
+  }
+  return false;
+}
+
+// Size of an MPEG-4 descriptor (ISO 14496-1 8.3.3), up to four bytes of
+// seven bits each.
+bool ReadDescriptorSize(const uint8_t* data, size_t size, size_t* pos, size_t* length) {
+  *length = 0;
+  for (int i = 0; i < 4; ++i) {
+    if (*pos >= size) {
+      return false;
+    }
+    uint8_t byte = data[(*pos)++];
+    *length = *length << 7 | (byte & 0x7F);
+    if (!(byte & 0x80)) {
+      return true;
+    }
+  }
+  return true;
+}
+
+// Finds the AudioSpecificConfig in the ES_Descriptor of an esds box.
+bool FindAudioSpecificConfig(const uint8_t* data, size_t size, const uint8_t** config,
+                             size_t* configSize) {
+  const uint8_t kEsDescriptorTag = 0x03;
+  const uint8_t kDecoderConfigDescriptorTag = 0x04;
+  const uint8_t kDecoderSpecificInfoTag = 0x05;
+
+  // Version and flags of the full box.
+  size_t pos = 4;
+  size_t length = 0;
+  if (pos >= size || data[pos++] != kEsDescriptorTag ||
+      !ReadDescriptorSize(data, size, &pos, &length) || size - pos < 3) {
+    return false;
+  }
+  pos += 2;
+  uint8_t flags = data[pos++];
+  if (flags & 0x80) {
+    // dependsOn_ES_ID
+    pos += 2;
+  }
+  if (flags & 0x40) {
+    // URL
+    if (pos >= size) {
+      return false;
+    }
+    pos += 1 + data[pos];
+  }
+  if (flags & 0x20) {
+    // OCR_ES_Id
+    pos += 2;
+  }
+  if (pos >= size || data[pos++] != kDecoderConfigDescriptorTag ||
+      !ReadDescriptorSize(data, size, &pos, &length)) {
+    return false;
+  }
+  // objectTypeIndication, streamType, bufferSizeDB and the two bit rates.
+  pos += 13;
+  if (pos >= size || data[pos++] != kDecoderSpecificInfoTag ||
+      !ReadDescriptorSize(data, size, &pos, &length) || length > size - pos) {
+    return false;
+  }
+  *config = data + pos;
+  *configSize = length;
+  return true;
+}
+
+// Sample flags of fragments (ISO 14496-12 8.8.3.1).
+bool IsSyncSample(uint32_t flags) {
+  const uint32_t kSampleIsNonSyncSample = 0x10000;
+  return !(flags & kSampleIsNonSyncSample);
+}
+
+const uint32_t kTfhdBaseDataOffset = 0x000001;
+const uint32_t kTfhdSampleDescriptionIndex = 0x000002;
+const uint32_t kTfhdDefaultSampleDuration = 0x000008;
+const uint32_t kTfhdDefaultSampleSize = 0x000010;
+const uint32_t kTfhdDefaultSampleFlags = 0x000020;
+
+const uint32_t kTrunDataOffset = 0x000001;
+const uint32_t kTrunFirstSampleFlags = 0x000004;
+const uint32_t kTrunSampleDuration = 0x000100;
+const uint32_t kTrunSampleSize = 0x000200;
+const uint32_t kTrunSampleFlags = 0x000400;
+const uint32_t kTrunSampleCompositionTimeOffset = 0x000800;
+
+}  // namespace
+
+Mp4Demuxer::Mp4Demuxer(const char* filepath)
+    : filePath_(strdup(filepath)), mappedFile_(new MappedFile(filepath)) {}
+
+Mp4Demuxer::~Mp4Demuxer() { free(static_cast<void*>(filePath_)); }
+
+bool Mp4Demuxer::open() {
+  if (mappedFile_->isOpen()) {
+    return reset() == 0;
+  }
+  if (!mappedFile_->open(MappedFile::kAdviceSequential)) {
+    printf("Open test file %s failed\n", filePath_);
+    return false;
+  }
+  const uint8_t* data = mappedFile_->data();
+  const size_t size = mappedFile_->size();
+  bool hasMoov = false;
+  size_t pos = 0;
+  Mp4Box box;
+  while (ReadBox(data, size, &pos, &box)) {
+    if (box.type == BoxType("moov")) {
+      hasMoov = parseMoov(box.payload, box.size);
+    } else if (box.type == BoxType("moof") && hasMoov) {
+      parseMoof(box.payload, box.size, box.offset);
+    }
+  }
+
+  // Samples outside of the file, e.g. of a truncated download, are dropped.
+  size_t samples = 0;
+  for (Track& track : mp4Tracks_) {
+    for (size_t i = 0; i < track.samples.size(); ++i) {
+      const Sample& sample = track.samples[i];
+      if (sample.offset > size || sample.size > size - sample.offset) {
+        track.samples.resize(i);
+        break;
+      }
+    }
+    samples += track.samples.size();
+  }
+  if (tracks_.empty() || samples == 0) {
+    printf("No H.264, H.265 or AAC samples in %s\n", filePath_);
+    mappedFile_->close();
+    return false;
+  }
+  return true;
+}
+
+bool Mp4Demuxer::parseMoov(const uint8_t* data, size_t size) {
+  size_t pos = 0;
+  Mp4Box box;
+  while (ReadBox(data, size, &pos, &box)) {
+    if (box.type == BoxType("trak")) {
+      parseTrak(box.payload, box.size);
+    }
+  }
+  // Fragment defaults, which refer to the tracks.
+  Mp4Box mvex;
+  if (FindBox(data, size, BoxType("mvex"), &mvex)) {
+    pos = 0;
+    while (ReadBox(mvex.payload, mvex.size, &pos, &box)) {
+      if (box.type == BoxType("trex")) {
+        parseTrex(box.payload, box.size);
+      }
+    }
+  }
+  return true;
+}
+
+bool Mp4Demuxer::parseTrak(const uint8_t* data, size_t size) {
+  Mp4Box tkhd, mdia, mdhd, hdlr, minf, stbl;
+  if (!FindBox(data, size, BoxType("tkhd"), &tkhd) ||
+      !FindBox(data, size, BoxType("mdia"), &mdia) ||
+      !FindBox(mdia.payload, mdia.size, BoxType("mdhd"), &mdhd) ||
+      !FindBox(mdia.payload, mdia.size, BoxType("hdlr"), &hdlr) ||
+      !FindBox(mdia.payload, mdia.size, BoxType("minf"), &minf) ||
+      !FindBox(minf.payload, minf.size, BoxType("stbl"), &stbl)) {
+    return false;
+  }
+
+  Track track;
+  track.nalLengthSize = 0;
+  track.defaultDuration = 0;
+  track.defaultSize = 0;
+  track.defaultFlags = 0;
+  track.next = 0;
+  memset(&track.aacConfig, 0, sizeof(track.aacConfig));
+
+  // Version 1 boxes have 64 bit times.
+  size_t idOffset = tkhd.size > 0 && tkhd.payload[0] == 1 ? 20 : 12;
+  size_t timescaleOffset = mdhd.size > 0 && mdhd.payload[0] == 1 ? 20 : 12;
+  if (tkhd.size < idOffset + 4 || mdhd.size < timescaleOffset + 4 || hdlr.size < 12) {
+    return false;
+  }
+  track.id = Be32(tkhd.payload + idOffset);
+  track.timescale = Be32(mdhd.payload + timescaleOffset);
+  uint32_t handler = Be32(hdlr.payload + 8);
+  if (track.timescale == 0 || (handler != BoxType("vide") && handler != BoxType("soun"))) {
+    return false;
+  }
+
+  ContainerTrack info;
+  memset(&info, 0, sizeof(info));
+  info.type = handler == BoxType("vide") ? ContainerTrack::kVideo : ContainerTrack::kAudio;
+  if (!parseStbl(stbl.payload, stbl.size, &info, &track)) {
+    return false;
+  }
+  tracks_.push_back(info);
+  mp4Tracks_.push_back(std::move(track));
+  return true;
+}
+
+bool Mp4Demuxer::parseSampleEntry(uint32_t type, const uint8_t* data, size_t size,
+                                  ContainerTrack* info, Track* track) {
+  if (info->type == ContainerTrack::kVideo) {
+    // Reserved, data_reference_index, predefined fields, width and height,
+    // resolutions, frame_count, compressorname, depth and predefined.
+    const size_t kVisualSampleEntrySize = 78;
+    if (size < kVisualSampleEntrySize) {
+      return false;
+    }
+    info->width = Be16(data + 24);
+    info->height = Be16(data + 26);
+    const uint8_t* boxes = data + kVisualSampleEntrySize;
+    size_t boxesSize = size - kVisualSampleEntrySize;
+    Mp4Box config;
+    if (type == BoxType("avc1") || type == BoxType("avc3")) {
+      info->videoCodec = agora::rtc::VIDEO_CODEC_H264;
+      return FindBox(boxes, boxesSize, BoxType("avcC"), &config) &&
+             ParseAvcDecoderConfig(config.payload, config.size, &track->nalLengthSize,
+                                   &track->parameterSets);
+    }
+    if (type == BoxType("hvc1") || type == BoxType("hev1")) {
+      info->videoCodec = agora::rtc::VIDEO_CODEC_H265;
+      return FindBox(boxes, boxesSize, BoxType("hvcC"), &config) &&
+             ParseHevcDecoderConfig(config.payload, config.size, &track->nalLengthSize,
+                                    &track->parameterSets);
+    }
+    return false;
+  }
+
+  if (type != BoxType("mp4a")) {
+    return false;
+  }
+  // Reserved, data_reference_index, version, revision, vendor, channelcount,
+  // samplesize, compression id, packet size and samplerate.
+  size_t audioSampleEntrySize = 28;
+  if (size < audioSampleEntrySize) {
+    return false;
+  }
+  // QuickTime sound description versions 1 and 2 carry more fields.
+  uint16_t version = Be16(data + 8);
+  if (version == 1) {
+    audioSampleEntrySize += 16;
+  } else if (version == 2) {
+    audioSampleEntrySize += 36;
+  }
+  if (size < audioSampleEntrySize) {
+    return false;
+  }
+  const uint8_t* boxes = data + audioSampleEntrySize;
+  size_t boxesSize = size - audioSampleEntrySize;
+  Mp4Box esds;
+  if (!FindBox(boxes, boxesSize, BoxType("esds"), &esds)) {
+    // QuickTime puts it into a wave box.
+    Mp4Box wave;
+    if (!FindBox(boxes, boxesSize, BoxType("wave"), &wave) ||
+        !FindBox(wave.payload, wave.size, BoxType("esds"), &esds)) {
+      return false;
+    }
+  }
+  const uint8_t* config = nullptr;
+  size_t configSize = 0;
+  if (!FindAudioSpecificConfig(esds.payload, esds.size, &config, &configSize) ||
+      !ParseAudioSpecificConfig(config, configSize, &track->aacConfig)) {
+    return false;
+  }
+  info->audioCodec =
+      track->aacConfig.sbr ? agora::rtc::AUDIO_CODEC_HEAAC : agora::rtc::AUDIO_CODEC_AACLC;
+  info->sampleRateHz = track->aacConfig.sampleRateHz;
+  info->numberOfChannels = track->aacConfig.channelConfig;
+  if (info->numberOfChannels == 0) {
+    info->numberOfChannels = Be16(data + 16);
+  }
+  return true;
+}
+
+bool Mp4Demuxer::parseStbl(const uint8_t* data, size_t size, ContainerTrack* info,
+                           Track* track) {
+  Mp4Box stsd;
+  if (!FindBox(data, size, BoxType("stsd"), &stsd) || stsd.size < 8) {
+    return false;
+  }
+  // Only the first sample description is used.
+  Mp4Box entry;
+  size_t pos = 8;
+  if (!ReadBox(stsd.payload, stsd.size, &pos, &entry) ||
+      !parseSampleEntry(entry.type, entry.payload, entry.size, info, track)) {
+    return false;
+  }
+
+  Mp4Box stts, ctts, stsc, stsz, stz2, stco, co64, stss;
+  bool hasSizes = FindBox(data, size, BoxType("stsz"), &stsz);
+  bool hasCompactSizes = !hasSizes && FindBox(data, size, BoxType("stz2"), &stz2);
+  bool hasOffsets = FindBox(data, size, BoxType("stco"), &stco);
+  bool hasLargeOffsets = !hasOffsets && FindBox(data, size, BoxType("co64"), &co64);
+  if (!FindBox(data, size, BoxType("stts"), &stts) ||
+      !FindBox(data, size, BoxType("stsc"), &stsc) || !(hasSizes || hasCompactSizes) ||
+      !(hasOffsets || hasLargeOffsets)) {
+    // Fragmented files describe their samples in moof only.
+    return true;
+  }
+
+  // Sample sizes.
+  std::vector<Sample>& samples = track->samples;
+  if (hasSizes) {
+    if (stsz.size < 12) {
+      return false;
+    }
+    uint32_t sampleSize = Be32(stsz.payload + 4);
+    uint32_t count = Be32(stsz.payload + 8);
+    if (sampleSize == 0 && count > (stsz.size - 12) / 4) {
+      return false;
+    }
+    samples.resize(count);
+    for (uint32_t i = 0; i < count; ++i) {
+      samples[i].size = sampleSize ? sampleSize : Be32(stsz.payload + 12 + 4 * i);
+    }
+  } else {
+    if (stz2.size < 12) {
+      return false;
+    }
+    uint32_t fieldSize = stz2.payload[7];
+    uint32_t count = Be32(stz2.payload + 8);
+    if ((fieldSize != 4 && fieldSize != 8 && fieldSize != 16) ||
+        count > (stz2.size - 12) * 8 / fieldSize) {
+      return false;
+    }
+    samples.resize(count);
+    const uint8_t* sizes = stz2.payload + 12;
+    for (uint32_t i = 0; i < count; ++i) {
+      if (fieldSize == 4) {
+        samples[i].size = (i & 1) ? sizes[i / 2] & 0x0F : sizes[i / 2] >> 4;
+      } else if (fieldSize == 8) {
+        samples[i].size = sizes[i];
+      } else {
+        samples[i].size = Be16(sizes + 2 * i);
+      }
+    }
+  }
+
+  // Chunk offsets, then the samples of each chunk back to back.
+  const Mp4Box& offsets = hasOffsets ? stco : co64;
+  size_t offsetSize = hasOffsets ? 4 : 8;
+  if (offsets.size < 8 || stsc.size < 8) {
+    return false;
+  }
+  uint32_t chunkCount = Be32(offsets.payload + 4);
+  uint32_t stscCount = Be32(stsc.payload + 4);
+  if (chunkCount > (offsets.size - 8) / offsetSize || stscCount > (stsc.size - 8) / 12) {
+    return false;
+  }
+  size_t sampleIndex = 0;
+  for (uint32_t i = 0; i < stscCount && sampleIndex < samples.size(); ++i) {
+    const uint8_t* run = stsc.payload + 8 + 12 * i;
+    uint32_t firstChunk = Be32(run);
+    uint32_t samplesPerChunk = Be32(run + 4);
+    uint32_t lastChunk = i + 1 < stscCount ? Be32(run + 12) - 1 : chunkCount;
+    if (firstChunk == 0 || lastChunk > chunkCount) {
+      return false;
+    }
+    for (uint32_t chunk = firstChunk; chunk <= lastChunk && sampleIndex < samples.size();
+         ++chunk) {
+      const uint8_t* entry = offsets.payload + 8 + offsetSize * (chunk - 1);
+      uint64_t offset = hasOffsets ? Be32(entry) : Be64(entry);
+      for (uint32_t j = 0; j < samplesPerChunk && sampleIndex < samples.size(); ++j) {
+        samples[sampleIndex].offset = offset;
+        offset += samples[sampleIndex].size;
+        ++sampleIndex;
+      }
+    }
+  }
+  samples.resize(sampleIndex);
+
+  // Decode times.
+  if (stts.size < 8) {
+    return false;
+  }
+  uint32_t sttsCount = Be32(stts.payload + 4);
+  if (sttsCount > (stts.size - 8) / 8) {
+    return false;
+  }
+  int64_t dts = 0;
+  sampleIndex = 0;
+  for (uint32_t i = 0; i < sttsCount; ++i) {
+    uint32_t count = Be32(stts.payload + 8 + 8 * i);
+    uint32_t delta = Be32(stts.payload + 12 + 8 * i);
+    for (uint32_t j = 0; j < count && sampleIndex < samples.size(); ++j) {
+      samples[sampleIndex].dts = dts;
+      samples[sampleIndex].compositionOffset = 0;
+      dts += delta;
+      ++sampleIndex;
+    }
+  }
+  samples.resize(sampleIndex);
+
+  // Composition offsets, signed in version 1 and in practice in version 0.
+  if (FindBox(data, size, BoxType("ctts"), &ctts) && ctts.size >= 8) {
+    uint32_t cttsCount = Be32(ctts.payload + 4);
+    if (cttsCount <= (ctts.size - 8) / 8) {
+      sampleIndex = 0;
+      for (uint32_t i = 0; i < cttsCount; ++i) {
+        uint32_t count = Be32(ctts.payload + 8 + 8 * i);
+        int32_t offset = static_cast<int32_t>(Be32(ctts.payload + 12 + 8 * i));
+        for (uint32_t j = 0; j < count && sampleIndex < samples.size(); ++j) {
+          samples[sampleIndex++].compositionOffset = offset;
+        }
+      }
+    }
+  }
+
+  // Without a sync sample table every sample is a sync sample.
+  bool hasSyncSamples = FindBox(data, size, BoxType("stss"), &stss) && stss.size >= 8;
+  for (Sample& sample : samples) {
+    sample.keyFrame = !hasSyncSamples;
+  }
+  if (hasSyncSamples) {
+    uint32_t count = Be32(stss.payload + 4);
+    for (uint32_t i = 0; i < count && 8 + 4 * i + 4 <= stss.size; ++i) {
+      uint32_t number = Be32(stss.payload + 8 + 4 * i);
+      if (number >= 1 && number <= samples.size()) {
+        samples[number - 1].keyFrame = true;
+      }
+    }
+  }
+  return true;
+}
+
+Mp4Demuxer::Track* Mp4Demuxer::findTrack(uint32_t id) {
+  for (Track& track : mp4Tracks_) {
+    if (track.id == id) {
+      return &track;
+    }
+  }
+  return nullptr;
+}
+
+void Mp4Demuxer::parseTrex(const uint8_t* data, size_t size) {
+  if (size < 24) {
+    return;
+  }
+  Track* track = findTrack(Be32(data + 4));
+  if (track) {
+    track->defaultDuration = Be32(data + 12);
+    track->defaultSize = Be32(data + 16);
+    track->defaultFlags = Be32(data + 20);
+  }
+}
+
+void Mp4Demuxer::parseMoof(const uint8_t* data, size_t size, uint64_t moofOffset) {
+  size_t pos = 0;
+  Mp4Box box;
+  while (ReadBox(data, size, &pos, &box)) {
+    if (box.type == BoxType("traf")) {
+      parseTraf(box.payload, box.size, moofOffset);
+    }
+  }
+}
+
+void Mp4Demuxer::parseTraf(const uint8_t* data, size_t size, uint64_t moofOffset) {
+  Mp4Box tfhd;
+  if (!FindBox(data, size, BoxType("tfhd"), &tfhd) || tfhd.size < 8) {
+    return;
+  }
+  const uint8_t* p = tfhd.payload;
+  const uint8_t* end = p + tfhd.size;
+  uint32_t flags = Be32(p) & 0xFFFFFF;
+  Track* track = findTrack(Be32(p + 4));
+  if (!track) {
+    return;
+  }
+  p += 8;
+  // Data offsets count from the moof box unless a base is given.
+  uint64_t baseOffset = moofOffset;
+  uint32_t defaultDuration = track->defaultDuration;
+  uint32_t defaultSize = track->defaultSize;
+  uint32_t defaultFlags = track->defaultFlags;
+  if ((flags & kTfhdBaseDataOffset) && end - p >= 8) {
+    baseOffset = Be64(p);
+    p += 8;
+  }
+  if (flags & kTfhdSampleDescriptionIndex) {
+    p += 4;
+  }
+  if ((flags & kTfhdDefaultSampleDuration) && end - p >= 4) {
+    defaultDuration = Be32(p);
+    p += 4;
+  }
+  if ((flags & kTfhdDefaultSampleSize) && end - p >= 4) {
+    defaultSize = Be32(p);
+    p += 4;
+  }
+  if ((flags & kTfhdDefaultSampleFlags) && end - p >= 4) {
+    defaultFlags = Be32(p);
+  }
+
+  // Decode time of the first sample, or where the last fragment ended.
+  int64_t dts = 0;
+  if (!track->samples.empty()) {
+    const Sample& last = track->samples.back();
+    dts = last.dts + defaultDuration;
+  }
+  Mp4Box tfdt;
+  if (FindBox(data, size, BoxType("tfdt"), &tfdt) && tfdt.size >= 8) {
+    dts = tfdt.payload[0] == 1 && tfdt.size >= 12 ? static_cast<int64_t>(Be64(tfdt.payload + 4))
+                                                   : Be32(tfdt.payload + 4);
+  }
+
+  uint64_t dataOffset = baseOffset;
+  size_t pos = 0;
+  Mp4Box trun;
+  while (ReadBox(data, size, &pos, &trun)) {
+    if (trun.type != BoxType("trun") || trun.size < 8) {
+      continue;
+    }
+    p = trun.payload;
+    end = p + trun.size;
+    uint32_t trunFlags = Be32(p) & 0xFFFFFF;
+    uint32_t count = Be32(p + 4);
+    p += 8;
+    if ((trunFlags & kTrunDataOffset) && end - p >= 4) {
+      dataOffset = baseOffset + static_cast<int32_t>(Be32(p));
+      p += 4;
+    }
+    uint32_t firstFlags = defaultFlags;
+    bool hasFirstFlags = (trunFlags & kTrunFirstSampleFlags) && end - p >= 4;
+    if (hasFirstFlags) {
+      firstFlags = Be32(p);
+      p += 4;
+    }
+    size_t fieldsSize = 4 * (!!(trunFlags & kTrunSampleDuration) + !!(trunFlags & kTrunSampleSize) +
+                             !!(trunFlags & kTrunSampleFlags) +
+                             !!(trunFlags & kTrunSampleCompositionTimeOffset));
+    if (fieldsSize > 0 && count > static_cast<size_t>(end - p) / fieldsSize) {
+      return;
+    }
+    for (uint32_t i = 0; i < count; ++i) {
+      Sample sample;
+      uint32_t duration = defaultDuration;
+      uint32_t sampleFlags = i == 0 && hasFirstFlags ? firstFlags : defaultFlags;
+      sample.size = defaultSize;
+      sample.compositionOffset = 0;
+      if (trunFlags & kTrunSampleDuration) {
+        duration = Be32(p);
+        p += 4;
+      }
+      if (trunFlags & kTrunSampleSize) {
+        sample.size = Be32(p);
+        p += 4;
+      }
+      if (trunFlags & kTrunSampleFlags) {
+        sampleFlags = Be32(p);
+        p += 4;
+      }
+      if (trunFlags & kTrunSampleCompositionTimeOffset) {
+        sample.compositionOffset = static_cast<int32_t>(Be32(p));
+        p += 4;
+      }
+      sample.offset = dataOffset;
+      sample.dts = dts;
+      sample.keyFrame = IsSyncSample(sampleFlags);
+      track->samples.push_back(sample);
+      dataOffset += sample.size;
+      dts += duration;
+    }
+  }
+}
+
+size_t Mp4Demuxer::sampleCount(int track) const { return mp4Tracks_[track].samples.size(); }
+
+bool Mp4Demuxer::getRawSample(int track, size_t i, const uint8_t** data, int* length) const {
+  if (track < 0 || static_cast<size_t>(track) >= mp4Tracks_.size() ||
+      i >= mp4Tracks_[track].samples.size()) {
+    return false;
+  }
+  const Sample& sample = mp4Tracks_[track].samples[i];
+  *data = mappedFile_->data() + sample.offset;
+  *length = static_cast<int>(sample.size);
+  return true;
+}
+
+bool Mp4Demuxer::convertSample(const Track& track, const ContainerTrack& info,
+                               const Sample& sample) {
+  const uint8_t* data = mappedFile_->data() + sample.offset;
+  sampleBuffer_.clear();
+  if (info.type == ContainerTrack::kAudio) {
+    uint8_t header[kAdtsHeaderSize];
+    if (!WriteAdtsHeader(track.aacConfig, sample.size, header)) {
+      return false;
+    }
+    sampleBuffer_.insert(sampleBuffer_.end(), header, header + sizeof(header));
+    sampleBuffer_.insert(sampleBuffer_.end(), data, data + sample.size);
+    return true;
+  }
+
+  if (sample.keyFrame) {
+    sampleBuffer_ = track.parameterSets;
+  }
+  AppendLengthPrefixedNalUnits(data, sample.size, track.nalLengthSize, &sampleBuffer_);
+  return !sampleBuffer_.empty();
+}
+
+bool Mp4Demuxer::getNext(ContainerSample* sample) {
+  while (true) {
+    // The track whose next sample is due first.
+    int next = -1;
+    int64_t nextDtsUs = 0;
+    for (size_t i = 0; i < mp4Tracks_.size(); ++i) {
+      const Track& track = mp4Tracks_[i];
+      if (track.next >= track.samples.size()) {
+        continue;
+      }
+      int64_t dtsUs = track.samples[track.next].dts * 1000000 / track.timescale;
+      if (next < 0 || dtsUs < nextDtsUs) {
+        next = static_cast<int>(i);
+        nextDtsUs = dtsUs;
+      }
+    }
+    if (next < 0) {
+      return false;
+    }
+
+    Track& track = mp4Tracks_[next];
+    const Sample& current = track.samples[track.next++];
+    if (!convertSample(track, tracks_[next], current)) {
+      continue;
+    }
+    sample->track = next;
+    sample->data = sampleBuffer_.data();
+    sample->length = static_cast<int>(sampleBuffer_.size());
+    sample->dtsUs = nextDtsUs;
+    sample->ptsUs = (current.dts + current.compositionOffset) * 1000000 / track.timescale;
+    sample->keyFrame = current.keyFrame;
+    return true;
+  }
+}
+
+int Mp4Demuxer::reset() {
+  if (!mappedFile_->isOpen()) {
+    return -1;
+  }
+  for (Track& track : mp4Tracks_) {
+    track.next = 0;
+  }
+  return 0;
+}
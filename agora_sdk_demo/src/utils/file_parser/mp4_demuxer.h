@@ -0,0 +1,80 @@
+//  Agora RTC/MEDIA SDK
+//
+//  Copyright (c) 2020 Agora.io. All rights reserved.
+//
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <memory>
+#include <vector>
+
+#include "aac_file_parser.h"
+#include "container_demuxer.h"
+
+class MappedFile;
+
+// Demuxes MP4 (ISO 14496-12) files, plain or fragmented, straight from the
+// memory mapped file. Sample tables come from moov for plain files and from
+// the moof boxes of fragmented ones. Samples are read in place: only video
+// gets copied, to turn its length prefixed NAL units into Annex-B, and AAC
+// to put an ADTS header in front.
+class Mp4Demuxer : public ContainerDemuxer {
+ public:
+  explicit Mp4Demuxer(const char* filepath);
+  ~Mp4Demuxer();
+
+  bool open() override;
+  bool getNext(ContainerSample* sample) override;
+  int reset() override;
+
+  // Sample |i| of |track| as stored in the file, without any conversion.
+  size_t sampleCount(int track) const;
+  bool getRawSample(int track, size_t i, const uint8_t** data, int* length) const;
+
+ private:
+  struct Sample {
+    uint64_t offset;
+    uint32_t size;
+    bool keyFrame;
+    // In the track's timescale.
+    int64_t dts;
+    int32_t compositionOffset;
+  };
+
+  struct Track {
+    uint32_t id;
+    uint32_t timescale;
+    // Size of the NAL unit length fields of H.264/H.265 samples.
+    int nalLengthSize;
+    // SPS/PPS (and VPS) from avcC/hvcC, as Annex-B.
+    std::vector<uint8_t> parameterSets;
+    AacAudioConfig aacConfig;
+    // Fragment defaults from trex.
+    uint32_t defaultDuration;
+    uint32_t defaultSize;
+    uint32_t defaultFlags;
+    std::vector<Sample> samples;
+    size_t next;
+  };
+
+  bool parseMoov(const uint8_t* data, size_t size);
+  bool parseTrak(const uint8_t* data, size_t size);
+  bool parseSampleEntry(uint32_t type, const uint8_t* data, size_t size, ContainerTrack* info,
+                        Track* track);
+  bool parseStbl(const uint8_t* data, size_t size, ContainerTrack* info, Track* track);
+  void parseTrex(const uint8_t* data, size_t size);
+  void parseMoof(const uint8_t* data, size_t size, uint64_t moofOffset);
+  void parseTraf(const uint8_t* data, size_t size, uint64_t moofOffset);
+  Track* findTrack(uint32_t id);
+
+  bool convertSample(const Track& track, const ContainerTrack& info, const Sample& sample);
+
+ private:
+  char* filePath_;
+  std::unique_ptr<MappedFile> mappedFile_;
+  // Parallel to |tracks_|.
+  std::vector<Track> mp4Tracks_;
+  std::vector<uint8_t> sampleBuffer_;
+};
@@ -0,0 +1,347 @@
+//  Agora RTC/MEDIA SDK
+//
+//  Copyright (c) 2020 Agora.io. All rights reserved.
+//
+
+#include "ogg_opus_packet_parser.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "ogg_opus_file_parser.h"
+#include "utils/live_stream_reader.h"
+
+namespace {
+
+const int kOpusSampleRateHz = 48000;
+// No packet lasts longer than 120 ms.
+const int kMaxOpusPacketSamples = 5760;
+const size_t kReadChunkSize = 64 * 1024;
+// Same as the buffer senders hand to getNext().
+const size_t kMaxValidatedPacketSize = 8192;
+
+const char kOpusHeadMagic[8] = {'O', 'p', 'u', 's', 'H', 'e', 'a', 'd'};
+// Magic, version, channel count, pre-skip and input sample rate.
+const size_t kOpusHeadMinSize = 19;
+
+}  // namespace
+
+int OpusPacketSamples(const uint8_t* packet, size_t length) {
+  if (length < 1) {
+    return 0;
+  }
+  int config = packet[0] >> 3;
+  int frameSamples = 0;
+  if (config < 12) {
+    // SILK only: 10, 20, 40 or 60 ms.
+    static const int kSilkFrameSamples[] = {480, 960, 1920, 2880};
+    frameSamples = kSilkFrameSamples[config & 3];
+  } else if (config < 16) {
+    // Hybrid: 10 or 20 ms.
+    frameSamples = (config & 1) ? 960 : 480;
+  } else {
+    // CELT only: 2.5, 5, 10 or 20 ms.
+    frameSamples = 120 << (config & 3);
+  }
+
+  int frames = 0;
+  switch (packet[0] & 3) {
+    case 0:
+      frames = 1;
+      break;
+    case 1:
+    case 2:
+      frames = 2;
+      break;
+    default:
+      if (length < 2) {
+        return 0;
+      }
+      frames = packet[1] & 0x3F;
+      break;
+  }
+  int samples = frames * frameSamples;
+  return samples <= kMaxOpusPacketSamples ? samples : 0;
+}
+
+OggOpusPacketParser::OggOpusPacketParser(const char* filepath, bool validate)
+    : oggOpusFilePath_(strdup(filepath)),
+      validate_(validate),
+      file_(nullptr),
+      streamStateReady_(false),
+      serialNo_(0),
+      eos_(false),
+      numberOfChannels_(0),
+      preSkip_(0),
+      nextPacket_(0),
+      granule_(0),
+      lastPacketPtsUs_(0),
+      lastPacketSamples_(0),
+      validationErrors_(0) {
+  ogg_sync_init(&syncState_);
+}
+
+OggOpusPacketParser::~OggOpusPacketParser() {
+  close();
+  ogg_sync_clear(&syncState_);
+  free(static_cast<void*>(oggOpusFilePath_));
+}
+
+void OggOpusPacketParser::close() {
+  if (file_) {
+    fclose(file_);
+    file_ = nullptr;
+  }
+  if (live_) {
+    live_->close();
+  }
+  if (streamStateReady_) {
+    ogg_stream_clear(&streamState_);
+    streamStateReady_ = false;
+  }
+  ogg_sync_reset(&syncState_);
+  packets_.clear();
+  packetGranules_.clear();
+  nextPacket_ = 0;
+  granule_ = 0;
+  eos_ = false;
+  validator_.reset();
+}
+
+bool OggOpusPacketParser::setLiveInput(bool follow) {
+  live_.reset(new LiveStreamReader(oggOpusFilePath_, follow));
+  return true;
+}
+
+void OggOpusPacketParser::cancel() {
+  if (live_) {
+    live_->cancel();
+  }
+}
+
+bool OggOpusPacketParser::open() {
+  close();
+  if (live_) {
+    if (!live_->open()) {
+      return false;
+    }
+  } else {
+    file_ = fopen(oggOpusFilePath_, "rb");
+    if (!file_) {
+      printf("open %s fail\n", oggOpusFilePath_);
+      return false;
+    }
+  }
+  if (!parseHeaders()) {
+    printf("%s is not an Ogg Opus file\n", oggOpusFilePath_);
+    close();
+    return false;
+  }
+  if (validate_ && !live_) {
+    validator_.reset(new OggOpusFileParser(oggOpusFilePath_));
+    if (!validator_->open()) {
+      printf("opusfile can't open %s, validation disabled\n", oggOpusFilePath_);
+      validator_.reset();
+    }
+  }
+  return true;
+}
+
+int OggOpusPacketParser::reset() { return !live_ && open() ? 0 : -1; }
+
+bool OggOpusPacketParser::readPage(ogg_page* page) {
+  while (true) {
+    int ret = ogg_sync_pageout(&syncState_, page);
+    if (ret > 0) {
+      return true;
+    }
+    if (ret < 0) {
+      // Skipped garbage while resyncing.
+      continue;
+    }
+    // A live read returns whatever arrived, so a page goes out as soon as
+    // its last byte is in.
+    char* buffer = ogg_sync_buffer(&syncState_, kReadChunkSize);
+    size_t bytes = live_ ? live_->read(reinterpret_cast<uint8_t*>(buffer), kReadChunkSize)
+                         : fread(buffer, 1, kReadChunkSize, file_);
+    if (bytes == 0) {
+      return false;
+    }
+    ogg_sync_wrote(&syncState_, bytes);
+  }
+}
+
+bool OggOpusPacketParser::parseHeaders() {
+  ogg_page page;
+  // Find the beginning of the first Opus stream.
+  while (!streamStateReady_) {
+    if (!readPage(&page) || !ogg_page_bos(&page)) {
+      return false;
+    }
+    if (page.body_len < static_cast<long>(kOpusHeadMinSize) ||
+        memcmp(page.body, kOpusHeadMagic, sizeof(kOpusHeadMagic)) != 0) {
+      // Some other logical stream.
+      continue;
+    }
+    serialNo_ = ogg_page_serialno(&page);
+    ogg_stream_init(&streamState_, serialNo_);
+    streamStateReady_ = true;
+    ogg_stream_pagein(&streamState_, &page);
+  }
+
+  // OpusHead, then OpusTags which may span several pages.
+  ogg_packet packet;
+  int headerPackets = 0;
+  while (headerPackets < 2) {
+    int ret = ogg_stream_packetout(&streamState_, &packet);
+    if (ret < 0) {
+      return false;
+    }
+    if (ret == 0) {
+      if (!readPage(&page)) {
+        return false;
+      }
+      if (ogg_page_serialno(&page) == serialNo_) {
+        ogg_stream_pagein(&streamState_, &page);
+      }
+      continue;
+    }
+    if (headerPackets == 0) {
+      if (packet.bytes < static_cast<long>(kOpusHeadMinSize)) {
+        return false;
+      }
+      numberOfChannels_ = packet.packet[9];
+      preSkip_ = packet.packet[10] | packet.packet[11] << 8;
+    }
+    ++headerPackets;
+  }
+  return numberOfChannels_ > 0;
+}
+
+bool OggOpusPacketParser::fillPackets() {
+  packets_.clear();
+  packetGranules_.clear();
+  nextPacket_ = 0;
+  while (packets_.empty()) {
+    if (eos_) {
+      return false;
+    }
+    ogg_page page;
+    if (!readPage(&page)) {
+      return false;
+    }
+    if (ogg_page_serialno(&page) != serialNo_) {
+      if (ogg_page_bos(&page)) {
+        // A chained stream starts, only the first one is played.
+        return false;
+      }
+      continue;
+    }
+    ogg_stream_pagein(&streamState_, &page);
+    eos_ = ogg_page_eos(&page) != 0;
+
+    ogg_packet packet;
+    int pageSamples = 0;
+    int ret = 0;
+    while ((ret = ogg_stream_packetout(&streamState_, &packet)) != 0) {
+      if (ret < 0) {
+        // Lost data, the granule of this page puts the timeline back.
+        continue;
+      }
+      packets_.push_back(packet);
+      pageSamples += OpusPacketSamples(packet.packet, packet.bytes);
+    }
+
+    // The page granule is where its last packet ends. The last page may end
+    // earlier than its packets to trim padding, so it keeps counting.
+    int64_t pageGranule = ogg_page_granulepos(&page);
+    if (!packets_.empty() && pageGranule >= 0 && !eos_) {
+      granule_ = pageGranule - pageSamples;
+      if (granule_ < 0) {
+        granule_ = 0;
+      }
+    }
+  }
+  for (const ogg_packet& packet : packets_) {
+    packetGranules_.push_back(granule_);
+    granule_ += OpusPacketSamples(packet.packet, packet.bytes);
+  }
+  return true;
+}
+
+bool OggOpusPacketParser::hasNext() {
+  return nextPacket_ < packets_.size() || fillPackets();
+}
+
+bool OggOpusPacketParser::getNext(const uint8_t** data, int* length) {
+  if (!hasNext()) {
+    *length = 0;
+    return false;
+  }
+  const ogg_packet& packet = packets_[nextPacket_];
+  *data = packet.packet;
+  *length = static_cast<int>(packet.bytes);
+  lastPacketPtsUs_ = (packetGranules_[nextPacket_] - preSkip_) * 1000000 / kOpusSampleRateHz;
+  lastPacketSamples_ = OpusPacketSamples(*data, *length);
+  ++nextPacket_;
+  if (validator_) {
+    validate(*data, *length);
+  }
+  return true;
+}
+
+void OggOpusPacketParser::getNext(char* buffer, int* length) {
+  const uint8_t* data = nullptr;
+  int size = 0;
+  if (!getNext(&data, &size)) {
+    *length = 0;
+    return;
+  }
+  if (size > *length) {
+    printf("Opus packet of %d bytes exceeds the buffer of %d bytes\n", size, *length);
+    *length = 0;
+    return;
+  }
+  memcpy(buffer, data, size);
+  *length = size;
+}
+
+void OggOpusPacketParser::validate(const uint8_t* data, int length) {
+  validationBuffer_.resize(kMaxValidatedPacketSize);
+  int expectedLength = static_cast<int>(validationBuffer_.size());
+  if (!validator_->hasNext()) {
+    expectedLength = 0;
+  } else {
+    validator_->getNext(validationBuffer_.data(), &expectedLength);
+  }
+  if (expectedLength != length || memcmp(validationBuffer_.data(), data, length) != 0) {
+    ++validationErrors_;
+    printf("Opus packet mismatch in %s at %lld us: %d bytes, opusfile has %d bytes\n",
+           oggOpusFilePath_, static_cast<long long>(lastPacketPtsUs_), length, expectedLength);
+  }
+}
+
+agora::rtc::AUDIO_CODEC_TYPE OggOpusPacketParser::getCodecType() {
+  return agora::rtc::AUDIO_CODEC_OPUS;
+}
+
+// All Opus audio is coded at 48 kHz, whatever rate the source had.
+int OggOpusPacketParser::getSampleRateHz() { return kOpusSampleRateHz; }
+
+int OggOpusPacketParser::getNumberOfChannels() { return numberOfChannels_; }
+
+int OggOpusPacketParser::getFrameSamples() { return lastPacketSamples_; }
+
+bool OggOpusPacketParser::next(AudioFrameView* frame) {
+  const uint8_t* data = nullptr;
+  int length = 0;
+  if (!getNext(&data, &length)) {
+    return false;
+  }
+  frame->data = data;
+  frame->size = length;
+  frame->ptsUs = lastPacketPtsUs_;
+  frame->durationSamples = lastPacketSamples_;
+  frame->flags = lastPacketPtsUs_ < 0 ? AudioFrameView::kPriming : 0;
+  return true;
+}
@@ -0,0 +1,96 @@
+//  Agora RTC/MEDIA SDK
+//
+//  Copyright (c) 2020 Agora.io. All rights reserved.
+//
+
+#pragma once
+
+#include <ogg/ogg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <memory>
+#include <vector>
+
+#include "utils/file_parser/audio_file_parser_factory.h"
+
+class LiveStreamReader;
+class OggOpusFileParser;
+
+// Number of 48 kHz samples in an Opus packet according to its TOC byte
+// (RFC 6716 3.1), or 0 if the packet is malformed.
+int OpusPacketSamples(const uint8_t* packet, size_t length);
+
+// Demuxes the first Opus stream of an Ogg file with libogg and hands out the
+// compressed packets as they are, without decoding anything. Timestamps are
+// derived from the page granule positions.
+//
+// In validation mode every packet is also checked against the packet opusfile
+// produces while decoding the same file, which costs a full decode per packet.
+// Live streams aren't validated, opusfile can't read them a second time.
+class OggOpusPacketParser : public AudioFileParser {
+ public:
+  explicit OggOpusPacketParser(const char* filepath, bool validate = false);
+  virtual ~OggOpusPacketParser();
+
+ public:
+  // AudioFileParser
+  bool open() override;
+  bool hasNext() override;
+
+  void getNext(char* buffer, int* length) override;
+
+  agora::rtc::AUDIO_CODEC_TYPE getCodecType() override;
+  int getSampleRateHz() override;
+  int getNumberOfChannels() override;
+  int getFrameSamples() override;
+  int reset() override;
+  // Timed by the granule positions, priming packets are flagged.
+  bool next(AudioFrameView* frame) override;
+  bool setLiveInput(bool follow) override;
+  void cancel() override;
+
+  // Points |data| at the next packet, valid until the next call.
+  bool getNext(const uint8_t** data, int* length);
+
+  // Presentation time of the packet returned last, pre-skip removed. Negative
+  // for packets that only prime the decoder.
+  int64_t lastPacketPtsUs() const { return lastPacketPtsUs_; }
+  int preSkip() const { return preSkip_; }
+  // Packets that didn't match opusfile's in validation mode.
+  int validationErrors() const { return validationErrors_; }
+
+ private:
+  bool readPage(ogg_page* page);
+  bool fillPackets();
+  bool parseHeaders();
+  void validate(const uint8_t* data, int length);
+  void close();
+
+ private:
+  char* oggOpusFilePath_;
+  bool validate_;
+  FILE* file_;
+  std::unique_ptr<LiveStreamReader> live_;
+  ogg_sync_state syncState_;
+  ogg_stream_state streamState_;
+  bool streamStateReady_;
+  int serialNo_;
+  bool eos_;
+
+  int numberOfChannels_;
+  int preSkip_;
+
+  // Packets of the current page, they point into |streamState_| and stay
+  // valid until the next page goes in.
+  std::vector<ogg_packet> packets_;
+  std::vector<int64_t> packetGranules_;
+  size_t nextPacket_;
+  // Granule position where the next packet starts.
+  int64_t granule_;
+  int64_t lastPacketPtsUs_;
+  int lastPacketSamples_;
+
+  std::unique_ptr<OggOpusFileParser> validator_;
+  std::vector<char> validationBuffer_;
+  int validationErrors_;
+};
@@ -0,0 +1,135 @@
+//  Agora RTC/MEDIA SDK
+//
+//  Copyright (c) 2020 Agora.io. All rights reserved.
+//
+
+#include "prefetching_audio_file_parser.h"
+
+#include <stdio.h>
+#include <string.h>
+
+namespace {
+
+// Queued frames end with their timing, which the reader strips.
+struct FrameTrailer {
+  int64_t ptsUs;
+  uint32_t durationSamples;
+  uint32_t flags;
+};
+
+const int kFrameTrailerSize = sizeof(FrameTrailer);
+
+}  // namespace
+
+PrefetchingAudioFileParser::PrefetchingAudioFileParser(std::unique_ptr<AudioFileParser> parser,
+                                                       int frames)
+    : parser_(std::move(parser)),
+      source_(std::bind(&PrefetchingAudioFileParser::readFrame, this, std::placeholders::_1),
+              frames),
+      codecType_(agora::rtc::AUDIO_CODEC_OPUS),
+      sampleRateHz_(0),
+      numberOfChannels_(0),
+      bitsPerSample_(0),
+      lastFrame_{nullptr, 0, 0, 0, 0} {}
+
+PrefetchingAudioFileParser::~PrefetchingAudioFileParser() { stop(); }
+
+void PrefetchingAudioFileParser::stop() {
+  // A live parser may be waiting for its writer.
+  cancel();
+  source_.stop();
+}
+
+void PrefetchingAudioFileParser::cancel() {
+  if (parser_) {
+    parser_->cancel();
+  }
+}
+
+bool PrefetchingAudioFileParser::open() {
+  stop();
+  if (!parser_ || !parser_->open()) {
+    return false;
+  }
+  codecType_ = parser_->getCodecType();
+  sampleRateHz_ = parser_->getSampleRateHz();
+  numberOfChannels_ = parser_->getNumberOfChannels();
+  bitsPerSample_ = parser_->getBitsPerSample();
+  source_.start();
+  return true;
+}
+
+bool PrefetchingAudioFileParser::readFrame(std::vector<uint8_t>* frame) {
+  AudioFrameView view;
+  if (!parser_->next(&view)) {
+    return false;
+  }
+  FrameTrailer trailer = {view.ptsUs, view.durationSamples, view.flags};
+  frame->assign(view.data, view.data + view.size);
+  frame->insert(frame->end(), reinterpret_cast<const uint8_t*>(&trailer),
+                reinterpret_cast<const uint8_t*>(&trailer) + kFrameTrailerSize);
+  return true;
+}
+
+bool PrefetchingAudioFileParser::hasNext() { return source_.hasNext(); }
+
+bool PrefetchingAudioFileParser::getNext(const uint8_t** data, int* length) {
+  AudioFrameView view;
+  if (!next(&view)) {
+    *length = 0;
+    return false;
+  }
+  *data = view.data;
+  *length = static_cast<int>(view.size);
+  return true;
+}
+
+bool PrefetchingAudioFileParser::next(AudioFrameView* frame) {
+  const uint8_t* data = nullptr;
+  int length = 0;
+  if (!source_.next(&data, &length) || length < kFrameTrailerSize) {
+    return false;
+  }
+  FrameTrailer trailer;
+  length -= kFrameTrailerSize;
+  memcpy(&trailer, data + length, kFrameTrailerSize);
+  lastFrame_ = {data, static_cast<size_t>(length), trailer.ptsUs, trailer.durationSamples,
+                trailer.flags};
+  *frame = lastFrame_;
+  return true;
+}
+
+void PrefetchingAudioFileParser::getNext(char* buffer, int* length) {
+  const uint8_t* data = nullptr;
+  int size = 0;
+  if (!getNext(&data, &size)) {
+    *length = 0;
+    return;
+  }
+  if (size > *length) {
+    printf("Audio frame of %d bytes exceeds the buffer of %d bytes\n", size, *length);
+    *length = 0;
+    return;
+  }
+  memcpy(buffer, data, size);
+  *length = size;
+}
+
+agora::rtc::AUDIO_CODEC_TYPE PrefetchingAudioFileParser::getCodecType() { return codecType_; }
+
+int PrefetchingAudioFileParser::getSampleRateHz() { return sampleRateHz_; }
+
+int PrefetchingAudioFileParser::getNumberOfChannels() { return numberOfChannels_; }
+
+int PrefetchingAudioFileParser::getBitsPerSample() { return bitsPerSample_; }
+
+int PrefetchingAudioFileParser::getFrameSamples() {
+  return static_cast<int>(lastFrame_.durationSamples);
+}
+
+int PrefetchingAudioFileParser::reset() {
+  stop();
+  int ret = parser_->reset();
+  source_.start();
+  return ret;
+}
@@ -0,0 +1,59 @@
+//  Agora RTC/MEDIA SDK
+//
+//  Copyright (c) 2020 Agora.io. All rights reserved.
+//
+
+#pragma once
+
+#include <stdint.h>
+#include <memory>
+#include <vector>
+
+#include "audio_file_parser_factory.h"
+#include "utils/media_file_source.h"
+
+// Runs another AudioFileParser on a background thread and keeps up to
+// |frames| frames ready ahead of the caller. The wrapped parser must not be
+// used directly once this one owns it.
+class PrefetchingAudioFileParser : public AudioFileParser {
+ public:
+  PrefetchingAudioFileParser(std::unique_ptr<AudioFileParser> parser, int frames);
+  ~PrefetchingAudioFileParser();
+
+ public:
+  // AudioFileParser
+  bool open() override;
+  bool hasNext() override;
+
+  void getNext(char* buffer, int* length) override;
+
+  agora::rtc::AUDIO_CODEC_TYPE getCodecType() override;
+  int getSampleRateHz() override;
+  int getNumberOfChannels() override;
+  int getBitsPerSample() override;
+  int getFrameSamples() override;
+  int reset() override;
+  // Passes on the timing of the wrapped parser.
+  bool next(AudioFrameView* frame) override;
+  void cancel() override;
+
+  // Points |data| at the next frame, valid until the next call.
+  bool getNext(const uint8_t** data, int* length);
+
+  uint64_t underruns() const { return source_.underruns(); }
+
+ private:
+  bool readFrame(std::vector<uint8_t>* frame);
+  void stop();
+
+ private:
+  std::unique_ptr<AudioFileParser> parser_;
+  MediaFileSource source_;
+
+  // Taken from |parser_| before the background thread starts.
+  agora::rtc::AUDIO_CODEC_TYPE codecType_;
+  int sampleRateHz_;
+  int numberOfChannels_;
+  int bitsPerSample_;
+  AudioFrameView lastFrame_;
+};
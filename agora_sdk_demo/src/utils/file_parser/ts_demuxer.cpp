@@ -0,0 +1,488 @@
+//  Agora RTC/MEDIA SDK
+//
+//  Copyright (c) 2020 Agora.io. All rights reserved.
+//
+
+#include "ts_demuxer.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "utils/mapped_file.h"
+#include "utils/start_code_finder.h"
+#include "utils/ts_packet_sync.h"
+
+namespace {
+
+const uint16_t kPatPid = 0x0000;
+
+const uint8_t kStreamTypeAacAdts = 0x0F;
+const uint8_t kStreamTypeH264 = 0x1B;
+const uint8_t kStreamTypeH265 = 0x24;
+
+const uint8_t kTableIdPat = 0x00;
+const uint8_t kTableIdPmt = 0x02;
+
+const int64_t kTimestampRate = 90000;
+const uint64_t kTimestampMask = (1ull << 33) - 1;
+// A jump between timestamps or PCRs this large is a discontinuity.
+const int64_t kMaxTimestampJump = 10 * kTimestampRate;
+
+// Samples a stream may have waiting while another stream has none, which
+// bounds the memory a stream without data costs.
+const size_t kMaxQueuedSamples = 128;
+
+// Stop looking for the PMT and the audio configs after this much.
+const size_t kMaxProbeBytes = 4 * 1024 * 1024;
+
+const int kAacSamplesPerFrame = 1024;
+
+// Difference of two 33 bit timestamps, taking the shorter way around.
+int64_t TimestampDelta(uint64_t to, uint64_t from) {
+  int64_t delta = static_cast<int64_t>((to - from) & kTimestampMask);
+  return delta >= (1ll << 32) ? delta - (1ll << 33) : delta;
+}
+
+uint64_t ReadPesTimestamp(const uint8_t* p) {
+  return static_cast<uint64_t>(p[0] & 0x0E) << 29 | static_cast<uint64_t>(p[1]) << 22 |
+         static_cast<uint64_t>(p[2] & 0xFE) << 14 | static_cast<uint64_t>(p[3]) << 7 |
+         static_cast<uint64_t>(p[4]) >> 1;
+}
+
+bool ContainsKeyFrame(agora::rtc::VIDEO_CODEC_TYPE codec, const uint8_t* data, size_t size) {
+  const uint8_t* end = data + size;
+  for (const uint8_t* p = FindStartCode(data, end); end - p > 3; p = FindStartCode(p + 3, end)) {
+    uint8_t header = p[3];
+    if (codec == agora::rtc::VIDEO_CODEC_H264) {
+      // IDR slice.
+      if ((header & 0x1F) == 5) {
+        return true;
+      }
+    } else {
+      // BLA, IDR and CRA pictures.
+      int type = (header >> 1) & 0x3F;
+      if (type >= 16 && type <= 21) {
+        return true;
+      }
+    }
+  }
+  return false;
+}
+
+// The section after the pointer_field of a payload that starts one, and its
+// length up to the CRC.
+bool GetSection(const uint8_t* payload, size_t size, uint8_t tableId, const uint8_t** section,
+                size_t* sectionSize) {
+  if (size < 1 || payload[0] >= size - 1) {
+    return false;
+  }
+  const uint8_t* s = payload + 1 + payload[0];
+  size_t left = size - 1 - payload[0];
+  if (left < 3 || s[0] != tableId) {
+    return false;
+  }
+  size_t length = (s[1] & 0x0F) << 8 | s[2];
+  // Sections spanning packets aren't supported, PAT and PMT rarely do.
+  if (length < 9 || length + 3 > left) {
+    return false;
+  }
+  *section = s;
+  *sectionSize = length + 3 - 4;
+  return true;
+}
+
+}  // namespace
+
+TsDemuxer::TsDemuxer(const char* filepath)
+    : filePath_(strdup(filepath)),
+      mappedFile_(new MappedFile(filepath)),
+      position_(0),
+      syncedPackets_(0),
+      pmtPid_(-1),
+      pcrPid_(-1),
+      hasPmt_(false),
+      hasTimestamp_(false),
+      lastRawTimestamp_(0),
+      lastTimestamp_(0),
+      firstTimestamp_(0),
+      hasPcr_(false),
+      lastPcr_(0),
+      discontinuity_(false) {}
+
+TsDemuxer::~TsDemuxer() { free(static_cast<void*>(filePath_)); }
+
+bool TsDemuxer::probe(const uint8_t* data, size_t size) {
+  size_t packets = 0;
+  while (packets < 3 && packets * kTsPacketSize < size &&
+         data[packets * kTsPacketSize] == kTsSyncByte) {
+    ++packets;
+  }
+  return packets >= 2;
+}
+
+bool TsDemuxer::open() {
+  if (mappedFile_->isOpen()) {
+    return reset() == 0;
+  }
+  if (!mappedFile_->open(MappedFile::kAdviceSequential)) {
+    printf("Open test file %s failed\n", filePath_);
+    return false;
+  }
+  // The tracks and their formats come from the start of the file.
+  while (!isConfigured() && position_ < kMaxProbeBytes && readPacket()) {
+  }
+  if (tracks_.empty()) {
+    printf("No H.264, H.265 or AAC streams in %s\n", filePath_);
+    mappedFile_->close();
+    return false;
+  }
+  resetState();
+  return true;
+}
+
+bool TsDemuxer::isConfigured() const {
+  if (!hasPmt_) {
+    return false;
+  }
+  for (const ContainerTrack& track : tracks_) {
+    if (track.type == ContainerTrack::kAudio && track.sampleRateHz == 0) {
+      return false;
+    }
+  }
+  return true;
+}
+
+bool TsDemuxer::readPacket() {
+  const uint8_t* data = mappedFile_->data();
+  const size_t size = mappedFile_->size();
+  if (syncedPackets_ == 0) {
+    // Validate the whole run of packets ahead at once. After a sync loss,
+    // resync at a sync byte that another packet follows.
+    while (size - position_ >= kTsPacketSize) {
+      size_t packets = (size - position_) / kTsPacketSize;
+      syncedPackets_ = CountTsSyncedPackets(data + position_, packets);
+      if (syncedPackets_ >= 2 || syncedPackets_ == packets) {
+        break;
+      }
+      syncedPackets_ = 0;
+      const void* next = memchr(data + position_ + 1, kTsSyncByte, size - position_ - 1);
+      position_ = next ? static_cast<const uint8_t*>(next) - data : size;
+    }
+    if (syncedPackets_ == 0) {
+      return false;
+    }
+  }
+  const uint8_t* p = data + position_;
+  position_ += kTsPacketSize;
+  --syncedPackets_;
+
+  // transport_error_indicator
+  if (p[1] & 0x80) {
+    return true;
+  }
+  bool payloadStart = (p[1] & 0x40) != 0;
+  uint16_t pid = static_cast<uint16_t>((p[1] & 0x1F) << 8 | p[2]);
+  int adaptationControl = (p[3] >> 4) & 0x03;
+  int continuity = p[3] & 0x0F;
+  size_t offset = 4;
+  bool randomAccess = false;
+  if (adaptationControl & 0x02) {
+    size_t length = p[4];
+    if (length > kTsPacketSize - 5) {
+      return true;
+    }
+    if (length > 0) {
+      randomAccess = (p[5] & 0x40) != 0;
+      if (pid == pcrPid_) {
+        parsePcr(p + 5, length);
+      }
+    }
+    offset = 5 + length;
+  }
+  if (!(adaptationControl & 0x01) || offset >= kTsPacketSize) {
+    return true;
+  }
+  const uint8_t* payload = p + offset;
+  size_t payloadSize = kTsPacketSize - offset;
+
+  if (pid == kPatPid) {
+    if (payloadStart) {
+      parsePat(payload, payloadSize);
+    }
+    return true;
+  }
+  if (pid == pmtPid_) {
+    if (payloadStart && !hasPmt_) {
+      parsePmt(payload, payloadSize);
+    }
+    return true;
+  }
+  Stream* stream = findStream(pid);
+  if (!stream) {
+    return true;
+  }
+  if (stream->continuity >= 0 && continuity != ((stream->continuity + 1) & 0x0F)) {
+    if (continuity == stream->continuity) {
+      // Duplicate packet.
+      return true;
+    }
+    // Lost packets, the PES being reassembled is broken.
+    stream->pes.clear();
+  }
+  stream->continuity = continuity;
+  if (payloadStart) {
+    finishPes(stream);
+    stream->randomAccess = randomAccess;
+    stream->pes.assign(payload, payload + payloadSize);
+  } else if (!stream->pes.empty()) {
+    stream->pes.insert(stream->pes.end(), payload, payload + payloadSize);
+  }
+  return true;
+}
+
+void TsDemuxer::parsePat(const uint8_t* data, size_t size) {
+  const uint8_t* section = nullptr;
+  size_t sectionSize = 0;
+  if (!GetSection(data, size, kTableIdPat, &section, &sectionSize)) {
+    return;
+  }
+  // The first program, program number 0 points to the network PID.
+  for (size_t i = 8; i + 4 <= sectionSize; i += 4) {
+    uint16_t program = static_cast<uint16_t>(section[i] << 8 | section[i + 1]);
+    if (program != 0) {
+      pmtPid_ = (section[i + 2] & 0x1F) << 8 | section[i + 3];
+      return;
+    }
+  }
+}
+
+void TsDemuxer::parsePmt(const uint8_t* data, size_t size) {
+  const uint8_t* section = nullptr;
+  size_t sectionSize = 0;
+  if (!GetSection(data, size, kTableIdPmt, &section, &sectionSize) || sectionSize < 12) {
+    return;
+  }
+  pcrPid_ = (section[8] & 0x1F) << 8 | section[9];
+  size_t programInfoLength = (section[10] & 0x0F) << 8 | section[11];
+  for (size_t i = 12 + programInfoLength; i + 5 <= sectionSize;) {
+    uint8_t streamType = section[i];
+    uint16_t pid = static_cast<uint16_t>((section[i + 1] & 0x1F) << 8 | section[i + 2]);
+    size_t infoLength = (section[i + 3] & 0x0F) << 8 | section[i + 4];
+    i += 5 + infoLength;
+
+    ContainerTrack track;
+    memset(&track, 0, sizeof(track));
+    if (streamType == kStreamTypeH264 || streamType == kStreamTypeH265) {
+      track.type = ContainerTrack::kVideo;
+      track.videoCodec = streamType == kStreamTypeH264 ? agora::rtc::VIDEO_CODEC_H264
+                                                       : agora::rtc::VIDEO_CODEC_H265;
+    } else if (streamType == kStreamTypeAacAdts) {
+      track.type = ContainerTrack::kAudio;
+      // ADTS can't signal SBR, HE-AAC in TS plays as its AAC core.
+      track.audioCodec = agora::rtc::AUDIO_CODEC_AACLC;
+    } else {
+      continue;
+    }
+    Stream stream;
+    stream.pid = pid;
+    stream.streamType = streamType;
+    stream.track = static_cast<int>(tracks_.size());
+    stream.randomAccess = false;
+    stream.continuity = -1;
+    tracks_.push_back(track);
+    streams_.push_back(std::move(stream));
+  }
+  hasPmt_ = true;
+}
+
+void TsDemuxer::parsePcr(const uint8_t* adaptation, size_t size) {
+  const uint8_t kDiscontinuityIndicator = 0x80;
+  const uint8_t kPcrFlag = 0x10;
+  if (adaptation[0] & kDiscontinuityIndicator) {
+    discontinuity_ = true;
+  }
+  if (!(adaptation[0] & kPcrFlag) || size < 7) {
+    return;
+  }
+  // The 90 kHz base, the 27 MHz extension isn't needed for pacing.
+  uint64_t pcr = static_cast<uint64_t>(adaptation[1]) << 25 |
+                 static_cast<uint64_t>(adaptation[2]) << 17 |
+                 static_cast<uint64_t>(adaptation[3]) << 9 |
+                 static_cast<uint64_t>(adaptation[4]) << 1 | adaptation[5] >> 7;
+  if (hasPcr_) {
+    int64_t delta = TimestampDelta(pcr, lastPcr_);
+    if (delta < 0 || delta > kMaxTimestampJump) {
+      discontinuity_ = true;
+    }
+  }
+  lastPcr_ = pcr;
+  hasPcr_ = true;
+}
+
+int64_t TsDemuxer::unwrapTimestamp(uint64_t timestamp) {
+  if (!hasTimestamp_) {
+    hasTimestamp_ = true;
+    discontinuity_ = false;
+    lastRawTimestamp_ = timestamp;
+    lastTimestamp_ = static_cast<int64_t>(timestamp);
+    firstTimestamp_ = lastTimestamp_;
+    return lastTimestamp_;
+  }
+  int64_t delta = TimestampDelta(timestamp, lastRawTimestamp_);
+  if (discontinuity_ || delta > kMaxTimestampJump || delta < -kMaxTimestampJump) {
+    // The source restarted its clock, carry on from where the timeline is.
+    delta = 0;
+    discontinuity_ = false;
+  }
+  lastRawTimestamp_ = timestamp;
+  lastTimestamp_ += delta;
+  return lastTimestamp_;
+}
+
+void TsDemuxer::finishPes(Stream* stream) {
+  std::vector<uint8_t>& pes = stream->pes;
+  // packet_start_code_prefix, stream_id, PES_packet_length and the optional
+  // header up to PES_header_data_length.
+  const size_t kPesHeaderSize = 9;
+  if (pes.size() < kPesHeaderSize || pes[0] != 0 || pes[1] != 0 || pes[2] != 1) {
+    pes.clear();
+    return;
+  }
+  uint8_t ptsDtsFlags = pes[7] >> 6;
+  size_t headerSize = kPesHeaderSize + pes[8];
+  // Samples without a PTS can't be paced.
+  if (headerSize > pes.size() || !(ptsDtsFlags & 0x02) ||
+      (ptsDtsFlags == 0x03 && pes[8] < 10) || pes[8] < 5) {
+    pes.clear();
+    return;
+  }
+  uint64_t pts = ReadPesTimestamp(&pes[9]);
+  uint64_t dts = ptsDtsFlags == 0x03 ? ReadPesTimestamp(&pes[14]) : pts;
+  size_t pesSize = pes.size();
+  size_t packetLength = pes[4] << 8 | pes[5];
+  // Zero for video PES packets of unbounded length.
+  if (packetLength != 0 && 6 + packetLength < pesSize) {
+    pesSize = 6 + packetLength;
+  }
+  if (pesSize <= headerSize) {
+    pes.clear();
+    return;
+  }
+  int64_t timestamp = unwrapTimestamp(dts);
+  const ContainerTrack& track = tracks_[stream->track];
+
+  if (track.type == ContainerTrack::kVideo) {
+    Sample sample;
+    sample.dts = timestamp;
+    sample.pts = timestamp + TimestampDelta(pts, dts);
+    // The PES becomes the sample, only the header in front is moved away.
+    pes.resize(pesSize);
+    pes.erase(pes.begin(), pes.begin() + headerSize);
+    sample.keyFrame =
+        stream->randomAccess || ContainsKeyFrame(track.videoCodec, pes.data(), pes.size());
+    sample.data.swap(pes);
+    stream->ready.push_back(std::move(sample));
+    return;
+  }
+
+  // A PES of AAC carries several ADTS frames, timed from the PTS on.
+  const uint8_t* p = pes.data() + headerSize;
+  const uint8_t* end = pes.data() + pesSize;
+  int frames = 0;
+  AacAudioConfig config;
+  while (p < end) {
+    size_t frameLength = ParseAdtsHeader(p, end - p, &config);
+    if (frameLength == 0) {
+      break;
+    }
+    if (track.sampleRateHz == 0) {
+      tracks_[stream->track].sampleRateHz = config.sampleRateHz;
+      tracks_[stream->track].numberOfChannels = config.channelConfig;
+    }
+    Sample sample;
+    sample.dts = timestamp + static_cast<int64_t>(frames) * kAacSamplesPerFrame * kTimestampRate /
+                                 config.sampleRateHz;
+    sample.pts = sample.dts;
+    sample.keyFrame = true;
+    sample.data.assign(p, p + frameLength);
+    stream->ready.push_back(std::move(sample));
+    p += frameLength;
+    ++frames;
+  }
+  pes.clear();
+}
+
+TsDemuxer::Stream* TsDemuxer::findStream(uint16_t pid) {
+  for (Stream& stream : streams_) {
+    if (stream.pid == pid) {
+      return &stream;
+    }
+  }
+  return nullptr;
+}
+
+bool TsDemuxer::getNext(ContainerSample* sample) {
+  bool more = true;
+  while (true) {
+    // Samples go out in decode order across streams, once every stream has
+    // one waiting or the file is done.
+    Stream* next = nullptr;
+    bool waiting = false;
+    size_t queued = 0;
+    for (Stream& stream : streams_) {
+      if (stream.ready.empty()) {
+        waiting = true;
+        continue;
+      }
+      if (stream.ready.size() > queued) {
+        queued = stream.ready.size();
+      }
+      if (!next || stream.ready.front().dts < next->ready.front().dts) {
+        next = &stream;
+      }
+    }
+    if (next && (!more || !waiting || queued >= kMaxQueuedSamples)) {
+      current_ = std::move(next->ready.front());
+      next->ready.pop_front();
+      sample->track = next->track;
+      sample->data = current_.data.data();
+      sample->length = static_cast<int>(current_.data.size());
+      sample->dtsUs = (current_.dts - firstTimestamp_) * 1000000 / kTimestampRate;
+      sample->ptsUs = (current_.pts - firstTimestamp_) * 1000000 / kTimestampRate;
+      sample->keyFrame = current_.keyFrame;
+      return true;
+    }
+    if (!more) {
+      return false;
+    }
+    more = readPacket();
+    if (!more) {
+      for (Stream& stream : streams_) {
+        finishPes(&stream);
+      }
+    }
+  }
+}
+
+void TsDemuxer::resetState() {
+  position_ = 0;
+  syncedPackets_ = 0;
+  for (Stream& stream : streams_) {
+    stream.pes.clear();
+    stream.ready.clear();
+    stream.randomAccess = false;
+    stream.continuity = -1;
+  }
+  hasTimestamp_ = false;
+  hasPcr_ = false;
+  discontinuity_ = false;
+}
+
+int TsDemuxer::reset() {
+  if (!mappedFile_->isOpen()) {
+    return -1;
+  }
+  resetState();
+  return 0;
+}
@@ -0,0 +1,93 @@
+//  Agora RTC/MEDIA SDK
+//
+//  Copyright (c) 2020 Agora.io. All rights reserved.
+//
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include "aac_file_parser.h"
+#include "container_demuxer.h"
+
+class MappedFile;
+
+// Demuxes MPEG-TS (ISO 13818-1) files of 188 byte packets from the memory
+// mapped file. The first program of the PAT is played, with its H.264, H.265
+// and ADTS AAC streams. Samples keep their PES timestamps, unwrapped and made
+// continuous across discontinuities, so replaying them reproduces the timing
+// of the capture including its jitter.
+class TsDemuxer : public ContainerDemuxer {
+ public:
+  explicit TsDemuxer(const char* filepath);
+  ~TsDemuxer();
+
+  bool open() override;
+  bool getNext(ContainerSample* sample) override;
+  int reset() override;
+
+  // True if |data| starts with a few packets in a row.
+  static bool probe(const uint8_t* data, size_t size);
+
+ private:
+  struct Sample {
+    std::vector<uint8_t> data;
+    // 90 kHz, unwrapped.
+    int64_t dts;
+    int64_t pts;
+    bool keyFrame;
+  };
+
+  struct Stream {
+    uint16_t pid;
+    uint8_t streamType;
+    // Index into |tracks_|.
+    int track;
+    // The PES packet being reassembled.
+    std::vector<uint8_t> pes;
+    bool randomAccess;
+    // continuity_counter of the last packet, -1 before the first.
+    int continuity;
+    // Complete samples not handed out yet, in decode order.
+    std::deque<Sample> ready;
+  };
+
+  // Returns false at the end of the file.
+  bool readPacket();
+  void parsePat(const uint8_t* data, size_t size);
+  void parsePmt(const uint8_t* data, size_t size);
+  void parsePcr(const uint8_t* adaptation, size_t size);
+  void finishPes(Stream* stream);
+  int64_t unwrapTimestamp(uint64_t timestamp);
+  bool isConfigured() const;
+  Stream* findStream(uint16_t pid);
+  void resetState();
+
+ private:
+  char* filePath_;
+  std::unique_ptr<MappedFile> mappedFile_;
+  size_t position_;
+  // Packets from |position_| on known to start with the sync byte.
+  size_t syncedPackets_;
+  int pmtPid_;
+  int pcrPid_;
+  bool hasPmt_;
+  std::vector<Stream> streams_;
+
+  bool hasTimestamp_;
+  // The last timestamp as read, and where it landed on the continuous
+  // timeline.
+  uint64_t lastRawTimestamp_;
+  int64_t lastTimestamp_;
+  int64_t firstTimestamp_;
+  bool hasPcr_;
+  uint64_t lastPcr_;
+  // Set when the PCR jumps, the next timestamp then continues the timeline.
+  bool discontinuity_;
+
+  Sample current_;
+};
@@ -7,109 +7,360 @@
 #include "wav_pcm_file_parser.h"
 #include <stdlib.h>
 #include <string.h>
+#include <algorithm>
+#include <limits>
+
+#include "utils/live_stream_reader.h"
+#include "utils/mapped_file.h"
+
+namespace {
+
+const uint16_t kWaveFormatPcm = 0x0001;
+const uint16_t kWaveFormatIeeeFloat = 0x0003;
+const uint16_t kWaveFormatExtensible = 0xFFFE;
+
+// Size of the WAVEFORMAT fields every "fmt " chunk has, and of the whole
+// WAVEFORMATEXTENSIBLE structure.
+const uint32_t kFormatChunkMinSize = 16;
+const uint32_t kExtensibleFormatSize = 40;
+
+// Frames converted at once, in 10 ms frames.
+const int kFramesPerBlock = 50;
+
+}  // namespace
 
 WavPcmFileParser::WavPcmFileParser(const char* filepath)
     : wavFilePath_(strdup(filepath)),
-      wavFile_(nullptr),
-      readedLength_(0),
-      bufDataLength_(0),
-      isEof_(false) {}
+      mappedFile_(new MappedFile(filepath)),
+      sourceFormat_(PcmSampleFormat::kInt16),
+      sourceChannels_(0),
+      channelMask_(0),
+      sampleRateHz_(0),
+      sourceFrameSize_(0),
+      dataOffset_(0),
+      dataFrames_(0),
+      convertedFrames_(0),
+      frameSamples_(0),
+      bufferedSamples_(0),
+      bufferPos_(0) {}
+
+WavPcmFileParser::~WavPcmFileParser() { free(static_cast<void*>(wavFilePath_)); }
+
+bool WavPcmFileParser::setLiveInput(bool follow) {
+  live_.reset(new LiveStreamReader(wavFilePath_, follow));
+  return true;
+}
 
-WavPcmFileParser::~WavPcmFileParser() {
-  if (wavFile_) {
-    fclose(wavFile_);
+void WavPcmFileParser::cancel() {
+  if (live_) {
+    live_->cancel();
   }
-  free(static_cast<void*>(wavFilePath_));
 }
 
 bool WavPcmFileParser::open() {
-  wavFile_ = fopen(wavFilePath_, "rb");
-  if (wavFile_ == nullptr) {
-    printf("Open test file %s failed\n", wavFilePath_);
+  if (live_) {
+    // Waits for the writer to send the header.
+    if (!live_->open() || !parseLiveChunks()) {
+      live_->close();
+      sourceChannels_ = 0;
+      sampleRateHz_ = 0;
+      return false;
+    }
+  } else {
+    if (mappedFile_->isOpen()) {
+      return reset() == 0;
+    }
+    if (!mappedFile_->open(MappedFile::kAdviceSequential)) {
+      printf("Open test file %s failed\n", wavFilePath_);
+      return false;
+    }
+    if (!parseChunks()) {
+      mappedFile_->close();
+      sourceChannels_ = 0;
+      sampleRateHz_ = 0;
+      return false;
+    }
+  }
+  downmixer_.reset(new PcmDownmixer(sourceChannels_, channelMask_,
+                                    sourceChannels_ > 2 ? 2 : sourceChannels_));
+  frameSamples_ = static_cast<size_t>(sampleRateHz_ / 100) * downmixer_->outputChannels();
+  pcmBuffer_.resize(static_cast<size_t>(sampleRateHz_ / 100) * kFramesPerBlock * sourceChannels_);
+  if (live_) {
+    convertedFrames_ = 0;
+    bufferedSamples_ = 0;
+    bufferPos_ = 0;
+    resetSampleClock();
+    return true;
+  }
+  return reset() == 0;
+}
+
+bool WavPcmFileParser::parseChunks() {
+  const uint8_t* data = mappedFile_->data();
+  const size_t size = mappedFile_->size();
+  if (size < 12 || memcmp(data, "RIFF", 4) != 0 || memcmp(data + 8, "WAVE", 4) != 0) {
+    printf("Unsupported test file format %s\n", wavFilePath_);
     return false;
   }
-  unsigned char buffer[44] = {0};
-  size_t readsize = fread(buffer, 1, sizeof(buffer), wavFile_);
-  if (readsize < sizeof(buffer)) {
-    printf("Read test file %s failed\n", wavFilePath_);
+
+  bool hasFormat = false;
+  size_t pos = 12;
+  while (pos + 8 <= size) {
+    const uint8_t* chunk = data + pos;
+    uint32_t chunkSize = get_le32(chunk + 4);
+    pos += 8;
+    if (memcmp(chunk, "fmt ", 4) == 0) {
+      if (chunkSize > size - pos || !parseFormat(data + pos, chunkSize)) {
+        printf("Unsupported WAV audio format in %s\n", wavFilePath_);
+        return false;
+      }
+      hasFormat = true;
+    } else if (memcmp(chunk, "data", 4) == 0) {
+      if (!hasFormat) {
+        printf("Invalid WAV audio file format %s, data before fmt\n", wavFilePath_);
+        return false;
+      }
+      // Writers that stream leave the size at 0 or 0xFFFFFFFF, and truncated
+      // files claim more than they have. Both play to the end of the file.
+      size_t dataSize = size - pos;
+      if (chunkSize != 0 && chunkSize != 0xFFFFFFFF && chunkSize < dataSize) {
+        dataSize = chunkSize;
+      }
+      dataOffset_ = pos;
+      dataFrames_ = dataSize / sourceFrameSize_;
+      return true;
+    }
+    // LIST, fact, bext, ... are of no use here. Chunks are padded to even
+    // sizes.
+    if (chunkSize > size - pos) {
+      break;
+    }
+    pos += chunkSize + (chunkSize & 1);
+  }
+  printf("Invalid WAV audio file format %s, no %s chunk\n", wavFilePath_,
+         hasFormat ? "data" : "fmt");
+  return false;
+}
+
+bool WavPcmFileParser::parseLiveChunks() {
+  if (!live_->require(12) || memcmp(live_->data(), "RIFF", 4) != 0 ||
+      memcmp(live_->data() + 8, "WAVE", 4) != 0) {
+    printf("Unsupported test file format %s\n", wavFilePath_);
     return false;
   }
-  parseWAVHeader(buffer, wavHeader_);
+  live_->consume(12);
 
-  // For WAV file generated by ffmpeg.
-  if (strncmp(wavHeader_.dataTag, "LIST", 4) == 0) {
-    printf("LIST trunk size %d\n", wavHeader_.dataLength);
-    readsize = fread(buffer, 1, wavHeader_.dataLength, wavFile_);
-    if (readsize < wavHeader_.dataLength) {
-      printf("Invalid WAV audio file format %s\n", wavFilePath_);
-      return false;
+  bool hasFormat = false;
+  while (live_->require(8)) {
+    char id[4];
+    memcpy(id, live_->data(), sizeof(id));
+    uint32_t chunkSize = get_le32(live_->data() + 4);
+    live_->consume(8);
+    if (memcmp(id, "fmt ", 4) == 0) {
+      if (!live_->require(chunkSize) || !parseFormat(live_->data(), chunkSize)) {
+        printf("Unsupported WAV audio format in %s\n", wavFilePath_);
+        return false;
+      }
+      hasFormat = true;
+    } else if (memcmp(id, "data", 4) == 0) {
+      if (!hasFormat) {
+        printf("Invalid WAV audio file format %s, data before fmt\n", wavFilePath_);
+        return false;
+      }
+      // Writers that stream leave the size at 0 or 0xFFFFFFFF.
+      dataOffset_ = 0;
+      dataFrames_ = chunkSize != 0 && chunkSize != 0xFFFFFFFF
+                        ? chunkSize / sourceFrameSize_
+                        : std::numeric_limits<size_t>::max();
+      return true;
+    }
+    // Skipped in pieces, nothing needs a whole LIST chunk in memory.
+    size_t skip = chunkSize + (chunkSize & 1);
+    while (skip > 0 && live_->require(1)) {
+      size_t bytes = std::min(skip, live_->available());
+      live_->consume(bytes);
+      skip -= bytes;
     }
-    readsize = fread(buffer, 1, 8, wavFile_);
-    if (readsize < 8) {
-      printf("Invalid WAV audio file format %s\n", wavFilePath_);
+  }
+  printf("Invalid WAV audio file format %s, no %s chunk\n", wavFilePath_,
+         hasFormat ? "data" : "fmt");
+  return false;
+}
+
+bool WavPcmFileParser::parseFormat(const uint8_t* chunk, uint32_t chunkSize) {
+  if (chunkSize < kFormatChunkMinSize) {
+    return false;
+  }
+  uint16_t formatTag = get_le16(chunk);
+  int channels = get_le16(chunk + 2);
+  uint32_t sampleRateHz = get_le32(chunk + 4);
+  uint16_t blockAlign = get_le16(chunk + 12);
+  uint16_t bitsPerSample = get_le16(chunk + 14);
+  uint32_t channelMask = 0;
+  if (formatTag == kWaveFormatExtensible) {
+    if (chunkSize < kExtensibleFormatSize) {
       return false;
     }
-    strncpy(reinterpret_cast<char*>(wavHeader_.dataTag), reinterpret_cast<const char*>(buffer), 4);
-    wavHeader_.dataLength = get_le32(buffer + 4);
+    channelMask = get_le32(chunk + 20);
+    // The GUID of the sub format starts with the plain format tag.
+    formatTag = get_le16(chunk + 24);
   }
-  if (strncmp(wavHeader_.tag, "RIFF", 4) != 0 || strncmp(wavHeader_.typeTag, "WAVE", 4) != 0 ||
-      strncmp(wavHeader_.fmtTag, "fmt ", 4) != 0 || strncmp(wavHeader_.dataTag, "data", 4) != 0) {
-    printf("Unsupported test file format %s\n", wavFilePath_);
-    wavHeader_.numberOfChannels = 0;
-    wavHeader_.sampleRateHz = 0;
+
+  PcmSampleFormat format;
+  if (formatTag == kWaveFormatPcm && bitsPerSample == 8) {
+    format = PcmSampleFormat::kUInt8;
+  } else if (formatTag == kWaveFormatPcm && bitsPerSample == 16) {
+    format = PcmSampleFormat::kInt16;
+  } else if (formatTag == kWaveFormatPcm && bitsPerSample == 24) {
+    format = PcmSampleFormat::kInt24;
+  } else if (formatTag == kWaveFormatPcm && bitsPerSample == 32) {
+    format = PcmSampleFormat::kInt32;
+  } else if (formatTag == kWaveFormatIeeeFloat && bitsPerSample == 32) {
+    format = PcmSampleFormat::kFloat32;
+  } else {
+    printf("WAV format %d with %d bits per sample isn't supported\n", formatTag, bitsPerSample);
     return false;
   }
+  // Frames are handed out 10 ms at a time, which needs at least 100 Hz.
+  if (channels == 0 || sampleRateHz < 100 || sampleRateHz > 192000 ||
+      blockAlign != channels * PcmSampleBytes(format)) {
+    printf("WAV with %d channels at %u Hz, %d bytes per frame isn't supported\n", channels,
+           sampleRateHz, blockAlign);
+    return false;
+  }
+  sourceFormat_ = format;
+  sourceChannels_ = channels;
+  channelMask_ = channelMask;
+  sampleRateHz_ = static_cast<int>(sampleRateHz);
+  sourceFrameSize_ = blockAlign;
   return true;
 }
 
 bool WavPcmFileParser::hasNext() {
-  if (wavHeader_.numberOfChannels == 0 || wavHeader_.sampleRateHz == 0) {
+  if (!live_ && !mappedFile_->isOpen()) {
     return false;
   }
-  readData();
-  if (isEof_ || readedLength_ >= wavHeader_.dataLength) {
+  return bufferPos_ < bufferedSamples_ || convertBlock();
+}
+
+size_t WavPcmFileParser::bufferLiveFrames(size_t maxFrames) {
+  size_t tenMsFrames = static_cast<size_t>(sampleRateHz_ / 100);
+  live_->require(std::min(maxFrames, tenMsFrames) * sourceFrameSize_);
+  size_t frames = std::min(maxFrames, live_->available() / sourceFrameSize_);
+  if (!live_->ended() && frames > tenMsFrames) {
+    frames -= frames % tenMsFrames;
+  }
+  return frames;
+}
+
+bool WavPcmFileParser::convertBlock() {
+  if (!downmixer_ || convertedFrames_ >= dataFrames_) {
     return false;
   }
+  size_t frames = pcmBuffer_.size() / sourceChannels_;
+  if (frames > dataFrames_ - convertedFrames_) {
+    frames = dataFrames_ - convertedFrames_;
+  }
+  const uint8_t* src = nullptr;
+  if (live_) {
+    // Converts what arrived, not a whole block, so nothing waits for more.
+    frames = bufferLiveFrames(frames);
+    if (frames == 0) {
+      return false;
+    }
+    src = live_->data();
+  } else {
+    src = mappedFile_->data() + dataOffset_ + convertedFrames_ * sourceFrameSize_;
+  }
+  ConvertPcmToInt16(src, sourceFormat_, frames * sourceChannels_, pcmBuffer_.data());
+  downmixer_->process(pcmBuffer_.data(), frames, pcmBuffer_.data());
+  convertedFrames_ += frames;
+
+  bufferedSamples_ = frames * downmixer_->outputChannels();
+  bufferPos_ = 0;
+  // Pad the last frame up to 10 ms.
+  size_t partial = bufferedSamples_ % frameSamples_;
+  if (partial != 0) {
+    size_t padding = frameSamples_ - partial;
+    memset(pcmBuffer_.data() + bufferedSamples_, 0, padding * sizeof(int16_t));
+    bufferedSamples_ += padding;
+  }
+  if (live_) {
+    live_->consume(frames * sourceFrameSize_);
+    return true;
+  }
+  // Pages of the next block are read ahead while this one plays.
+  size_t nextOffset = dataOffset_ + convertedFrames_ * sourceFrameSize_;
+  mappedFile_->willNeed(nextOffset, pcmBuffer_.size() / sourceChannels_ * sourceFrameSize_);
   return true;
 }
 
 int WavPcmFileParser::reset() {
-  fseek(wavFile_, 0, SEEK_SET);
-  readedLength_ = 0;
-  isEof_ = false;
+  if (live_ || !mappedFile_->isOpen()) {
+    return -1;
+  }
+  convertedFrames_ = 0;
+  bufferedSamples_ = 0;
+  bufferPos_ = 0;
+  resetSampleClock();
   return 0;
 }
 
-int WavPcmFileParser::getNumberOfChannels() { return wavHeader_.numberOfChannels; }
-int WavPcmFileParser::getSampleRate() { return wavHeader_.sampleRateHz; }
+int WavPcmFileParser::getNumberOfChannels() {
+  return downmixer_ ? downmixer_->outputChannels() : sourceChannels_;
+}
 
-int WavPcmFileParser::getBitsPerSample() { return wavHeader_.bitsPerSample; }
+int WavPcmFileParser::getSampleRate() { return sampleRateHz_; }
 
-void WavPcmFileParser::getNext(char* buffer, int* length) {
-  memcpy(buffer, dataBuffer_, bufDataLength_);
-  *length = bufDataLength_;
-  bufDataLength_ = 0;
-}
+int WavPcmFileParser::getBitsPerSample() { return 16; }
 
-agora::rtc::AUDIO_CODEC_TYPE WavPcmFileParser::getCodecType() {
-  return agora::rtc::AUDIO_CODEC_PCMU;
+bool WavPcmFileParser::getNext(const uint8_t** data, int* length) {
+  if (!hasNext()) {
+    *length = 0;
+    return false;
+  }
+  *data = reinterpret_cast<const uint8_t*>(pcmBuffer_.data() + bufferPos_);
+  *length = static_cast<int>(frameSamples_ * sizeof(int16_t));
+  bufferPos_ += frameSamples_;
+  return true;
 }
 
-int WavPcmFileParser::getSampleRateHz() { return getSampleRate(); }
+bool WavPcmFileParser::next(AudioFrameView* frame) {
+  const uint8_t* data = nullptr;
+  int length = 0;
+  if (!getNext(&data, &length)) {
+    return false;
+  }
+  frame->data = data;
+  frame->size = length;
+  frame->durationSamples = getFrameSamples();
+  frame->flags = 0;
+  stampBySamples(frame);
+  return true;
+}
 
-void WavPcmFileParser::readData() {
-  if (isEof_ || readedLength_ >= wavHeader_.dataLength) {
+void WavPcmFileParser::getNext(char* buffer, int* length) {
+  const uint8_t* data = nullptr;
+  int size = 0;
+  if (!getNext(&data, &size)) {
+    *length = 0;
     return;
   }
-  int length =
-      wavHeader_.sampleRateHz / 100 * wavHeader_.numberOfChannels * wavHeader_.bitsPerSample / 8;
-  if (bufDataLength_ > 0) {
+  if (size > *length) {
+    printf("10 ms of PCM take %d bytes, more than the buffer of %d bytes\n", size, *length);
+    *length = 0;
     return;
   }
-  size_t readsize = fread(dataBuffer_, 1, length, wavFile_);
-  if (readsize < length) {
-    isEof_ = true;
-  }
-  readedLength_ += readsize;
-  bufDataLength_ = readsize;
+  memcpy(buffer, data, size);
+  *length = size;
 }
+
+int WavPcmFileParser::getFrameSamples() { return sampleRateHz_ / 100; }
+
+// AUDIO_CODEC_TYPE has no linear PCM. The samples only go to the SDK's PCM
+// sender, which encodes them itself, so this never labels a sent frame.
+agora::rtc::AUDIO_CODEC_TYPE WavPcmFileParser::getCodecType() {
+  return agora::rtc::AUDIO_CODEC_PCMU;
+}
+
+int WavPcmFileParser::getSampleRateHz() { return getSampleRate(); }
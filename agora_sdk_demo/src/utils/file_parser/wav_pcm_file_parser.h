@@ -7,13 +7,28 @@
 
 #include <stdint.h>
 #include <stdio.h>
+#include <memory>
+#include <vector>
 
 #include "audio_file_parser_factory.h"
+#include "utils/pcm_convert.h"
 #include "utils/wav_header.h"
 
+class LiveStreamReader;
+class MappedFile;
+
 void makeWAVHeader(unsigned char _dst[44], const WavHeader& header);
 void parseWAVHeader(const unsigned char _dst[44], WavHeader& header);
 
+// Plays 8, 16, 24 and 32 bit integer or 32 bit float WAV files, plain or
+// WAVE_FORMAT_EXTENSIBLE, with their chunks in any order. Samples are
+// converted to 16 bit and mixed down to stereo at most, a few hundred
+// milliseconds at a time straight from the memory mapped file, and handed
+// out as 10 ms frames. The last frame is padded with silence.
+//
+// Read live, the header is taken from the stream and samples are converted
+// as soon as 10 ms of them arrived. A "data" chunk without a size plays until
+// the writer stops.
 class WavPcmFileParser : public AudioFileParser {
  public:
   explicit WavPcmFileParser(const char* filepath);
@@ -29,18 +44,48 @@ class WavPcmFileParser : public AudioFileParser {
   void getNext(char* buffer, int* length) override;
   agora::rtc::AUDIO_CODEC_TYPE getCodecType() override;
   int getSampleRateHz() override;
+  int getFrameSamples() override;
+  bool next(AudioFrameView* frame) override;
+  bool setLiveInput(bool follow) override;
+  void cancel() override;
 
- private:
-  void readData();
+  // Points |data| at the next 10 ms of 16 bit samples, valid until the next
+  // call.
+  bool getNext(const uint8_t** data, int* length);
+
+  // Channels and sample format stored in the file, before conversion.
+  int getSourceChannels() const { return sourceChannels_; }
+  PcmSampleFormat getSourceFormat() const { return sourceFormat_; }
 
  private:
-  static constexpr int BufferSize = 4096;
+  bool parseChunks();
+  bool parseLiveChunks();
+  bool parseFormat(const uint8_t* chunk, uint32_t chunkSize);
+  bool convertBlock();
+  // Waits for 10 ms of samples and returns how many of the next |maxFrames|
+  // are buffered, in whole 10 ms frames unless the stream ended.
+  size_t bufferLiveFrames(size_t maxFrames);
 
+ private:
   char* wavFilePath_;
-  FILE* wavFile_;
-  unsigned char dataBuffer_[BufferSize] = {0};
-  WavHeader wavHeader_;
-  int32_t readedLength_;
-  int32_t bufDataLength_;
-  bool isEof_;
+  std::unique_ptr<MappedFile> mappedFile_;
+  std::unique_ptr<LiveStreamReader> live_;
+  std::unique_ptr<PcmDownmixer> downmixer_;
+
+  PcmSampleFormat sourceFormat_;
+  int sourceChannels_;
+  uint32_t channelMask_;
+  int sampleRateHz_;
+  size_t sourceFrameSize_;
+
+  // The "data" chunk, in whole frames.
+  size_t dataOffset_;
+  size_t dataFrames_;
+  size_t convertedFrames_;
+
+  // Converted samples of the current block.
+  std::vector<int16_t> pcmBuffer_;
+  size_t frameSamples_;
+  size_t bufferedSamples_;
+  size_t bufferPos_;
 };
@@ -0,0 +1,233 @@
+//  Agora RTC/MEDIA SDK
+//
+//  Copyright (c) 2020 Agora.io. All rights reserved.
+//
+
+#include "g711.h"
+
+#if defined(AGORA_DEMO_ARCH_X86)
+#include <immintrin.h>
+#endif
+
+namespace {
+
+typedef void (*EncodeFunc)(const int16_t* src, size_t samples, uint8_t* dst);
+
+// Sign bit and the bits every code is flipped by (G.711 tables 1a and 2a).
+const uint8_t kMuLawPositive = 0xFF;
+const uint8_t kALawPositive = 0xD5;
+const uint8_t kSignBit = 0x80;
+const int kMuLawBias = 33;
+const int kMuLawMax = 0x1FFF;
+
+// Negative samples are taken in one's complement, as the ITU-T software
+// tools library does.
+int Magnitude(int16_t sample) { return sample < 0 ? ~sample : sample; }
+
+// Segment and the 4 bit step inside it, e.g. 0x25 for segment 2, step 5.
+uint8_t MuLawCode(int16_t sample) {
+  int value = (Magnitude(sample) >> 2) + kMuLawBias;
+  if (value > kMuLawMax) {
+    value = kMuLawMax;
+  }
+  int segment = 0;
+  while (segment < 7 && value > (0x40 << segment) - 1) {
+    ++segment;
+  }
+  int code = segment << 4 | ((value >> (segment + 1)) & 0x0F);
+  return static_cast<uint8_t>(code ^ (sample < 0 ? kMuLawPositive ^ kSignBit : kMuLawPositive));
+}
+
+uint8_t ALawCode(int16_t sample) {
+  int value = Magnitude(sample) >> 4;
+  int segment = 0;
+  while (segment < 7 && value > (0x10 << segment) - 1) {
+    ++segment;
+  }
+  int code = segment << 4 | ((value >> (segment > 0 ? segment - 1 : 0)) & 0x0F);
+  return static_cast<uint8_t>(code ^ (sample < 0 ? kALawPositive ^ kSignBit : kALawPositive));
+}
+
+int16_t MuLawSample(uint8_t code) {
+  int inverted = ~code & 0xFF;
+  int segment = (inverted >> 4) & 0x07;
+  int value = (((inverted & 0x0F) << 3) + (kMuLawBias << 2)) << segment;
+  value -= kMuLawBias << 2;
+  return static_cast<int16_t>(code & kSignBit ? value : -value);
+}
+
+int16_t ALawSample(uint8_t code) {
+  int flipped = code ^ (kALawPositive & ~kSignBit);
+  int segment = (flipped >> 4) & 0x07;
+  int value = ((flipped & 0x0F) << 4) + 8;
+  if (segment > 0) {
+    value = (value + 0x100) << (segment - 1);
+  }
+  return static_cast<int16_t>(code & kSignBit ? value : -value);
+}
+
+// The codes only depend on the 14 (mu-law) or 12 (A-law) most significant
+// bits, which index the encoder tables.
+struct G711Tables {
+  G711Tables() {
+    for (int i = 0; i < 1 << 14; ++i) {
+      muLawEncode[i] = MuLawCode(static_cast<int16_t>(i << 2));
+    }
+    for (int i = 0; i < 1 << 12; ++i) {
+      aLawEncode[i] = ALawCode(static_cast<int16_t>(i << 4));
+    }
+    for (int i = 0; i < 256; ++i) {
+      muLawDecode[i] = MuLawSample(static_cast<uint8_t>(i));
+      aLawDecode[i] = ALawSample(static_cast<uint8_t>(i));
+    }
+  }
+
+  uint8_t muLawEncode[1 << 14];
+  uint8_t aLawEncode[1 << 12];
+  int16_t muLawDecode[256];
+  int16_t aLawDecode[256];
+};
+
+const G711Tables& Tables() {
+  static const G711Tables tables;
+  return tables;
+}
+
+void EncodeMuLawScalar(const int16_t* src, size_t samples, uint8_t* dst) {
+  const uint8_t* table = Tables().muLawEncode;
+  for (size_t i = 0; i < samples; ++i) {
+    dst[i] = table[static_cast<uint16_t>(src[i]) >> 2];
+  }
+}
+
+void EncodeALawScalar(const int16_t* src, size_t samples, uint8_t* dst) {
+  const uint8_t* table = Tables().aLawEncode;
+  for (size_t i = 0; i < samples; ++i) {
+    dst[i] = table[static_cast<uint16_t>(src[i]) >> 4];
+  }
+}
+
+#if defined(AGORA_DEMO_ARCH_X86)
+// Both laws split the magnitude into a segment, the number of significant
+// bits above the lowest ones, and a 4 bit step inside it. The bits that count
+// fit a byte, so byte shuffles look up the segment of its high and low
+// nibble, and the power of two the magnitude is multiplied by to shift out
+// the step. The shuffles work per 128 bit lane, every table is in both.
+struct ShuffleTables {
+  __m256i highSegment;
+  __m256i lowSegment;
+  __m256i factor;
+};
+
+__attribute__((target("avx2"))) __m256i Broadcast(const int8_t table[16]) {
+  return _mm256_broadcastsi128_si256(_mm_loadu_si128(reinterpret_cast<const __m128i*>(table)));
+}
+
+__attribute__((target("avx2"))) ShuffleTables MakeShuffleTables(const int8_t factors[16]) {
+  static const int8_t kHighSegment[16] = {0, 5, 6, 6, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7, 7};
+  static const int8_t kLowSegment[16] = {0, 1, 2, 2, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 4, 4};
+  return ShuffleTables{Broadcast(kHighSegment), Broadcast(kLowSegment), Broadcast(factors)};
+}
+
+// |value| holds magnitudes below 2^13 whose bits from 6 up give the segment,
+// |mantissa| the same shifted such that the step starts at bit 16 minus the
+// segment.
+__attribute__((target("avx2"))) __m256i G711CodesAvx2(const ShuffleTables& tables,
+                                                       __m256i value, __m256i mantissa,
+                                                       __m256i sign, uint8_t positive) {
+  // The high byte of every index is zero and finds a zero in the tables.
+  const __m256i index = _mm256_srli_epi16(value, 6);
+  const __m256i segment = _mm256_max_epu8(
+      _mm256_shuffle_epi8(tables.highSegment, _mm256_srli_epi16(index, 4)),
+      _mm256_shuffle_epi8(tables.lowSegment, _mm256_and_si256(index, _mm256_set1_epi16(0x0F))));
+  const __m256i factor = _mm256_slli_epi16(_mm256_shuffle_epi8(tables.factor, segment), 8);
+  const __m256i step =
+      _mm256_and_si256(_mm256_mulhi_epu16(mantissa, factor), _mm256_set1_epi16(0x0F));
+  const __m256i code = _mm256_or_si256(_mm256_slli_epi16(segment, 4), step);
+  const __m256i flip = _mm256_xor_si256(_mm256_set1_epi16(positive),
+                                        _mm256_and_si256(sign, _mm256_set1_epi16(kSignBit)));
+  return _mm256_xor_si256(code, flip);
+}
+
+__attribute__((target("avx2"))) __m256i MuLawCodesAvx2(const ShuffleTables& tables,
+                                                        __m256i samples) {
+  const __m256i sign = _mm256_srai_epi16(samples, 15);
+  __m256i value = _mm256_srli_epi16(_mm256_xor_si256(samples, sign), 2);
+  value = _mm256_min_epi16(_mm256_add_epi16(value, _mm256_set1_epi16(kMuLawBias)),
+                           _mm256_set1_epi16(kMuLawMax));
+  return G711CodesAvx2(tables, value, value, sign, kMuLawPositive);
+}
+
+// A-law takes 12 bits, 4 of them below its segment bits where mu-law has 6.
+// Its first two segments step alike.
+__attribute__((target("avx2"))) __m256i ALawCodesAvx2(const ShuffleTables& tables,
+                                                       __m256i samples) {
+  const __m256i sign = _mm256_srai_epi16(samples, 15);
+  const __m256i value = _mm256_srli_epi16(_mm256_xor_si256(samples, sign), 4);
+  return G711CodesAvx2(tables, _mm256_slli_epi16(value, 2), _mm256_slli_epi16(value, 1), sign,
+                       kALawPositive);
+}
+
+template <__m256i (*Codes)(const ShuffleTables&, __m256i), EncodeFunc Tail>
+__attribute__((target("avx2"))) void EncodeAvx2(const ShuffleTables& tables, const int16_t* src,
+                                                size_t samples, uint8_t* dst) {
+  size_t i = 0;
+  for (; i + 32 <= samples; i += 32) {
+    __m256i a = Codes(tables, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i)));
+    __m256i b = Codes(tables, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + i + 16)));
+    // packus works per 128 bit lane, restore the sample order.
+    __m256i packed = _mm256_permute4x64_epi64(_mm256_packus_epi16(a, b), 0xD8);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), packed);
+  }
+  Tail(src + i, samples - i, dst + i);
+}
+
+// High bytes of 2^(15 - shift), where mu-law shifts by the segment plus one
+// and A-law by the segment but at least one.
+const int8_t kMuLawFactors[16] = {-128, 64, 32, 16, 8, 4, 2, 1};
+const int8_t kALawFactors[16] = {-128, -128, 64, 32, 16, 8, 4, 2};
+
+__attribute__((target("avx2"))) void EncodeMuLawAvx2(const int16_t* src, size_t samples,
+                                                     uint8_t* dst) {
+  static const ShuffleTables tables = MakeShuffleTables(kMuLawFactors);
+  EncodeAvx2<MuLawCodesAvx2, EncodeMuLawScalar>(tables, src, samples, dst);
+}
+
+__attribute__((target("avx2"))) void EncodeALawAvx2(const int16_t* src, size_t samples,
+                                                    uint8_t* dst) {
+  static const ShuffleTables tables = MakeShuffleTables(kALawFactors);
+  EncodeAvx2<ALawCodesAvx2, EncodeALawScalar>(tables, src, samples, dst);
+}
+#endif
+
+EncodeFunc SelectEncode(G711Law law, SimdLevel level) {
+  level = ClampSimdLevel(level);
+  const bool muLaw = law == G711Law::kMuLaw;
+#if defined(AGORA_DEMO_ARCH_X86)
+  // The byte shuffles need SSSE3, which comes with AVX2. Without them the
+  // tables, which stay in the L1 cache, beat computing the codes.
+  if (level == SimdLevel::kAvx2) {
+    return muLaw ? EncodeMuLawAvx2 : EncodeALawAvx2;
+  }
+#endif
+  return muLaw ? EncodeMuLawScalar : EncodeALawScalar;
+}
+
+}  // namespace
+
+void EncodeG711(const int16_t* src, G711Law law, size_t samples, uint8_t* dst) {
+  static const EncodeFunc muLaw = SelectEncode(G711Law::kMuLaw, GetSimdLevel());
+  static const EncodeFunc aLaw = SelectEncode(G711Law::kALaw, GetSimdLevel());
+  (law == G711Law::kMuLaw ? muLaw : aLaw)(src, samples, dst);
+}
+
+void EncodeG711(const int16_t* src, G711Law law, size_t samples, uint8_t* dst, SimdLevel level) {
+  SelectEncode(law, level)(src, samples, dst);
+}
+
+void DecodeG711(const uint8_t* src, G711Law law, size_t samples, int16_t* dst) {
+  const int16_t* table = law == G711Law::kMuLaw ? Tables().muLawDecode : Tables().aLawDecode;
+  for (size_t i = 0; i < samples; ++i) {
+    dst[i] = table[src[i]];
+  }
+}
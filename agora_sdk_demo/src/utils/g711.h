@@ -0,0 +1,31 @@
+//  Agora RTC/MEDIA SDK
+//
+//  Copyright (c) 2020 Agora.io. All rights reserved.
+//
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "utils/cpu_features.h"
+
+// The two companding laws of ITU-T G.711.
+enum class G711Law : uint8_t {
+  kMuLaw = 0,  // PCMU
+  kALaw,       // PCMA
+};
+
+// Encodes |samples| 16 bit samples to one G.711 byte each, bit exact with the
+// ITU-T reference: the 14 (mu-law) or 12 (A-law) most significant bits are
+// companded, the rest is dropped.
+void EncodeG711(const int16_t* src, G711Law law, size_t samples, uint8_t* dst);
+
+// Same as above with an explicit implementation, for tests and benchmarks.
+// The scalar one looks every sample up in a table, the AVX2 one computes 16
+// samples at a time. Levels the CPU doesn't support fall back to the best
+// supported one.
+void EncodeG711(const int16_t* src, G711Law law, size_t samples, uint8_t* dst, SimdLevel level);
+
+// Expands |samples| G.711 bytes to 16 bit samples through a table.
+void DecodeG711(const uint8_t* src, G711Law law, size_t samples, int16_t* dst);
@@ -0,0 +1,226 @@
+//  Agora RTC/MEDIA SDK
+//
+//  Copyright (c) 2020 Agora.io. All rights reserved.
+//
+
+#include "live_stream_reader.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <algorithm>
+
+namespace {
+
+// Reads ask for this much at least. A pipe hands over what it has, so the
+// size only bounds how many system calls a burst takes.
+const size_t kReadChunkSize = 64 * 1024;
+// How often a followed file is checked without inotify.
+const int kFollowPollMs = 5;
+
+}  // namespace
+
+LiveStreamReader::LiveStreamReader(const char* path, bool follow, int idleTimeoutMs)
+    : path_(strdup(path)),
+      follow_(follow),
+      idleTimeoutMs_(idleTimeoutMs),
+      fd_(-1),
+      ownsFd_(false),
+      regularFile_(false),
+      wakeFds_{-1, -1},
+      inotifyFd_(-1),
+      cancelled_(false),
+      ended_(false),
+      bytesRead_(0),
+      begin_(0),
+      end_(0) {}
+
+LiveStreamReader::~LiveStreamReader() {
+  close();
+  free(static_cast<void*>(path_));
+}
+
+bool LiveStreamReader::IsLivePath(const char* path) {
+  if (strcmp(path, "-") == 0) {
+    return true;
+  }
+  struct stat st;
+  return stat(path, &st) == 0 && (S_ISFIFO(st.st_mode) || S_ISCHR(st.st_mode));
+}
+
+bool LiveStreamReader::open() {
+  close();
+  if (strcmp(path_, "-") == 0) {
+    // stdin is shared with the parent, so its flags stay as they are. poll()
+    // says when a read won't block.
+    fd_ = STDIN_FILENO;
+  } else {
+    // Without O_NONBLOCK opening a FIFO waits for the writer, and cancel()
+    // couldn't wake that up.
+    fd_ = ::open(path_, O_RDONLY | O_NONBLOCK | O_CLOEXEC);
+    if (fd_ < 0) {
+      printf("open %s fail, error %s\n", path_, strerror(errno));
+      return false;
+    }
+    ownsFd_ = true;
+  }
+  struct stat st;
+  regularFile_ = fstat(fd_, &st) == 0 && S_ISREG(st.st_mode);
+  if (pipe2(wakeFds_, O_NONBLOCK | O_CLOEXEC) != 0) {
+    printf("pipe for %s fail, error %s\n", path_, strerror(errno));
+    close();
+    return false;
+  }
+  if (follow_ && regularFile_) {
+    // Wakes up on every write to the file, polling is the fallback.
+    inotifyFd_ = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    if (inotifyFd_ >= 0 && inotify_add_watch(inotifyFd_, path_, IN_MODIFY | IN_CLOSE_WRITE) < 0) {
+      ::close(inotifyFd_);
+      inotifyFd_ = -1;
+    }
+  }
+  cancelled_ = false;
+  ended_ = false;
+  bytesRead_ = 0;
+  begin_ = 0;
+  end_ = 0;
+  lastGrowth_ = std::chrono::steady_clock::now();
+  return true;
+}
+
+void LiveStreamReader::close() {
+  if (ownsFd_ && fd_ >= 0) {
+    ::close(fd_);
+  }
+  fd_ = -1;
+  ownsFd_ = false;
+  for (int& fd : wakeFds_) {
+    if (fd >= 0) {
+      ::close(fd);
+      fd = -1;
+    }
+  }
+  if (inotifyFd_ >= 0) {
+    ::close(inotifyFd_);
+    inotifyFd_ = -1;
+  }
+  ended_ = true;
+}
+
+void LiveStreamReader::cancel() {
+  cancelled_ = true;
+  if (wakeFds_[1] >= 0) {
+    char wake = 0;
+    ssize_t ret = write(wakeFds_[1], &wake, 1);
+    (void)ret;
+  }
+}
+
+size_t LiveStreamReader::readSome(uint8_t* dst, size_t size) {
+  while (fd_ >= 0 && !ended_ && !cancelled_) {
+    struct pollfd fds[2] = {{fd_, POLLIN, 0}, {wakeFds_[0], POLLIN, 0}};
+    if (poll(fds, 2, -1) < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      break;
+    }
+    if (fds[1].revents != 0) {
+      break;
+    }
+    ssize_t bytes = ::read(fd_, dst, size);
+    if (bytes > 0) {
+      bytesRead_ += bytes;
+      lastGrowth_ = std::chrono::steady_clock::now();
+      return static_cast<size_t>(bytes);
+    }
+    if (bytes < 0) {
+      if (errno == EINTR || errno == EAGAIN) {
+        continue;
+      }
+      printf("read %s fail, error %s\n", path_, strerror(errno));
+      break;
+    }
+    // The writer closed the pipe, or a file ended.
+    if (!follow_ || !regularFile_ || !waitForGrowth()) {
+      break;
+    }
+  }
+  ended_ = true;
+  return 0;
+}
+
+bool LiveStreamReader::waitForGrowth() {
+  while (!cancelled_) {
+    auto idle = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::steady_clock::now() - lastGrowth_)
+                    .count();
+    if (idle >= idleTimeoutMs_) {
+      return false;
+    }
+    int timeoutMs = static_cast<int>(idleTimeoutMs_ - idle);
+    if (inotifyFd_ < 0) {
+      return poll(nullptr, 0, std::min(timeoutMs, kFollowPollMs)) >= 0 || errno == EINTR;
+    }
+    struct pollfd fds[2] = {{wakeFds_[0], POLLIN, 0}, {inotifyFd_, POLLIN, 0}};
+    int ret = poll(fds, 2, timeoutMs);
+    if (ret < 0 && errno != EINTR) {
+      return false;
+    }
+    if (fds[0].revents != 0) {
+      return false;
+    }
+    if (fds[1].revents != 0) {
+      // The events only say that something happened, read() tells what.
+      char events[4096];
+      while (::read(inotifyFd_, events, sizeof(events)) > 0) {
+      }
+      return true;
+    }
+  }
+  return false;
+}
+
+bool LiveStreamReader::require(size_t size) {
+  while (available() < size) {
+    size_t capacity = std::max(size, kReadChunkSize);
+    if (buffer_.size() - begin_ < capacity && begin_ > 0) {
+      memmove(buffer_.data(), buffer_.data() + begin_, end_ - begin_);
+      end_ -= begin_;
+      begin_ = 0;
+    }
+    if (buffer_.size() < capacity) {
+      buffer_.resize(capacity);
+    }
+    size_t bytes = readSome(buffer_.data() + end_, buffer_.size() - end_);
+    if (bytes == 0) {
+      return false;
+    }
+    end_ += bytes;
+  }
+  return true;
+}
+
+void LiveStreamReader::consume(size_t size) {
+  begin_ += std::min(size, available());
+  if (begin_ == end_) {
+    begin_ = 0;
+    end_ = 0;
+  }
+}
+
+size_t LiveStreamReader::read(uint8_t* buffer, size_t size) {
+  if (available() > 0) {
+    size_t bytes = std::min(size, available());
+    memcpy(buffer, data(), bytes);
+    consume(bytes);
+    return bytes;
+  }
+  return readSome(buffer, size);
+}
@@ -0,0 +1,83 @@
+//  Agora RTC/MEDIA SDK
+//
+//  Copyright (c) 2020 Agora.io. All rights reserved.
+//
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <vector>
+
+// Reads a stream that is still being produced while it plays: stdin, a FIFO,
+// a character device, or a file another process keeps appending to. A read
+// returns as soon as the writer handed over any bytes instead of waiting for
+// a whole buffer, so a frame reaches the parser the moment its last byte
+// arrives.
+//
+// Reads block. They belong on a background thread, which cancel() wakes from
+// any other thread.
+class LiveStreamReader {
+ public:
+  // "-" reads stdin. With |follow| the end of a regular file isn't the end of
+  // the stream: the reader waits for the file to grow, until it didn't for
+  // |idleTimeoutMs|.
+  LiveStreamReader(const char* path, bool follow, int idleTimeoutMs = 5000);
+  ~LiveStreamReader();
+
+  // Whether |path| can only be read live: "-", FIFOs and character devices.
+  static bool IsLivePath(const char* path);
+
+  bool open();
+  void close();
+  // Makes a blocked read return and every later one fail. Thread safe.
+  void cancel();
+
+  // Waits until |size| bytes are buffered. Returns false if the stream ended
+  // or was cancelled first, the bytes buffered so far stay available.
+  bool require(size_t size);
+  // The buffered bytes, valid until the next require(), read() or consume().
+  const uint8_t* data() const { return buffer_.data() + begin_; }
+  size_t available() const { return end_ - begin_; }
+  void consume(size_t size);
+  // Copies up to |size| bytes, buffered ones first, and waits only if there
+  // are none. Returns 0 at the end of the stream.
+  size_t read(uint8_t* buffer, size_t size);
+
+  // The writer is done, or the stream was cancelled, or failed.
+  bool ended() const { return ended_; }
+  uint64_t bytesRead() const { return bytesRead_; }
+
+ private:
+  LiveStreamReader(const LiveStreamReader&) = delete;
+  LiveStreamReader& operator=(const LiveStreamReader&) = delete;
+
+  // Reads once into |dst| and returns the byte count, 0 at the end.
+  size_t readSome(uint8_t* dst, size_t size);
+  // Waits for a regular file at its end to grow. False once it went idle or
+  // the stream was cancelled.
+  bool waitForGrowth();
+
+ private:
+  char* path_;
+  bool follow_;
+  int idleTimeoutMs_;
+  int fd_;
+  bool ownsFd_;
+  bool regularFile_;
+  // Wakes up poll() on cancel().
+  int wakeFds_[2];
+  // Wakes up on writes to a followed file.
+  int inotifyFd_;
+  std::atomic<bool> cancelled_;
+  bool ended_;
+  // When a followed file last grew.
+  std::chrono::steady_clock::time_point lastGrowth_;
+  uint64_t bytesRead_;
+
+  std::vector<uint8_t> buffer_;
+  size_t begin_;
+  size_t end_;
+};
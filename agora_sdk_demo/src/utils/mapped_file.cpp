@@ -0,0 +1,76 @@
+//  Agora RTC/MEDIA SDK
+//
+//  Copyright (c) 2020 Agora.io. All rights reserved.
+//
+
+#include "mapped_file.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+MappedFile::MappedFile(const char* filepath)
+    : filePath_(strdup(filepath)), data_(nullptr), size_(0) {}
+
+MappedFile::~MappedFile() {
+  close();
+  free(static_cast<void*>(filePath_));
+}
+
+bool MappedFile::open(Advice advice) {
+  if (data_) {
+    return true;
+  }
+  int fd = ::open(filePath_, O_RDONLY);
+  if (fd < 0) {
+    printf("open %s fail, error %s\n", filePath_, strerror(errno));
+    return false;
+  }
+  struct stat st;
+  if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) || st.st_size <= 0) {
+    ::close(fd);
+    return false;
+  }
+  void* addr = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+  // The mapping keeps its own reference to the file.
+  ::close(fd);
+  if (addr == MAP_FAILED) {
+    printf("mmap %s fail, error %s\n", filePath_, strerror(errno));
+    return false;
+  }
+
+  int madv = MADV_NORMAL;
+  if (advice == kAdviceSequential) {
+    madv = MADV_SEQUENTIAL;
+  } else if (advice == kAdviceRandom) {
+    madv = MADV_RANDOM;
+  }
+  madvise(addr, st.st_size, madv);
+
+  data_ = static_cast<const uint8_t*>(addr);
+  size_ = st.st_size;
+  return true;
+}
+
+void MappedFile::close() {
+  if (data_) {
+    munmap(const_cast<uint8_t*>(data_), size_);
+    data_ = nullptr;
+    size_ = 0;
+  }
+}
+
+void MappedFile::willNeed(size_t offset, size_t length) const {
+  if (!data_ || offset >= size_) {
+    return;
+  }
+  static const size_t kPageSize = sysconf(_SC_PAGESIZE);
+  size_t begin = offset & ~(kPageSize - 1);
+  size_t end = offset + length < size_ ? offset + length : size_;
+  madvise(const_cast<uint8_t*>(data_) + begin, end - begin, MADV_WILLNEED);
+}
@@ -0,0 +1,42 @@
+//  Agora RTC/MEDIA SDK
+//
+//  Copyright (c) 2020 Agora.io. All rights reserved.
+//
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+// Read-only memory mapping of a whole media file. Parsers built on top of it
+// hand out (pointer, length) views straight into the mapping instead of
+// copying through intermediate buffers.
+class MappedFile {
+ public:
+  enum Advice { kAdviceNormal, kAdviceSequential, kAdviceRandom };
+
+  explicit MappedFile(const char* filepath);
+  ~MappedFile();
+
+  // Maps the file and applies |advice| as read-ahead hint. Returns false if the
+  // file can't be opened or mapped (e.g. empty file, pipe or device).
+  bool open(Advice advice = kAdviceSequential);
+  void close();
+
+  bool isOpen() const { return data_ != nullptr; }
+  const uint8_t* data() const { return data_; }
+  size_t size() const { return size_; }
+  const char* path() const { return filePath_; }
+
+  // Hints the kernel to start reading [offset, offset + length) ahead of use.
+  void willNeed(size_t offset, size_t length) const;
+
+ private:
+  MappedFile(const MappedFile&) = delete;
+  MappedFile& operator=(const MappedFile&) = delete;
+
+ private:
+  char* filePath_;
+  const uint8_t* data_;
+  size_t size_;
+};
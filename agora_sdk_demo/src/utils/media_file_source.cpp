@@ -0,0 +1,122 @@
+//  Agora RTC/MEDIA SDK
+//
+//  Copyright (c) 2020 Agora.io. All rights reserved.
+//
+
+#include "media_file_source.h"
+
+#include <utility>
+
+namespace {
+
+size_t RoundUpToPowerOfTwo(size_t value) {
+  size_t result = 2;
+  while (result < value) {
+    result <<= 1;
+  }
+  return result;
+}
+
+}  // namespace
+
+MediaFileSource::MediaFileSource(ReadFrame readFrame, size_t capacity)
+    : readFrame_(std::move(readFrame)),
+      slots_(RoundUpToPowerOfTwo(capacity)),
+      mask_(slots_.size() - 1),
+      head_(0),
+      released_(0),
+      tail_(0),
+      eof_(false),
+      stopping_(false),
+      underruns_(0),
+      consumerWaiting_(false),
+      producerWaiting_(false) {}
+
+MediaFileSource::~MediaFileSource() { stop(); }
+
+void MediaFileSource::start() {
+  stop();
+  head_ = 0;
+  released_ = 0;
+  tail_ = 0;
+  eof_ = false;
+  stopping_ = false;
+  thread_ = std::thread(&MediaFileSource::run, this);
+}
+
+void MediaFileSource::stop() {
+  if (!thread_.joinable()) {
+    return;
+  }
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopping_ = true;
+  }
+  notFull_.notify_one();
+  notEmpty_.notify_one();
+  thread_.join();
+}
+
+void MediaFileSource::run() {
+  while (!stopping_) {
+    uint64_t tail = tail_.load(std::memory_order_relaxed);
+    if (tail - released_ >= slots_.size()) {
+      std::unique_lock<std::mutex> lock(mutex_);
+      producerWaiting_ = true;
+      notFull_.wait(lock, [this, tail] { return stopping_ || tail - released_ < slots_.size(); });
+      producerWaiting_ = false;
+      continue;
+    }
+    if (!readFrame_(&slots_[tail & mask_])) {
+      eof_ = true;
+      wakeConsumer();
+      return;
+    }
+    tail_ = tail + 1;
+    wakeConsumer();
+  }
+}
+
+void MediaFileSource::wakeConsumer() {
+  // The consumer sets its flag before checking |tail_| and |eof_| again, and
+  // the producer checks the flag after publishing them. One of the two sees
+  // the other, so the wakeup can't get lost.
+  if (consumerWaiting_) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    notEmpty_.notify_one();
+  }
+}
+
+bool MediaFileSource::waitReadable() {
+  if (head_ < tail_.load(std::memory_order_acquire)) {
+    return true;
+  }
+  if (!eof_) {
+    underruns_.fetch_add(1, std::memory_order_relaxed);
+    std::unique_lock<std::mutex> lock(mutex_);
+    consumerWaiting_ = true;
+    notEmpty_.wait(lock, [this] { return head_ < tail_ || eof_ || stopping_; });
+    consumerWaiting_ = false;
+  }
+  return head_ < tail_;
+}
+
+bool MediaFileSource::hasNext() { return thread_.joinable() && waitReadable(); }
+
+bool MediaFileSource::next(const uint8_t** data, int* length) {
+  // The frame returned last may be refilled from now on.
+  released_ = head_;
+  if (producerWaiting_) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    notFull_.notify_one();
+  }
+  if (!hasNext()) {
+    *length = 0;
+    return false;
+  }
+  const std::vector<uint8_t>& frame = slots_[head_ & mask_];
+  *data = frame.data();
+  *length = static_cast<int>(frame.size());
+  ++head_;
+  return true;
+}
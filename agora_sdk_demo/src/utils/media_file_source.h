@@ -0,0 +1,80 @@
+//  Agora RTC/MEDIA SDK
+//
+//  Copyright (c) 2020 Agora.io. All rights reserved.
+//
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Reads frames on a background thread into a bounded ring, ahead of the
+// thread that consumes them, so file I/O never stalls a paced sender.
+//
+// The ring has one producer and one consumer and needs no lock while frames
+// are flowing: each side only moves its own index. A lock and condition
+// variables are only used to sleep while the ring is full or empty. Slots
+// keep their buffers, so no memory is allocated once the ring went round.
+class MediaFileSource {
+ public:
+  // Called on the background thread to store the next frame in |frame|.
+  // Returns false at the end of the file.
+  typedef std::function<bool(std::vector<uint8_t>* frame)> ReadFrame;
+
+  // |capacity| is rounded up to a power of two.
+  MediaFileSource(ReadFrame readFrame, size_t capacity);
+  ~MediaFileSource();
+
+  // Starts reading from the current position of the underlying file. The
+  // owner may reposition the file between stop() and start().
+  void start();
+  void stop();
+
+  // Waits until the next frame is read or the end is reached.
+  bool hasNext();
+  // Points |data| at the next frame, valid until the next call.
+  bool next(const uint8_t** data, int* length);
+
+  size_t capacity() const { return slots_.size(); }
+  // Times the consumer had to wait for the background thread.
+  uint64_t underruns() const { return underruns_.load(std::memory_order_relaxed); }
+
+ private:
+  MediaFileSource(const MediaFileSource&) = delete;
+  MediaFileSource& operator=(const MediaFileSource&) = delete;
+
+  void run();
+  void wakeConsumer();
+  // Waits until slot |head_| is filled, false if the file ended first.
+  bool waitReadable();
+
+ private:
+  ReadFrame readFrame_;
+  std::vector<std::vector<uint8_t>> slots_;
+  size_t mask_;
+
+  // Next slot the consumer reads, only touched by the consumer.
+  uint64_t head_;
+  // Slots before |released_| may be refilled. The consumer releases the slot
+  // it returned last only on its next call, so the view stays valid.
+  std::atomic<uint64_t> released_;
+  // Next slot the producer fills, written by the producer only.
+  std::atomic<uint64_t> tail_;
+  std::atomic<bool> eof_;
+  std::atomic<bool> stopping_;
+  std::atomic<uint64_t> underruns_;
+
+  // Set by a side before it sleeps, so the other side knows to wake it.
+  std::atomic<bool> consumerWaiting_;
+  std::atomic<bool> producerWaiting_;
+  std::mutex mutex_;
+  std::condition_variable notFull_;
+  std::condition_variable notEmpty_;
+  std::thread thread_;
+};
@@ -0,0 +1,368 @@
+//  Agora RTC/MEDIA SDK
+//
+//  Copyright (c) 2020 Agora.io. All rights reserved.
+//
+
+#include "pcm_convert.h"
+
+#include <math.h>
+#include <string.h>
+
+#if defined(AGORA_DEMO_ARCH_X86)
+#include <immintrin.h>
+#endif
+
+namespace {
+
+typedef void (*ConvertFunc)(const uint8_t* src, size_t samples, int16_t* dst);
+
+const float kFloatScale = 32768.0f;
+const int kGainBits = 14;
+
+int16_t FloatToInt16(float value) {
+  float scaled = value * kFloatScale;
+  // Written so that NaN ends up at the lower bound, like the vector code.
+  if (!(scaled > -32768.0f)) {
+    scaled = -32768.0f;
+  }
+  if (scaled > 32767.0f) {
+    scaled = 32767.0f;
+  }
+  return static_cast<int16_t>(lrintf(scaled));
+}
+
+void ConvertUInt8Scalar(const uint8_t* src, size_t samples, int16_t* dst) {
+  for (size_t i = 0; i < samples; ++i) {
+    dst[i] = static_cast<int16_t>((src[i] - 128) * 256);
+  }
+}
+
+void ConvertInt16Scalar(const uint8_t* src, size_t samples, int16_t* dst) {
+  memmove(dst, src, samples * sizeof(int16_t));
+}
+
+void ConvertInt24Scalar(const uint8_t* src, size_t samples, int16_t* dst) {
+  for (size_t i = 0; i < samples; ++i) {
+    dst[i] = static_cast<int16_t>(src[3 * i + 1] | src[3 * i + 2] << 8);
+  }
+}
+
+void ConvertInt32Scalar(const uint8_t* src, size_t samples, int16_t* dst) {
+  for (size_t i = 0; i < samples; ++i) {
+    dst[i] = static_cast<int16_t>(src[4 * i + 2] | src[4 * i + 3] << 8);
+  }
+}
+
+void ConvertFloat32Scalar(const uint8_t* src, size_t samples, int16_t* dst) {
+  for (size_t i = 0; i < samples; ++i) {
+    float value;
+    memcpy(&value, src + 4 * i, sizeof(value));
+    dst[i] = FloatToInt16(value);
+  }
+}
+
+#if defined(AGORA_DEMO_ARCH_X86)
+__attribute__((target("sse2"))) void ConvertInt32Sse2(const uint8_t* src, size_t samples,
+                                                      int16_t* dst) {
+  size_t i = 0;
+  for (; i + 8 <= samples; i += 8) {
+    __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 4 * i));
+    __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 4 * i + 16));
+    __m128i packed = _mm_packs_epi32(_mm_srai_epi32(a, 16), _mm_srai_epi32(b, 16));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), packed);
+  }
+  ConvertInt32Scalar(src + 4 * i, samples - i, dst + i);
+}
+
+__attribute__((target("sse2"))) void ConvertFloat32Sse2(const uint8_t* src, size_t samples,
+                                                        int16_t* dst) {
+  const __m128 scale = _mm_set1_ps(kFloatScale);
+  const __m128 lower = _mm_set1_ps(-32768.0f);
+  const __m128 upper = _mm_set1_ps(32767.0f);
+  size_t i = 0;
+  for (; i + 8 <= samples; i += 8) {
+    __m128 a = _mm_mul_ps(_mm_loadu_ps(reinterpret_cast<const float*>(src + 4 * i)), scale);
+    __m128 b = _mm_mul_ps(_mm_loadu_ps(reinterpret_cast<const float*>(src + 4 * i + 16)), scale);
+    // maxps returns its second operand for NaN.
+    a = _mm_min_ps(_mm_max_ps(a, lower), upper);
+    b = _mm_min_ps(_mm_max_ps(b, lower), upper);
+    __m128i packed = _mm_packs_epi32(_mm_cvtps_epi32(a), _mm_cvtps_epi32(b));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), packed);
+  }
+  ConvertFloat32Scalar(src + 4 * i, samples - i, dst + i);
+}
+
+__attribute__((target("avx2"))) void ConvertInt24Avx2(const uint8_t* src, size_t samples,
+                                                      int16_t* dst) {
+  // Picks the two high bytes of the first four 3 byte samples of a load.
+  const __m128i shuffle = _mm_setr_epi8(1, 2, 4, 5, 7, 8, 10, 11, -1, -1, -1, -1, -1, -1, -1, -1);
+  size_t i = 0;
+  // 8 samples are 24 bytes, the second load reads 4 bytes past them.
+  for (; i + 8 <= samples && 3 * (samples - i) >= 28; i += 8) {
+    __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 3 * i));
+    __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 3 * i + 12));
+    __m128i packed = _mm_unpacklo_epi64(_mm_shuffle_epi8(a, shuffle), _mm_shuffle_epi8(b, shuffle));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), packed);
+  }
+  ConvertInt24Scalar(src + 3 * i, samples - i, dst + i);
+}
+
+__attribute__((target("avx2"))) void ConvertInt32Avx2(const uint8_t* src, size_t samples,
+                                                      int16_t* dst) {
+  size_t i = 0;
+  for (; i + 16 <= samples; i += 16) {
+    __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + 4 * i));
+    __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + 4 * i + 32));
+    __m256i packed = _mm256_packs_epi32(_mm256_srai_epi32(a, 16), _mm256_srai_epi32(b, 16));
+    // packs works per 128 bit lane, restore the sample order.
+    packed = _mm256_permute4x64_epi64(packed, 0xD8);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), packed);
+  }
+  ConvertInt32Sse2(src + 4 * i, samples - i, dst + i);
+}
+
+__attribute__((target("avx2"))) void ConvertFloat32Avx2(const uint8_t* src, size_t samples,
+                                                        int16_t* dst) {
+  const __m256 scale = _mm256_set1_ps(kFloatScale);
+  const __m256 lower = _mm256_set1_ps(-32768.0f);
+  const __m256 upper = _mm256_set1_ps(32767.0f);
+  size_t i = 0;
+  for (; i + 16 <= samples; i += 16) {
+    __m256 a = _mm256_mul_ps(_mm256_loadu_ps(reinterpret_cast<const float*>(src + 4 * i)), scale);
+    __m256 b =
+        _mm256_mul_ps(_mm256_loadu_ps(reinterpret_cast<const float*>(src + 4 * i + 32)), scale);
+    a = _mm256_min_ps(_mm256_max_ps(a, lower), upper);
+    b = _mm256_min_ps(_mm256_max_ps(b, lower), upper);
+    __m256i packed = _mm256_packs_epi32(_mm256_cvtps_epi32(a), _mm256_cvtps_epi32(b));
+    packed = _mm256_permute4x64_epi64(packed, 0xD8);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), packed);
+  }
+  ConvertFloat32Sse2(src + 4 * i, samples - i, dst + i);
+}
+#endif
+
+ConvertFunc SelectConvert(PcmSampleFormat format, SimdLevel level) {
+  level = ClampSimdLevel(level);
+  switch (format) {
+    case PcmSampleFormat::kUInt8:
+      return ConvertUInt8Scalar;
+    case PcmSampleFormat::kInt16:
+      return ConvertInt16Scalar;
+    case PcmSampleFormat::kInt24:
+#if defined(AGORA_DEMO_ARCH_X86)
+      // The byte shuffle needs SSSE3, which comes with AVX2.
+      if (level == SimdLevel::kAvx2) {
+        return ConvertInt24Avx2;
+      }
+#endif
+      return ConvertInt24Scalar;
+    case PcmSampleFormat::kInt32:
+#if defined(AGORA_DEMO_ARCH_X86)
+      if (level == SimdLevel::kAvx2) {
+        return ConvertInt32Avx2;
+      }
+      if (level == SimdLevel::kSse2) {
+        return ConvertInt32Sse2;
+      }
+#endif
+      return ConvertInt32Scalar;
+    case PcmSampleFormat::kFloat32:
+#if defined(AGORA_DEMO_ARCH_X86)
+      if (level == SimdLevel::kAvx2) {
+        return ConvertFloat32Avx2;
+      }
+      if (level == SimdLevel::kSse2) {
+        return ConvertFloat32Sse2;
+      }
+#endif
+      return ConvertFloat32Scalar;
+  }
+  return ConvertInt16Scalar;
+}
+
+void StereoToMonoScalar(const int16_t* src, size_t frames, int16_t* dst) {
+  for (size_t i = 0; i < frames; ++i) {
+    dst[i] = static_cast<int16_t>((src[2 * i] + src[2 * i + 1]) >> 1);
+  }
+}
+
+#if defined(AGORA_DEMO_ARCH_X86)
+__attribute__((target("sse2"))) void StereoToMonoSse2(const int16_t* src, size_t frames,
+                                                      int16_t* dst) {
+  const __m128i ones = _mm_set1_epi16(1);
+  size_t i = 0;
+  for (; i + 8 <= frames; i += 8) {
+    __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 2 * i));
+    __m128i b = _mm_loadu_si128(reinterpret_cast<const __m128i*>(src + 2 * i + 8));
+    // Sums of left and right as int32, halved, never saturate when packed.
+    __m128i sumA = _mm_srai_epi32(_mm_madd_epi16(a, ones), 1);
+    __m128i sumB = _mm_srai_epi32(_mm_madd_epi16(b, ones), 1);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(dst + i), _mm_packs_epi32(sumA, sumB));
+  }
+  StereoToMonoScalar(src + 2 * i, frames - i, dst + i);
+}
+
+__attribute__((target("avx2"))) void StereoToMonoAvx2(const int16_t* src, size_t frames,
+                                                      int16_t* dst) {
+  const __m256i ones = _mm256_set1_epi16(1);
+  size_t i = 0;
+  for (; i + 16 <= frames; i += 16) {
+    __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + 2 * i));
+    __m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(src + 2 * i + 16));
+    __m256i sumA = _mm256_srai_epi32(_mm256_madd_epi16(a, ones), 1);
+    __m256i sumB = _mm256_srai_epi32(_mm256_madd_epi16(b, ones), 1);
+    __m256i packed = _mm256_permute4x64_epi64(_mm256_packs_epi32(sumA, sumB), 0xD8);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst + i), packed);
+  }
+  StereoToMonoSse2(src + 2 * i, frames - i, dst + i);
+}
+#endif
+
+// Gains of a speaker position on the left and right output, in tenths.
+struct SpeakerGains {
+  uint32_t speaker;
+  int left;
+  int right;
+};
+
+// WAVE_FORMAT_EXTENSIBLE speaker bits in channel order. 7 is about -3 dB.
+const SpeakerGains kSpeakerGains[] = {
+    {0x1, 10, 0},     // FRONT_LEFT
+    {0x2, 0, 10},     // FRONT_RIGHT
+    {0x4, 7, 7},      // FRONT_CENTER
+    {0x8, 0, 0},      // LOW_FREQUENCY
+    {0x10, 7, 0},     // BACK_LEFT
+    {0x20, 0, 7},     // BACK_RIGHT
+    {0x40, 10, 0},    // FRONT_LEFT_OF_CENTER
+    {0x80, 0, 10},    // FRONT_RIGHT_OF_CENTER
+    {0x100, 5, 5},    // BACK_CENTER
+    {0x200, 7, 0},    // SIDE_LEFT
+    {0x400, 0, 7},    // SIDE_RIGHT
+    {0x800, 5, 5},    // TOP_CENTER
+    {0x1000, 7, 0},   // TOP_FRONT_LEFT
+    {0x2000, 5, 5},   // TOP_FRONT_CENTER
+    {0x4000, 0, 7},   // TOP_FRONT_RIGHT
+    {0x8000, 7, 0},   // TOP_BACK_LEFT
+    {0x10000, 5, 5},  // TOP_BACK_CENTER
+    {0x20000, 0, 7},  // TOP_BACK_RIGHT
+};
+
+const size_t kSpeakerCount = sizeof(kSpeakerGains) / sizeof(kSpeakerGains[0]);
+
+}  // namespace
+
+size_t PcmSampleBytes(PcmSampleFormat format) {
+  switch (format) {
+    case PcmSampleFormat::kUInt8:
+      return 1;
+    case PcmSampleFormat::kInt16:
+      return 2;
+    case PcmSampleFormat::kInt24:
+      return 3;
+    case PcmSampleFormat::kInt32:
+    case PcmSampleFormat::kFloat32:
+      return 4;
+  }
+  return 0;
+}
+
+void ConvertPcmToInt16(const uint8_t* src, PcmSampleFormat format, size_t samples, int16_t* dst) {
+  static const ConvertFunc kConverts[] = {
+      SelectConvert(PcmSampleFormat::kUInt8, GetSimdLevel()),
+      SelectConvert(PcmSampleFormat::kInt16, GetSimdLevel()),
+      SelectConvert(PcmSampleFormat::kInt24, GetSimdLevel()),
+      SelectConvert(PcmSampleFormat::kInt32, GetSimdLevel()),
+      SelectConvert(PcmSampleFormat::kFloat32, GetSimdLevel()),
+  };
+  kConverts[static_cast<size_t>(format)](src, samples, dst);
+}
+
+void ConvertPcmToInt16(const uint8_t* src, PcmSampleFormat format, size_t samples, int16_t* dst,
+                       SimdLevel level) {
+  SelectConvert(format, level)(src, samples, dst);
+}
+
+PcmDownmixer::PcmDownmixer(int inputChannels, uint32_t channelMask, int outputChannels)
+    : inputChannels_(inputChannels > 0 ? inputChannels : 1),
+      outputChannels_(outputChannels >= inputChannels_ ? inputChannels_
+                                                        : (outputChannels >= 2 ? 2 : 1)),
+      gains_(inputChannels_ * outputChannels_, 0) {
+  if (outputChannels_ == inputChannels_) {
+    for (int i = 0; i < inputChannels_; ++i) {
+      gains_[i * inputChannels_ + i] = 1 << kGainBits;
+    }
+    return;
+  }
+
+  // Speaker position of each input channel, the default order without a mask.
+  std::vector<int> left(inputChannels_, 5);
+  std::vector<int> right(inputChannels_, 5);
+  size_t speaker = 0;
+  for (int i = 0; i < inputChannels_; ++i) {
+    while (channelMask != 0 && speaker < kSpeakerCount &&
+           !(channelMask & kSpeakerGains[speaker].speaker)) {
+      ++speaker;
+    }
+    if (speaker < kSpeakerCount) {
+      left[i] = kSpeakerGains[speaker].left;
+      right[i] = kSpeakerGains[speaker].right;
+      ++speaker;
+    }
+  }
+
+  for (int o = 0; o < outputChannels_; ++o) {
+    int total = 0;
+    for (int i = 0; i < inputChannels_; ++i) {
+      total += outputChannels_ == 1 ? left[i] + right[i] : (o == 0 ? left[i] : right[i]);
+    }
+    for (int i = 0; i < inputChannels_ && total > 0; ++i) {
+      int gain = outputChannels_ == 1 ? left[i] + right[i] : (o == 0 ? left[i] : right[i]);
+      gains_[o * inputChannels_ + i] = (gain << kGainBits) / total;
+    }
+  }
+}
+
+void PcmDownmixer::process(const int16_t* src, size_t frames, int16_t* dst) const {
+  process(src, frames, dst, GetSimdLevel());
+}
+
+void PcmDownmixer::process(const int16_t* src, size_t frames, int16_t* dst,
+                           SimdLevel level) const {
+  if (inputChannels_ == outputChannels_) {
+    memmove(dst, src, frames * inputChannels_ * sizeof(int16_t));
+    return;
+  }
+  if (inputChannels_ == 2 && outputChannels_ == 1) {
+    switch (ClampSimdLevel(level)) {
+#if defined(AGORA_DEMO_ARCH_X86)
+      case SimdLevel::kAvx2:
+        StereoToMonoAvx2(src, frames, dst);
+        return;
+      case SimdLevel::kSse2:
+        StereoToMonoSse2(src, frames, dst);
+        return;
+#endif
+      default:
+        StereoToMonoScalar(src, frames, dst);
+        return;
+    }
+  }
+
+  // Surround layouts are rare, a plain matrix multiply does.
+  for (size_t f = 0; f < frames; ++f) {
+    const int16_t* in = src + f * inputChannels_;
+    int32_t mixed[2] = {0, 0};
+    for (int o = 0; o < outputChannels_; ++o) {
+      const int32_t* gains = gains_.data() + o * inputChannels_;
+      for (int i = 0; i < inputChannels_; ++i) {
+        mixed[o] += gains[i] * in[i];
+      }
+    }
+    // Outputs are written after all inputs of the frame have been read.
+    for (int o = 0; o < outputChannels_; ++o) {
+      int32_t value = (mixed[o] + (1 << (kGainBits - 1))) >> kGainBits;
+      dst[f * outputChannels_ + o] =
+          static_cast<int16_t>(value > 32767 ? 32767 : (value < -32768 ? -32768 : value));
+    }
+  }
+}
@@ -0,0 +1,58 @@
+//  Agora RTC/MEDIA SDK
+//
+//  Copyright (c) 2020 Agora.io. All rights reserved.
+//
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <vector>
+
+#include "utils/cpu_features.h"
+
+// Little endian interleaved PCM sample formats found in WAV files.
+enum class PcmSampleFormat : uint8_t {
+  kUInt8 = 0,
+  kInt16,
+  kInt24,
+  kInt32,
+  kFloat32,
+};
+
+size_t PcmSampleBytes(PcmSampleFormat format);
+
+// Converts |samples| samples of |format| at |src| to int16. Integer formats
+// keep their 16 most significant bits, float is scaled by 32768, rounded to
+// nearest and saturated (NaN gives -32768).
+void ConvertPcmToInt16(const uint8_t* src, PcmSampleFormat format, size_t samples, int16_t* dst);
+
+// Same as above with an explicit implementation, for tests and benchmarks.
+// Levels the CPU doesn't support fall back to the best supported one.
+void ConvertPcmToInt16(const uint8_t* src, PcmSampleFormat format, size_t samples, int16_t* dst,
+                       SimdLevel level);
+
+// Mixes interleaved int16 frames down to mono or stereo. Speaker positions
+// come from the WAVE_FORMAT_EXTENSIBLE channel mask, or the default order
+// (FL, FR, FC, LFE, BL, BR, ...) without one. Stereo keeps the left and right
+// speakers on their side and spreads centre speakers over both at -3 dB,
+// mono averages all of them. LFE is dropped. The gains of each output add up
+// to one, so mixes never clip.
+class PcmDownmixer {
+ public:
+  // Fewer |outputChannels| than |inputChannels| give stereo at most.
+  PcmDownmixer(int inputChannels, uint32_t channelMask, int outputChannels);
+
+  int inputChannels() const { return inputChannels_; }
+  int outputChannels() const { return outputChannels_; }
+
+  // Mixes |frames| frames from |src| into |dst|, which may alias |src|.
+  void process(const int16_t* src, size_t frames, int16_t* dst) const;
+  void process(const int16_t* src, size_t frames, int16_t* dst, SimdLevel level) const;
+
+ private:
+  int inputChannels_;
+  int outputChannels_;
+  // Q14 gain of input channel i on output channel o at [o * inputChannels_ + i].
+  std::vector<int32_t> gains_;
+};
@@ -0,0 +1,151 @@
+//  Agora RTC/MEDIA SDK
+//
+//  Copyright (c) 2020 Agora.io. All rights reserved.
+//
+
+#include "replay_file.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <atomic>
+
+namespace {
+
+const char kReplayMagic[4] = {'A', 'R', 'P', 'L'};
+const uint32_t kReplayVersion = 1;
+
+// The payload area starts on a page, so each frame can be mapped on its own.
+const uint64_t kPayloadAreaAlignment = 4096;
+
+uint64_t AlignUp(uint64_t value, uint64_t alignment) {
+  return (value + alignment - 1) & ~(alignment - 1);
+}
+
+}  // namespace
+
+bool GetReplaySourceVersion(const char* filepath, uint64_t* size, int64_t* mtimeNs) {
+  struct stat st;
+  if (stat(filepath, &st) != 0) {
+    return false;
+  }
+  *size = st.st_size;
+  *mtimeNs = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+  return true;
+}
+
+ReplayFile::ReplayFile(const char* filepath)
+    : file_(filepath), header_(nullptr), frames_(nullptr) {}
+
+bool ReplayFile::isReplayFile(const char* filepath) {
+  FILE* file = fopen(filepath, "rb");
+  if (!file) {
+    return false;
+  }
+  char magic[4] = {0};
+  bool isReplay = fread(magic, 1, sizeof(magic), file) == sizeof(magic) &&
+                  memcmp(magic, kReplayMagic, sizeof(kReplayMagic)) == 0;
+  fclose(file);
+  return isReplay;
+}
+
+std::string ReplayFile::sidecarPath(const char* filepath) {
+  return std::string(filepath) + ".replay";
+}
+
+bool ReplayFile::open() {
+  if (header_) {
+    return true;
+  }
+  if (!file_.open(MappedFile::kAdviceSequential)) {
+    printf("Open replay file %s failed\n", file_.path());
+    return false;
+  }
+  const ReplayFileHeader* header = reinterpret_cast<const ReplayFileHeader*>(file_.data());
+  size_t size = file_.size();
+  bool valid = size >= kReplayHeaderSize &&
+               memcmp(header->magic, kReplayMagic, sizeof(kReplayMagic)) == 0 &&
+               header->version == kReplayVersion &&
+               header->frameTableOffset % alignof(ReplayFrame) == 0 &&
+               header->frameTableOffset >= kReplayHeaderSize && header->frameTableOffset <= size &&
+               static_cast<uint64_t>(header->frameCount) * sizeof(ReplayFrame) <=
+                   size - header->frameTableOffset;
+  if (!valid) {
+    printf("Not a replay file or a different version: %s\n", file_.path());
+    file_.close();
+    return false;
+  }
+  header_ = header;
+  frames_ = reinterpret_cast<const ReplayFrame*>(file_.data() + header->frameTableOffset);
+  return true;
+}
+
+bool ReplayFile::matchesSource(const char* filepath) const {
+  uint64_t size = 0;
+  int64_t mtimeNs = 0;
+  return GetReplaySourceVersion(filepath, &size, &mtimeNs) && header_->sourceSize == size &&
+         header_->sourceMtimeNs == mtimeNs;
+}
+
+ReplayFileWriter::ReplayFileWriter(const ReplayFileHeader& header) : header_(header) {}
+
+void ReplayFileWriter::addFrame(const uint8_t* data, uint32_t size, int64_t ptsUs, uint32_t flags,
+                                uint32_t codec) {
+  payload_.resize(AlignUp(payload_.size(), kReplayPayloadAlignment));
+  ReplayFrame frame;
+  memset(&frame, 0, sizeof(frame));
+  frame.offset = payload_.size();
+  frame.size = size;
+  frame.flags = flags;
+  frame.ptsUs = ptsUs;
+  frame.codec = codec;
+  frames_.push_back(frame);
+  payload_.insert(payload_.end(), data, data + size);
+}
+
+bool ReplayFileWriter::save(const char* filepath, int64_t durationUs, uint64_t sourceSize,
+                            int64_t sourceMtimeNs) const {
+  ReplayFileHeader header = header_;
+  memcpy(header.magic, kReplayMagic, sizeof(kReplayMagic));
+  header.version = kReplayVersion;
+  header.frameCount = static_cast<uint32_t>(frames_.size());
+  header.frameTableOffset = kReplayHeaderSize;
+  header.payloadOffset =
+      AlignUp(kReplayHeaderSize + frames_.size() * sizeof(ReplayFrame), kPayloadAreaAlignment);
+  header.payloadSize = payload_.size();
+  header.durationUs = durationUs;
+  header.sourceSize = sourceSize;
+  header.sourceMtimeNs = sourceMtimeNs;
+
+  std::vector<ReplayFrame> frames(frames_);
+  for (size_t i = 0; i < frames.size(); ++i) {
+    frames[i].offset += header.payloadOffset;
+  }
+  std::vector<uint8_t> padding(header.payloadOffset - kReplayHeaderSize -
+                               frames.size() * sizeof(ReplayFrame));
+
+  static std::atomic<int> sequence(0);
+  char suffix[64] = {0};
+  snprintf(suffix, sizeof(suffix), ".%d.%d.tmp", getpid(), sequence++);
+  std::string tmpPath = std::string(filepath) + suffix;
+
+  FILE* file = fopen(tmpPath.c_str(), "wb");
+  if (!file) {
+    printf("Open %s for writing failed\n", tmpPath.c_str());
+    return false;
+  }
+  bool written =
+      fwrite(&header, sizeof(header), 1, file) == 1 &&
+      (frames.empty() ||
+       fwrite(frames.data(), sizeof(ReplayFrame), frames.size(), file) == frames.size()) &&
+      (padding.empty() || fwrite(padding.data(), 1, padding.size(), file) == padding.size()) &&
+      (payload_.empty() || fwrite(payload_.data(), 1, payload_.size(), file) == payload_.size());
+  written = (fclose(file) == 0) && written;
+  if (!written || rename(tmpPath.c_str(), filepath) != 0) {
+    printf("Write replay file %s failed\n", filepath);
+    unlink(tmpPath.c_str());
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,156 @@
+//  Agora RTC/MEDIA SDK
+//
+//  Copyright (c) 2020 Agora.io. All rights reserved.
+//
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "mapped_file.h"
+
+// Replay files hold one track of encoded frames exactly as the senders hand
+// them to the SDK, so playing one needs no parsing at all:
+//
+//   ReplayFileHeader    at 0, kReplayHeaderSize bytes
+//   ReplayFrame[]       at |frameTableOffset|, |frameCount| records
+//   payloads            from |payloadOffset| (page aligned), each frame
+//                       starting on a kReplayPayloadAlignment boundary
+//
+// Everything is written and read in host byte order, like the frame index
+// sidecars.
+
+enum class ReplayMediaType : uint32_t {
+  kVideo = 1,
+  kAudio = 2,
+};
+
+struct ReplayFileHeader {
+  char magic[4];
+  uint32_t version;
+  uint32_t mediaType;
+  // agora::rtc::VIDEO_CODEC_TYPE or agora::rtc::AUDIO_CODEC_TYPE.
+  uint32_t codec;
+  uint32_t frameCount;
+  uint32_t reserved0;
+  uint64_t frameTableOffset;
+  uint64_t payloadOffset;
+  uint64_t payloadSize;
+  // Time one pass over the file lasts, i.e. where a loop continues.
+  int64_t durationUs;
+  // Size and mtime of the file the replay file was converted from.
+  uint64_t sourceSize;
+  int64_t sourceMtimeNs;
+
+  // Video only.
+  uint32_t width;
+  uint32_t height;
+  uint32_t frameRateNum;
+  uint32_t frameRateDen;
+
+  // Audio only.
+  uint32_t sampleRateHz;
+  uint32_t numberOfChannels;
+  uint32_t bitsPerSample;
+  uint32_t reserved1[7];
+};
+
+struct ReplayFrame {
+  enum Flags : uint32_t {
+    kKeyFrame = 1,
+    // Audio decoder priming, see AudioFrameView::kPriming.
+    kPriming = 2,
+  };
+
+  // Byte offset of the payload in the replay file.
+  uint64_t offset;
+  uint32_t size;
+  uint32_t flags;
+  // Presentation time relative to the first frame.
+  int64_t ptsUs;
+  uint32_t codec;
+  uint32_t reserved;
+};
+
+const size_t kReplayHeaderSize = 128;
+const size_t kReplayPayloadAlignment = 16;
+
+static_assert(sizeof(ReplayFileHeader) == kReplayHeaderSize, "ReplayFileHeader must stay packed");
+static_assert(sizeof(ReplayFrame) == 32, "ReplayFrame must stay packed");
+
+// Size and mtime of |filepath|, which tell whether a replay file converted
+// from it is still current.
+bool GetReplaySourceVersion(const char* filepath, uint64_t* size, int64_t* mtimeNs);
+
+// A replay file mapped as it is. Opening it only checks the header, the
+// frames are handed out as views into the mapping and checked one by one as
+// they are read, so opening takes the same time for any file and playing
+// allocates nothing.
+class ReplayFile {
+ public:
+  explicit ReplayFile(const char* filepath);
+
+  bool open();
+
+  // True if |filepath| starts with the replay file magic.
+  static bool isReplayFile(const char* filepath);
+  // Where the converter puts the replay file of |filepath| by default. The
+  // media corpus plays it instead of parsing |filepath| while it is current.
+  static std::string sidecarPath(const char* filepath);
+
+  const ReplayFileHeader& header() const { return *header_; }
+  ReplayMediaType mediaType() const { return static_cast<ReplayMediaType>(header_->mediaType); }
+  const char* path() const { return file_.path(); }
+  // True if the file was converted from |filepath| as it is now.
+  bool matchesSource(const char* filepath) const;
+
+  size_t size() const { return header_->frameCount; }
+  const ReplayFrame& frame(size_t i) const { return frames_[i]; }
+  // The payload of frame |i|, nullptr if the frame table points outside the
+  // file.
+  const uint8_t* payload(size_t i) const {
+    const ReplayFrame& f = frames_[i];
+    if (f.offset > file_.size() || f.size > file_.size() - f.offset) {
+      return nullptr;
+    }
+    return file_.data() + f.offset;
+  }
+  // Hints the kernel to read the payload of frame |i| ahead of use.
+  void willNeed(size_t i) const { file_.willNeed(frames_[i].offset, frames_[i].size); }
+
+ private:
+  ReplayFile(const ReplayFile&) = delete;
+  ReplayFile& operator=(const ReplayFile&) = delete;
+
+ private:
+  MappedFile file_;
+  const ReplayFileHeader* header_;
+  const ReplayFrame* frames_;
+};
+
+// Lays out a replay file in memory and writes it in one go.
+class ReplayFileWriter {
+ public:
+  // |header| carries the media type, the codec and the stream properties,
+  // the layout fields are filled in by save().
+  explicit ReplayFileWriter(const ReplayFileHeader& header);
+
+  void addFrame(const uint8_t* data, uint32_t size, int64_t ptsUs, uint32_t flags, uint32_t codec);
+  size_t size() const { return frames_.size(); }
+
+  // Writes the file next to |filepath| and renames it over |filepath|, so
+  // senders never map a half written file.
+  bool save(const char* filepath, int64_t durationUs, uint64_t sourceSize,
+            int64_t sourceMtimeNs) const;
+
+ private:
+  ReplayFileHeader header_;
+  std::vector<ReplayFrame> frames_;
+  // Payloads with their alignment padding, offsets relative to the start of
+  // the payload area.
+  std::vector<uint8_t> payload_;
+};
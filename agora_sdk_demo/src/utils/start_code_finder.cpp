@@ -0,0 +1,148 @@
+//  Agora RTC/MEDIA SDK
+//
+//  Copyright (c) 2020 Agora.io. All rights reserved.
+//
+
+#include "start_code_finder.h"
+
+#include <string.h>
+
+#if defined(AGORA_DEMO_ARCH_X86)
+#include <immintrin.h>
+#endif
+
+typedef const uint8_t* (*FindPatternFunc)(const uint8_t* begin, const uint8_t* end);
+
+// All finders look for "00 00 kThird". If the third byte of a window is
+// neither 0 nor kThird, no match can start in the window, so skip all of it.
+template <uint8_t kThird>
+static const uint8_t* FindPatternScalar(const uint8_t* begin, const uint8_t* end) {
+  const uint8_t* p = begin;
+  while (end - p > 2) {
+    if (p[2] != 0 && p[2] != kThird) {
+      p += 3;
+    } else if (p[2] == kThird && p[1] == 0 && p[0] == 0) {
+      return p;
+    } else {
+      ++p;
+    }
+  }
+  return end;
+}
+
+#if defined(AGORA_DEMO_ARCH_X86)
+template <uint8_t kThird>
+__attribute__((target("sse2"))) static const uint8_t* FindPatternSse2(const uint8_t* begin,
+                                                                       const uint8_t* end) {
+  const __m128i zero = _mm_setzero_si128();
+  const __m128i third = _mm_set1_epi8(static_cast<char>(kThird));
+  const uint8_t* p = begin;
+  // Each iteration tests the 16 windows starting at p..p+15, which reads up to
+  // p[17]. Pairs of zero bytes are rare in slice data, so the third byte is
+  // only compared once a block has one.
+  while (end - p >= 18) {
+    __m128i b0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    __m128i b1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 1));
+    __m128i pairs = _mm_and_si128(_mm_cmpeq_epi8(b0, zero), _mm_cmpeq_epi8(b1, zero));
+    if (_mm_movemask_epi8(pairs)) {
+      __m128i b2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p + 2));
+      int mask = _mm_movemask_epi8(_mm_and_si128(pairs, _mm_cmpeq_epi8(b2, third)));
+      if (mask) {
+        return p + __builtin_ctz(mask);
+      }
+    }
+    p += 16;
+  }
+  return FindPatternScalar<kThird>(p, end);
+}
+
+template <uint8_t kThird>
+__attribute__((target("avx2"))) static const uint8_t* FindPatternAvx2(const uint8_t* begin,
+                                                                       const uint8_t* end) {
+  const __m256i zero = _mm256_setzero_si256();
+  const __m256i third = _mm256_set1_epi8(static_cast<char>(kThird));
+  const uint8_t* p = begin;
+  // Two windows of 32 per iteration. Pairs of zero bytes are rare in slice
+  // data, so the third byte is only compared once a block has one.
+  while (end - p >= 66) {
+    __m256i b0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p));
+    __m256i b1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 1));
+    __m256i b2 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 32));
+    __m256i b3 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 33));
+    __m256i pairs0 = _mm256_and_si256(_mm256_cmpeq_epi8(b0, zero), _mm256_cmpeq_epi8(b1, zero));
+    __m256i pairs1 = _mm256_and_si256(_mm256_cmpeq_epi8(b2, zero), _mm256_cmpeq_epi8(b3, zero));
+    if (!_mm256_testz_si256(_mm256_or_si256(pairs0, pairs1), _mm256_or_si256(pairs0, pairs1))) {
+      __m256i t0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 2));
+      uint32_t mask = static_cast<uint32_t>(
+          _mm256_movemask_epi8(_mm256_and_si256(pairs0, _mm256_cmpeq_epi8(t0, third))));
+      if (mask) {
+        return p + __builtin_ctz(mask);
+      }
+      __m256i t1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(p + 34));
+      mask = static_cast<uint32_t>(
+          _mm256_movemask_epi8(_mm256_and_si256(pairs1, _mm256_cmpeq_epi8(t1, third))));
+      if (mask) {
+        return p + 32 + __builtin_ctz(mask);
+      }
+    }
+    p += 64;
+  }
+  return FindPatternSse2<kThird>(p, end);
+}
+#endif
+
+template <uint8_t kThird>
+static FindPatternFunc SelectFindPattern(SimdLevel level) {
+  switch (ClampSimdLevel(level)) {
+#if defined(AGORA_DEMO_ARCH_X86)
+    case SimdLevel::kAvx2:
+      return FindPatternAvx2<kThird>;
+    case SimdLevel::kSse2:
+      return FindPatternSse2<kThird>;
+#endif
+    default:
+      return FindPatternScalar<kThird>;
+  }
+}
+
+const uint8_t* FindStartCode(const uint8_t* begin, const uint8_t* end) {
+  static const FindPatternFunc find = SelectFindPattern<1>(GetSimdLevel());
+  return find(begin, end);
+}
+
+const uint8_t* FindEmulationPrevention(const uint8_t* begin, const uint8_t* end) {
+  static const FindPatternFunc find = SelectFindPattern<3>(GetSimdLevel());
+  return find(begin, end);
+}
+
+size_t UnescapeRbsp(const uint8_t* data, size_t length, uint8_t* out, size_t capacity) {
+  const uint8_t* p = data;
+  const uint8_t* end = data + length;
+  size_t written = 0;
+  while (p < end && written < capacity) {
+    size_t wanted = capacity - written;
+    // An escape that matters starts within the next |wanted| bytes, so it
+    // ends within |wanted| + 2.
+    const uint8_t* searchEnd = static_cast<size_t>(end - p) > wanted + 2 ? p + wanted + 2 : end;
+    const uint8_t* escape = FindEmulationPrevention(p, searchEnd);
+    // Two rbsp bytes before the emulation byte.
+    const uint8_t* copyEnd = escape == searchEnd ? searchEnd : escape + 2;
+    size_t size = static_cast<size_t>(copyEnd - p) < wanted ? copyEnd - p : wanted;
+    memcpy(out + written, p, size);
+    written += size;
+    if (escape == searchEnd) {
+      break;
+    }
+    p = escape + 3;
+  }
+  return written;
+}
+
+const uint8_t* FindStartCode(const uint8_t* begin, const uint8_t* end, SimdLevel level) {
+  return SelectFindPattern<1>(level)(begin, end);
+}
+
+const uint8_t* FindEmulationPrevention(const uint8_t* begin, const uint8_t* end,
+                                       SimdLevel level) {
+  return SelectFindPattern<3>(level)(begin, end);
+}
@@ -0,0 +1,32 @@
+//  Agora RTC/MEDIA SDK
+//
+//  Copyright (c) 2020 Agora.io. All rights reserved.
+//
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "utils/cpu_features.h"
+
+// Returns the position of the first Annex-B start code "00 00 01" in
+// [begin, end), or |end| if there is none. A four bytes start code is found at
+// its second byte, callers check the byte before to tell them apart.
+const uint8_t* FindStartCode(const uint8_t* begin, const uint8_t* end);
+
+// Returns the position of the first emulation prevention sequence "00 00 03"
+// in [begin, end), or |end| if there is none.
+const uint8_t* FindEmulationPrevention(const uint8_t* begin, const uint8_t* end);
+
+// Copies the NAL unit payload [data, data + length) to |out| without its
+// emulation prevention bytes, stopping once |capacity| bytes are written.
+// Only as much of the payload is scanned as the output needs, so parsing a
+// slice header costs the same for any slice size. Returns the bytes written.
+size_t UnescapeRbsp(const uint8_t* data, size_t length, uint8_t* out, size_t capacity);
+
+// Same as above with an explicit implementation, for tests and benchmarks.
+// Levels the CPU doesn't support fall back to the best supported one.
+const uint8_t* FindStartCode(const uint8_t* begin, const uint8_t* end, SimdLevel level);
+const uint8_t* FindEmulationPrevention(const uint8_t* begin, const uint8_t* end,
+                                       SimdLevel level);
@@ -0,0 +1,82 @@
+//  Agora RTC/MEDIA SDK
+//
+//  Copyright (c) 2020 Agora.io. All rights reserved.
+//
+
+#include "ts_packet_sync.h"
+
+#if defined(AGORA_DEMO_ARCH_X86)
+#include <immintrin.h>
+#endif
+
+typedef size_t (*CountSyncedFunc)(const uint8_t* data, size_t packets);
+
+static size_t CountSyncedScalar(const uint8_t* data, size_t packets) {
+  size_t i = 0;
+  while (i < packets && data[i * kTsPacketSize] == kTsSyncByte) {
+    ++i;
+  }
+  return i;
+}
+
+#if defined(AGORA_DEMO_ARCH_X86)
+// The sync bytes are 188 bytes apart, so they are gathered into one register
+// and compared together.
+__attribute__((target("sse2"))) static size_t CountSyncedSse2(const uint8_t* data,
+                                                              size_t packets) {
+  const __m128i sync = _mm_set1_epi8(static_cast<char>(kTsSyncByte));
+  size_t i = 0;
+  for (; packets - i >= 16; i += 16) {
+    const uint8_t* p = data + i * kTsPacketSize;
+    __m128i bytes = _mm_setr_epi8(p[0], p[188], p[376], p[564], p[752], p[940], p[1128],
+                                  p[1316], p[1504], p[1692], p[1880], p[2068], p[2256],
+                                  p[2444], p[2632], p[2820]);
+    int mask = _mm_movemask_epi8(_mm_cmpeq_epi8(bytes, sync));
+    if (mask != 0xFFFF) {
+      return i + __builtin_ctz(~mask);
+    }
+  }
+  return i + CountSyncedScalar(data + i * kTsPacketSize, packets - i);
+}
+
+__attribute__((target("avx2"))) static size_t CountSyncedAvx2(const uint8_t* data,
+                                                              size_t packets) {
+  const __m256i offsets = _mm256_setr_epi32(0, 188, 376, 564, 752, 940, 1128, 1316);
+  const __m256i lowByte = _mm256_set1_epi32(0xFF);
+  const __m256i sync = _mm256_set1_epi32(kTsSyncByte);
+  size_t i = 0;
+  // The gather loads four bytes from each packet, all inside the packet.
+  for (; packets - i >= 8; i += 8) {
+    const int* p = reinterpret_cast<const int*>(data + i * kTsPacketSize);
+    __m256i words = _mm256_i32gather_epi32(p, offsets, 1);
+    __m256i equal = _mm256_cmpeq_epi32(_mm256_and_si256(words, lowByte), sync);
+    int mask = _mm256_movemask_ps(_mm256_castsi256_ps(equal));
+    if (mask != 0xFF) {
+      return i + __builtin_ctz(~mask);
+    }
+  }
+  return i + CountSyncedScalar(data + i * kTsPacketSize, packets - i);
+}
+#endif
+
+static CountSyncedFunc SelectCountSynced(SimdLevel level) {
+  switch (ClampSimdLevel(level)) {
+#if defined(AGORA_DEMO_ARCH_X86)
+    case SimdLevel::kAvx2:
+      return CountSyncedAvx2;
+    case SimdLevel::kSse2:
+      return CountSyncedSse2;
+#endif
+    default:
+      return CountSyncedScalar;
+  }
+}
+
+size_t CountTsSyncedPackets(const uint8_t* data, size_t packets) {
+  static const CountSyncedFunc count = SelectCountSynced(GetSimdLevel());
+  return count(data, packets);
+}
+
+size_t CountTsSyncedPackets(const uint8_t* data, size_t packets, SimdLevel level) {
+  return SelectCountSynced(level)(data, packets);
+}
@@ -0,0 +1,23 @@
+//  Agora RTC/MEDIA SDK
+//
+//  Copyright (c) 2020 Agora.io. All rights reserved.
+//
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "utils/cpu_features.h"
+
+const size_t kTsPacketSize = 188;
+const uint8_t kTsSyncByte = 0x47;
+
+// Returns how many of the |packets| MPEG-TS packets at |data| in a row start
+// with the sync byte, so a demuxer can validate a whole run up front instead of
+// testing every packet as it goes.
+size_t CountTsSyncedPackets(const uint8_t* data, size_t packets);
+
+// Same as above with an explicit implementation, for tests and benchmarks.
+// Levels the CPU doesn't support fall back to the best supported one.
+size_t CountTsSyncedPackets(const uint8_t* data, size_t packets, SimdLevel level);
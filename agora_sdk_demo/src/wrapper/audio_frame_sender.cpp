@@ -12,6 +12,7 @@
 
 #include "connection_wrapper.h"
 #include "local_user_wrapper.h"
+#include "media_corpus.h"
 #include "utils.h"
 #include "utils/file_parser/audio_file_parser_factory.h"
 
@@ -19,8 +20,31 @@ AudioFrameSender::AudioFrameSender() = default;
 
 AudioFrameSender::~AudioFrameSender() = default;
 
+// Frames a live parser may hold before the writer blocks, 160 ms or more of
+// audio.
+static const int kLiveAudioFrames = 8;
+
 void AudioFrameSender::setVerbose(bool verbose) { verbose_ = verbose; }
 
+void AudioFrameSender::setLiveInput(bool follow) {
+  live_ = true;
+  follow_ = follow;
+}
+
+void AudioFrameSender::setLoops(int loops) { loops_ = loops; }
+
+bool AudioFrameSender::nextFrame(AudioFileParser* parser, AudioFrameView* frame, int* loop) {
+  if (parser->next(frame)) {
+    return true;
+  }
+  // A pass ended, start the next one from the top of the file.
+  if (live_ || (loops_ >= 0 && *loop + 1 >= loops_) || parser->reset() != 0) {
+    return false;
+  }
+  ++*loop;
+  return parser->next(frame);
+}
+
 EncodedAudioFrameSender::EncodedAudioFrameSender(const char* filepath, AUDIO_FILE_TYPE filetype)
     : file_path(filepath), file_type(filetype) {}
 
@@ -39,8 +63,13 @@ bool EncodedAudioFrameSender::initialize(agora::base::IAgoraService* service,
   customAudioTrack->setEnabled(true);
   connection->GetLocalUser()->PublishAudioTrack(customAudioTrack);
 
-  file_parser_ = std::move(
-      AudioFileParserFactory::Instance().createAudioFileParser(file_path.c_str(), file_type));
+  if (live_) {
+    file_parser_ = AudioFileParserFactory::Instance().createLiveAudioFileParser(
+        file_path.c_str(), file_type, follow_, kLiveAudioFrames);
+  } else {
+    corpus_ = MediaCorpus::Instance().acquireAudio(file_path.c_str(), file_type);
+    file_parser_.reset(new MediaCorpusAudioParser(corpus_));
+  }
   if (!file_parser_ || !file_parser_->open()) {
     printf("Open test file %s failed\n", file_path.c_str());
     return false;
@@ -49,9 +78,40 @@ bool EncodedAudioFrameSender::initialize(agora::base::IAgoraService* service,
   return true;
 }
 
+bool EncodedAudioFrameSender::nextPacket(AudioFrameView* packet, int* loop) {
+  if (!nextFrame(file_parser_.get(), packet, loop)) {
+    return false;
+  }
+  if (packet_frames_ <= 1) {
+    return true;
+  }
+  // The frames of the corpus lie back to back, so a packet is a view across
+  // them. Frames from elsewhere, or around the end of a loop, are copied.
+  bool joined = file_parser_->viewsStayValid();
+  if (!joined) {
+    packet_.assign(packet->data, packet->data + packet->size);
+  }
+  AudioFrameView frame;
+  for (int i = 1; i < packet_frames_ && nextFrame(file_parser_.get(), &frame, loop); ++i) {
+    if (joined && frame.data != packet->data + packet->size) {
+      packet_.assign(packet->data, packet->data + packet->size);
+      joined = false;
+    }
+    if (joined) {
+      packet->size += frame.size;
+    } else {
+      packet_.insert(packet_.end(), frame.data, frame.data + frame.size);
+    }
+    packet->durationSamples += frame.durationSamples;
+  }
+  if (!joined) {
+    packet->data = packet_.data();
+    packet->size = packet_.size();
+  }
+  return true;
+}
+
 void EncodedAudioFrameSender::sendAudioFrames() {
-  uint8_t databuf[8192] = {0};
-  int length = 8192;
   int bytesnum = 0;
   agora::rtc::EncodedAudioFrameInfo audioFrameInfo;
   audioFrameInfo.numberOfChannels = file_parser_->getNumberOfChannels();
@@ -60,36 +120,43 @@ void EncodedAudioFrameSender::sendAudioFrames() {
 
   AGO_LOG("sendAudio numberOfChannels %d, sampleRateHz %d, codec %d\n",
           audioFrameInfo.numberOfChannels, audioFrameInfo.sampleRateHz, audioFrameInfo.codec);
+  if (audioFrameInfo.sampleRateHz <= 0) {
+    AGO_LOG("Unknown sample rate, nothing to pace the frames by\n");
+    return;
+  }
 
-  int sentFrames = -1;
+  // Every frame is due when the samples sent before it have played, counted
+  // from the start so that rounding never accumulates. The frames are views
+  // into the corpus and go to the SDK without a copy.
+  int64_t sentSamples = 0;
   auto startTime = std::chrono::steady_clock::now();
-  while (file_parser_->hasNext()) {
-    length = 8192;
-    file_parser_->getNext(reinterpret_cast<char*>(databuf), &length);
-    if (length > 0) {
-      bool ret =
-          audio_encoded_frame_sender_->sendEncodedAudioFrame(databuf, length, audioFrameInfo);
-      if (!ret) {
-        break;
-      }
+  AudioFrameView frame;
+  int loop = 0;
+  while (nextPacket(&frame, &loop)) {
+    if (frame.size == 0) {
+      continue;
+    }
+    audioFrameInfo.samplesPerChannel = frame.durationSamples;
+    bool ret = audio_encoded_frame_sender_->sendEncodedAudioFrame(frame.data, frame.size,
+                                                                  audioFrameInfo);
+    if (!ret) {
+      break;
+    }
 #if 0
-      if (sentNumAudioFrames_ < 5) {
-        dumpByteArray(buffer, length);
-      }
+    if (sentNumAudioFrames_ < 5) {
+      dumpByteArray(frame.data, frame.size);
+    }
 #endif
-      bytesnum += length;
-      ++sent_audio_frames_;
-      sentFrames++;
-      auto sendFrameEndTime = std::chrono::steady_clock::now();
-      int durationInMs = (sentFrames * 10) + 10;
-
-      signed int diff = durationInMs - std::chrono::duration_cast<std::chrono::milliseconds>(
-                                           sendFrameEndTime - startTime)
-                                           .count();
-      if (diff > 0) {
-        std::this_thread::sleep_for(std::chrono::milliseconds(diff));
-      }
+    bytesnum += frame.size;
+    ++sent_audio_frames_;
+    if (live_) {
+      continue;
     }
+    sentSamples += frame.durationSamples > 0 ? frame.durationSamples
+                                             : audioFrameInfo.sampleRateHz / 100;
+    std::this_thread::sleep_until(
+        startTime +
+        std::chrono::microseconds(sentSamples * 1000000 / audioFrameInfo.sampleRateHz));
   }
   if (verbose_) {
     AGO_LOG("Send %ld test aac frames end, %d bytes\n", sent_audio_frames_, bytesnum);
@@ -112,10 +179,19 @@ bool AudioPcmFrameSender::initialize(agora::base::IAgoraService* service,
   auto customAudioTrack = service->createCustomAudioTrack(audio_pcm_frame_ender_);
   customAudioTrack->setEnabled(true);
   connection->GetLocalUser()->PublishAudioTrack(customAudioTrack);
+  return open(audio_pcm_frame_ender_);
+}
 
-  file_parser_ = AudioFileParserFactory::Instance().createAudioFileParser(
-      file_path.c_str(), AUDIO_FILE_TYPE::AUDIO_FILE_PCM);
-  ;
+bool AudioPcmFrameSender::open(agora::agora_refptr<agora::rtc::IAudioPcmDataSender> sender) {
+  audio_pcm_frame_ender_ = sender;
+  if (live_) {
+    file_parser_ = AudioFileParserFactory::Instance().createLiveAudioFileParser(
+        file_path.c_str(), AUDIO_FILE_TYPE::AUDIO_FILE_PCM, follow_, kLiveAudioFrames);
+  } else {
+    corpus_ = MediaCorpus::Instance().acquireAudio(file_path.c_str(),
+                                                   AUDIO_FILE_TYPE::AUDIO_FILE_PCM);
+    file_parser_.reset(new MediaCorpusAudioParser(corpus_));
+  }
   if (!file_parser_ || !file_parser_->open()) {
     printf("Open test file %s failed\n", file_path.c_str());
     return false;
@@ -125,22 +201,36 @@ bool AudioPcmFrameSender::initialize(agora::base::IAgoraService* service,
 
 void AudioPcmFrameSender::sendAudioFrames() {
   const int loop_time_ms = -1;
-  static constexpr int BufferSize = 4096;
-  int samples_per_loop = file_parser_->getSampleRateHz() / 100;
+  int sample_rate = file_parser_->getSampleRateHz();
   int sample_size = file_parser_->getNumberOfChannels() * file_parser_->getBitsPerSample() / 8;
+  if (sample_rate <= 0 || sample_size <= 0) {
+    return;
+  }
 
-  unsigned char dataBuffer[BufferSize] = {0};
-  int length = 0;
-  int frames = 0;
-
+  int64_t sent_samples = 0;
   auto start_time = now_ms();
-  while (file_parser_->hasNext()) {
-    file_parser_->getNext(reinterpret_cast<char*>(dataBuffer), &length);
+  auto start_clock = std::chrono::steady_clock::now();
+  AudioFrameView frame;
+  int loop = 0;
+  while (nextFrame(file_parser_.get(), &frame, &loop)) {
     auto overhead_begin = now_ms();
     if ((loop_time_ms != -1) && (overhead_begin - start_time) >= loop_time_ms) break;
-    audio_pcm_frame_ender_->sendAudioPcmData(dataBuffer, 0, samples_per_loop, sample_size,
-                                             file_parser_->getNumberOfChannels(),
-                                             file_parser_->getSampleRateHz());
-    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+    int samples_per_loop = frame.durationSamples > 0
+                               ? static_cast<int>(frame.durationSamples)
+                               : static_cast<int>(frame.size) / sample_size;
+    if (samples_per_loop <= 0) {
+      continue;
+    }
+    // The capture time counts the samples sent, across loops too.
+    uint32_t capture_timestamp = static_cast<uint32_t>(sent_samples * 1000 / sample_rate);
+    audio_pcm_frame_ender_->sendAudioPcmData(frame.data, capture_timestamp, samples_per_loop,
+                                             sample_size, file_parser_->getNumberOfChannels(),
+                                             sample_rate);
+    sent_samples += samples_per_loop;
+    if (live_) {
+      continue;
+    }
+    std::this_thread::sleep_until(
+        start_clock + std::chrono::microseconds(sent_samples * 1000000 / sample_rate));
   }
 }
@@ -7,6 +7,7 @@
 #pragma once
 
 #include <string>
+#include <vector>
 
 #include "api2/IAgoraService.h"
 #include "api2/NGIAgoraMediaNodeFactory.h"
@@ -14,6 +15,7 @@
 
 class AudioFileParser;
 class ConnectionWrapper;
+class MediaCorpusAudio;
 
 class AudioFrameSender {
  public:
@@ -27,9 +29,26 @@ class AudioFrameSender {
   virtual void sendAudioFrames() = 0;
 
   void setVerbose(bool verbose);
+  // Reads the file live instead of from the media corpus, see
+  // AudioFileParserFactory::createLiveAudioFileParser(), and sends every
+  // frame the moment it arrives. The writer sets the pace. Call before
+  // initialize().
+  void setLiveInput(bool follow);
+  // Plays the file |loops| times back to back on one timeline, forever if
+  // negative. The parser rewinds in place and the pacing clock runs on, so
+  // receivers see one unbroken stream. Live input plays once.
+  void setLoops(int loops);
+
+ protected:
+  // Like |parser|->next(), but wraps around at the end of a pass while loops
+  // are left. |loop| counts the passes.
+  bool nextFrame(AudioFileParser* parser, AudioFrameView* frame, int* loop);
 
  protected:
   bool verbose_{false};
+  bool live_{false};
+  bool follow_{false};
+  int loops_{1};
 };
 
 class EncodedAudioFrameSender : public AudioFrameSender {
@@ -44,9 +63,23 @@ class EncodedAudioFrameSender : public AudioFrameSender {
 
   void sendAudioFrames() override;
 
+  // Sends |frames| frames of the file per packet, e.g. 2 for 20 ms of G.711.
+  // Only for formats whose frames may be joined, such as G.711.
+  void setPacketFrames(int frames) { packet_frames_ = frames; }
+
+  // The shared file being played, which stays loaded while held.
+  std::shared_ptr<const MediaCorpusAudio> corpus() const { return corpus_; }
+
+ private:
+  // Like nextFrame(), but joins |packet_frames_| frames into |packet|.
+  bool nextPacket(AudioFrameView* packet, int* loop);
+
  private:
   std::string file_path;
   AUDIO_FILE_TYPE file_type;
+  int packet_frames_{1};
+  std::vector<uint8_t> packet_;
+  std::shared_ptr<const MediaCorpusAudio> corpus_;
   agora::agora_refptr<agora::rtc::IAudioEncodedFrameSender> audio_encoded_frame_sender_;
   std::unique_ptr<AudioFileParser> file_parser_;
   int64_t sent_audio_frames_{0};
@@ -64,8 +97,15 @@ class AudioPcmFrameSender : public AudioFrameSender {
 
   void sendAudioFrames() override;
 
+  // Opens the file and sends it through |sender|. initialize() calls it once
+  // the track is published.
+  bool open(agora::agora_refptr<agora::rtc::IAudioPcmDataSender> sender);
+
+  std::shared_ptr<const MediaCorpusAudio> corpus() const { return corpus_; }
+
  private:
   std::string file_path;
+  std::shared_ptr<const MediaCorpusAudio> corpus_;
   std::unique_ptr<AudioFileParser> file_parser_;
   agora::agora_refptr<agora::rtc::IAudioPcmDataSender> audio_pcm_frame_ender_;
   int64_t sent_audio_frames_{0};
@@ -0,0 +1,142 @@
+//  Agora RTC/MEDIA SDK
+//
+//  Copyright (c) 2020 Agora.io. All rights reserved.
+//
+
+#include "container_file_sender.h"
+
+#include <stdint.h>
+#include <stdio.h>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+
+#include "connection_wrapper.h"
+#include "local_user_wrapper.h"
+#include "utils.h"
+#include "utils/file_parser/container_demuxer.h"
+
+ContainerFileSender::ContainerFileSender(const char* filepath, bool sendAudio, bool sendVideo)
+    : file_path_(filepath), send_audio_(sendAudio), send_video_(sendVideo) {}
+
+ContainerFileSender::~ContainerFileSender() = default;
+
+bool ContainerFileSender::initialize(agora::base::IAgoraService* service,
+                                     agora::agora_refptr<agora::rtc::IMediaNodeFactory> factory,
+                                     std::shared_ptr<ConnectionWrapper> connection) {
+  demuxer_ = ContainerDemuxer::create(file_path_.c_str());
+  if (!demuxer_ || !demuxer_->open()) {
+    printf("Open test file %s failed\n", file_path_.c_str());
+    demuxer_.reset();
+    return false;
+  }
+  const std::vector<ContainerTrack>& tracks = demuxer_->tracks();
+  for (size_t i = 0; i < tracks.size(); ++i) {
+    if (tracks[i].type == ContainerTrack::kVideo && video_track_ < 0 && send_video_) {
+      video_track_ = static_cast<int>(i);
+    } else if (tracks[i].type == ContainerTrack::kAudio && audio_track_ < 0 && send_audio_) {
+      audio_track_ = static_cast<int>(i);
+    }
+  }
+
+  if (video_track_ >= 0) {
+    video_encoded_image_sender_ = factory->createVideoEncodedImageSender();
+    if (!video_encoded_image_sender_) {
+      return false;
+    }
+    auto customVideoTrack = service->createCustomVideoTrack(video_encoded_image_sender_, false,
+                                                            agora::base::CC_DISABLED);
+    connection->GetLocalUser()->PublishVideoTrack(customVideoTrack);
+  }
+  if (audio_track_ >= 0) {
+    audio_encoded_frame_sender_ = factory->createAudioEncodedFrameSender();
+    if (!audio_encoded_frame_sender_) {
+      printf("Create audio encoded frame sender failed\n");
+      return false;
+    }
+    auto customAudioTrack =
+        service->createCustomAudioTrack(audio_encoded_frame_sender_, agora::base::MIX_DISABLED);
+    customAudioTrack->setEnabled(true);
+    connection->GetLocalUser()->PublishAudioTrack(customAudioTrack);
+  }
+  printf("Open test file %s successfully, video track %d, audio track %d\n", file_path_.c_str(),
+         video_track_, audio_track_);
+  return video_track_ >= 0 || audio_track_ >= 0;
+}
+
+void ContainerFileSender::sendFrames() {
+  if (!demuxer_) {
+    return;
+  }
+  agora::rtc::EncodedVideoFrameInfo videoFrameInfo;
+  agora::rtc::EncodedAudioFrameInfo audioFrameInfo;
+  if (video_track_ >= 0) {
+    const ContainerTrack& track = demuxer_->tracks()[video_track_];
+    videoFrameInfo.codecType = track.videoCodec;
+    videoFrameInfo.width = track.width;
+    videoFrameInfo.height = track.height;
+    videoFrameInfo.rotation = agora::rtc::VIDEO_ORIENTATION_0;
+    videoFrameInfo.packetizationMode = agora::rtc::NonInterleaved;
+  }
+  if (audio_track_ >= 0) {
+    const ContainerTrack& track = demuxer_->tracks()[audio_track_];
+    audioFrameInfo.codec = track.audioCodec;
+    audioFrameInfo.sampleRateHz = track.sampleRateHz;
+    audioFrameInfo.numberOfChannels = track.numberOfChannels;
+  }
+
+  // Samples go out on an absolute clock, so time spent sending doesn't add up.
+  // A new pass continues the clock where the last one ended: after its last
+  // sample plus the gap that sample had to the one before on its track.
+  auto startTime = std::chrono::steady_clock::now();
+  bool started = false;
+  int64_t firstDtsUs = 0;
+  int64_t loopOffsetUs = 0;
+  int64_t passEndUs = 0;
+  int64_t lastDtsUs[2] = {INT64_MIN, INT64_MIN};
+  int videoFrames = 0;
+  int audioFrames = 0;
+  int loop = 0;
+  ContainerSample sample;
+  while (true) {
+    if (!demuxer_->getNext(&sample)) {
+      if (!started || (loops_ >= 0 && loop + 1 >= loops_) || demuxer_->reset() != 0) {
+        break;
+      }
+      ++loop;
+      loopOffsetUs += passEndUs;
+      passEndUs = 0;
+      lastDtsUs[0] = lastDtsUs[1] = INT64_MIN;
+      continue;
+    }
+    if (sample.track != video_track_ && sample.track != audio_track_) {
+      continue;
+    }
+    if (!started) {
+      firstDtsUs = sample.dtsUs;
+      started = true;
+    }
+    int64_t& lastDts = lastDtsUs[sample.track == video_track_ ? 0 : 1];
+    int64_t sampleDtsUs = sample.dtsUs - firstDtsUs;
+    int64_t gapUs = lastDts != INT64_MIN ? sample.dtsUs - lastDts : 0;
+    lastDts = sample.dtsUs;
+    passEndUs = std::max(passEndUs, sampleDtsUs + gapUs);
+    std::this_thread::sleep_until(startTime +
+                                  std::chrono::microseconds(loopOffsetUs + sampleDtsUs));
+    if (sample.track == video_track_) {
+      videoFrameInfo.frameType = sample.keyFrame ? agora::rtc::VIDEO_FRAME_TYPE_KEY_FRAME
+                                                 : agora::rtc::VIDEO_FRAME_TYPE_DELTA_FRAME;
+      video_encoded_image_sender_->sendEncodedVideoImage(sample.data, sample.length,
+                                                         videoFrameInfo);
+      ++videoFrames;
+    } else {
+      if (!audio_encoded_frame_sender_->sendEncodedAudioFrame(sample.data, sample.length,
+                                                              audioFrameInfo)) {
+        break;
+      }
+      ++audioFrames;
+    }
+  }
+  AGO_LOG("Send %s end, %d video frames, %d audio frames\n", file_path_.c_str(), videoFrames,
+          audioFrames);
+}
@@ -0,0 +1,45 @@
+//  Agora RTC/MEDIA SDK
+//
+//  Copyright (c) 2020 Agora.io. All rights reserved.
+//
+
+#pragma once
+
+#include <memory>
+#include <string>
+
+#include "api2/IAgoraService.h"
+#include "api2/NGIAgoraMediaNodeFactory.h"
+
+class ConnectionWrapper;
+class ContainerDemuxer;
+
+// Sends the first video and the first audio track of a container file, e.g.
+// an MP4, paced together by the decode times the file gives them.
+class ContainerFileSender {
+ public:
+  ContainerFileSender(const char* filepath, bool sendAudio, bool sendVideo);
+  virtual ~ContainerFileSender();
+
+  bool initialize(agora::base::IAgoraService* service,
+                  agora::agora_refptr<agora::rtc::IMediaNodeFactory> factory,
+                  std::shared_ptr<ConnectionWrapper> connection);
+
+  // Plays the file |loops| times back to back, forever if negative. Every
+  // pass is shifted to start where the one before ended.
+  void setLoops(int loops) { loops_ = loops; }
+
+  void sendFrames();
+
+ private:
+  std::string file_path_;
+  bool send_audio_;
+  bool send_video_;
+  std::unique_ptr<ContainerDemuxer> demuxer_;
+  // Indexes into the demuxer's tracks, -1 if not sent.
+  int audio_track_{-1};
+  int video_track_{-1};
+  int loops_{1};
+  agora::agora_refptr<agora::rtc::IVideoEncodedImageSender> video_encoded_image_sender_;
+  agora::agora_refptr<agora::rtc::IAudioEncodedFrameSender> audio_encoded_frame_sender_;
+};
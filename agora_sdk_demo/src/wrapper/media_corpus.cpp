@@ -0,0 +1,394 @@
+//  Agora RTC/MEDIA SDK
+//
+//  Copyright (c) 2020 Agora.io. All rights reserved.
+//
+
+#include "media_corpus.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <algorithm>
+
+#include "utils/file_parser/ivf_file_parser.h"
+#include "utils/mapped_file.h"
+#include "video_frame_sender.h"
+
+namespace {
+
+std::string SlotKey(const char* filepath, int format) {
+  return std::string(filepath) + "#" + std::to_string(format);
+}
+
+agora::rtc::VIDEO_CODEC_TYPE VideoCodecType(VideoFileFormat format, uint32_t fourcc) {
+  switch (format) {
+    case VideoFileFormat::kH264AnnexB:
+      return agora::rtc::VIDEO_CODEC_H264;
+    case VideoFileFormat::kH265AnnexB:
+      return agora::rtc::VIDEO_CODEC_H265;
+    case VideoFileFormat::kAv1Obu:
+      return kVideoCodecAv1;
+    case VideoFileFormat::kIvf:
+      break;
+  }
+  if (fourcc == IvfFourcc('V', 'P', '9', '0')) {
+    return agora::rtc::VIDEO_CODEC_VP9;
+  } else if (fourcc == IvfFourcc('H', '2', '6', '4')) {
+    return agora::rtc::VIDEO_CODEC_H264;
+  } else if (fourcc == IvfFourcc('A', 'V', '0', '1')) {
+    return kVideoCodecAv1;
+  }
+  return agora::rtc::VIDEO_CODEC_VP8;
+}
+
+// Opens |filepath| itself if it is a replay file, otherwise the replay file
+// converted from it as long as that is current. Returns nullptr if there is
+// none and the file has to be parsed.
+std::unique_ptr<ReplayFile> OpenReplayFile(const char* filepath, ReplayMediaType mediaType) {
+  bool isSidecar = !ReplayFile::isReplayFile(filepath);
+  std::string path = isSidecar ? ReplayFile::sidecarPath(filepath) : filepath;
+  if (isSidecar && !ReplayFile::isReplayFile(path.c_str())) {
+    return nullptr;
+  }
+  std::unique_ptr<ReplayFile> replay(new ReplayFile(path.c_str()));
+  if (!replay->open()) {
+    return nullptr;
+  }
+  if (isSidecar && !replay->matchesSource(filepath)) {
+    printf("Replay file %s is out of date, parse %s instead\n", path.c_str(), filepath);
+    return nullptr;
+  }
+  if (replay->mediaType() != mediaType) {
+    printf("Replay file %s holds another media type\n", path.c_str());
+    return nullptr;
+  }
+  return replay;
+}
+
+}  // namespace
+
+bool MediaCorpusAudio::load(const char* filepath, AUDIO_FILE_TYPE filetype) {
+  // Validation compares against a decode of the original file, and a replay
+  // of a WAV file holds PCM, not the G.711 it is encoded to.
+  if (filetype != AUDIO_FILE_TYPE::AUDIO_FILE_OPUS_VALIDATE &&
+      filetype != AUDIO_FILE_TYPE::AUDIO_FILE_PCMU &&
+      filetype != AUDIO_FILE_TYPE::AUDIO_FILE_PCMA) {
+    replay_ = OpenReplayFile(filepath, ReplayMediaType::kAudio);
+  }
+  if (replay_) {
+    const ReplayFileHeader& header = replay_->header();
+    path_ = filepath;
+    codecType_ = static_cast<agora::rtc::AUDIO_CODEC_TYPE>(header.codec);
+    sampleRateHz_ = header.sampleRateHz;
+    numberOfChannels_ = header.numberOfChannels;
+    bitsPerSample_ = header.bitsPerSample;
+    return replay_->size() > 0;
+  }
+
+  std::unique_ptr<AudioFileParser> parser =
+      AudioFileParserFactory::Instance().createAudioFileParser(filepath, filetype);
+  if (!parser || !parser->open()) {
+    return false;
+  }
+  path_ = filepath;
+  codecType_ = parser->getCodecType();
+  sampleRateHz_ = parser->getSampleRateHz();
+  numberOfChannels_ = parser->getNumberOfChannels();
+  bitsPerSample_ = parser->getBitsPerSample();
+
+  AudioFrameView view;
+  while (parser->next(&view)) {
+    Frame frame = {data_.size(), static_cast<int>(view.size),
+                   static_cast<int>(view.durationSamples), view.ptsUs, view.flags};
+    frames_.push_back(frame);
+    data_.insert(data_.end(), view.data, view.data + view.size);
+  }
+  data_.shrink_to_fit();
+  frames_.shrink_to_fit();
+  return !frames_.empty();
+}
+
+uint32_t MediaCorpusAudio::frameFlags(size_t i) const {
+  if (!replay_) {
+    return frames_[i].flags;
+  }
+  return (replay_->frame(i).flags & ReplayFrame::kPriming) != 0 ? AudioFrameView::kPriming : 0;
+}
+
+int MediaCorpusAudio::frameSamples(size_t i) const {
+  if (!replay_) {
+    return frames_[i].samples;
+  }
+  // Replay files time frames by their first sample, rounded down to the
+  // microsecond, which rounds back to that sample for any audio rate.
+  int64_t endUs = i + 1 < replay_->size() ? replay_->frame(i + 1).ptsUs
+                                          : replay_->header().durationUs;
+  auto samplePosition = [this](int64_t us) {
+    return (us * sampleRateHz_ + 500000) / 1000000;
+  };
+  return static_cast<int>(samplePosition(endUs) - samplePosition(replay_->frame(i).ptsUs));
+}
+
+bool MediaCorpusVideo::load(const char* filepath, VideoFileFormat format) {
+  replay_ = OpenReplayFile(filepath, ReplayMediaType::kVideo);
+  if (replay_) {
+    path_ = filepath;
+    codecType_ = static_cast<agora::rtc::VIDEO_CODEC_TYPE>(replay_->header().codec);
+    return true;
+  }
+
+  index_ = VideoFrameIndex::loadOrBuild(filepath, format);
+  file_.reset(new MappedFile(filepath));
+  if (!index_ || !file_->open(MappedFile::kAdviceSequential)) {
+    return false;
+  }
+  path_ = filepath;
+  codecType_ = VideoCodecType(format, index_->codecFourcc());
+  return true;
+}
+
+int MediaCorpusVideo::width() const {
+  return replay_ ? static_cast<int>(replay_->header().width) : index_->width();
+}
+
+int MediaCorpusVideo::height() const {
+  return replay_ ? static_cast<int>(replay_->header().height) : index_->height();
+}
+
+int MediaCorpusVideo::framesPerSecond() const {
+  if (!replay_) {
+    return index_->framesPerSecond();
+  }
+  const ReplayFileHeader& header = replay_->header();
+  if (header.frameRateDen == 0) {
+    return 0;
+  }
+  return (header.frameRateNum + header.frameRateDen / 2) / header.frameRateDen;
+}
+
+int64_t MediaCorpusVideo::durationUs() const {
+  return replay_ ? replay_->header().durationUs : index_->durationUs();
+}
+
+size_t MediaCorpusVideo::bytes() const {
+  return replay_ ? replay_->header().payloadSize : file_->size();
+}
+
+const uint8_t* MediaCorpusVideo::frameData(size_t i) const {
+  if (replay_) {
+    return replay_->payload(i);
+  }
+  const VideoFrameIndexEntry& frame = (*index_)[i];
+  if (frame.offset + frame.length > file_->size()) {
+    return nullptr;
+  }
+  return file_->data() + frame.offset;
+}
+
+void MediaCorpusVideo::willNeed(size_t i) const {
+  if (replay_) {
+    replay_->willNeed(i);
+    return;
+  }
+  const VideoFrameIndexEntry& frame = (*index_)[i];
+  file_->willNeed(frame.offset, frame.length);
+}
+
+MediaCorpus& MediaCorpus::Instance() {
+  static MediaCorpus corpus;
+  return corpus;
+}
+
+template <typename T, typename Format>
+std::shared_ptr<const T> MediaCorpus::acquire(SlotMap<T>* slots, const char* filepath,
+                                              Format format) {
+  std::shared_ptr<Slot<T>> slot;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    std::shared_ptr<Slot<T>>& entry = (*slots)[SlotKey(filepath, static_cast<int>(format))];
+    if (!entry) {
+      entry = std::make_shared<Slot<T>>();
+    }
+    slot = entry;
+  }
+
+  // Only the loads of the same file wait for each other.
+  std::lock_guard<std::mutex> lock(slot->mutex);
+  std::shared_ptr<const T> file = slot->file.lock();
+  if (file) {
+    return file;
+  }
+  std::shared_ptr<T> loaded(new T());
+  if (!loaded->load(filepath, format)) {
+    printf("Load test file %s into the media corpus failed\n", filepath);
+    return nullptr;
+  }
+  slot->file = loaded;
+  return loaded;
+}
+
+std::shared_ptr<const MediaCorpusAudio> MediaCorpus::acquireAudio(const char* filepath,
+                                                                  AUDIO_FILE_TYPE filetype) {
+  return acquire(&audioSlots_, filepath, filetype);
+}
+
+std::shared_ptr<const MediaCorpusVideo> MediaCorpus::acquireVideo(const char* filepath,
+                                                                  VideoFileFormat format) {
+  return acquire(&videoSlots_, filepath, format);
+}
+
+MediaCorpusPreloader::MediaCorpusPreloader(int threads) : threads_(threads) {
+  if (threads_ <= 0) {
+    threads_ = static_cast<int>(std::thread::hardware_concurrency());
+  }
+  if (threads_ <= 0) {
+    threads_ = 1;
+  }
+}
+
+MediaCorpusPreloader::~MediaCorpusPreloader() { wait(); }
+
+void MediaCorpusPreloader::add(const std::string& filepath, bool video, int format) {
+  if (!workers_.empty()) {
+    return;
+  }
+  for (const Item& item : items_) {
+    if (item.path == filepath && item.video == video && item.format == format) {
+      return;
+    }
+  }
+  items_.push_back(Item{filepath, video, format});
+}
+
+void MediaCorpusPreloader::addAudio(const std::string& filepath, AUDIO_FILE_TYPE filetype) {
+  add(filepath, false, static_cast<int>(filetype));
+}
+
+void MediaCorpusPreloader::addVideo(const std::string& filepath, VideoFileFormat format) {
+  add(filepath, true, static_cast<int>(format));
+}
+
+void MediaCorpusPreloader::start() {
+  if (!workers_.empty() || items_.empty()) {
+    return;
+  }
+  printf("Preload %zu test files on %d threads\n", items_.size(),
+         std::min(threads_, static_cast<int>(items_.size())));
+  startTime_ = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < items_.size() && i < static_cast<size_t>(threads_); ++i) {
+    workers_.emplace_back(&MediaCorpusPreloader::run, this);
+  }
+}
+
+void MediaCorpusPreloader::run() {
+  // Each worker takes the next file nobody has taken yet.
+  for (size_t i = next_++; i < items_.size(); i = next_++) {
+    const Item& item = items_[i];
+    std::shared_ptr<const MediaCorpusAudio> audio;
+    std::shared_ptr<const MediaCorpusVideo> video;
+    if (item.video) {
+      video = MediaCorpus::Instance().acquireVideo(item.path.c_str(),
+                                                   static_cast<VideoFileFormat>(item.format));
+    } else {
+      audio = MediaCorpus::Instance().acquireAudio(item.path.c_str(),
+                                                   static_cast<AUDIO_FILE_TYPE>(item.format));
+    }
+    bool ok = audio || video;
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (audio) {
+      audio_.push_back(std::move(audio));
+    }
+    if (video) {
+      video_.push_back(std::move(video));
+    }
+    ++done_;
+    failed_ += ok ? 0 : 1;
+    long long elapsedMs = std::chrono::duration_cast<std::chrono::milliseconds>(
+                              std::chrono::steady_clock::now() - startTime_)
+                              .count();
+    printf("Preloaded %zu/%zu %s%s after %lld ms\n", done_, items_.size(), item.path.c_str(),
+           ok ? "" : " failed", elapsedMs);
+  }
+}
+
+size_t MediaCorpusPreloader::wait() {
+  for (std::thread& worker : workers_) {
+    if (worker.joinable()) {
+      worker.join();
+    }
+  }
+  std::lock_guard<std::mutex> lock(mutex_);
+  return failed_;
+}
+
+MediaCorpusAudioParser::MediaCorpusAudioParser(std::shared_ptr<const MediaCorpusAudio> corpus)
+    : corpus_(std::move(corpus)), next_(0) {}
+
+bool MediaCorpusAudioParser::open() {
+  next_ = 0;
+  return corpus_ != nullptr;
+}
+
+bool MediaCorpusAudioParser::hasNext() { return corpus_ && next_ < corpus_->size(); }
+
+bool MediaCorpusAudioParser::getNext(const uint8_t** data, int* length) {
+  if (!hasNext()) {
+    *length = 0;
+    return false;
+  }
+  *data = corpus_->frameData(next_);
+  *length = corpus_->frameLength(next_);
+  if (!*data) {
+    printf("Frame %zu of %s lies outside the file\n", next_, corpus_->path().c_str());
+    // Damaged, stop playing it.
+    next_ = corpus_->size();
+    *length = 0;
+    return false;
+  }
+  ++next_;
+  return true;
+}
+
+void MediaCorpusAudioParser::getNext(char* buffer, int* length) {
+  const uint8_t* data = nullptr;
+  int size = 0;
+  if (!getNext(&data, &size) || size > *length) {
+    *length = 0;
+    return;
+  }
+  memcpy(buffer, data, size);
+  *length = size;
+}
+
+agora::rtc::AUDIO_CODEC_TYPE MediaCorpusAudioParser::getCodecType() {
+  return corpus_->codecType();
+}
+
+int MediaCorpusAudioParser::getSampleRateHz() { return corpus_->sampleRateHz(); }
+
+int MediaCorpusAudioParser::getNumberOfChannels() { return corpus_->numberOfChannels(); }
+
+int MediaCorpusAudioParser::getBitsPerSample() { return corpus_->bitsPerSample(); }
+
+int MediaCorpusAudioParser::getFrameSamples() {
+  return next_ > 0 ? corpus_->frameSamples(next_ - 1) : 0;
+}
+
+int MediaCorpusAudioParser::reset() {
+  next_ = 0;
+  return 0;
+}
+
+bool MediaCorpusAudioParser::next(AudioFrameView* frame) {
+  const uint8_t* data = nullptr;
+  int length = 0;
+  if (!getNext(&data, &length)) {
+    return false;
+  }
+  frame->data = data;
+  frame->size = length;
+  frame->ptsUs = corpus_->framePtsUs(next_ - 1);
+  frame->durationSamples = corpus_->frameSamples(next_ - 1);
+  frame->flags = corpus_->frameFlags(next_ - 1);
+  return true;
+}
@@ -0,0 +1,229 @@
+//  Agora RTC/MEDIA SDK
+//
+//  Copyright (c) 2020 Agora.io. All rights reserved.
+//
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "utils/file_parser/audio_file_parser_factory.h"
+#include "utils/replay_file.h"
+#include "video_frame_index.h"
+
+class MappedFile;
+
+// An audio file split into frames once by its AudioFileParser. The frames sit
+// back to back in one buffer and never change after loading. Replay files are
+// mapped and played as they are instead.
+class MediaCorpusAudio {
+ public:
+  const std::string& path() const { return path_; }
+  agora::rtc::AUDIO_CODEC_TYPE codecType() const { return codecType_; }
+  int sampleRateHz() const { return sampleRateHz_; }
+  int numberOfChannels() const { return numberOfChannels_; }
+  int bitsPerSample() const { return bitsPerSample_; }
+
+  size_t size() const { return replay_ ? replay_->size() : frames_.size(); }
+  // nullptr if a replay file is damaged.
+  const uint8_t* frameData(size_t i) const {
+    return replay_ ? replay_->payload(i) : data_.data() + frames_[i].offset;
+  }
+  int frameLength(size_t i) const {
+    return replay_ ? static_cast<int>(replay_->frame(i).size) : frames_[i].length;
+  }
+  // Samples per channel in frame |i|, 0 if unknown.
+  int frameSamples(size_t i) const;
+  // Presentation time of frame |i| as the parser or the replay file gave it.
+  int64_t framePtsUs(size_t i) const {
+    return replay_ ? replay_->frame(i).ptsUs : frames_[i].ptsUs;
+  }
+  // AudioFrameView::Flags of frame |i|, e.g. the Opus priming.
+  uint32_t frameFlags(size_t i) const;
+  size_t bytes() const { return replay_ ? replay_->header().payloadSize : data_.size(); }
+
+ private:
+  friend class MediaCorpus;
+  MediaCorpusAudio() = default;
+  bool load(const char* filepath, AUDIO_FILE_TYPE filetype);
+
+ private:
+  struct Frame {
+    size_t offset;
+    int length;
+    int samples;
+    int64_t ptsUs;
+    uint32_t flags;
+  };
+
+  std::string path_;
+  std::unique_ptr<ReplayFile> replay_;
+  agora::rtc::AUDIO_CODEC_TYPE codecType_{agora::rtc::AUDIO_CODEC_OPUS};
+  int sampleRateHz_{0};
+  int numberOfChannels_{0};
+  int bitsPerSample_{0};
+  std::vector<uint8_t> data_;
+  std::vector<Frame> frames_;
+};
+
+// An encoded video file mapped once, together with its access unit index, or
+// a mapped replay file which brings its own frame table.
+class MediaCorpusVideo {
+ public:
+  const std::string& path() const { return path_; }
+  agora::rtc::VIDEO_CODEC_TYPE codecType() const { return codecType_; }
+  // Stream properties known from the file, zero if unknown.
+  int width() const;
+  int height() const;
+  int framesPerSecond() const;
+  // Time one pass over the file lasts, i.e. where a loop continues.
+  int64_t durationUs() const;
+  // Size of the whole file.
+  size_t bytes() const;
+
+  size_t size() const { return replay_ ? replay_->size() : index_->size(); }
+  // nullptr if the frame lies outside the file, e.g. for an out of date index.
+  const uint8_t* frameData(size_t i) const;
+  uint32_t frameLength(size_t i) const {
+    return replay_ ? replay_->frame(i).size : (*index_)[i].length;
+  }
+  int64_t framePtsUs(size_t i) const {
+    return replay_ ? replay_->frame(i).ptsUs : (*index_)[i].ptsUs;
+  }
+  bool isKeyFrame(size_t i) const {
+    return replay_ ? (replay_->frame(i).flags & ReplayFrame::kKeyFrame) != 0
+                   : ((*index_)[i].flags & VideoFrameIndexEntry::kKeyFrame) != 0;
+  }
+  // Hints the kernel to read frame |i| ahead of use.
+  void willNeed(size_t i) const;
+
+ private:
+  friend class MediaCorpus;
+  MediaCorpusVideo() = default;
+  bool load(const char* filepath, VideoFileFormat format);
+
+ private:
+  std::string path_;
+  agora::rtc::VIDEO_CODEC_TYPE codecType_{agora::rtc::VIDEO_CODEC_H264};
+  std::unique_ptr<MappedFile> file_;
+  std::shared_ptr<VideoFrameIndex> index_;
+  std::unique_ptr<ReplayFile> replay_;
+};
+
+// Process wide cache of the test media. Each file is loaded and framed once,
+// however many senders play it, and every sender only keeps its own cursor.
+// Entries are reference counted: a file stays loaded while some sender holds
+// it and is freed after the last one lets go. Senders asking for a file that
+// is still loading wait for it instead of loading it again.
+class MediaCorpus {
+ public:
+  static MediaCorpus& Instance();
+
+  // Returns nullptr if the file can't be opened or parsed.
+  std::shared_ptr<const MediaCorpusAudio> acquireAudio(const char* filepath,
+                                                       AUDIO_FILE_TYPE filetype);
+  std::shared_ptr<const MediaCorpusVideo> acquireVideo(const char* filepath,
+                                                       VideoFileFormat format);
+
+ private:
+  MediaCorpus() = default;
+
+  template <typename T>
+  struct Slot {
+    std::mutex mutex;
+    std::weak_ptr<const T> file;
+  };
+  template <typename T>
+  using SlotMap = std::map<std::string, std::shared_ptr<Slot<T>>>;
+
+  template <typename T, typename Format>
+  std::shared_ptr<const T> acquire(SlotMap<T>* slots, const char* filepath, Format format);
+
+ private:
+  std::mutex mutex_;
+  SlotMap<MediaCorpusAudio> audioSlots_;
+  SlotMap<MediaCorpusVideo> videoSlots_;
+};
+
+// Loads a set of corpus files on a pool of threads ahead of the senders, e.g.
+// while the connections are set up, and holds them until it is destroyed so
+// that every sender finds them loaded. A sender asking for a file that is
+// still loading only waits for that file. Video indexes also persist in their
+// sidecars, so later runs get through this quickly.
+class MediaCorpusPreloader {
+ public:
+  // At most |threads| files load at once, one per core if not positive.
+  explicit MediaCorpusPreloader(int threads = 0);
+  // Waits for the files still loading.
+  ~MediaCorpusPreloader();
+
+  // Files added twice load once. Adding stops at start().
+  void addAudio(const std::string& filepath, AUDIO_FILE_TYPE filetype);
+  void addVideo(const std::string& filepath, VideoFileFormat format);
+  size_t size() const { return items_.size(); }
+
+  // Starts loading in the background and reports each file as it is done.
+  void start();
+  // Blocks until every file is loaded, returns how many failed.
+  size_t wait();
+
+ private:
+  struct Item {
+    std::string path;
+    bool video;
+    int format;
+  };
+
+  void add(const std::string& filepath, bool video, int format);
+  void run();
+
+ private:
+  int threads_;
+  std::vector<Item> items_;
+  std::vector<std::thread> workers_;
+  std::chrono::steady_clock::time_point startTime_;
+  std::atomic<size_t> next_{0};
+  std::mutex mutex_;
+  size_t done_{0};
+  size_t failed_{0};
+  std::vector<std::shared_ptr<const MediaCorpusAudio>> audio_;
+  std::vector<std::shared_ptr<const MediaCorpusVideo>> video_;
+};
+
+// Plays a shared audio file through the AudioFileParser interface.
+class MediaCorpusAudioParser : public AudioFileParser {
+ public:
+  explicit MediaCorpusAudioParser(std::shared_ptr<const MediaCorpusAudio> corpus);
+
+ public:
+  // AudioFileParser
+  bool open() override;
+  bool hasNext() override;
+
+  void getNext(char* buffer, int* length) override;
+
+  agora::rtc::AUDIO_CODEC_TYPE getCodecType() override;
+  int getSampleRateHz() override;
+  int getNumberOfChannels() override;
+  int getBitsPerSample() override;
+  int getFrameSamples() override;
+  int reset() override;
+  bool next(AudioFrameView* frame) override;
+  bool viewsStayValid() const override { return true; }
+
+  // Points |data| at the next frame inside the shared file.
+  bool getNext(const uint8_t** data, int* length);
+
+ private:
+  std::shared_ptr<const MediaCorpusAudio> corpus_;
+  size_t next_;
+};
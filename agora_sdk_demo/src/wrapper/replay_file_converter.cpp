@@ -0,0 +1,132 @@
+//  Agora RTC/MEDIA SDK
+//
+//  Copyright (c) 2020 Agora.io. All rights reserved.
+//
+
+#include "replay_file_converter.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+#include "media_corpus.h"
+#include "utils/replay_file.h"
+
+namespace {
+
+std::string OutputPath(const char* input, const char* output) {
+  return output && output[0] ? std::string(output) : ReplayFile::sidecarPath(input);
+}
+
+bool CheckInput(const char* input, uint64_t* size, int64_t* mtimeNs) {
+  if (!GetReplaySourceVersion(input, size, mtimeNs)) {
+    printf("Stat %s failed\n", input);
+    return false;
+  }
+  if (ReplayFile::isReplayFile(input)) {
+    printf("%s is a replay file already\n", input);
+    return false;
+  }
+  return true;
+}
+
+// Samples of frame |i| at the sample rate of |corpus|, 10 ms if neither the
+// parser nor the codec tell.
+int64_t AudioFrameSamples(const MediaCorpusAudio& corpus, size_t i) {
+  if (corpus.frameSamples(i) > 0) {
+    return corpus.frameSamples(i);
+  }
+  // PCM frames hold whole samples.
+  if (corpus.bitsPerSample() > 0 && corpus.numberOfChannels() > 0) {
+    return corpus.frameLength(i) / (corpus.numberOfChannels() * corpus.bitsPerSample() / 8);
+  }
+  return corpus.sampleRateHz() / 100;
+}
+
+}  // namespace
+
+bool ConvertVideoToReplayFile(const char* input, VideoFileFormat format, const char* output) {
+  uint64_t sourceSize = 0;
+  int64_t sourceMtimeNs = 0;
+  if (!CheckInput(input, &sourceSize, &sourceMtimeNs)) {
+    return false;
+  }
+  std::shared_ptr<const MediaCorpusVideo> video =
+      MediaCorpus::Instance().acquireVideo(input, format);
+  if (!video) {
+    return false;
+  }
+
+  ReplayFileHeader header;
+  memset(&header, 0, sizeof(header));
+  header.mediaType = static_cast<uint32_t>(ReplayMediaType::kVideo);
+  header.codec = static_cast<uint32_t>(video->codecType());
+  header.width = video->width();
+  header.height = video->height();
+  header.frameRateNum = video->framesPerSecond();
+  header.frameRateDen = 1;
+  ReplayFileWriter writer(header);
+  for (size_t i = 0; i < video->size(); ++i) {
+    const uint8_t* data = video->frameData(i);
+    if (!data) {
+      printf("Frame %zu of %s lies outside the file\n", i, input);
+      return false;
+    }
+    writer.addFrame(data, video->frameLength(i), video->framePtsUs(i),
+                    video->isKeyFrame(i) ? ReplayFrame::kKeyFrame : 0, header.codec);
+  }
+
+  std::string path = OutputPath(input, output);
+  if (!writer.save(path.c_str(), video->durationUs(), sourceSize, sourceMtimeNs)) {
+    return false;
+  }
+  printf("Converted %s to %s, %zu video frames\n", input, path.c_str(), writer.size());
+  return true;
+}
+
+bool ConvertAudioToReplayFile(const char* input, AUDIO_FILE_TYPE filetype, const char* output) {
+  uint64_t sourceSize = 0;
+  int64_t sourceMtimeNs = 0;
+  if (!CheckInput(input, &sourceSize, &sourceMtimeNs)) {
+    return false;
+  }
+  std::shared_ptr<const MediaCorpusAudio> audio =
+      MediaCorpus::Instance().acquireAudio(input, filetype);
+  if (!audio || audio->sampleRateHz() <= 0) {
+    return false;
+  }
+
+  ReplayFileHeader header;
+  memset(&header, 0, sizeof(header));
+  header.mediaType = static_cast<uint32_t>(ReplayMediaType::kAudio);
+  header.codec = static_cast<uint32_t>(audio->codecType());
+  header.sampleRateHz = audio->sampleRateHz();
+  header.numberOfChannels = audio->numberOfChannels();
+  header.bitsPerSample = audio->bitsPerSample();
+  ReplayFileWriter writer(header);
+  // Counted in samples so the timestamps don't drift.
+  int64_t samples = 0;
+  for (size_t i = 0; i < audio->size(); ++i) {
+    const uint8_t* data = audio->frameData(i);
+    int length = audio->frameLength(i);
+    if (!data) {
+      printf("Frame %zu of %s lies outside the file\n", i, input);
+      return false;
+    }
+    uint32_t flags = ReplayFrame::kKeyFrame;
+    if ((audio->frameFlags(i) & AudioFrameView::kPriming) != 0) {
+      flags |= ReplayFrame::kPriming;
+    }
+    writer.addFrame(data, length, samples * 1000000 / audio->sampleRateHz(), flags,
+                    header.codec);
+    samples += AudioFrameSamples(*audio, i);
+  }
+
+  std::string path = OutputPath(input, output);
+  if (!writer.save(path.c_str(), samples * 1000000 / audio->sampleRateHz(), sourceSize,
+                   sourceMtimeNs)) {
+    return false;
+  }
+  printf("Converted %s to %s, %zu audio frames\n", input, path.c_str(), writer.size());
+  return true;
+}
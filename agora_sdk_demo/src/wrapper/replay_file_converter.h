@@ -0,0 +1,16 @@
+//  Agora RTC/MEDIA SDK
+//
+//  Copyright (c) 2020 Agora.io. All rights reserved.
+//
+
+#pragma once
+
+#include "utils/file_parser/audio_file_parser_factory.h"
+#include "video_frame_index.h"
+
+// Converts a media file into a replay file (see utils/replay_file.h) holding
+// the frames the senders would send for it, with their codec, key frame flag
+// and presentation time. Audio frames are timed by the samples they hold.
+// An empty |output| writes the sidecar the media corpus picks up for |input|.
+bool ConvertVideoToReplayFile(const char* input, VideoFileFormat format, const char* output);
+bool ConvertAudioToReplayFile(const char* input, AUDIO_FILE_TYPE filetype, const char* output);
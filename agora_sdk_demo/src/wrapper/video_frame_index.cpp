@@ -0,0 +1,419 @@
+//  Agora RTC/MEDIA SDK
+//
+//  Copyright (c) 2020 Agora.io. All rights reserved.
+//
+
+#include "video_frame_index.h"
+
+#include <stdio.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <atomic>
+
+#include "utils/bitbuffer.h"
+#include "utils/file_parser/av1_obu_file_parser.h"
+#include "utils/file_parser/h264_parameter_sets.h"
+#include "utils/file_parser/h264_file_parser.h"
+#include "utils/file_parser/h265_file_parser.h"
+#include "utils/file_parser/h265_parameter_sets.h"
+#include "utils/file_parser/ivf_file_parser.h"
+#include "utils/mapped_file.h"
+#include "utils/start_code_finder.h"
+#include "video_frame_sender_internal.h"
+
+namespace {
+
+const char kSidecarMagic[4] = {'V', 'F', 'I', 'X'};
+const uint32_t kSidecarVersion = 6;
+
+// On-disk layout of the sidecar, followed by |entryCount| packed
+// VideoFrameIndexEntry records. Written and read in host byte order.
+struct SidecarHeader {
+  char magic[4];
+  uint32_t version;
+  uint32_t format;
+  uint32_t entryCount;
+  uint64_t fileSize;
+  int64_t fileMtimeNs;
+  uint32_t codecFourcc;
+  uint16_t width;
+  uint16_t height;
+  uint32_t frameRateNum;
+  uint32_t frameRateDen;
+  int64_t durationUs;
+};
+
+static_assert(sizeof(VideoFrameIndexEntry) == 24, "VideoFrameIndexEntry must stay packed");
+static_assert(sizeof(SidecarHeader) == 56, "SidecarHeader must stay packed");
+
+// Enough RBSP bytes for first_mb_in_slice, slice_type and
+// pic_parameter_set_id.
+const size_t kSliceHeaderPrefixSize = 16;
+
+}  // namespace
+
+std::string VideoFrameIndex::sidecarPath(const char* filepath) {
+  return std::string(filepath) + ".idx";
+}
+
+std::shared_ptr<VideoFrameIndex> VideoFrameIndex::loadOrBuild(const char* filepath,
+                                                              VideoFileFormat format) {
+  struct stat st;
+  if (stat(filepath, &st) != 0) {
+    printf("Stat video file %s failed\n", filepath);
+    return nullptr;
+  }
+  uint64_t fileSize = st.st_size;
+  int64_t fileMtimeNs = static_cast<int64_t>(st.st_mtim.tv_sec) * 1000000000 + st.st_mtim.tv_nsec;
+
+  std::shared_ptr<VideoFrameIndex> index(new VideoFrameIndex);
+  index->format_ = format;
+  std::string sidecar = sidecarPath(filepath);
+  if (index->load(sidecar, fileSize, fileMtimeNs)) {
+    return index;
+  }
+
+  bool built = false;
+  switch (format) {
+    case VideoFileFormat::kH264AnnexB:
+      built = index->buildH264(filepath);
+      break;
+    case VideoFileFormat::kIvf:
+      built = index->buildIvf(filepath);
+      break;
+    case VideoFileFormat::kH265AnnexB:
+      built = index->buildH265(filepath);
+      break;
+    case VideoFileFormat::kAv1Obu:
+      built = index->buildAv1Obu(filepath);
+      break;
+  }
+  if (!built) {
+    printf("Index video file %s failed\n", filepath);
+    return nullptr;
+  }
+  index->finalize();
+  if (!index->save(sidecar, fileSize, fileMtimeNs)) {
+    printf("Write frame index %s failed, keep it in memory only\n", sidecar.c_str());
+  }
+  return index;
+}
+
+int VideoFrameIndex::framesPerSecond() const {
+  if (frameRateDen_ == 0) {
+    return 0;
+  }
+  return (frameRateNum_ + frameRateDen_ / 2) / frameRateDen_;
+}
+
+bool VideoFrameIndex::buildH264(const char* filepath) {
+  H264FileParser parser(filepath);
+  if (!parser.open()) {
+    return false;
+  }
+  // The stream is described by the SPS its first picture decodes with.
+  H264ParameterSets parameterSets;
+  const H264Sps* streamSps = nullptr;
+  VideoFrameIndexEntry frame = {0, 0, 0, 0};
+  bool frameHasVcl = false;
+  bool frameAllIntra = true;
+  uint64_t offset = 0;
+  auto closeFrame = [&]() {
+    if (frame.length > 0) {
+      if (frameHasVcl && frameAllIntra) {
+        frame.flags |= VideoFrameIndexEntry::kKeyFrame;
+      }
+      entries_.push_back(frame);
+    }
+    frame = {offset, 0, 0, 0};
+    frameHasVcl = false;
+    frameAllIntra = true;
+  };
+
+  while (parser.hasNext()) {
+    const uint8_t* nalu = nullptr;
+    int length = 0;
+    if (!parser.getNext(&nalu, &length) || length <= 0) {
+      break;
+    }
+    // NAL units keep their three or four bytes start code.
+    int headerPos = 0;
+    while (headerPos < length - 1 && nalu[headerPos] == 0) {
+      ++headerPos;
+    }
+    ++headerPos;
+    if (headerPos >= length) {
+      offset += length;
+      frame.length += length;
+      continue;
+    }
+
+    NaluType naluType = ParseNaluType(nalu[headerPos]);
+    if (IsH264Vcl(naluType)) {
+      uint8_t sliceHeader[kSliceHeaderPrefixSize];
+      size_t sliceHeaderSize = UnescapeRbsp(nalu + headerPos + kNaluTypeSize,
+                                            length - headerPos - kNaluTypeSize, sliceHeader,
+                                            sizeof(sliceHeader));
+      CachedBitBuffer slice_reader(sliceHeader, sliceHeaderSize);
+      uint32_t first_mb_in_slice = 0;
+      uint32_t slice_type = 0;
+      uint32_t pic_parameter_set_id = 0;
+      slice_reader.ReadExponentialGolomb(&first_mb_in_slice);
+      slice_reader.ReadExponentialGolomb(&slice_type);
+      slice_type %= 5;
+      if (!streamSps && slice_reader.ReadExponentialGolomb(&pic_parameter_set_id)) {
+        streamSps = parameterSets.activeSps(pic_parameter_set_id);
+      }
+
+      if (first_mb_in_slice == 0 && frameHasVcl) {
+        closeFrame();
+      }
+      frameHasVcl = true;
+      if (naluType != kIdr && slice_type != SliceType::kI && slice_type != SliceType::kSi) {
+        frameAllIntra = false;
+      }
+    } else {
+      if (StartsH264AccessUnit(naluType) && frameHasVcl) {
+        closeFrame();
+      }
+      if (!streamSps && (naluType == kSps || naluType == kPps)) {
+        parameterSets.updateNalu(nalu + headerPos, length - headerPos);
+      }
+    }
+    frame.length += length;
+    offset += length;
+  }
+  closeFrame();
+  // A cut index would be saved and played as if it were the whole file.
+  if (parser.overflowed()) {
+    return false;
+  }
+
+  if (!streamSps) {
+    streamSps = parameterSets.lastSps();
+  }
+  uint32_t frameRateNum = 0;
+  uint32_t frameRateDen = 0;
+  if (streamSps) {
+    width_ = streamSps->width;
+    height_ = streamSps->height;
+  }
+  if (streamSps && GetH264FrameRate(*streamSps, &frameRateNum, &frameRateDen)) {
+    assignNominalTimestamps(frameRateNum, frameRateDen);
+  } else {
+    assignNominalTimestamps();
+  }
+  return true;
+}
+
+bool VideoFrameIndex::buildH265(const char* filepath) {
+  H265FileParser parser(filepath);
+  if (!parser.open()) {
+    return false;
+  }
+  // Access units cover the file back to back. The stream is described by
+  // the first SPS.
+  H265Sps sps;
+  bool hasSps = false;
+  uint64_t offset = 0;
+  const uint8_t* accessUnit = nullptr;
+  int length = 0;
+  bool irap = false;
+  while (parser.getNextAccessUnit(&accessUnit, &length, &irap)) {
+    VideoFrameIndexEntry frame = {offset, static_cast<uint32_t>(length),
+                                  irap ? VideoFrameIndexEntry::kKeyFrame : 0u, 0};
+    entries_.push_back(frame);
+    offset += length;
+    if (!hasSps) {
+      hasSps = FindH265Sps(accessUnit, length, &sps);
+    }
+  }
+  if (parser.overflowed()) {
+    return false;
+  }
+  uint32_t frameRateNum = 0;
+  uint32_t frameRateDen = 0;
+  if (hasSps) {
+    width_ = sps.width;
+    height_ = sps.height;
+  }
+  if (hasSps && GetH265FrameRate(sps, &frameRateNum, &frameRateDen)) {
+    assignNominalTimestamps(frameRateNum, frameRateDen);
+  } else {
+    assignNominalTimestamps();
+  }
+  return true;
+}
+
+bool VideoFrameIndex::buildAv1Obu(const char* filepath) {
+  Av1ObuFileParser parser(filepath);
+  if (!parser.open()) {
+    return false;
+  }
+  // Temporal units cover the file back to back.
+  uint64_t offset = 0;
+  const uint8_t* temporalUnit = nullptr;
+  int length = 0;
+  bool keyFrame = false;
+  while (parser.getNextTemporalUnit(&temporalUnit, &length, &keyFrame)) {
+    VideoFrameIndexEntry frame = {offset, static_cast<uint32_t>(length),
+                                  keyFrame ? VideoFrameIndexEntry::kKeyFrame : 0u, 0};
+    entries_.push_back(frame);
+    offset += length;
+  }
+  codecFourcc_ = IvfFourcc('A', 'V', '0', '1');
+  const Av1SequenceHeader& sequenceHeader = parser.sequenceHeader();
+  if (parser.hasSequenceHeader()) {
+    width_ = sequenceHeader.maxFrameWidth;
+    height_ = sequenceHeader.maxFrameHeight;
+  }
+  if (sequenceHeader.numUnitsInDisplayTick > 0 && sequenceHeader.timeScale > 0) {
+    assignNominalTimestamps(sequenceHeader.timeScale, sequenceHeader.numUnitsInDisplayTick);
+  } else {
+    assignNominalTimestamps();
+  }
+  return true;
+}
+
+void VideoFrameIndex::assignNominalTimestamps(uint32_t frameRateNum, uint32_t frameRateDen) {
+  // Elementary streams carry no per frame timing we parse.
+  frameRateNum_ = frameRateNum;
+  frameRateDen_ = frameRateDen;
+  for (size_t i = 0; i < entries_.size(); ++i) {
+    entries_[i].ptsUs = static_cast<int64_t>(i) * 1000000 * frameRateDen_ / frameRateNum_;
+  }
+}
+
+bool VideoFrameIndex::buildIvf(const char* filepath) {
+  IvfFileParser parser(filepath);
+  if (!parser.open()) {
+    return false;
+  }
+  const IvfFileHeader& header = parser.header();
+  codecFourcc_ = header.fourcc;
+  width_ = header.width;
+  height_ = header.height;
+
+  // Hidden frames, e.g. VP8 alt-refs written on their own, go out right
+  // behind the frame before them, so only shown frames take display time.
+  IvfFrame frame;
+  uint64_t firstTimestamp = 0;
+  size_t shownFrames = 0;
+  int64_t lastShownPtsUs = 0;
+  while (parser.getNextFrame(&frame)) {
+    if (entries_.empty()) {
+      firstTimestamp = frame.timestamp;
+    }
+    int64_t ptsUs = 0;
+    if (!parser.timestampToUs(frame.timestamp - firstTimestamp, &ptsUs)) {
+      ptsUs = static_cast<int64_t>(shownFrames) * 1000000 / 30;
+    }
+    if (!frame.shown) {
+      ptsUs = entries_.empty() ? 0 : entries_.back().ptsUs;
+    } else {
+      ++shownFrames;
+      lastShownPtsUs = ptsUs;
+    }
+    VideoFrameIndexEntry entry = {frame.offset, static_cast<uint32_t>(frame.size),
+                                  frame.keyFrame ? VideoFrameIndexEntry::kKeyFrame : 0u, ptsUs};
+    entries_.push_back(entry);
+  }
+
+  // Derive the nominal rate from the timestamps of the shown frames.
+  uint32_t frameRateDen = static_cast<uint32_t>((lastShownPtsUs + 500) / 1000);
+  if (shownFrames > 1 && frameRateDen > 0) {
+    frameRateNum_ = static_cast<uint32_t>(shownFrames - 1) * 1000;
+    frameRateDen_ = frameRateDen;
+  }
+  return true;
+}
+
+void VideoFrameIndex::finalize() {
+  if (entries_.empty()) {
+    durationUs_ = 0;
+    return;
+  }
+  // The last frame shows for as long as the last shown frame before it.
+  // Hidden frames repeat the pts of the frame before them, skip them.
+  int64_t lastPtsUs = entries_.back().ptsUs;
+  int64_t frameIntervalUs = frameRateNum_ > 0 ? 1000000LL * frameRateDen_ / frameRateNum_ : 0;
+  for (size_t i = entries_.size() - 1; i > 0; --i) {
+    if (entries_[i - 1].ptsUs < lastPtsUs) {
+      frameIntervalUs = lastPtsUs - entries_[i - 1].ptsUs;
+      break;
+    }
+  }
+  durationUs_ = lastPtsUs + frameIntervalUs;
+}
+
+bool VideoFrameIndex::load(const std::string& path, uint64_t fileSize, int64_t fileMtimeNs) {
+  FILE* file = fopen(path.c_str(), "rb");
+  if (!file) {
+    return false;
+  }
+  SidecarHeader header;
+  bool valid = fread(&header, sizeof(header), 1, file) == 1 &&
+               memcmp(header.magic, kSidecarMagic, sizeof(kSidecarMagic)) == 0 &&
+               header.version == kSidecarVersion &&
+               header.format == static_cast<uint32_t>(format_) && header.fileSize == fileSize &&
+               header.fileMtimeNs == fileMtimeNs;
+  if (valid) {
+    entries_.resize(header.entryCount);
+    valid = header.entryCount == 0 ||
+            fread(entries_.data(), sizeof(VideoFrameIndexEntry), header.entryCount, file) ==
+                header.entryCount;
+  }
+  fclose(file);
+  if (!valid) {
+    entries_.clear();
+    return false;
+  }
+  codecFourcc_ = header.codecFourcc;
+  width_ = header.width;
+  height_ = header.height;
+  frameRateNum_ = header.frameRateNum;
+  frameRateDen_ = header.frameRateDen;
+  durationUs_ = header.durationUs;
+  return true;
+}
+
+bool VideoFrameIndex::save(const std::string& path, uint64_t fileSize,
+                           int64_t fileMtimeNs) const {
+  // Concurrent senders may index the same file, so write a private file and
+  // rename it over the sidecar atomically.
+  static std::atomic<int> sequence(0);
+  char suffix[64] = {0};
+  snprintf(suffix, sizeof(suffix), ".%d.%d.tmp", getpid(), sequence++);
+  std::string tmpPath = path + suffix;
+
+  FILE* file = fopen(tmpPath.c_str(), "wb");
+  if (!file) {
+    return false;
+  }
+  SidecarHeader header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, kSidecarMagic, sizeof(kSidecarMagic));
+  header.version = kSidecarVersion;
+  header.format = static_cast<uint32_t>(format_);
+  header.entryCount = static_cast<uint32_t>(entries_.size());
+  header.fileSize = fileSize;
+  header.fileMtimeNs = fileMtimeNs;
+  header.codecFourcc = codecFourcc_;
+  header.width = static_cast<uint16_t>(width_);
+  header.height = static_cast<uint16_t>(height_);
+  header.frameRateNum = frameRateNum_;
+  header.frameRateDen = frameRateDen_;
+  header.durationUs = durationUs_;
+
+  bool written =
+      fwrite(&header, sizeof(header), 1, file) == 1 &&
+      (entries_.empty() || fwrite(entries_.data(), sizeof(VideoFrameIndexEntry), entries_.size(),
+                                  file) == entries_.size());
+  written = (fclose(file) == 0) && written;
+  if (!written || rename(tmpPath.c_str(), path.c_str()) != 0) {
+    unlink(tmpPath.c_str());
+    return false;
+  }
+  return true;
+}
@@ -0,0 +1,84 @@
+//  Agora RTC/MEDIA SDK
+//
+//  Copyright (c) 2020 Agora.io. All rights reserved.
+//
+
+#pragma once
+
+#include <stddef.h>
+#include <stdint.h>
+#include <memory>
+#include <string>
+#include <vector>
+
+// One access unit (a whole encoded video frame) of an encoded video file.
+struct VideoFrameIndexEntry {
+  enum Flags : uint32_t {
+    kKeyFrame = 1,
+  };
+
+  uint64_t offset;  // Byte offset of the frame payload in the file.
+  uint32_t length;  // Payload length in bytes.
+  uint32_t flags;
+  int64_t ptsUs;  // Presentation time relative to the first frame.
+};
+
+enum class VideoFileFormat : uint32_t {
+  kH264AnnexB = 1,
+  kIvf = 2,
+  kH265AnnexB = 3,
+  // AV1 low overhead bitstream format, a plain sequence of OBUs.
+  kAv1Obu = 4,
+};
+
+// Access unit index of an encoded video file. Building it parses the whole
+// bitstream once; the result is persisted as "<file>.idx" next to the file
+// and reused as long as the file's size and mtime don't change. Senders then
+// seek and loop in O(1) without any per-run parsing.
+class VideoFrameIndex {
+ public:
+  // Loads the sidecar of |filepath| if it is still valid, otherwise builds the
+  // index and rewrites the sidecar. Returns nullptr if the file can't be read.
+  static std::shared_ptr<VideoFrameIndex> loadOrBuild(const char* filepath,
+                                                      VideoFileFormat format);
+  static std::string sidecarPath(const char* filepath);
+
+  VideoFileFormat format() const { return format_; }
+  size_t size() const { return entries_.size(); }
+  bool empty() const { return entries_.empty(); }
+  const VideoFrameIndexEntry& operator[](size_t i) const { return entries_[i]; }
+  const std::vector<VideoFrameIndexEntry>& entries() const { return entries_; }
+
+  // Stream properties known from the container, zero if unknown.
+  uint32_t codecFourcc() const { return codecFourcc_; }
+  int width() const { return width_; }
+  int height() const { return height_; }
+  // Nominal frame rate as |frameRateNum_| / |frameRateDen_|.
+  int framesPerSecond() const;
+  // Time one pass over the file lasts, i.e. where a loop continues.
+  int64_t durationUs() const { return durationUs_; }
+
+ private:
+  VideoFrameIndex() = default;
+
+  bool buildH264(const char* filepath);
+  bool buildH265(const char* filepath);
+  bool buildAv1Obu(const char* filepath);
+  bool buildIvf(const char* filepath);
+  // Spaces the frames evenly at |frameRateNum| / |frameRateDen| fps.
+  void assignNominalTimestamps(uint32_t frameRateNum = 30, uint32_t frameRateDen = 1);
+  void finalize();
+
+  bool load(const std::string& path, uint64_t fileSize, int64_t fileMtimeNs);
+  bool save(const std::string& path, uint64_t fileSize, int64_t fileMtimeNs) const;
+
+ private:
+  VideoFileFormat format_{VideoFileFormat::kH264AnnexB};
+  uint32_t codecFourcc_{0};
+  int width_{0};
+  int height_{0};
+  uint32_t frameRateNum_{30};
+  uint32_t frameRateDen_{1};
+  int64_t durationUs_{0};
+  std::vector<VideoFrameIndexEntry> entries_;
+};
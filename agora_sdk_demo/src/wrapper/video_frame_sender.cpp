@@ -7,21 +7,77 @@
 #include "video_frame_sender.h"
 
 #include <stdio.h>
+#include <chrono>
 #include <thread>
 #include <cstring>
 
 #include "test_data/foreman_frames.h"
 #include "connection_wrapper.h"
 #include "local_user_wrapper.h"
+#include "media_corpus.h"
 #include "utils.h"
 #include "utils/bitbuffer.h"
 #include "utils/file_parser/h264_file_parser.h"
+#include "utils/file_parser/h264_parameter_sets.h"
+#include "utils/file_parser/ivf_file_parser.h"
+#include "utils/start_code_finder.h"
+#include "video_frame_index.h"
 #include "video_frame_sender_internal.h"
 
 VideoFrameSender::VideoFrameSender() = default;
 
 VideoFrameSender::~VideoFrameSender() = default;
 
+// How far ahead of the send cursor frames are paged in.
+static const size_t kReadAheadFrames = 30;
+
+// Sends the frames of |video| straight out of the mapped file, paced against
+// an absolute clock by their presentation times. A negative |loops| repeats
+// forever, with the timeline continuing across loops.
+static void SendIndexedVideoFrames(agora::rtc::IVideoEncodedImageSender* sender,
+                                   const MediaCorpusVideo& video,
+                                   agora::rtc::EncodedVideoFrameInfo frameInfo, int loops) {
+  const size_t frames = video.size();
+  if (frames == 0) {
+    return;
+  }
+  auto startTime = std::chrono::steady_clock::now();
+  int64_t loopOffsetUs = 0;
+  for (int loop = 0; loops < 0 || loop < loops; ++loop) {
+    for (size_t i = 0; i < frames; ++i) {
+      const uint8_t* data = video.frameData(i);
+      if (!data) {
+        AGO_LOG("Frame index of %s is out of date\n", video.path().c_str());
+        return;
+      }
+      // The kernel reads the pages in while this thread waits, so a cold page
+      // cache doesn't make a frame late.
+      video.willNeed((i + kReadAheadFrames) % frames);
+      std::this_thread::sleep_until(startTime +
+                                    std::chrono::microseconds(loopOffsetUs + video.framePtsUs(i)));
+      frameInfo.frameType = video.isKeyFrame(i) ? agora::rtc::VIDEO_FRAME_TYPE_KEY_FRAME
+                                                : agora::rtc::VIDEO_FRAME_TYPE_DELTA_FRAME;
+      sender->sendEncodedVideoImage(data, video.frameLength(i), frameInfo);
+    }
+    loopOffsetUs += video.durationUs();
+  }
+}
+
+// Takes |filepath| and its frame index from the media corpus, which loads them
+// only if no other sender is playing the file.
+static bool OpenIndexedVideoFile(const std::string& filepath, VideoFileFormat format,
+                                 std::shared_ptr<const MediaCorpusVideo>* corpus) {
+  std::shared_ptr<const MediaCorpusVideo> video =
+      MediaCorpus::Instance().acquireVideo(filepath.c_str(), format);
+  if (!video) {
+    printf("Open test file %s failed\n", filepath.c_str());
+    return false;
+  }
+  printf("Open test file %s successfully, %zu frames\n", filepath.c_str(), video->size());
+  *corpus = std::move(video);
+  return true;
+}
+
 VideoVP8FrameSender::VideoVP8FrameSender(const char* filepath) : file_path_(filepath) {}
 
 VideoVP8FrameSender::~VideoVP8FrameSender() = default;
@@ -33,116 +89,51 @@ bool VideoVP8FrameSender::initialize(agora::base::IAgoraService* service,
   if (!video_encoded_image_sender_) {
     return false;
   }
+  if (!OpenIndexedVideoFile(file_path_, VideoFileFormat::kIvf, &corpus_)) {
+    return false;
+  }
   auto customVideoTrack = service->createCustomVideoTrack(video_encoded_image_sender_);
+  // Describe the stream the file holds. IVF headers carry the size and the
+  // time base, the bitrate is the file's average in Kbps.
   agora::rtc::VideoEncoderConfiguration encoder_config;
-  encoder_config.codecType = agora::rtc::VIDEO_CODEC_VP8;
-  encoder_config.bitrate = 1 * 1000 * 1000;
-  encoder_config.minBitrate = 500 * 1000;
-  encoder_config.dimensions.width = 2560;
-  encoder_config.dimensions.height = 1440;
-  encoder_config.frameRate = 30;
+  encoder_config.codecType = corpus_->codecType();
+  encoder_config.dimensions.width = corpus_->width();
+  encoder_config.dimensions.height = corpus_->height();
+  encoder_config.frameRate = corpus_->framesPerSecond() > 0 ? corpus_->framesPerSecond() : 30;
+  int64_t durationUs = corpus_->durationUs();
+  encoder_config.bitrate =
+      durationUs > 0 ? static_cast<int>(corpus_->bytes() * 8 * 1000 / durationUs) : 1000;
+  encoder_config.minBitrate = encoder_config.bitrate / 2;
   customVideoTrack->setVideoEncoderConfiguration(encoder_config);
   connection->GetLocalUser()->PublishVideoTrack(customVideoTrack);
-
   return true;
 }
 
 void VideoVP8FrameSender::sendVideoFrames() {
-  const int loop_time_ms = -1;
-  const char* test_file = file_path_.c_str();
-  FILE* f = fopen(test_file, "rb");
-  IVF_HEADER header = {0};
-  uint64_t last_time_diff = 0;
-  uint64_t last_time_stamp = 0;
-  agora::rtc::VIDEO_FRAME_TYPE frame_type;
-  agora::rtc::VIDEO_CODEC_TYPE codec;
-
-#define CONVERT_TO_INT(a, b, c, d) \
-    ((ENDIANNESS == 'l') ? (a | b << 8 | c << 16 | d << 24) : (a << 24 | b << 16 | c << 8 | d))
-
-  fread(&header, sizeof(header), 1, f);
-  if (header.codec == CONVERT_TO_INT('V', 'P', '8', '0')) {
-    codec = agora::rtc::VIDEO_CODEC_VP8;
-  } else if (header.codec == CONVERT_TO_INT('V', 'P', '9', '0')) {
-    codec = agora::rtc::VIDEO_CODEC_VP9;
-  } else if (header.codec == CONVERT_TO_INT('H', '2', '6', '4')) {
-    codec = agora::rtc::VIDEO_CODEC_H264;
-  } else {
-    codec = agora::rtc::VIDEO_CODEC_VP8;
-  }
-  AGO_LOG("Begin to send ivf file, width %d, height %d, frame_rate %d, time_scale %d, frames %d",
-          header.width, header.height, header.frame_rate, header.time_scale, header.frames);
-  fseek(f, header.head_len, SEEK_SET);
-  auto start_time = now_ms();
-  while (true) {
-    auto overhead_begin = now_ms();
-    if ((loop_time_ms != -1) && (overhead_begin - start_time) >= loop_time_ms) break;
-    IVF_PAYLOAD payload = {0};
-    fread(&payload, sizeof(payload), 1, f);
-    if (payload.length == 0) {
-      fseek(f, header.head_len, SEEK_SET);
-      last_time_stamp = 0;
-      continue;
-    }
-    char* buf = new char[payload.length];
-    fread(buf, payload.length, 1, f);
-    agora::rtc::VIDEO_FRAME_TYPE frame_type;
-    if (payload.frame_type == webrtc::kVideoFrameKey) {
-      frame_type = agora::rtc::VIDEO_FRAME_TYPE_KEY_FRAME;
-    } else if (payload.frame_type == webrtc::kVideoFrameDelta) {
-      frame_type = agora::rtc::VIDEO_FRAME_TYPE_DELTA_FRAME;
-    } else {
-      frame_type = agora::rtc::VIDEO_FRAME_TYPE_UNKNOW;
-    }
-    uint64_t wait_time_ms =
-        (last_time_stamp == 0
-             ? last_time_diff
-             : ((payload.timestamp - last_time_stamp) / (header.time_scale / 1000)));
-    last_time_diff = wait_time_ms;
-    last_time_stamp = payload.timestamp;
-    auto overhead = now_ms() - overhead_begin;
-    std::this_thread::sleep_for(std::chrono::milliseconds(wait_time_ms - overhead));
-
-    agora::rtc::EncodedVideoFrameInfo videoEncodedFrameInfo;
-    videoEncodedFrameInfo.frameType = frame_type;
-    videoEncodedFrameInfo.width = header.width;
-    videoEncodedFrameInfo.height = header.height;
-    videoEncodedFrameInfo.rotation = agora::rtc::VIDEO_ORIENTATION_0;
-    videoEncodedFrameInfo.codecType = codec;
-    video_encoded_image_sender_->sendEncodedVideoImage(reinterpret_cast<uint8_t*>(buf),
-                                                       payload.length, videoEncodedFrameInfo);
-    delete[] buf;
+  if (!corpus_) {
+    return;
   }
-  fclose(f);
-}
+  AGO_LOG("Begin to send ivf file, width %d, height %d, frame_rate %d, frames %zu\n",
+          corpus_->width(), corpus_->height(), corpus_->framesPerSecond(), corpus_->size());
 
-std::vector<uint8_t> ParseRbsp(const uint8_t* data, size_t length) {
-  std::vector<uint8_t> out;
-  out.reserve(length);
-
-  for (size_t i = 0; i < length;) {
-    // Be careful about over/underflow here. byte_length_ - 3 can underflow, and
-    // i + 3 can overflow, but byte_length_ - i can't, because i < byte_length_
-    // above, and that expression will produce the number of bytes left in
-    // the stream including the byte at i.
-    if (length - i >= 3 && !data[i] && !data[i + 1] && data[i + 2] == 3) {
-      // Two rbsp bytes.
-      out.push_back(data[i++]);
-      out.push_back(data[i++]);
-      // Skip the emulation byte.
-      i++;
-    } else {
-      // Single rbsp byte.
-      out.push_back(data[i++]);
-    }
-  }
-  return out;
+  agora::rtc::EncodedVideoFrameInfo videoEncodedFrameInfo;
+  videoEncodedFrameInfo.width = corpus_->width();
+  videoEncodedFrameInfo.height = corpus_->height();
+  videoEncodedFrameInfo.rotation = agora::rtc::VIDEO_ORIENTATION_0;
+  videoEncodedFrameInfo.codecType = corpus_->codecType();
+  SendIndexedVideoFrames(video_encoded_image_sender_.get(), *corpus_, videoEncodedFrameInfo,
+                         loops_);
 }
 
 VideoH264FileSender::VideoH264FileSender(const char* filepath) : file_path_(filepath) {}
 
 VideoH264FileSender::~VideoH264FileSender() = default;
 
+void VideoH264FileSender::setLiveInput(bool follow) {
+  live_ = true;
+  follow_ = follow;
+}
+
 bool VideoH264FileSender::initialize(agora::base::IAgoraService* service,
                                      agora::agora_refptr<agora::rtc::IMediaNodeFactory> factory,
                                      std::shared_ptr<ConnectionWrapper> connection) {
@@ -154,112 +145,149 @@ bool VideoH264FileSender::initialize(agora::base::IAgoraService* service,
       service->createCustomVideoTrack(video_encoded_image_sender_, false, agora::base::CC_DISABLED);
   connection->GetLocalUser()->PublishVideoTrack(customVideoTrack);
 
-  std::unique_ptr<H264FileParser> parser(new H264FileParser(file_path_.c_str()));
-  bool ret = parser->open();
-  if (!ret) {
-    printf("Open test file %s failed\n", file_path_.c_str());
-    return false;
+  if (live_) {
+    live_parser_.reset(new H264FileParser(file_path_.c_str(), false));
+    live_parser_->setLiveInput(follow_);
+    if (!live_parser_->open()) {
+      printf("Open live input %s failed\n", file_path_.c_str());
+      live_parser_.reset();
+      return false;
+    }
+    return true;
   }
-  printf("Open test file %s successfully\n", file_path_.c_str());
-  file_parser_ = std::move(parser);
-  return true;
+  return OpenIndexedVideoFile(file_path_, VideoFileFormat::kH264AnnexB, &corpus_);
 }
 
-void VideoH264FileSender::sendVideoFrames() {
-  std::unique_ptr<char[]> buffer(new char[40960]);
-  std::unique_ptr<char[]> sliceBuffer(new char[40960]);
-  int totalLength = 0;
-  int totalSendLenth = 0;
-  int length = 40960;
-  int i = 0;
-  int bufdatalen = 0;
-  uint32_t last_slice_type;
-  NaluType lastNaluType = kSei;
-  int frameNum = 0;
-  while (file_parser_->hasNext()) {
-    length = 40960;
-    file_parser_->getNext(sliceBuffer.get(), &length);
-    NaluType naluType = ParseNaluType(sliceBuffer[4]);
-
-    if (naluType == NaluType::kSlice || naluType == NaluType::kIdr) {
-      std::vector<uint8_t> unpacked_buffer =
-          ParseRbsp(reinterpret_cast<const unsigned char*>(sliceBuffer.get() + 4), length - 4);
-      BitBuffer slice_reader(unpacked_buffer.data() + kNaluTypeSize,
-                             unpacked_buffer.size() - kNaluTypeSize);
-      // first_mb_in_slice
-      uint32_t first_mb_in_slice;
-      slice_reader.ReadExponentialGolomb(&first_mb_in_slice);
-
-      // slice_type: ue(v)
-      uint32_t slice_type;
-      slice_reader.ReadExponentialGolomb(&slice_type);
-      slice_type %= 5;
-
-      // New video frame found, so to send last video frame.
-      if (first_mb_in_slice == 0 &&
-          (lastNaluType == NaluType::kSlice || lastNaluType == NaluType::kIdr)) {
-        agora::rtc::EncodedVideoFrameInfo videoEncodedFrameInfo;
-
-        videoEncodedFrameInfo.rotation = agora::rtc::VIDEO_ORIENTATION_0;
-        videoEncodedFrameInfo.codecType = agora::rtc::VIDEO_CODEC_H264;
-        videoEncodedFrameInfo.framesPerSecond = 30;
-        if (i % 3 != 0) {
-          std::this_thread::sleep_for(std::chrono::milliseconds(34));
-        } else {
-          std::this_thread::sleep_for(std::chrono::milliseconds(33));
-        }
-        if (last_slice_type == SliceType::kI) {
-          videoEncodedFrameInfo.frameType = agora::rtc::VIDEO_FRAME_TYPE_KEY_FRAME;
-        } else {
-          videoEncodedFrameInfo.frameType = agora::rtc::VIDEO_FRAME_TYPE_DELTA_FRAME;
-        }
-        video_encoded_image_sender_->sendEncodedVideoImage(reinterpret_cast<uint8_t*>(buffer.get()),
-                                                           bufdatalen, videoEncodedFrameInfo);
-        totalSendLenth += bufdatalen;
-
-        //        printf(
-        //            "Send %d length %d, Nalu type %d, first_mb_in_slice %u, Slice type %u, nalu
-        //            number "
-        //            "%d\n",
-        //            frameNum++, bufdatalen, naluType, first_mb_in_slice, slice_type, i);
-        i = 0;
-
-        memcpy(buffer.get(), sliceBuffer.get(), length);
-        bufdatalen = length;
-      } else {
-        memcpy(buffer.get() + bufdatalen, sliceBuffer.get(), length);
-        bufdatalen += length;
-        ++i;
+void VideoH264FileSender::sendLiveFrames() {
+  agora::rtc::EncodedVideoFrameInfo videoEncodedFrameInfo;
+  videoEncodedFrameInfo.rotation = agora::rtc::VIDEO_ORIENTATION_0;
+  videoEncodedFrameInfo.codecType = agora::rtc::VIDEO_CODEC_H264;
+  videoEncodedFrameInfo.packetizationMode = agora::rtc::NonInterleaved;
+
+  // The frame size and rate follow the SPS, which may change mid-stream.
+  H264ParameterSets parameterSets;
+  size_t frames = 0;
+  size_t bytes = 0;
+  const uint8_t* data = nullptr;
+  int length = 0;
+  bool idr = false;
+  while (live_parser_->getNextAccessUnit(&data, &length, &idr)) {
+    if (parameterSets.update(data, length) && parameterSets.lastSps()) {
+      const H264Sps& sps = *parameterSets.lastSps();
+      videoEncodedFrameInfo.width = sps.width;
+      videoEncodedFrameInfo.height = sps.height;
+      uint32_t frameRateNum = 0;
+      uint32_t frameRateDen = 0;
+      if (GetH264FrameRate(sps, &frameRateNum, &frameRateDen)) {
+        videoEncodedFrameInfo.framesPerSecond = (frameRateNum + frameRateDen / 2) / frameRateDen;
       }
-      last_slice_type = slice_type;
-    } else {
-      memcpy(buffer.get() + bufdatalen, sliceBuffer.get(), length);
-      bufdatalen += length;
-      ++i;
+      AGO_LOG("Live h264 input %s is %dx%d\n", file_path_.c_str(), sps.width, sps.height);
     }
-    totalLength += length;
-    lastNaluType = naluType;
+    videoEncodedFrameInfo.frameType =
+        idr ? agora::rtc::VIDEO_FRAME_TYPE_KEY_FRAME : agora::rtc::VIDEO_FRAME_TYPE_DELTA_FRAME;
+    video_encoded_image_sender_->sendEncodedVideoImage(data, length, videoEncodedFrameInfo);
+    ++frames;
+    bytes += length;
   }
-  agora::rtc::EncodedVideoFrameInfo videoEncodedFrameInfo;
+  AGO_LOG("Live input %s ended, sent %zu frames, %zu bytes\n", file_path_.c_str(), frames, bytes);
+}
 
+void VideoH264FileSender::sendVideoFrames() {
+  if (live_parser_) {
+    sendLiveFrames();
+    return;
+  }
+  if (!corpus_) {
+    return;
+  }
+  AGO_LOG("Begin to send h264 file, width %d, height %d, frame_rate %d, frames %zu\n",
+          corpus_->width(), corpus_->height(), corpus_->framesPerSecond(), corpus_->size());
+
+  agora::rtc::EncodedVideoFrameInfo videoEncodedFrameInfo;
+  videoEncodedFrameInfo.width = corpus_->width();
+  videoEncodedFrameInfo.height = corpus_->height();
   videoEncodedFrameInfo.rotation = agora::rtc::VIDEO_ORIENTATION_0;
   videoEncodedFrameInfo.codecType = agora::rtc::VIDEO_CODEC_H264;
-  videoEncodedFrameInfo.framesPerSecond = 30;
+  videoEncodedFrameInfo.framesPerSecond = corpus_->framesPerSecond();
   videoEncodedFrameInfo.packetizationMode = agora::rtc::NonInterleaved;
-  if (i % 3 != 0) {
-    std::this_thread::sleep_for(std::chrono::milliseconds(34));
-  } else {
-    std::this_thread::sleep_for(std::chrono::milliseconds(33));
+  SendIndexedVideoFrames(video_encoded_image_sender_.get(), *corpus_, videoEncodedFrameInfo,
+                         loops_);
+
+  AGO_LOG("Total send %zu frames, %zu bytes per loop\n", corpus_->size(), corpus_->bytes());
+}
+
+VideoH265FileSender::VideoH265FileSender(const char* filepath) : file_path_(filepath) {}
+
+VideoH265FileSender::~VideoH265FileSender() = default;
+
+bool VideoH265FileSender::initialize(agora::base::IAgoraService* service,
+                                     agora::agora_refptr<agora::rtc::IMediaNodeFactory> factory,
+                                     std::shared_ptr<ConnectionWrapper> connection) {
+  video_encoded_image_sender_ = factory->createVideoEncodedImageSender();
+  if (!video_encoded_image_sender_) {
+    return false;
+  }
+  auto customVideoTrack =
+      service->createCustomVideoTrack(video_encoded_image_sender_, false, agora::base::CC_DISABLED);
+  connection->GetLocalUser()->PublishVideoTrack(customVideoTrack);
+
+  return OpenIndexedVideoFile(file_path_, VideoFileFormat::kH265AnnexB, &corpus_);
+}
+
+void VideoH265FileSender::sendVideoFrames() {
+  if (!corpus_) {
+    return;
+  }
+  AGO_LOG("Begin to send h265 file, width %d, height %d, frame_rate %d, frames %zu\n",
+          corpus_->width(), corpus_->height(), corpus_->framesPerSecond(), corpus_->size());
+
+  agora::rtc::EncodedVideoFrameInfo videoEncodedFrameInfo;
+  videoEncodedFrameInfo.width = corpus_->width();
+  videoEncodedFrameInfo.height = corpus_->height();
+  videoEncodedFrameInfo.rotation = agora::rtc::VIDEO_ORIENTATION_0;
+  videoEncodedFrameInfo.codecType = agora::rtc::VIDEO_CODEC_H265;
+  videoEncodedFrameInfo.framesPerSecond = corpus_->framesPerSecond();
+  SendIndexedVideoFrames(video_encoded_image_sender_.get(), *corpus_, videoEncodedFrameInfo,
+                         loops_);
+
+  AGO_LOG("Total send %zu frames, %zu bytes per loop\n", corpus_->size(), corpus_->bytes());
+}
+
+VideoAv1FileSender::VideoAv1FileSender(const char* filepath) : file_path_(filepath) {}
+
+VideoAv1FileSender::~VideoAv1FileSender() = default;
+
+bool VideoAv1FileSender::initialize(agora::base::IAgoraService* service,
+                                    agora::agora_refptr<agora::rtc::IMediaNodeFactory> factory,
+                                    std::shared_ptr<ConnectionWrapper> connection) {
+  video_encoded_image_sender_ = factory->createVideoEncodedImageSender();
+  if (!video_encoded_image_sender_) {
+    return false;
   }
-  if (last_slice_type == SliceType::kI) {
-    videoEncodedFrameInfo.frameType = agora::rtc::VIDEO_FRAME_TYPE_KEY_FRAME;
-  } else {
-    videoEncodedFrameInfo.frameType = agora::rtc::VIDEO_FRAME_TYPE_DELTA_FRAME;
+  auto customVideoTrack =
+      service->createCustomVideoTrack(video_encoded_image_sender_, false, agora::base::CC_DISABLED);
+  connection->GetLocalUser()->PublishVideoTrack(customVideoTrack);
+
+  // Anything but IVF is taken as a raw OBU stream.
+  VideoFileFormat format = IvfFileParser::IsIvfFile(file_path_.c_str()) ? VideoFileFormat::kIvf
+                                                                        : VideoFileFormat::kAv1Obu;
+  return OpenIndexedVideoFile(file_path_, format, &corpus_);
+}
+
+void VideoAv1FileSender::sendVideoFrames() {
+  if (!corpus_) {
+    return;
   }
-  video_encoded_image_sender_->sendEncodedVideoImage(reinterpret_cast<uint8_t*>(buffer.get()),
-                                                     bufdatalen, videoEncodedFrameInfo);
+  agora::rtc::EncodedVideoFrameInfo videoEncodedFrameInfo;
+  videoEncodedFrameInfo.width = corpus_->width();
+  videoEncodedFrameInfo.height = corpus_->height();
+  videoEncodedFrameInfo.rotation = agora::rtc::VIDEO_ORIENTATION_0;
+  videoEncodedFrameInfo.codecType = kVideoCodecAv1;
+  videoEncodedFrameInfo.framesPerSecond = corpus_->framesPerSecond();
+  SendIndexedVideoFrames(video_encoded_image_sender_.get(), *corpus_, videoEncodedFrameInfo,
+                         loops_);
 
-  AGO_LOG("Total read length %d, total send lenth %d\n", totalLength, totalSendLenth);
+  AGO_LOG("Total send %zu frames, %zu bytes per loop\n", corpus_->size(), corpus_->bytes());
 }
 
 struct VideoPacket {
@@ -293,8 +321,10 @@ bool VideoH264FramesSender::sendOneFrame(struct VideoPacket* videoPacket) {
   size_t payload_size = videoPacket->size;
 
   agora::rtc::EncodedVideoFrameInfo videoEncodedFrameInfo;
+  videoEncodedFrameInfo.width = width_;
+  videoEncodedFrameInfo.height = height_;
   videoEncodedFrameInfo.codecType = agora::rtc::VIDEO_CODEC_H264;
-  videoEncodedFrameInfo.framesPerSecond = 15;
+  videoEncodedFrameInfo.framesPerSecond = (frameRateNum_ + frameRateDen_ / 2) / frameRateDen_;
   videoEncodedFrameInfo.frameType = videoPacket->flags & 0x1
                                         ? agora::rtc::VIDEO_FRAME_TYPE_KEY_FRAME
                                         : agora::rtc::VIDEO_FRAME_TYPE_DELTA_FRAME;
@@ -304,32 +334,43 @@ bool VideoH264FramesSender::sendOneFrame(struct VideoPacket* videoPacket) {
 }
 
 void VideoH264FramesSender::sendVideoFrames() {
-  struct VideoPacket videoPacket;
   int numFrames = sizeof(foreman_frames) / sizeof(foreman_frames[0]);
-  for (int i = 0; i < numFrames; ++i) {
-    if (i % 3 != 0) {
-      std::this_thread::sleep_for(std::chrono::milliseconds(67));
-    } else {
-      std::this_thread::sleep_for(std::chrono::milliseconds(66));
-    }
-    videoPacket.data = foreman_frames[i].frame_data;
-    videoPacket.size = foreman_frames[i].frame_len;
-    if (i % 30 == 0) {
-      videoPacket.flags = 1;
-    } else {
-      videoPacket.flags = 0;
-    }
+  // The built-in clip is 15 fps, unless its SPS says otherwise.
+  H264ParameterSets parameterSets;
+  for (int i = 0; i < numFrames && !parameterSets.lastSps(); ++i) {
+    parameterSets.update(foreman_frames[i].frame_data, foreman_frames[i].frame_len);
+  }
+  if (const H264Sps* sps = parameterSets.lastSps()) {
+    width_ = sps->width;
+    height_ = sps->height;
+    GetH264FrameRate(*sps, &frameRateNum_, &frameRateDen_);
+  }
+  AGO_LOG("Begin to send h264 frames, width %d, height %d, frame_rate %u/%u\n", width_, height_,
+          frameRateNum_, frameRateDen_);
 
-    if (i % 3 != 0) {
-      videoPacket.timestamp += 67;
-    } else {
-      videoPacket.timestamp += 66;
-    }
-    sendBytes_ += foreman_frames[i].frame_len;
-    ++sendNumFrames_;
-    if (!sendOneFrame(&videoPacket)) {
-      AGO_LOG("Send video stream failed\n");
-      break;
+  struct VideoPacket videoPacket;
+  // Every pass continues the frame count, so the timeline runs on.
+  auto startTime = std::chrono::steady_clock::now();
+  int64_t sentFrames = 0;
+  for (int loop = 0; loops_ < 0 || loop < loops_; ++loop) {
+    for (int i = 0; i < numFrames; ++i) {
+      int64_t ptsUs = (sentFrames + 1) * 1000000 * frameRateDen_ / frameRateNum_;
+      std::this_thread::sleep_until(startTime + std::chrono::microseconds(ptsUs));
+      ++sentFrames;
+      videoPacket.data = foreman_frames[i].frame_data;
+      videoPacket.size = foreman_frames[i].frame_len;
+      if (i % 30 == 0) {
+        videoPacket.flags = 1;
+      } else {
+        videoPacket.flags = 0;
+      }
+      videoPacket.timestamp = ptsUs / 1000;
+      sendBytes_ += foreman_frames[i].frame_len;
+      ++sendNumFrames_;
+      if (!sendOneFrame(&videoPacket)) {
+        AGO_LOG("Send video stream failed\n");
+        return;
+      }
     }
   }
 }
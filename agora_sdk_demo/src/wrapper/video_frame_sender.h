@@ -6,6 +6,7 @@
 
 #pragma once
 
+#include <memory>
 #include <string>
 
 #include "api2/IAgoraService.h"
@@ -13,6 +14,10 @@
 
 class ConnectionWrapper;
 class H264FileParser;
+class MediaCorpusVideo;
+
+// The SDK headers in this tree predate AV1, newer SDKs number it 12.
+const agora::rtc::VIDEO_CODEC_TYPE kVideoCodecAv1 = static_cast<agora::rtc::VIDEO_CODEC_TYPE>(12);
 
 class VideoFrameSender {
  public:
@@ -29,11 +34,21 @@ class VideoVP8FrameSender {
                   agora::agora_refptr<agora::rtc::IMediaNodeFactory> factory,
                   std::shared_ptr<ConnectionWrapper> connection);
 
+  // Plays the file |loops| times back to back on one timeline, with the
+  // timestamps of every pass following on from the one before. Negative
+  // loops forever, which is the default.
+  void setLoops(int loops) { loops_ = loops; }
+
   void sendVideoFrames();
 
+  // The shared file being played, which stays loaded while held.
+  std::shared_ptr<const MediaCorpusVideo> corpus() const { return corpus_; }
+
  private:
   std::string file_path_;
   agora::agora_refptr<agora::rtc::IVideoEncodedImageSender> video_encoded_image_sender_;
+  std::shared_ptr<const MediaCorpusVideo> corpus_;
+  int loops_{-1};
 };
 
 class VideoH264FileSender {
@@ -41,16 +56,83 @@ class VideoH264FileSender {
   VideoH264FileSender(const char* filepath);
   virtual ~VideoH264FileSender();
 
+  // Reads the file live instead of from the media corpus, see
+  // H264FileParser::setLiveInput(), and sends every access unit the moment
+  // it is complete. The writer sets the pace. Call before initialize().
+  void setLiveInput(bool follow);
+
   bool initialize(agora::base::IAgoraService* service,
                   agora::agora_refptr<agora::rtc::IMediaNodeFactory> factory,
                   std::shared_ptr<ConnectionWrapper> connection);
 
+  // Plays the file |loops| times, see VideoVP8FrameSender::setLoops().
+  void setLoops(int loops) { loops_ = loops; }
+
   void sendVideoFrames();
 
+  // The shared file being played, which stays loaded while held.
+  std::shared_ptr<const MediaCorpusVideo> corpus() const { return corpus_; }
+
+ private:
+  void sendLiveFrames();
+
  private:
   std::string file_path_;
   agora::agora_refptr<agora::rtc::IVideoEncodedImageSender> video_encoded_image_sender_;
-  std::unique_ptr<H264FileParser> file_parser_;
+  std::shared_ptr<const MediaCorpusVideo> corpus_;
+  bool live_{false};
+  bool follow_{false};
+  std::unique_ptr<H264FileParser> live_parser_;
+  int loops_{1};
+};
+
+class VideoH265FileSender {
+ public:
+  VideoH265FileSender(const char* filepath);
+  virtual ~VideoH265FileSender();
+
+  bool initialize(agora::base::IAgoraService* service,
+                  agora::agora_refptr<agora::rtc::IMediaNodeFactory> factory,
+                  std::shared_ptr<ConnectionWrapper> connection);
+
+  // Plays the file |loops| times, see VideoVP8FrameSender::setLoops().
+  void setLoops(int loops) { loops_ = loops; }
+
+  void sendVideoFrames();
+
+  // The shared file being played, which stays loaded while held.
+  std::shared_ptr<const MediaCorpusVideo> corpus() const { return corpus_; }
+
+ private:
+  std::string file_path_;
+  agora::agora_refptr<agora::rtc::IVideoEncodedImageSender> video_encoded_image_sender_;
+  std::shared_ptr<const MediaCorpusVideo> corpus_;
+  int loops_{1};
+};
+
+// Sends an AV1 file, either a raw OBU stream or an IVF file.
+class VideoAv1FileSender {
+ public:
+  VideoAv1FileSender(const char* filepath);
+  virtual ~VideoAv1FileSender();
+
+  bool initialize(agora::base::IAgoraService* service,
+                  agora::agora_refptr<agora::rtc::IMediaNodeFactory> factory,
+                  std::shared_ptr<ConnectionWrapper> connection);
+
+  // Plays the file |loops| times, see VideoVP8FrameSender::setLoops().
+  void setLoops(int loops) { loops_ = loops; }
+
+  void sendVideoFrames();
+
+  // The shared file being played, which stays loaded while held.
+  std::shared_ptr<const MediaCorpusVideo> corpus() const { return corpus_; }
+
+ private:
+  std::string file_path_;
+  agora::agora_refptr<agora::rtc::IVideoEncodedImageSender> video_encoded_image_sender_;
+  std::shared_ptr<const MediaCorpusVideo> corpus_;
+  int loops_{1};
 };
 
 struct VideoPacket;
@@ -64,6 +146,9 @@ class VideoH264FramesSender {
                   agora::agora_refptr<agora::rtc::IMediaNodeFactory> factory,
                   std::shared_ptr<ConnectionWrapper> connection);
 
+  // Plays the built-in clip |loops| times, see VideoVP8FrameSender::setLoops().
+  void setLoops(int loops) { loops_ = loops; }
+
   void sendVideoFrames();
 
   int getSentFrameNum() { return sendNumFrames_; }
@@ -75,5 +160,11 @@ class VideoH264FramesSender {
  private:
   int sendBytes_{0};
   int sendNumFrames_{0};
+  // Taken from the SPS of the clip when it tells.
+  int width_{0};
+  int height_{0};
+  uint32_t frameRateNum_{15};
+  uint32_t frameRateDen_{1};
   agora::agora_refptr<agora::rtc::IVideoEncodedImageSender> video_encoded_image_sender_;
+  int loops_{1};
 };
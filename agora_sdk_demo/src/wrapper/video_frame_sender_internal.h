@@ -5,6 +5,7 @@
 //
 
 #pragma once
+#include <stddef.h>
 #include <stdint.h>
 
 namespace webrtc {
@@ -39,22 +40,3 @@ const uint8_t kNaluTypeMask = 0x1F;
 const size_t kNaluTypeSize = 1;
 
 inline NaluType ParseNaluType(uint8_t data) { return static_cast<NaluType>(data & kNaluTypeMask); }
-
-struct IVF_HEADER {
-  uint32_t signature;
-  uint16_t version;
-  uint16_t head_len;
-  uint32_t codec;
-  uint16_t width;
-  uint16_t height;
-  uint32_t time_scale;
-  uint32_t frame_rate;
-  uint32_t frames;
-  uint32_t unused;
-};
-
-struct IVF_PAYLOAD {
-  uint32_t length;
-  uint32_t frame_type;
-  uint64_t timestamp;
-};
@@ -17,7 +17,9 @@
 #include "media_data_receiver.h"
 #include "media_data_sender.h"
 #include "media_send_task.h"
+#include "wrapper/media_corpus.h"
 #include "wrapper/utils.h"
+#include "wrapper/video_frame_sender.h"
 
 static agora::base::IAgoraService* sService = nullptr;
 
@@ -36,11 +38,18 @@ static int recvType = 0;
 static bool mediaPacket = false;
 static std::string connection_test_cname = CONNECTION_TEST_DEFAULT_CNAME;
 static bool startRecorder = false;
+static std::string containerFile;
+static std::string liveAudioPath;
+static std::string liveVideoPath;
+static bool followLiveInput = false;
+static bool seamlessLoop = false;
+static int preloadThreads = 0;
+static int g711PacketMs = 0;
 
 void parseArgs(int argc, char* argv[]) {
   char* ptr = nullptr;
   int ch = 0;
-  while ((ch = getopt(argc, argv, "a:v:j:d:hm:n:u:s:r:pc:l")) != -1) {
+  while ((ch = getopt(argc, argv, "a:v:j:d:hm:n:u:s:r:pc:lf:A:V:FLP:G:")) != -1) {
     switch (ch) {
       case 'a':
         audioCodec = atoi(optarg);
@@ -86,11 +95,45 @@ void parseArgs(int argc, char* argv[]) {
       case 'l':
         startRecorder = true;
         break;
+      case 'f':
+        containerFile = optarg;
+        break;
+      case 'A':
+        liveAudioPath = optarg;
+        break;
+      case 'V':
+        liveVideoPath = optarg;
+        break;
+      case 'F':
+        followLiveInput = true;
+        break;
+      case 'L':
+        seamlessLoop = true;
+        break;
+      case 'P':
+        preloadThreads = atoi(optarg);
+        break;
+      case 'G':
+        g711PacketMs = atoi(optarg);
+        break;
       case '?':
         printf("Unknown option: %c\n", static_cast<char>(optopt));
         break;
     }
   }
+  if (liveAudioPath == "-" && liveVideoPath == "-") {
+    printf("Only one live input can read stdin, dropping the video\n");
+    liveVideoPath.clear();
+  }
+  if ((!liveAudioPath.empty() || !liveVideoPath.empty()) && concurrency > 1) {
+    // A stream can be read only once.
+    printf("Live input sends from a single thread\n");
+    concurrency = 1;
+  }
+  if (g711PacketMs != 0 && g711PacketMs != 10 && g711PacketMs != 20) {
+    printf("G.711 packets last 10 or 20 ms, using 20 ms\n");
+    g711PacketMs = 20;
+  }
   printf("Concurrency %d, cycles %d\n", concurrency, cycles);
 }
 
@@ -112,6 +155,9 @@ agora::rtc::AUDIO_CODEC_TYPE getAudioCodecType(int audioCodec) {
     case 3:
       audioCodecType = agora::rtc::AUDIO_CODEC_PCMU;
       break;
+    case 4:
+      audioCodecType = agora::rtc::AUDIO_CODEC_PCMA;
+      break;
     case 7:
       audioCodecType = agora::rtc::AUDIO_CODEC_AACLC;
       break;
@@ -134,6 +180,8 @@ enum VIDEO_CODEC_TYPE {
   VIDEO_CODEC_VP8 = 1,
   /** 2: h264. */
   VIDEO_CODEC_H264 = 2,
+  /** 3: h265. */
+  VIDEO_CODEC_H265 = 3,
   /** 5: VP9. */
   VIDEO_CODEC_VP9 = 5,
   // kVideoCodecI420,
@@ -154,6 +202,12 @@ agora::rtc::VIDEO_CODEC_TYPE getVideoCodecType(int videoCodec) {
     case 2:
       videoCodecType = agora::rtc::VIDEO_CODEC_H264;
       break;
+    case 3:
+      videoCodecType = agora::rtc::VIDEO_CODEC_H265;
+      break;
+    case 4:
+      videoCodecType = kVideoCodecAv1;
+      break;
   }
   return videoCodecType;
 }
@@ -172,7 +226,26 @@ void startConcurrentSend() {
         sendAudio, sendVideo, mediaPacket, 2 * (i + startUid) + 3);
     task->setAudioCodecType(getAudioCodecType(audioCodec));
     task->setVideoCodecType(getVideoCodecType(videoCodec), multiSlice);
+    if (!containerFile.empty()) {
+      task->setContainerFile(containerFile);
+    }
+    task->setSeamlessLoop(seamlessLoop);
+    task->setG711PacketMs(g711PacketMs);
+    if (!liveAudioPath.empty() || !liveVideoPath.empty()) {
+      task->setLiveInput(liveAudioPath, liveVideoPath, followLiveInput);
+    }
     tasks.push_back(task);
+  }
+
+  // The test files load while the tasks connect. A task that is ready first
+  // waits only for the files it plays.
+  MediaCorpusPreloader preloader(preloadThreads);
+  for (const auto& task : tasks) {
+    task->addCorpusFiles(&preloader);
+  }
+  preloader.start();
+
+  for (const auto& task : tasks) {
     std::thread* systhread = new std::thread(std::bind(&MediaSendTask::Run, task.get()));
     sysThreads.push_back(systhread);
 
@@ -13,6 +13,7 @@
 #include "utils/file_parser/fixed_frame_length_audio_file_parser.h"
 #include "wrapper/audio_frame_sender.h"
 #include "wrapper/connection_wrapper.h"
+#include "wrapper/container_file_sender.h"
 #include "wrapper/local_user_wrapper.h"
 #include "wrapper/media_packet_sender.h"
 #include "wrapper/statistic_dump.h"
@@ -44,12 +45,18 @@ bool MediaDataSender::connect(const char* channelId, agora::user_id_t userId) {
   return true;
 }
 
-void MediaDataSender::sendEncodedAudioFile(const char* filepath, AUDIO_FILE_TYPE filetype) {
+void MediaDataSender::sendEncodedAudioFile(const char* filepath, AUDIO_FILE_TYPE filetype,
+                                           int packetFrames) {
   auto frame_sender = std::make_shared<EncodedAudioFrameSender>(filepath, filetype);
+  frame_sender->setPacketFrames(packetFrames);
+  if (loops_ != 0) {
+    frame_sender->setLoops(loops_);
+  }
   if (!frame_sender->initialize(service_, factory_, connection_)) {
     printf("Initialize test file %s for sending successfully\n", filepath);
     return;
   }
+  audioCorpus_ = frame_sender->corpus();
   frame_sender->sendAudioFrames();
 }
 
@@ -65,13 +72,24 @@ void MediaDataSender::sendAudioOpusFile(const char* filepath) {
   sendEncodedAudioFile(filepath, AUDIO_FILE_TYPE::AUDIO_FILE_OPUS);
 }
 
+void MediaDataSender::sendAudioG711File(const char* filepath, bool muLaw, int packetMs) {
+  // The parser encodes 10 ms per frame.
+  sendEncodedAudioFile(filepath,
+                       muLaw ? AUDIO_FILE_TYPE::AUDIO_FILE_PCMU : AUDIO_FILE_TYPE::AUDIO_FILE_PCMA,
+                       packetMs > 10 ? packetMs / 10 : 1);
+}
+
 void MediaDataSender::sendAudioPcmFile(const char* filepath) {
   auto frame_sender = std::make_shared<AudioPcmFrameSender>(filepath);
+  if (loops_ != 0) {
+    frame_sender->setLoops(loops_);
+  }
   if (!frame_sender->initialize(service_, factory_, connection_)) {
     printf("Initialize test file %s for sending successfully\n", filepath);
     return;
   }
   printf("Open test file %s successfully\n", filepath);
+  audioCorpus_ = frame_sender->corpus();
   frame_sender->sendAudioFrames();
 }
 
@@ -90,18 +108,49 @@ void MediaDataSender::sendAudioMediaPacket() {
 
 void MediaDataSender::sendVideoVp8File(const char* filepath) {
   std::unique_ptr<VideoVP8FrameSender> video_frame_sender(new VideoVP8FrameSender(filepath));
+  if (loops_ != 0) {
+    video_frame_sender->setLoops(loops_);
+  }
   video_frame_sender->initialize(service_, factory_, connection_);
+  videoCorpus_ = video_frame_sender->corpus();
   video_frame_sender->sendVideoFrames();
 }
 
 void MediaDataSender::sendVideoH264File(const char* filepath) {
   std::unique_ptr<VideoH264FileSender> video_frame_sender(new VideoH264FileSender(filepath));
+  if (loops_ != 0) {
+    video_frame_sender->setLoops(loops_);
+  }
   video_frame_sender->initialize(service_, factory_, connection_);
+  videoCorpus_ = video_frame_sender->corpus();
+  video_frame_sender->sendVideoFrames();
+}
+
+void MediaDataSender::sendVideoH265File(const char* filepath) {
+  std::unique_ptr<VideoH265FileSender> video_frame_sender(new VideoH265FileSender(filepath));
+  if (loops_ != 0) {
+    video_frame_sender->setLoops(loops_);
+  }
+  video_frame_sender->initialize(service_, factory_, connection_);
+  videoCorpus_ = video_frame_sender->corpus();
+  video_frame_sender->sendVideoFrames();
+}
+
+void MediaDataSender::sendVideoAv1File(const char* filepath) {
+  std::unique_ptr<VideoAv1FileSender> video_frame_sender(new VideoAv1FileSender(filepath));
+  if (loops_ != 0) {
+    video_frame_sender->setLoops(loops_);
+  }
+  video_frame_sender->initialize(service_, factory_, connection_);
+  videoCorpus_ = video_frame_sender->corpus();
   video_frame_sender->sendVideoFrames();
 }
 
 void MediaDataSender::sendVideo() {
   std::unique_ptr<VideoH264FramesSender> video_frame_sender(new VideoH264FramesSender());
+  if (loops_ != 0) {
+    video_frame_sender->setLoops(loops_);
+  }
   video_frame_sender->initialize(service_, factory_, connection_);
   video_frame_sender->sendVideoFrames();
 
@@ -122,3 +171,44 @@ void MediaDataSender::sendVideoMediaPacket() {
   packet_sender->initialize(service_, factory_, connection_);
   packet_sender->sendPackets();
 }
+
+void MediaDataSender::sendLiveAudio(const char* filepath, AUDIO_FILE_TYPE filetype, bool follow,
+                                    int packetFrames) {
+  std::unique_ptr<AudioFrameSender> frame_sender;
+  if (filetype == AUDIO_FILE_TYPE::AUDIO_FILE_PCM) {
+    frame_sender.reset(new AudioPcmFrameSender(filepath));
+  } else {
+    std::unique_ptr<EncodedAudioFrameSender> encoded_sender(
+        new EncodedAudioFrameSender(filepath, filetype));
+    encoded_sender->setPacketFrames(packetFrames);
+    frame_sender = std::move(encoded_sender);
+  }
+  frame_sender->setLiveInput(follow);
+  if (!frame_sender->initialize(service_, factory_, connection_)) {
+    printf("Initialize live input %s for sending failed\n", filepath);
+    return;
+  }
+  frame_sender->sendAudioFrames();
+}
+
+void MediaDataSender::sendLiveVideoH264(const char* filepath, bool follow) {
+  std::unique_ptr<VideoH264FileSender> video_frame_sender(new VideoH264FileSender(filepath));
+  video_frame_sender->setLiveInput(follow);
+  if (!video_frame_sender->initialize(service_, factory_, connection_)) {
+    printf("Initialize live input %s for sending failed\n", filepath);
+    return;
+  }
+  video_frame_sender->sendVideoFrames();
+}
+
+void MediaDataSender::sendContainerFile(const char* filepath, bool sendAudio, bool sendVideo) {
+  std::unique_ptr<ContainerFileSender> frame_sender(
+      new ContainerFileSender(filepath, sendAudio, sendVideo));
+  if (loops_ != 0) {
+    frame_sender->setLoops(loops_);
+  }
+  if (!frame_sender->initialize(service_, factory_, connection_)) {
+    return;
+  }
+  frame_sender->sendFrames();
+}
@@ -15,6 +15,8 @@
 
 class AudioFileParser;
 class ConnectionWrapper;
+class MediaCorpusAudio;
+class MediaCorpusVideo;
 
 class MediaDataSender {
  public:
@@ -23,22 +25,42 @@ class MediaDataSender {
   virtual ~MediaDataSender();
 
   void setVerbose(bool verbose);
+  // Every file sender created from now on plays its file |loops| times in one
+  // go, forever if negative, see AudioFrameSender::setLoops(). 0 leaves each
+  // sender at its default.
+  void setLoops(int loops) { loops_ = loops; }
   bool connect(const char* channelId, agora::user_id_t userId);
 
   void sendAudioAACFile(const char* filepath, bool heaac);
   void sendAudioOpusFile(const char* filepath);
 
   void sendAudioPcmFile(const char* filepath);
+  // Encodes a WAV file to G.711 mu-law or A-law while it plays and sends it
+  // in packets of |packetMs| milliseconds, a multiple of 10.
+  void sendAudioG711File(const char* filepath, bool muLaw, int packetMs);
   void sendAudioMediaPacket();
 
   void sendVideo();
   void sendVideoVp8File(const char* filepath);
   void sendVideoH264File(const char* filepath);
+  void sendVideoH265File(const char* filepath);
+  void sendVideoAv1File(const char* filepath);
   void sendVideoMediaPacket();
 
+  // Sends the audio and/or video track of a container file such as an MP4.
+  void sendContainerFile(const char* filepath, bool sendAudio, bool sendVideo);
+
+  // Send a stream while it is still being written, "-" reads stdin. With
+  // |follow| a regular file is played as it grows. Encoded frames go out
+  // |packetFrames| at a time.
+  void sendLiveAudio(const char* filepath, AUDIO_FILE_TYPE filetype, bool follow,
+                     int packetFrames = 1);
+  void sendLiveVideoH264(const char* filepath, bool follow);
+
  private:
   agora::agora_refptr<agora::rtc::IAudioEncodedFrameSender> createAudioEncodedFrameSender();
-  void sendEncodedAudioFile(const char* filepath, AUDIO_FILE_TYPE filetype);
+  void sendEncodedAudioFile(const char* filepath, AUDIO_FILE_TYPE filetype,
+                            int packetFrames = 1);
 
  protected:
   int uid_;
@@ -52,5 +74,10 @@ class MediaDataSender {
 
   int sentNumVideoFrames_{0};
 
+  // The files played last stay loaded in the media corpus for the next round.
+  std::shared_ptr<const MediaCorpusAudio> audioCorpus_;
+  std::shared_ptr<const MediaCorpusVideo> videoCorpus_;
+
   bool verbose_{false};
+  int loops_{0};
 };
@@ -5,9 +5,27 @@
 //
 #include "media_send_task.h"
 
+#include <thread>
+
 #include "media_data_sender.h"
+#include "utils/file_parser/ivf_file_parser.h"
+#include "wrapper/media_corpus.h"
 #include "wrapper/statistic_dump.h"
 #include "wrapper/utils.h"
+#include "wrapper/video_frame_sender.h"
+
+namespace {
+
+const char kAacFile[] = "test_data/aac.aac";
+const char kHeAacFile[] = "test_data/he_aac.aac";
+const char kPcmFile[] = "test_data/test.wav";
+const char kOpusFile[] = "test_data/ehren-paper_lights-96.opus";
+const char kVp8File[] = "test_data/test.vp8.ivf";
+const char kH264File[] = "test_data/test_multi_slice.h264";
+const char kH265File[] = "test_data/test.h265";
+const char kAv1File[] = "test_data/test.av1.obu";
+
+}  // namespace
 
 MediaSendTask::MediaSendTask(agora::base::IAgoraService* service, std::string threadName,
                              int cycles, bool sendAudio, bool sendVideo, bool sendMediaPacket,
@@ -21,6 +39,7 @@ MediaSendTask::MediaSendTask(agora::base::IAgoraService* service, std::string th
       audioCodec_(agora::rtc::AUDIO_CODEC_OPUS),
       videoCodec_(agora::rtc::VIDEO_CODEC_H264),
       multiSlice_(false),
+      follow_(false),
       uid_(uid) {}
 
 MediaSendTask::~MediaSendTask() {}
@@ -34,6 +53,174 @@ void MediaSendTask::setVideoCodecType(agora::rtc::VIDEO_CODEC_TYPE videoCodec, b
   multiSlice_ = multiSlice;
 }
 
+void MediaSendTask::setContainerFile(const std::string& filepath) { containerFile_ = filepath; }
+
+void MediaSendTask::setLiveInput(const std::string& audioPath, const std::string& videoPath,
+                                 bool follow) {
+  liveAudioPath_ = audioPath;
+  liveVideoPath_ = videoPath;
+  follow_ = follow;
+}
+
+void MediaSendTask::addCorpusFiles(MediaCorpusPreloader* preloader) const {
+  // Media packets, container files and live streams don't go through the
+  // corpus.
+  if (mediaPacket_ || !containerFile_.empty() || !liveAudioPath_.empty() ||
+      !liveVideoPath_.empty()) {
+    return;
+  }
+  if (sendAudio_) {
+    switch (audioCodec_) {
+      case agora::rtc::AUDIO_CODEC_AACLC:
+        preloader->addAudio(kAacFile, AUDIO_FILE_TYPE::AUDIO_FILE_AACLC);
+        break;
+      case agora::rtc::AUDIO_CODEC_HEAAC:
+        preloader->addAudio(kHeAacFile, AUDIO_FILE_TYPE::AUDIO_FILE_HEAAC);
+        break;
+      case agora::rtc::AUDIO_CODEC_PCMU:
+        preloader->addAudio(kPcmFile, g711PacketMs_ > 0 ? AUDIO_FILE_TYPE::AUDIO_FILE_PCMU
+                                                        : AUDIO_FILE_TYPE::AUDIO_FILE_PCM);
+        break;
+      case agora::rtc::AUDIO_CODEC_PCMA:
+        preloader->addAudio(kPcmFile, g711PacketMs_ > 0 ? AUDIO_FILE_TYPE::AUDIO_FILE_PCMA
+                                                        : AUDIO_FILE_TYPE::AUDIO_FILE_PCM);
+        break;
+      case agora::rtc::AUDIO_CODEC_OPUS:
+        preloader->addAudio(kOpusFile, AUDIO_FILE_TYPE::AUDIO_FILE_OPUS);
+        break;
+      default:
+        break;
+    }
+  }
+  if (sendVideo_) {
+    switch (static_cast<int>(videoCodec_)) {
+      case agora::rtc::VIDEO_CODEC_VP8:
+        preloader->addVideo(kVp8File, VideoFileFormat::kIvf);
+        break;
+      case agora::rtc::VIDEO_CODEC_H264:
+        // Without multiple slices the frames are built in.
+        if (multiSlice_) {
+          preloader->addVideo(kH264File, VideoFileFormat::kH264AnnexB);
+        }
+        break;
+      case agora::rtc::VIDEO_CODEC_H265:
+        preloader->addVideo(kH265File, VideoFileFormat::kH265AnnexB);
+        break;
+      case kVideoCodecAv1:
+        preloader->addVideo(kAv1File, IvfFileParser::IsIvfFile(kAv1File)
+                                          ? VideoFileFormat::kIvf
+                                          : VideoFileFormat::kAv1Obu);
+        break;
+      default:
+        break;
+    }
+  }
+}
+
+void MediaSendTask::sendLive(MediaDataSender* sender) {
+  // Live tracks arrive side by side, so each one gets its own thread.
+  std::thread audioThread;
+  if (!liveAudioPath_.empty()) {
+    AUDIO_FILE_TYPE filetype = AUDIO_FILE_TYPE::AUDIO_FILE_OPUS;
+    int packetFrames = 1;
+    switch (audioCodec_) {
+      case agora::rtc::AUDIO_CODEC_AACLC:
+        filetype = AUDIO_FILE_TYPE::AUDIO_FILE_AACLC;
+        break;
+      case agora::rtc::AUDIO_CODEC_HEAAC:
+        filetype = AUDIO_FILE_TYPE::AUDIO_FILE_HEAAC;
+        break;
+      case agora::rtc::AUDIO_CODEC_PCMU:
+      case agora::rtc::AUDIO_CODEC_PCMA:
+        if (g711PacketMs_ > 0) {
+          // The G.711 parser encodes 10 ms per frame.
+          filetype = audioCodec_ == agora::rtc::AUDIO_CODEC_PCMU
+                         ? AUDIO_FILE_TYPE::AUDIO_FILE_PCMU
+                         : AUDIO_FILE_TYPE::AUDIO_FILE_PCMA;
+          packetFrames = g711PacketMs_ / 10;
+        } else {
+          filetype = AUDIO_FILE_TYPE::AUDIO_FILE_PCM;
+        }
+        break;
+      default:
+        break;
+    }
+    printf("Start to send live audio %s in thread %s\n", liveAudioPath_.c_str(),
+           threadName_.c_str());
+    audioThread = std::thread([this, sender, filetype, packetFrames] {
+      sender->sendLiveAudio(liveAudioPath_.c_str(), filetype, follow_, packetFrames);
+    });
+  }
+  if (!liveVideoPath_.empty()) {
+    printf("Start to send live video %s in thread %s\n", liveVideoPath_.c_str(),
+           threadName_.c_str());
+    sender->sendLiveVideoH264(liveVideoPath_.c_str(), follow_);
+  }
+  if (audioThread.joinable()) {
+    audioThread.join();
+  }
+  printf("Live input ended in thread %s\n", threadName_.c_str());
+}
+
+void MediaSendTask::sendAudio(MediaDataSender* audioVideoSender, int round) {
+  printf("Start to send audio of round %d in thread %s\n", round, threadName_.c_str());
+  if (mediaPacket_)
+    audioVideoSender->sendAudioMediaPacket();
+  else {
+    switch (audioCodec_) {
+      case agora::rtc::AUDIO_CODEC_AACLC:
+        audioVideoSender->sendAudioAACFile(kAacFile, false);
+        break;
+      case agora::rtc::AUDIO_CODEC_HEAAC:
+        audioVideoSender->sendAudioAACFile(kHeAacFile, true);
+        break;
+      case agora::rtc::AUDIO_CODEC_PCMU:
+      case agora::rtc::AUDIO_CODEC_PCMA:
+        if (g711PacketMs_ > 0) {
+          audioVideoSender->sendAudioG711File(
+              kPcmFile, audioCodec_ == agora::rtc::AUDIO_CODEC_PCMU, g711PacketMs_);
+        } else {
+          audioVideoSender->sendAudioPcmFile(kPcmFile);
+        }
+        break;
+      case agora::rtc::AUDIO_CODEC_OPUS:
+        audioVideoSender->sendAudioOpusFile(kOpusFile);
+        break;
+      default:
+        break;
+    }
+  }
+}
+
+void MediaSendTask::sendVideo(MediaDataSender* audioVideoSender, int round) {
+  printf("Start to send video of round %d in thread %s\n", round, threadName_.c_str());
+  if (mediaPacket_)
+    audioVideoSender->sendVideoMediaPacket();
+  else {
+    // Switch on the value, AV1 is outside of the SDK enum.
+    switch (static_cast<int>(videoCodec_)) {
+      case agora::rtc::VIDEO_CODEC_VP8:
+        audioVideoSender->sendVideoVp8File(kVp8File);
+        break;
+      case agora::rtc::VIDEO_CODEC_H264:
+        if (multiSlice_) {
+          audioVideoSender->sendVideoH264File(kH264File);
+        } else {
+          audioVideoSender->sendVideo();
+        }
+        break;
+      case agora::rtc::VIDEO_CODEC_H265:
+        audioVideoSender->sendVideoH265File(kH265File);
+        break;
+      case kVideoCodecAv1:
+        audioVideoSender->sendVideoAv1File(kAv1File);
+        break;
+      default:
+        break;
+    }
+  }
+}
+
 void MediaSendTask::Run() {
   printf("To connect channel %s in thread %s, pid %d, tid %ld\n", threadName_.c_str(),
          threadName_.c_str(), getpid(), gettid());
@@ -44,52 +231,39 @@ void MediaSendTask::Run() {
   if (connected) {
     printf("Connect successfully in channel name %s, uid %s to send stream cycles_ %d\n",
            threadName_.c_str(), buf, cycles_);
-    for (int i = 0; i < cycles_; ++i) {
-      if (sendAudio_) {
-        printf("Start to send audio of round %d in thread %s\n", i, threadName_.c_str());
-        if (mediaPacket_)
-          audioVideoSender->sendAudioMediaPacket();
-        else {
-          switch (audioCodec_) {
-            case agora::rtc::AUDIO_CODEC_AACLC:
-              audioVideoSender->sendAudioAACFile("test_data/aac.aac", false);
-              break;
-            case agora::rtc::AUDIO_CODEC_HEAAC:
-              audioVideoSender->sendAudioAACFile("test_data/he_aac.aac", true);
-              break;
-            case agora::rtc::AUDIO_CODEC_PCMU:
-              audioVideoSender->sendAudioPcmFile("test_data/test.wav");
-              break;
-            case agora::rtc::AUDIO_CODEC_OPUS:
-              audioVideoSender->sendAudioOpusFile(
-                  "test_data/ehren-paper_lights-96.opus");
-              break;
-            default:
-              break;
-          }
-        }
+    if (!liveAudioPath_.empty() || !liveVideoPath_.empty()) {
+      // A live stream plays once, the writer decides how long.
+      sendLive(audioVideoSender.get());
+      StatisticDump::dumpThreadFinalStats(gettid());
+      return;
+    }
+    int rounds = cycles_;
+    if (seamlessLoop_ && !mediaPacket_) {
+      // One round, in which each sender loops over its file.
+      audioVideoSender->setLoops(cycles_ > 0 ? cycles_ : -1);
+      rounds = 1;
+    }
+    for (int i = 0; i < rounds; ++i) {
+      if (!containerFile_.empty() && !mediaPacket_) {
+        printf("Start to send %s of round %d in thread %s\n", containerFile_.c_str(), i,
+               threadName_.c_str());
+        audioVideoSender->sendContainerFile(containerFile_.c_str(), sendAudio_, sendVideo_);
+        printf("Send audio/video of round %d end in thread %s\n", i, threadName_.c_str());
+        continue;
       }
-
-      if (sendVideo_) {
-        printf("Start to send video of round %d in thread %s\n", i, threadName_.c_str());
-        if (mediaPacket_)
-          audioVideoSender->sendVideoMediaPacket();
-        else {
-          switch (videoCodec_) {
-            case agora::rtc::VIDEO_CODEC_VP8:
-              audioVideoSender->sendVideoVp8File("test_data/test.vp8.ivf");
-              break;
-            case agora::rtc::VIDEO_CODEC_H264:
-              if (multiSlice_) {
-                audioVideoSender->sendVideoH264File(
-                    "test_data/test_multi_slice.h264");
-              } else {
-                audioVideoSender->sendVideo();
-              }
-              break;
-            default:
-              break;
-          }
+      if (seamlessLoop_ && sendAudio_ && sendVideo_ && !mediaPacket_) {
+        // Looping senders only return at the end, so the tracks go side by side.
+        std::thread audioThread([this, &audioVideoSender, i] {
+          sendAudio(audioVideoSender.get(), i);
+        });
+        sendVideo(audioVideoSender.get(), i);
+        audioThread.join();
+      } else {
+        if (sendAudio_) {
+          sendAudio(audioVideoSender.get(), i);
+        }
+        if (sendVideo_) {
+          sendVideo(audioVideoSender.get(), i);
         }
       }
       printf("Send audio/video of round %d end in thread %s\n", i, threadName_.c_str());
@@ -9,6 +9,9 @@
 
 #include "api2/IAgoraService.h"
 
+class MediaCorpusPreloader;
+class MediaDataSender;
+
 class MediaSendTask {
  public:
   MediaSendTask(agora::base::IAgoraService* service, std::string threadName, int cycles,
@@ -17,6 +20,27 @@ class MediaSendTask {
   virtual void Run();
   void setAudioCodecType(agora::rtc::AUDIO_CODEC_TYPE audioCodec);
   void setVideoCodecType(agora::rtc::VIDEO_CODEC_TYPE videoCodec, bool multiSlice);
+  // Plays the tracks of |filepath| instead of the elementary test files.
+  void setContainerFile(const std::string& filepath);
+  // Plays live streams instead, see MediaDataSender::sendLiveAudio(). An
+  // empty path leaves that track out. The audio format follows
+  // setAudioCodecType().
+  void setLiveInput(const std::string& audioPath, const std::string& videoPath, bool follow);
+  // Plays every file |cycles| times in a row through the same senders and
+  // tracks instead of setting them up again per round, forever if |cycles|
+  // isn't positive.
+  void setSeamlessLoop(bool seamless) { seamlessLoop_ = seamless; }
+  // Encodes the WAV test file or live input to G.711 while it plays and sends
+  // it in packets of |packetMs| milliseconds, mu-law for AUDIO_CODEC_PCMU and
+  // A-law for AUDIO_CODEC_PCMA. 0 sends the PCM as it is.
+  void setG711PacketMs(int packetMs) { g711PacketMs_ = packetMs; }
+  // Adds the corpus files this task is going to play to |preloader|.
+  void addCorpusFiles(MediaCorpusPreloader* preloader) const;
+
+ private:
+  void sendLive(MediaDataSender* sender);
+  void sendAudio(MediaDataSender* audioVideoSender, int round);
+  void sendVideo(MediaDataSender* audioVideoSender, int round);
 
  private:
   agora::base::IAgoraService* service_;
@@ -28,5 +52,11 @@ class MediaSendTask {
   agora::rtc::AUDIO_CODEC_TYPE audioCodec_;
   agora::rtc::VIDEO_CODEC_TYPE videoCodec_;
   bool multiSlice_;
+  std::string containerFile_;
+  std::string liveAudioPath_;
+  std::string liveVideoPath_;
+  bool follow_;
+  bool seamlessLoop_{false};
+  int g711PacketMs_{0};
   int uid_;
 };